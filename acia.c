@@ -0,0 +1,225 @@
+#include <string.h>
+#include <time.h>
+#include "include/acia.h"
+
+//控制寄存器位 3-0 选择的波特率, 0 是外部时钟, 这里当作不限速
+static const double ACIA_Baud[16] = {
+        0, 50, 75, 109.92, 134.58, 150, 300, 600,
+        1200, 1800, 2400, 3600, 4800, 7200, 9600, 19200,
+};
+
+/**
+ * 按控制寄存器和命令寄存器计算一个字符的周期数: 起始位 + 数据位 + 校验位 + 停止位
+ */
+static void ACIA_Timing(struct ACIA *acia) {
+    double baud = ACIA_Baud[acia->Control & 0x0F];
+    if (baud == 0) {
+        acia->Char_Cycles = 0;
+        return;
+    }
+    int bits = 1 + 8 - ((acia->Control >> 5) & 3) + (acia->Command & ACIA_CMD_PARITY ? 1 : 0)
+               + (acia->Control & 0x80 ? 2 : 1);
+    acia->Char_Cycles = (unsigned long long) (acia->Clock * bits / baud + 0.5);
+}
+
+static void ACIA_Raise(struct ACIA *acia) {
+    acia->Status |= ACIA_ST_IRQ;
+    if (acia->IRQ_Source) {
+        CPU_Set_IRQ(acia->Cpu, acia->IRQ_Source, 1);
+    }
+}
+
+/**
+ * RDR 空、收发器工作时, delay 周期后接收下一个字节
+ */
+static void ACIA_RX_Start(struct ACIA *acia, unsigned long long delay) {
+    if (acia->Rx && acia->Command & ACIA_CMD_DTR && !(acia->Status & (ACIA_ST_RDRF | ACIA_ST_DCD))) {
+        CPU_Timer_Start(acia->Cpu, &acia->RX_Timer, acia->Cpu->Cycles + delay);
+    }
+}
+
+/**
+ * TDR 里有字节、发送器工作时, delay 周期后发出; 已经在发送时不改变时间
+ */
+static void ACIA_TX_Start(struct ACIA *acia, unsigned long long delay) {
+    if (acia->TX_Busy && acia->Command & ACIA_CMD_DTR && acia->Command & ACIA_CMD_TIC && !acia->TX_Timer.Armed) {
+        CPU_Timer_Start(acia->Cpu, &acia->TX_Timer, acia->Cpu->Cycles + delay);
+    }
+}
+
+static void ACIA_RX_Fire(struct CPU_Timer *timer, struct CPU_Context *cpu) {
+    struct ACIA *acia = timer->Ctx;
+    int value = Ring_Get(acia->Rx);
+    if (value >= 0) {
+        acia->RDR = value;
+        acia->Status |= ACIA_ST_RDRF;
+        acia->RX_Bytes++;
+        if (!(acia->Command & ACIA_CMD_IRD)) {
+            ACIA_Raise(acia);
+        }
+    } else if (Ring_Ended(acia->Rx)) {
+        //输入结束: 载波消失, 和收到数据一样产生中断
+        acia->Status |= ACIA_ST_DCD;
+        if (!(acia->Command & ACIA_CMD_IRD)) {
+            ACIA_Raise(acia);
+        }
+    } else {
+        CPU_Timer_Start(cpu, timer, cpu->Cycles + ACIA_IDLE_CYCLES);
+    }
+}
+
+static void ACIA_TX_Fire(struct CPU_Timer *timer, struct CPU_Context *cpu) {
+    struct ACIA *acia = timer->Ctx;
+    if (acia->Tx && Ring_Put(acia->Tx, acia->TDR)) {
+        //缓冲区满, 等后台线程写出去
+        CPU_Timer_Start(cpu, timer, cpu->Cycles + ACIA_IDLE_CYCLES);
+        return;
+    }
+    acia->TX_Bytes++;
+    acia->TX_Busy = 0;
+    acia->Status |= ACIA_ST_TDRE;
+    if ((acia->Command & ACIA_CMD_TIC) == ACIA_CMD_TX_IRQ) {
+        ACIA_Raise(acia);
+    }
+}
+
+void ACIA_Reset(struct ACIA *acia) {
+    CPU_Timer_Stop(acia->Cpu, &acia->RX_Timer);
+    CPU_Timer_Stop(acia->Cpu, &acia->TX_Timer);
+    acia->RDR = 0;
+    acia->TDR = 0;
+    acia->TX_Busy = 0;
+    acia->Status = ACIA_ST_TDRE | (acia->Rx ? 0 : ACIA_ST_DCD);
+    acia->Command = ACIA_CMD_IRD;
+    acia->Control = 0;
+    ACIA_Timing(acia);
+    if (acia->IRQ_Source) {
+        CPU_Set_IRQ(acia->Cpu, acia->IRQ_Source, 0);
+    }
+}
+
+Byte ACIA_Read(void *ctx, Short addr) {
+    struct ACIA *acia = ctx;
+    switch (addr & 3) {
+        case ACIA_DATA:
+            if (acia->Status & ACIA_ST_RDRF) {
+                acia->Status &= ~(ACIA_ST_RDRF | ACIA_ST_OVERRUN);
+                ACIA_RX_Start(acia, acia->Char_Cycles);
+            }
+            return acia->RDR;
+        case ACIA_STATUS: {
+            Byte value = acia->Status;
+            //读状态清除中断
+            if (value & ACIA_ST_IRQ) {
+                acia->Status &= ~ACIA_ST_IRQ;
+                if (acia->IRQ_Source) {
+                    CPU_Set_IRQ(acia->Cpu, acia->IRQ_Source, 0);
+                }
+            }
+            return value;
+        }
+        case ACIA_COMMAND:
+            return acia->Command;
+        default:
+            return acia->Control;
+    }
+}
+
+void ACIA_Write(void *ctx, Short addr, Byte value) {
+    struct ACIA *acia = ctx;
+    switch (addr & 3) {
+        case ACIA_DATA:
+            //发送中再写入时覆盖 TDR, 和硬件一样
+            acia->TDR = value;
+            acia->TX_Busy = 1;
+            acia->Status &= ~ACIA_ST_TDRE;
+            ACIA_TX_Start(acia, acia->Char_Cycles);
+            break;
+        case ACIA_STATUS:
+            //写状态寄存器是编程复位: 清除命令寄存器的低 5 位
+            acia->Status &= ~ACIA_ST_OVERRUN;
+            value = acia->Command & 0xE0;
+            //fallthrough
+        case ACIA_COMMAND: {
+            Byte tx_irq = (value & ACIA_CMD_TIC) == ACIA_CMD_TX_IRQ
+                          && (acia->Command & ACIA_CMD_TIC) != ACIA_CMD_TX_IRQ;
+            acia->Command = value;
+            ACIA_Timing(acia);
+            if (!(value & ACIA_CMD_DTR)) {
+                CPU_Timer_Stop(acia->Cpu, &acia->RX_Timer);
+                CPU_Timer_Stop(acia->Cpu, &acia->TX_Timer);
+                break;
+            }
+            ACIA_RX_Start(acia, acia->Char_Cycles);
+            ACIA_TX_Start(acia, acia->Char_Cycles);
+            //打开发送中断时 TDR 已经空, 立即产生中断
+            if (tx_irq && acia->Status & ACIA_ST_TDRE) {
+                ACIA_Raise(acia);
+            }
+            break;
+        }
+        default:
+            acia->Control = value;
+            ACIA_Timing(acia);
+            break;
+    }
+}
+
+int ACIA_Open(struct ACIA *acia, struct CPU_Context *cpu, int in_fd, int out_fd, Byte irq, double clock) {
+    memset(acia, 0, sizeof(*acia));
+    acia->Cpu = cpu;
+    acia->IRQ_Source = irq;
+    acia->Clock = clock > 0 ? clock : ACIA_CLOCK;
+    acia->Device.Read = ACIA_Read;
+    acia->Device.Write = ACIA_Write;
+    acia->Device.Ctx = acia;
+    acia->RX_Timer.Fire = ACIA_RX_Fire;
+    acia->RX_Timer.Ctx = acia;
+    acia->TX_Timer.Fire = ACIA_TX_Fire;
+    acia->TX_Timer.Ctx = acia;
+    if (in_fd >= 0) {
+        if (Ring_Init(&acia->RX_Ring, ACIA_RING_SIZE)) {
+            return -1;
+        }
+        if (Ring_Pump_Start(&acia->RX_Pump, &acia->RX_Ring, in_fd, 1)) {
+            Ring_Free(&acia->RX_Ring);
+            return -1;
+        }
+        acia->Rx = &acia->RX_Ring;
+    }
+    if (out_fd >= 0) {
+        if (Ring_Init(&acia->TX_Ring, ACIA_RING_SIZE) == 0
+            && Ring_Pump_Start(&acia->TX_Pump, &acia->TX_Ring, out_fd, 0) == 0) {
+            acia->Tx = &acia->TX_Ring;
+        } else {
+            Ring_Free(&acia->TX_Ring);
+            ACIA_Close(acia);
+            return -1;
+        }
+    }
+    ACIA_Reset(acia);
+    return 0;
+}
+
+void ACIA_Close(struct ACIA *acia) {
+    CPU_Timer_Stop(acia->Cpu, &acia->RX_Timer);
+    CPU_Timer_Stop(acia->Cpu, &acia->TX_Timer);
+    if (acia->Tx) {
+        //TDR 里的字节已经开始发送, 发完再结束
+        struct timespec ts = {0, RING_IDLE_NS};
+        int sending = acia->TX_Busy && acia->Command & ACIA_CMD_DTR && acia->Command & ACIA_CMD_TIC;
+        while (sending && Ring_Put(acia->Tx, acia->TDR)
+               && !atomic_load_explicit(&acia->TX_Pump.Done, memory_order_acquire)) {
+            nanosleep(&ts, NULL);
+        }
+        acia->TX_Busy = 0;
+        Ring_Pump_Stop(&acia->TX_Pump);
+        Ring_Free(acia->Tx);
+        acia->Tx = NULL;
+    }
+    if (acia->Rx) {
+        Ring_Pump_Stop(&acia->RX_Pump);
+        Ring_Free(acia->Rx);
+        acia->Rx = NULL;
+    }
+}
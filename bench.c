@@ -0,0 +1,439 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "include/lib6502.h"
+
+/**
+ * 基准测试: 几个典型的 6502 内核, 测量每秒执行的指令数
+ * 同时作为 PGO 的训练负载, 所以覆盖了访存、移位、十进制、子程序和分支
+ * 只用公开指令, 三种型号结果都可以比较
+ * --lanes N 时改为对比多实例同步执行和 N 次单独执行的耗时, 并逐个实例比较结果
+ */
+
+struct Bench_Kernel {
+    const char *Name;
+    const unsigned char *Code;
+    size_t Size;
+};
+
+//复制 4 页: LDA (zp),Y / STA (zp),Y / INY / BNE
+static const unsigned char Kernel_Copy[] = {
+        0xA0, 0x00,             //0200 LDY #0
+        0xA2, 0x04,             //0202 LDX #4
+        0xA9, 0x10,             //0204 LDA #$10
+        0x85, 0x21,             //0206 STA $21
+        0xA9, 0x30,             //0208 LDA #$30
+        0x85, 0x23,             //020A STA $23
+        0xB1, 0x20,             //020C LDA ($20),Y
+        0x91, 0x22,             //020E STA ($22),Y
+        0xC8,                   //0210 INY
+        0xD0, 0xF9,             //0211 BNE $020C
+        0xE6, 0x21,             //0213 INC $21
+        0xE6, 0x23,             //0215 INC $23
+        0xCA,                   //0217 DEX
+        0xD0, 0xF2,             //0218 BNE $020C
+        0x4C, 0x00, 0x02,       //021A JMP $0200
+};
+
+//8x8 移位相加乘法
+static const unsigned char Kernel_Mul[] = {
+        0xA2, 0x00,             //0200 LDX #0
+        0x86, 0x10,             //0202 STX $10
+        0xA9, 0xD3,             //0204 LDA #$D3
+        0x85, 0x11,             //0206 STA $11
+        0xA9, 0x00,             //0208 LDA #0
+        0xA0, 0x08,             //020A LDY #8
+        0x46, 0x10,             //020C LSR $10
+        0x90, 0x03,             //020E BCC $0213
+        0x18,                   //0210 CLC
+        0x65, 0x11,             //0211 ADC $11
+        0x6A,                   //0213 ROR A
+        0x66, 0x12,             //0214 ROR $12
+        0x88,                   //0216 DEY
+        0xD0, 0xF3,             //0217 BNE $020C
+        0x85, 0x13,             //0219 STA $13
+        0xE8,                   //021B INX
+        0xD0, 0xE4,             //021C BNE $0202
+        0x4C, 0x00, 0x02,       //021E JMP $0200
+};
+
+//十进制计数和累加
+static const unsigned char Kernel_BCD[] = {
+        0xF8,                   //0200 SED
+        0xA2, 0x00,             //0201 LDX #0
+        0x18,                   //0203 CLC
+        0xA5, 0x30,             //0204 LDA $30
+        0x69, 0x01,             //0206 ADC #1
+        0x85, 0x30,             //0208 STA $30
+        0xA5, 0x31,             //020A LDA $31
+        0x69, 0x00,             //020C ADC #0
+        0x85, 0x31,             //020E STA $31
+        0xA5, 0x32,             //0210 LDA $32
+        0x65, 0x30,             //0212 ADC $30
+        0x85, 0x32,             //0214 STA $32
+        0xCA,                   //0216 DEX
+        0xD0, 0xEA,             //0217 BNE $0203
+        0xD8,                   //0219 CLD
+        0x4C, 0x00, 0x02,       //021A JMP $0200
+};
+
+//校验和 + 查表, 带数据相关分支
+static const unsigned char Kernel_Checksum[] = {
+        0xA0, 0x00,             //0200 LDY #0
+        0xA9, 0xFF,             //0202 LDA #$FF
+        0x85, 0x40,             //0204 STA $40
+        0xB9, 0x00, 0x10,       //0206 LDA $1000,Y
+        0x45, 0x40,             //0209 EOR $40
+        0x0A,                   //020B ASL A
+        0x90, 0x02,             //020C BCC $0210
+        0x49, 0x1D,             //020E EOR #$1D
+        0x85, 0x40,             //0210 STA $40
+        0xAA,                   //0212 TAX
+        0xBD, 0x00, 0x11,       //0213 LDA $1100,X
+        0x99, 0x00, 0x12,       //0216 STA $1200,Y
+        0xC8,                   //0219 INY
+        0xD0, 0xEA,             //021A BNE $0206
+        0x4C, 0x00, 0x02,       //021C JMP $0200
+};
+
+//子程序调用和栈操作
+static const unsigned char Kernel_Call[] = {
+        0xA2, 0x00,             //0200 LDX #0
+        0x20, 0x0C, 0x02,       //0202 JSR $020C
+        0xE8,                   //0205 INX
+        0xD0, 0xFA,             //0206 BNE $0202
+        0x4C, 0x00, 0x02,       //0208 JMP $0200
+        0xEA,                   //020B NOP
+        0x48,                   //020C PHA
+        0x8A,                   //020D TXA
+        0x29, 0x07,             //020E AND #7
+        0xF0, 0x03,             //0210 BEQ $0215
+        0x68,                   //0212 PLA
+        0x60,                   //0213 RTS
+        0xEA,                   //0214 NOP
+        0x68,                   //0215 PLA
+        0x60,                   //0216 RTS
+};
+
+//两个累加器: LDA zp / CLC / ADC # / STA zp
+static const unsigned char Kernel_Sum[] = {
+        0xA2, 0x00,             //0200 LDX #0
+        0xA5, 0x30,             //0202 LDA $30
+        0x18,                   //0204 CLC
+        0x69, 0x03,             //0205 ADC #3
+        0x85, 0x30,             //0207 STA $30
+        0xA5, 0x31,             //0209 LDA $31
+        0x18,                   //020B CLC
+        0x69, 0x05,             //020C ADC #5
+        0x85, 0x31,             //020E STA $31
+        0xCA,                   //0210 DEX
+        0xD0, 0xEF,             //0211 BNE $0202
+        0x4C, 0x00, 0x02,       //0213 JMP $0200
+};
+
+//填表: INY / CPY # / BNE
+static const unsigned char Kernel_Fill[] = {
+        0xA0, 0x00,             //0200 LDY #0
+        0x98,                   //0202 TYA
+        0x99, 0x00, 0x12,       //0203 STA $1200,Y
+        0xC8,                   //0206 INY
+        0xC0, 0xC0,             //0207 CPY #$C0
+        0xD0, 0xF7,             //0209 BNE $0202
+        0x4C, 0x00, 0x02,       //020B JMP $0200
+};
+
+static const struct Bench_Kernel Kernels[] = {
+        {"copy",     Kernel_Copy,     sizeof(Kernel_Copy)},
+        {"mul",      Kernel_Mul,      sizeof(Kernel_Mul)},
+        {"bcd",      Kernel_BCD,      sizeof(Kernel_BCD)},
+        {"checksum", Kernel_Checksum, sizeof(Kernel_Checksum)},
+        {"call",     Kernel_Call,     sizeof(Kernel_Call)},
+        {"sum",      Kernel_Sum,      sizeof(Kernel_Sum)},
+        {"fill",     Kernel_Fill,     sizeof(Kernel_Fill)},
+};
+
+#define BENCH_KERNELS (sizeof(Kernels) / sizeof(Kernels[0]))
+
+static double Bench_Now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//内核读的数据放在 $1000-$11FF
+#define BENCH_DATA_ADDR 0x1000
+#define BENCH_DATA_SIZE 0x200
+
+/**
+ * 按种子生成内核的输入数据, 多实例时每个实例用不同的种子
+ */
+static void Bench_Data(unsigned char *data, unsigned int seed) {
+    for (int i = 0; i < BENCH_DATA_SIZE; ++i) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+/**
+ * 创建 CPU 并装入内核和数据
+ */
+static Lib6502 *Bench_Setup(const struct Bench_Kernel *kernel, unsigned int seed) {
+    Lib6502 *emu = Lib6502_Create();
+    if (!emu) {
+        return NULL;
+    }
+    unsigned char data[BENCH_DATA_SIZE];
+    Bench_Data(data, seed);
+    Lib6502_Load(emu, BENCH_DATA_ADDR, data, sizeof(data));
+    Lib6502_Load(emu, 0x0200, kernel->Code, kernel->Size);
+    Lib6502_Poke(emu, 0xFFFC, 0x00);
+    Lib6502_Poke(emu, 0xFFFD, 0x02);
+    Lib6502_Reset(emu);
+    return emu;
+}
+
+/**
+ * 数出执行 cycles 个周期经过的指令数(逐条执行, 不计时)
+ */
+static unsigned long long Bench_Count(const struct Bench_Kernel *kernel, unsigned long long cycles) {
+    Lib6502 *emu = Bench_Setup(kernel, 1);
+    unsigned long long count = 0;
+    Lib6502_Regs regs;
+    do {
+        Lib6502_Step(emu);
+        count++;
+        Lib6502_Get_Regs(emu, &regs);
+    } while (regs.Cycles < cycles);
+    Lib6502_Destroy(emu);
+    return count;
+}
+
+/**
+ * 取 runs 次中最快的一次
+ * @return 每秒百万条指令
+ */
+static double Bench_Run(const struct Bench_Kernel *kernel, unsigned long long cycles, int runs) {
+    unsigned long long count = Bench_Count(kernel, cycles);
+    double best = 0;
+    for (int i = 0; i < runs; ++i) {
+        Lib6502 *emu = Bench_Setup(kernel, 1);
+        double start = Bench_Now();
+        Lib6502_Run_Cycles(emu, cycles);
+        double elapsed = Bench_Now() - start;
+        Lib6502_Destroy(emu);
+        if (elapsed > 0 && count / elapsed / 1e6 > best) {
+            best = count / elapsed / 1e6;
+        }
+    }
+    return best;
+}
+
+/**
+ * 多实例同步执行: 和 Bench_Setup 一样装入内核, 第 i 个实例的数据用种子 i + 1
+ */
+static Lib6502_Lanes *Bench_Lanes_Setup(const struct Bench_Kernel *kernel, int count) {
+    Lib6502_Lanes *lanes = Lib6502_Lanes_Create(count);
+    if (!lanes) {
+        return NULL;
+    }
+    unsigned char data[BENCH_DATA_SIZE];
+    for (int i = 0; i < count; ++i) {
+        Bench_Data(data, i + 1);
+        Lib6502_Lanes_Load(lanes, i, BENCH_DATA_ADDR, data, sizeof(data));
+    }
+    Lib6502_Lanes_Load(lanes, -1, 0x0200, kernel->Code, kernel->Size);
+    static const unsigned char reset[] = {0x00, 0x02};
+    Lib6502_Lanes_Load(lanes, -1, 0xFFFC, reset, sizeof(reset));
+    Lib6502_Lanes_Reset(lanes);
+    return lanes;
+}
+
+/**
+ * 比较一个实例和单独执行的 CPU: 寄存器、周期和整个内存
+ * @return 0 相同, 否则把第一处不同写进 why
+ */
+static int Bench_Lanes_Diff(Lib6502 *emu, const Lib6502_Lanes *lanes, int lane, char *why, size_t size) {
+    Lib6502_Regs expect, got;
+    Lib6502_Get_Regs(emu, &expect);
+    Lib6502_Lanes_Get_Regs(lanes, lane, &got);
+    if (expect.PC != got.PC || expect.SP != got.SP || expect.A != got.A || expect.X != got.X || expect.Y != got.Y
+        || expect.P != got.P || expect.Halted != got.Halted || expect.Cycles != got.Cycles) {
+        snprintf(why, size, "lane %d: PC=%04X A=%02X X=%02X Y=%02X P=%02X cycles=%llu,"
+                            " CPU_Run PC=%04X A=%02X X=%02X Y=%02X P=%02X cycles=%llu",
+                 lane, got.PC, got.A, got.X, got.Y, got.P, (unsigned long long) got.Cycles,
+                 expect.PC, expect.A, expect.X, expect.Y, expect.P, (unsigned long long) expect.Cycles);
+        return 1;
+    }
+    for (unsigned int addr = 0; addr < 0x10000; ++addr) {
+        uint8_t value = Lib6502_Lanes_Peek(lanes, lane, addr);
+        if (value != Lib6502_Peek(emu, addr)) {
+            snprintf(why, size, "lane %d: $%04X=%02X, CPU_Run %02X", lane, addr, value, Lib6502_Peek(emu, addr));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 对比多实例同步执行和逐个单独执行: 各取 runs 次中最快的一次, 每次都逐个实例比较结果
+ * @param scalar 逐个执行 count 个实例的秒数
+ * @param group 同步执行的秒数
+ * @param vector 按组执行的次数占全部调度的比例(一组算一次, 逐个执行的每条指令算一次)
+ * @return 0 结果相同, 1 不同(原因写进 why), -1 内存不足
+ */
+static int Bench_Lanes(const struct Bench_Kernel *kernel, unsigned long long cycles, int runs, int count,
+                       double *scalar, double *group, double *vector, char *why, size_t size) {
+    Lib6502 *emus[LIB6502_LANES_MAX] = {0};
+    *scalar = *group = 0;
+    int result = 0;
+    for (int run = 0; run < runs && result == 0; ++run) {
+        Lib6502_Lanes *lanes = Bench_Lanes_Setup(kernel, count);
+        for (int i = 0; i < count; ++i) {
+            emus[i] = Bench_Setup(kernel, i + 1);
+            result = emus[i] && lanes ? result : -1;
+        }
+        if (result == 0) {
+            double start = Bench_Now();
+            for (int i = 0; i < count; ++i) {
+                Lib6502_Run_Cycles(emus[i], cycles);
+            }
+            double middle = Bench_Now();
+            Lib6502_Lanes_Run_Cycles(lanes, cycles);
+            double end = Bench_Now();
+            *scalar = run == 0 || middle - start < *scalar ? middle - start : *scalar;
+            *group = run == 0 || end - middle < *group ? end - middle : *group;
+            Lib6502_Lanes_Stats stats;
+            Lib6502_Lanes_Get_Stats(lanes, &stats);
+            *vector = (double) stats.Vector_Ops / (stats.Vector_Ops + stats.Scalar_Ops + (stats.Vector_Ops == 0));
+            for (int i = 0; i < count && result == 0; ++i) {
+                result = Bench_Lanes_Diff(emus[i], lanes, i, why, size);
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            Lib6502_Destroy(emus[i]);
+            emus[i] = NULL;
+        }
+        Lib6502_Lanes_Destroy(lanes);
+    }
+    return result;
+}
+
+/**
+ * 从基线文件里找内核的结果, 每行 "名字 MIPS"
+ * @return 没有记录时为 0
+ */
+static double Bench_Baseline(FILE *fp, const char *name) {
+    char line[128];
+    char key[64];
+    double value;
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%63s %lf", key, &value) == 2 && strcmp(key, name) == 0) {
+            return value;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    unsigned long long cycles = 50000000;
+    int runs = 3;
+    double threshold = 10;
+    const char *baseline = NULL;
+    const char *save = NULL;
+    const char *only = NULL;
+    int lanes = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            save = argv[++i];
+        } else if (strcmp(argv[i], "--kernel") == 0 && i + 1 < argc) {
+            only = argv[++i];
+        } else if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+            lanes = atoi(argv[++i]);
+        } else {
+            lanes = -1;
+            break;
+        }
+    }
+    //多实例模式不记录也不比较基线
+    if (lanes < 0 || lanes > LIB6502_LANES_MAX || runs < 1 || (lanes && (baseline || save))) {
+        fprintf(stderr, "usage: cpu_6502_bench [--cycles N] [--runs N] [--save FILE]"
+                        " [--kernel NAME] [--baseline FILE [--threshold PCT]]\n"
+                        "       cpu_6502_bench --lanes N [--cycles N] [--runs N] [--kernel NAME]\n"
+                        "N lanes: 1 to %d\n", LIB6502_LANES_MAX);
+        return 1;
+    }
+    FILE *base = NULL;
+    if (baseline) {
+        base = fopen(baseline, "r");
+        if (!base) {
+            fprintf(stderr, "can't open baseline %s (build the bench-baseline target first)\n", baseline);
+            return 1;
+        }
+    }
+    FILE *out = NULL;
+    if (save) {
+        out = fopen(save, "w");
+        if (!out) {
+            fprintf(stderr, "can't write %s\n", save);
+            return 1;
+        }
+    }
+    int failed = 0;
+    for (unsigned int i = 0; i < BENCH_KERNELS; ++i) {
+        //只跑一个内核, 两个构建交替对比时用
+        if (only && strcmp(only, Kernels[i].Name) != 0) {
+            continue;
+        }
+        if (lanes) {
+            double scalar, group, vector;
+            char why[160];
+            int diff = Bench_Lanes(&Kernels[i], cycles, runs, lanes, &scalar, &group, &vector, why, sizeof(why));
+            if (diff < 0) {
+                fprintf(stderr, "out of memory\n");
+                return 1;
+            }
+            printf("%-10s %2d lanes %8.3fs, one by one %8.3fs  x%.2f  %3.0f%% grouped", Kernels[i].Name, lanes,
+                   group, scalar, group > 0 ? scalar / group : 0, vector * 100);
+            if (diff) {
+                printf("  MISMATCH %s", why);
+                failed = 1;
+            }
+            printf("\n");
+            continue;
+        }
+        double mips = Bench_Run(&Kernels[i], cycles, runs);
+        printf("%-10s %10.2f MIPS", Kernels[i].Name, mips);
+        if (out) {
+            fprintf(out, "%s %.2f\n", Kernels[i].Name, mips);
+        }
+        if (base) {
+            double expect = Bench_Baseline(base, Kernels[i].Name);
+            if (expect > 0) {
+                double change = (mips - expect) / expect * 100;
+                printf("  baseline %10.2f  %+6.1f%%", expect, change);
+                if (change < -threshold) {
+                    printf("  REGRESSION");
+                    failed = 1;
+                }
+            }
+        }
+        printf("\n");
+    }
+    if (base) {
+        fclose(base);
+    }
+    if (out) {
+        fclose(out);
+    }
+    return failed;
+}
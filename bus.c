@@ -0,0 +1,442 @@
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "include/cpu.h"
+#include "include/mapper.h"
+#include "include/pool.h"
+
+//没写过的内存页读到的内容
+static const Byte Bus_Zero[256];
+
+/**
+ * 按页的类型重新计算页表
+ * @param bus
+ * @param page
+ */
+static void Bus_Update(struct Bus *bus, int page) {
+    const Byte *data = bus->Backing[page] ? bus->Backing[page] : Bus_Zero;
+    int writable = bus->Backing[page] && !bus->ROM[page] && !bus->Shared[page];
+    Byte armed = bus->Armed[page];
+    bus->Read_Page[page] = bus->IO[page] || (armed & (BUS_ARM_READ | BUS_ARM_EXEC)) ? NULL : data;
+    bus->Write_Page[page] = bus->IO[page] || (armed & BUS_ARM_WRITE) || bus->Control[page] || !writable
+                            ? NULL : (Byte *) data;
+}
+
+/**
+ * Backing 要指向别处之前调用: 释放对共享页的引用
+ * @param bus
+ * @param page
+ */
+static void Bus_Drop(struct Bus *bus, int page) {
+    if (bus->Shared[page]) {
+        Pool_Release(bus->Pool, bus->Backing[page]);
+        bus->Shared[page] = 0;
+    }
+}
+
+/**
+ * 取页的可写内容: 没写过的页先在 Mem 里清零, 外部只读页和共享页先拷贝一份到 Mem(只读页仍然只读),
+ * RAM bank 页直接返回
+ * @param bus
+ * @param page
+ * @return
+ */
+static Byte *Bus_Own(struct Bus *bus, int page) {
+    Byte *mem = bus->Mem + (page << 8);
+    if (bus->Backing[page] && !bus->ROM[page] && !bus->Shared[page]) {
+        return (Byte *) bus->Backing[page];
+    }
+    if (bus->Backing[page] != mem) {
+        if (bus->Backing[page]) {
+            memcpy(mem, bus->Backing[page], 256);
+        } else {
+            memset(mem, 0, 256);
+        }
+        Bus_Drop(bus, page);
+        bus->Backing[page] = mem;
+        Bus_Update(bus, page);
+    }
+    return mem;
+}
+
+/**
+ * 清空总线: 所有页都是没写过的内存, 读到 0
+ * 不访问 Mem, 所以刚分配的总线不占物理内存
+ * @param bus
+ */
+void Bus_Init(struct Bus *bus) {
+    memset(bus->IO, 0, sizeof(bus->IO));
+    memset(bus->Backing, 0, sizeof(bus->Backing));
+    memset(bus->ROM, 0, sizeof(bus->ROM));
+    memset(bus->Dirty, 0, sizeof(bus->Dirty));
+    memset(bus->Armed, 0, sizeof(bus->Armed));
+    memset(bus->Control, 0, sizeof(bus->Control));
+    memset(bus->Shared, 0, sizeof(bus->Shared));
+    bus->Watch = NULL;
+    bus->Mapper = NULL;
+    bus->Pool = NULL;
+    bus->Threads = 0;
+    for (int page = 0; page < 256; ++page) {
+        Bus_Update(bus, page);
+    }
+}
+
+void Bus_Clear_Dirty(struct Bus *bus) {
+    memset(bus->Dirty, 0, sizeof(bus->Dirty));
+}
+
+/**
+ * 把 start-end 所在的页映射给设备, device 为 NULL 时恢复成原来的内存或只读页
+ * @param bus
+ * @param start
+ * @param end 包含
+ * @param device
+ */
+void Bus_Map_IO(struct Bus *bus, Short start, Short end, struct Bus_Device *device) {
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        bus->IO[page] = device;
+        Bus_Update(bus, page);
+    }
+}
+
+/**
+ * 把数据拷贝到总线内存, 超出 0xFFFF 的部分丢弃
+ * 只读页也会被写入(改的是它的私有副本)
+ * @param bus
+ * @param addr 起始地址
+ * @param data
+ * @param size
+ */
+void Bus_Load(struct Bus *bus, Short addr, const Byte *data, unsigned int size) {
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    while (size) {
+        unsigned int offset = addr & 0xFF;
+        unsigned int chunk = 256 - offset < size ? 256 - offset : size;
+        memcpy(Bus_Own(bus, addr >> 8) + offset, data, chunk);
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * 把只读数据映射到总线, 超出 0xFFFF 的部分丢弃
+ * 完整覆盖的页直接指向 data, 不拷贝, data 必须在总线使用期间有效;
+ * 只覆盖一部分的页(地址不按页对齐或者末尾不满一页)拷贝到 Mem
+ * CPU 对这些页的写入被丢弃
+ * @param bus
+ * @param addr 起始地址
+ * @param data
+ * @param size
+ */
+void Bus_Map_ROM(struct Bus *bus, Short addr, const Byte *data, unsigned int size) {
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    while (size) {
+        int page = addr >> 8;
+        unsigned int offset = addr & 0xFF;
+        unsigned int chunk = 256 - offset < size ? 256 - offset : size;
+        if (chunk == 256) {
+            Bus_Drop(bus, page);
+            bus->Backing[page] = data;
+        } else {
+            memcpy(Bus_Own(bus, page) + offset, data, chunk);
+        }
+        bus->ROM[page] = 1;
+        Bus_Update(bus, page);
+        addr += chunk;
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+/**
+ * 设置页上的观察点类型, 有观察点的访问不走页表
+ * @param bus
+ * @param page
+ * @param armed BUS_ARM_xxx 的组合
+ */
+void Bus_Arm(struct Bus *bus, int page, Byte armed) {
+    bus->Armed[page] = armed;
+    Bus_Update(bus, page);
+}
+
+/**
+ * 把按页对齐的 [addr, addr + size) 直接指向 data, 不拷贝, 用于 bank 切换
+ * data 必须在映射期间有效; data 为 NULL 时恢复成没写过的内存页
+ * @param bus
+ * @param addr 页对齐
+ * @param data
+ * @param size 256 的倍数, 超出 0xFFFF 的部分丢弃
+ * @param writable 非 0 时 CPU 直接写入 data, 否则为只读页
+ */
+void Bus_Map_Bank(struct Bus *bus, Short addr, const Byte *data, unsigned int size, int writable) {
+    unsigned int end = (addr >> 8) + (size >> 8) < 256 ? (addr >> 8) + (size >> 8) : 256;
+    Byte rom = data && !writable;
+    for (unsigned int page = addr >> 8; page < end; ++page) {
+        const Byte *backing = data ? data + ((page - (addr >> 8)) << 8) : NULL;
+        Bus_Drop(bus, page);
+        bus->Backing[page] = backing;
+        bus->ROM[page] = rom;
+        //切换 bank 时窗口里通常都是普通页, 直接写页表
+        if (backing && !bus->IO[page] && !bus->Armed[page] && !bus->Control[page]) {
+            bus->Read_Page[page] = backing;
+            bus->Write_Page[page] = rom ? NULL : (Byte *) backing;
+        } else {
+            Bus_Update(bus, page);
+        }
+    }
+}
+
+/**
+ * 标记映射器控制寄存器所在的页, 这些页的写入走慢路径并先交给 bus->Mapper
+ * @param bus
+ * @param start
+ * @param end 包含
+ * @param on
+ */
+void Bus_Map_Control(struct Bus *bus, Short start, Short end, Byte on) {
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        bus->Control[page] = on;
+        Bus_Update(bus, page);
+    }
+}
+
+/**
+ * CPU 写入 Write_Page 为 NULL 的非 I/O 页: 映射器的控制寄存器交给映射器, 只读页丢弃,
+ * 没写过的内存页先分配, 共享页拷贝回 Mem, 其它(有观察点)直接写入
+ * @param bus
+ * @param addr
+ * @param value
+ * @return
+ */
+Byte Bus_Write_Fault(struct Bus *bus, Short addr, Byte value) {
+    if (bus->Control[addr >> 8] && bus->Mapper && Mapper_Write(bus->Mapper, addr, value)) {
+        return value;
+    }
+    if (bus->ROM[addr >> 8]) {
+        return value;
+    }
+    if (bus->Shared[addr >> 8]) {
+        pthread_mutex_lock(&bus->Pool->Lock);
+        bus->Pool->Stats.Splits++;
+        pthread_mutex_unlock(&bus->Pool->Lock);
+    }
+    bus->Dirty[addr >> 8] = 1;
+    return Bus_Own(bus, addr >> 8)[addr & 0xFF] = value;
+}
+
+/**
+ * 读取页的内容, 不经过设备, 不计周期
+ * @param bus
+ * @param addr
+ * @return
+ */
+Byte Bus_Peek(const struct Bus *bus, Short addr) {
+    const Byte *data = bus->Backing[addr >> 8];
+    return data ? data[addr & 0xFF] : 0;
+}
+
+/**
+ * 写入页的内容, 不经过设备, 只读页也会被写入
+ * @param bus
+ * @param addr
+ * @param value
+ */
+void Bus_Poke(struct Bus *bus, Short addr, Byte value) {
+    Bus_Own(bus, addr >> 8)[addr & 0xFF] = value;
+}
+
+int Bus_Share(struct Bus *bus, struct Pool *pool) {
+    int count = 0;
+    Byte moved[256] = {0};
+    unsigned long long zero = 0;
+    unsigned long long released = 0;
+    if (bus->Pool && bus->Pool != pool) {
+        return 0;
+    }
+    bus->Pool = pool;
+    for (int page = 0; page < 256; ++page) {
+        Byte *mem = bus->Mem + (page << 8);
+        if (bus->Backing[page] != mem) {
+            continue;
+        }
+        if (memcmp(mem, Bus_Zero, 256) == 0) {
+            //只读页也可以: Backing 为 NULL 时读到 0, ROM 标志让写入仍然被丢弃
+            bus->Backing[page] = NULL;
+            zero++;
+        } else {
+            const Byte *data = Pool_Intern(pool, mem);
+            if (!data) {
+                continue;
+            }
+            bus->Backing[page] = data;
+            bus->Shared[page] = 1;
+        }
+        Bus_Update(bus, page);
+        moved[page] = 1;
+        count++;
+    }
+    //这次移走了页、并且整块 4K 里没有页还在用 Mem 时还给系统, 以后 Bus_Own 会重新清零或拷贝
+    uintptr_t base = (uintptr_t) bus->Mem;
+    for (uintptr_t addr = (base + 4095) & ~(uintptr_t) 4095; addr + 4096 <= base + 0x10000; addr += 4096) {
+        int used = 0;
+        int any = 0;
+        for (uintptr_t page = (addr - base) >> 8; page <= (addr + 4095 - base) >> 8 && page < 256; ++page) {
+            used |= bus->Backing[page] == bus->Mem + (page << 8);
+            any |= moved[page];
+        }
+        if (any && !used && madvise((void *) addr, 4096, MADV_DONTNEED) == 0) {
+            released += 4096;
+        }
+    }
+    pthread_mutex_lock(&pool->Lock);
+    pool->Stats.Zero_Pages += zero;
+    pool->Stats.Released_Bytes += released;
+    pthread_mutex_unlock(&pool->Lock);
+    return count;
+}
+
+void Bus_Unshare(struct Bus *bus) {
+    for (int page = 0; page < 256; ++page) {
+        if (bus->Shared[page]) {
+            Bus_Own(bus, page);
+        }
+    }
+    bus->Pool = NULL;
+}
+
+/**
+ * 在当前线程里按固定周期片轮流执行多个 CPU
+ * 顺序固定为 cpus[0..count), 每一轮每个 CPU 执行到 起点 + 轮数 * quantum,
+ * 所以结果是确定的, 单条指令超出的周期会在下一轮扣回
+ * @param cpus 共享同一个 Bus 的上下文
+ * @param count
+ * @param quantum 周期片
+ * @param cycles 每个 CPU 执行的总周期数
+ */
+void Bus_Run_Interleaved(struct CPU_Context **cpus, int count, unsigned int quantum, unsigned long long cycles) {
+    struct CPU_Context *prev = CPU_Current;
+    unsigned long long *start = malloc(sizeof(*start) * count);
+    for (int i = 0; i < count; ++i) {
+        start[i] = cpus[i]->Cycles;
+    }
+    if (quantum == 0) {
+        quantum = 1;
+    }
+    for (unsigned long long done = 0; done < cycles;) {
+        done = cycles - done > quantum ? done + quantum : cycles;
+        for (int i = 0; i < count; ++i) {
+            unsigned long long target = start[i] + done;
+            CPU_Select(cpus[i]);
+            if (CPU.Cycles < target) {
+                CPU_Run(target - CPU.Cycles);
+            }
+        }
+    }
+    free(start);
+    CPU_Select(prev);
+}
+
+//所有线程创建成功后才放行, 否则屏障永远等不齐
+struct Bus_Gate {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int released;
+    int abort;
+    pthread_barrier_t barrier;
+};
+
+struct Bus_Thread {
+    struct CPU_Context *cpu;
+    struct Bus_Gate *gate;
+    unsigned int sync_cycles;
+    unsigned long long cycles;
+};
+
+static void *Bus_Thread_Main(void *arg) {
+    struct Bus_Thread *thread = arg;
+    struct Bus_Gate *gate = thread->gate;
+    pthread_mutex_lock(&gate->lock);
+    while (!gate->released) {
+        pthread_cond_wait(&gate->cond, &gate->lock);
+    }
+    pthread_mutex_unlock(&gate->lock);
+    if (gate->abort) {
+        return NULL;
+    }
+    CPU_Select(thread->cpu);
+    unsigned long long start = CPU.Cycles;
+    for (unsigned long long done = 0; done < thread->cycles;) {
+        done = thread->cycles - done > thread->sync_cycles ? done + thread->sync_cycles : thread->cycles;
+        if (CPU.Cycles < start + done) {
+            CPU_Run(start + done - CPU.Cycles);
+        }
+        //同步点: 之前写入共享内存的数据对其它线程可见
+        pthread_barrier_wait(&gate->barrier);
+    }
+    return NULL;
+}
+
+/**
+ * 每个 CPU 一个线程并行执行, 每 sync_cycles 个周期在屏障处同步一次
+ * 两个同步点之间, 不同 CPU 对同一地址的读写顺序不确定
+ * @param cpus 共享同一个 Bus 的上下文
+ * @param count
+ * @param sync_cycles 同步间隔, 0 表示只在结束时同步
+ * @param cycles 每个 CPU 执行的总周期数
+ * @return 0 成功, -1 线程创建失败
+ */
+int Bus_Run_Parallel(struct CPU_Context **cpus, int count, unsigned int sync_cycles, unsigned long long cycles) {
+    pthread_t *tids = malloc(sizeof(*tids) * count);
+    struct Bus_Thread *threads = malloc(sizeof(*threads) * count);
+    struct Bus_Gate gate = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+    int started = 0;
+    if (sync_cycles == 0 || sync_cycles > cycles) {
+        sync_cycles = cycles > 0xFFFFFFFF ? 0xFFFFFFFF : (unsigned int) cycles;
+    }
+    //第一次写入时分配页不是线程安全的, 先把所有可写的内存页分配好
+    for (int i = 0; i < count; ++i) {
+        struct Bus *bus = cpus[i]->Bus;
+        for (int page = 0; page < 256; ++page) {
+            if (!bus->ROM[page]) {
+                Bus_Own(bus, page);
+            }
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        cpus[i]->Bus->Threads++;
+    }
+    pthread_barrier_init(&gate.barrier, NULL, count);
+    for (int i = 0; i < count; ++i) {
+        threads[i].cpu = cpus[i];
+        threads[i].gate = &gate;
+        threads[i].sync_cycles = sync_cycles;
+        threads[i].cycles = cycles;
+    }
+    for (; started < count; ++started) {
+        if (pthread_create(&tids[started], NULL, Bus_Thread_Main, &threads[started]) != 0) {
+            break;
+        }
+    }
+    pthread_mutex_lock(&gate.lock);
+    gate.released = 1;
+    gate.abort = started < count;
+    pthread_cond_broadcast(&gate.cond);
+    pthread_mutex_unlock(&gate.lock);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    pthread_barrier_destroy(&gate.barrier);
+    for (int i = 0; i < count; ++i) {
+        cpus[i]->Bus->Threads--;
+    }
+    free(threads);
+    free(tids);
+    return gate.abort ? -1 : 0;
+}
@@ -0,0 +1,510 @@
+#include <stdlib.h>
+#include <string.h>
+#include "include/cfg.h"
+#include "include/opcodes.h"
+
+/**
+ * @param cfg
+ * @param mem 64K 内存映像, 分析期间不能释放
+ * @param rom_start 常量区起点
+ * @param rom_end 常量区终点(包含)
+ */
+void CFG_Init(struct CFG *cfg, const Byte *mem, Short rom_start, Short rom_end) {
+    memset(cfg->Mark, 0, sizeof(cfg->Mark));
+    cfg->Mem = mem;
+    cfg->Rom_Start = rom_start;
+    cfg->Rom_End = rom_end;
+    cfg->Blocks = NULL;
+    cfg->Count = cfg->Cap = 0;
+    cfg->Routines = NULL;
+}
+
+static Byte CFG_In_Rom(const struct CFG *cfg, Short addr) {
+    return addr >= cfg->Rom_Start && addr <= cfg->Rom_End;
+}
+
+/**
+ * 静态解析 JMP (a): 指针在常量区内才可以解析
+ * NMOS 指针在页尾时高字节取同一页的 xx00
+ * @return 0 无法解析
+ */
+static Byte CFG_Resolve_Indirect(const struct CFG *cfg, Short pointer, Short *target) {
+#if CPU_IS_CMOS
+    Short high = pointer + 1;
+#else
+    Short high = (pointer & 0xFF00) | (Byte) (pointer + 1);
+#endif
+    if (!CFG_In_Rom(cfg, pointer) || !CFG_In_Rom(cfg, high)) {
+        return 0;
+    }
+    *target = cfg->Mem[pointer] | (cfg->Mem[high] << 8);
+    return 1;
+}
+
+/**
+ * 计算指令的跳转目标
+ * @return 0 没有静态目标
+ */
+static Byte CFG_Target(const struct CFG *cfg, Short addr, Short *target) {
+    const Byte *mem = cfg->Mem;
+    Byte opcode = mem[addr];
+    Byte length = OP_Length(opcode);
+    Short word = mem[(Short) (addr + 1)] | (mem[(Short) (addr + 2)] << 8);
+    switch (OP_Table[opcode].Mode) {
+        case MODE_REL:
+            *target = OP_Branch_Target(addr, mem[(Short) (addr + 1)], length);
+            return 1;
+        case MODE_ZPR:
+            *target = OP_Branch_Target(addr, mem[(Short) (addr + 2)], length);
+            return 1;
+        case MODE_ABS:
+            *target = word;
+            return 1;
+        case MODE_IND:
+            return CFG_Resolve_Indirect(cfg, word, target);
+        default:
+            return 0;
+    }
+}
+
+struct CFG_Stack {
+    Short *Items;
+    int Count;
+    int Cap;
+};
+
+static void CFG_Push(struct CFG *cfg, struct CFG_Stack *stack, Short addr) {
+    if (cfg->Mark[addr] & CFG_LEADER) {
+        return;
+    }
+    cfg->Mark[addr] |= CFG_LEADER;
+    if (stack->Count == stack->Cap) {
+        stack->Cap = stack->Cap ? stack->Cap * 2 : 256;
+        stack->Items = realloc(stack->Items, sizeof(Short) * stack->Cap);
+    }
+    stack->Items[stack->Count++] = addr;
+}
+
+/**
+ * 第一遍: 从入口沿所有可达路径反汇编, 标记指令和块起点
+ */
+static void CFG_Trace(struct CFG *cfg, const Short *entries, int count) {
+    struct CFG_Stack stack = {NULL, 0, 0};
+    for (int i = 0; i < count; ++i) {
+        CFG_Push(cfg, &stack, entries[i]);
+    }
+    while (stack.Count > 0) {
+        Short addr = stack.Items[--stack.Count];
+        for (;;) {
+            //已经反汇编过, 或者落在别的指令中间(重叠代码不跟踪)
+            if (cfg->Mark[addr] & (CFG_CODE | CFG_OPERAND)) {
+                break;
+            }
+            Byte opcode = cfg->Mem[addr];
+            Byte length = OP_Length(opcode);
+            Byte flow = OP_Table[opcode].Flow;
+            Short target;
+            Short next = addr + length;
+            cfg->Mark[addr] |= CFG_CODE;
+            for (int i = 1; i < length; ++i) {
+                cfg->Mark[(Short) (addr + i)] |= CFG_OPERAND;
+            }
+            if (flow == OP_FLOW_BRANCH || flow == OP_FLOW_CALL) {
+                CFG_Target(cfg, addr, &target);
+                CFG_Push(cfg, &stack, target);
+                //顺序执行的下一条也是块起点
+                cfg->Mark[next] |= CFG_LEADER;
+            } else if (flow == OP_FLOW_JUMP || flow == OP_FLOW_JUMP_IND) {
+                if (CFG_Target(cfg, addr, &target)) {
+                    CFG_Push(cfg, &stack, target);
+                }
+                break;
+            } else if (flow != OP_FLOW_NONE) {
+                break;
+            }
+            addr = next;
+        }
+    }
+    free(stack.Items);
+}
+
+static struct CFG_Block *CFG_New_Block(struct CFG *cfg) {
+    if (cfg->Count == cfg->Cap) {
+        cfg->Cap = cfg->Cap ? cfg->Cap * 2 : 64;
+        cfg->Blocks = realloc(cfg->Blocks, sizeof(struct CFG_Block) * cfg->Cap);
+    }
+    struct CFG_Block *block = &cfg->Blocks[cfg->Count++];
+    memset(block, 0, sizeof(*block));
+    return block;
+}
+
+/**
+ * 第二遍: 按地址顺序切分基本块, 统计周期和后继
+ */
+static void CFG_Split(struct CFG *cfg) {
+    for (int start = 0; start < 0x10000; ++start) {
+        if ((cfg->Mark[start] & (CFG_CODE | CFG_LEADER)) != (CFG_CODE | CFG_LEADER)) {
+            continue;
+        }
+        struct CFG_Block *block = CFG_New_Block(cfg);
+        Short addr = start;
+        block->Start = start;
+        for (;;) {
+            Byte opcode = cfg->Mem[addr];
+            const struct Opcode_Info *info = &OP_Table[opcode];
+            Byte length = OP_Length(opcode);
+            Short next = addr + length;
+            Short target;
+            block->Last = addr;
+            block->Length += length;
+            block->Instructions++;
+            Byte min, max;
+            OP_Cycle_Range(cfg->Mem, addr, &min, &max);
+            block->Min_Cycles += min;
+            block->Max_Cycles += max;
+            block->Flow = info->Flow;
+            if (info->Flow == OP_FLOW_BRANCH || info->Flow == OP_FLOW_JUMP) {
+                CFG_Target(cfg, addr, &target);
+                block->Succ[block->Succ_Count++] = target;
+                if (info->Flow == OP_FLOW_BRANCH) {
+                    block->Succ[block->Succ_Count++] = next;
+                }
+                break;
+            }
+            if (info->Flow == OP_FLOW_JUMP_IND) {
+                if (CFG_Target(cfg, addr, &target)) {
+                    block->Succ[block->Succ_Count++] = target;
+                } else {
+                    block->Unresolved = 1;
+                }
+                break;
+            }
+            if (info->Flow == OP_FLOW_CALL) {
+                CFG_Target(cfg, addr, &block->Call);
+                block->Succ[block->Succ_Count++] = next;
+                break;
+            }
+            if (info->Flow != OP_FLOW_NONE) {
+                break;
+            }
+            if ((cfg->Mark[next] & CFG_LEADER) || !(cfg->Mark[next] & CFG_CODE) || next < addr) {
+                block->Succ[block->Succ_Count++] = next;
+                break;
+            }
+            addr = next;
+        }
+    }
+}
+
+/**
+ * 从 entries 开始建立控制流图
+ * @param cfg
+ * @param entries 入口地址(复位/中断向量等)
+ * @param count
+ */
+void CFG_Build(struct CFG *cfg, const Short *entries, int count) {
+    CFG_Trace(cfg, entries, count);
+    CFG_Split(cfg);
+}
+
+/**
+ * 读取 NMI/RESET/IRQ 向量
+ * @param mem
+ * @param entries 至少 3 个
+ * @return 3
+ */
+int CFG_Vectors(const Byte *mem, Short *entries) {
+    for (int i = 0; i < 3; ++i) {
+        Short vector = 0xFFFA + i * 2;
+        entries[i] = mem[vector] | (mem[vector + 1] << 8);
+    }
+    return 3;
+}
+
+/**
+ * 查找以 addr 开头的基本块
+ * @return 下标, 没有返回 -1
+ */
+int CFG_Find(const struct CFG *cfg, Short addr) {
+    int low = 0;
+    int high = cfg->Count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (cfg->Blocks[mid].Start == addr) {
+            return mid;
+        }
+        if (cfg->Blocks[mid].Start < addr) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return -1;
+}
+
+//-------------子程序周期-----------------
+
+#define CFG_NO_PATH 0xFFFFFFFFFFFFFFFFULL
+
+/**
+ * 一个子程序里的块: 从入口沿后继可达(不经过入口)的块
+ */
+struct CFG_Walk {
+    int Entry;
+    Byte *Color;
+    int *Order;
+    int Count;
+    //每块到出口的最少/最多周期, CFG_NO_PATH 表示到不了出口
+    unsigned long long *Min;
+    unsigned long long *Max;
+    Byte Flags;
+};
+
+static int CFG_Walk_Alloc(struct CFG_Walk *walk, int count) {
+    walk->Color = calloc(count, 1);
+    walk->Order = malloc(sizeof(int) * count);
+    walk->Min = malloc(sizeof(unsigned long long) * count);
+    walk->Max = malloc(sizeof(unsigned long long) * count);
+    walk->Count = 0;
+    walk->Flags = 0;
+    return walk->Color && walk->Order && walk->Min && walk->Max ? 0 : -1;
+}
+
+static void CFG_Walk_Free(struct CFG_Walk *walk) {
+    free(walk->Color);
+    free(walk->Order);
+    free(walk->Min);
+    free(walk->Max);
+}
+
+/**
+ * 深度优先, 后序记录到 Order(后继在前), 遇到栈上的块就是循环
+ */
+static void CFG_Visit(const struct CFG *cfg, struct CFG_Walk *walk, int index) {
+    const struct CFG_Block *block = &cfg->Blocks[index];
+    walk->Color[index] = 1;
+    for (int i = 0; i < block->Succ_Count; ++i) {
+        int next = CFG_Find(cfg, block->Succ[i]);
+        if (next < 0 || next == walk->Entry) {
+            continue;
+        }
+        if (walk->Color[next] == 1) {
+            walk->Flags |= CFG_LOOP;
+        } else if (walk->Color[next] == 0) {
+            CFG_Visit(cfg, walk, next);
+        }
+    }
+    walk->Color[index] = 2;
+    walk->Order[walk->Count++] = index;
+}
+
+/**
+ * 经过块到出口的最少/最多周期, 返回或间接跳转的块就是出口
+ * 条件分支的跳转周期算在跳转的边上: 顺序执行不加, 跳转加 1、跳到另一页再加 1
+ * @param min 块本身(含调用的子程序)不跳转、不跨页的周期
+ * @param max 块本身的最多周期(含跳转)
+ * @return 0 没有路径
+ */
+static int CFG_Path(const struct CFG *cfg, const struct CFG_Walk *walk, const struct CFG_Block *block,
+                    unsigned long long min, unsigned long long max,
+                    unsigned long long *path_min, unsigned long long *path_max) {
+    if (block->Flow == OP_FLOW_RETURN || block->Unresolved) {
+        *path_min = min;
+        *path_max = max;
+        return 1;
+    }
+    Byte taken = 0;
+    if (block->Flow == OP_FLOW_BRANCH) {
+        Short next = block->Last + OP_Length(cfg->Mem[block->Last]);
+        taken = 1 + ((block->Succ[0] ^ next) >> 8 ? 1 : 0);
+    }
+    int found = 0;
+    for (int i = 0; i < block->Succ_Count; ++i) {
+        int next = CFG_Find(cfg, block->Succ[i]);
+        //Succ[0] 是跳转目标, Succ[1] 是顺序执行
+        unsigned long long low = min + (taken && i == 0 ? taken : 0);
+        unsigned long long high = max - (taken && i == 1 ? taken : 0);
+        if (next < 0) {
+            continue;
+        }
+        if (next != walk->Entry) {
+            if (walk->Min[next] == CFG_NO_PATH) {
+                continue;
+            }
+            low += walk->Min[next];
+            high += walk->Max[next];
+        }
+        if (!found || low < *path_min) {
+            *path_min = low;
+        }
+        if (!found || high > *path_max) {
+            *path_max = high;
+        }
+        found = 1;
+    }
+    return found;
+}
+
+const struct CFG_Routine *CFG_Routine(struct CFG *cfg, Short entry) {
+    int index = CFG_Find(cfg, entry);
+    if (index < 0) {
+        return NULL;
+    }
+    if (!cfg->Routines && !(cfg->Routines = calloc(cfg->Count, sizeof(struct CFG_Routine)))) {
+        return NULL;
+    }
+    struct CFG_Routine *routine = &cfg->Routines[index];
+    if (routine->State) {
+        return routine;
+    }
+    routine->State = 1;
+    struct CFG_Walk walk;
+    walk.Entry = index;
+    if (CFG_Walk_Alloc(&walk, cfg->Count)) {
+        CFG_Walk_Free(&walk);
+        routine->State = 0;
+        return NULL;
+    }
+    CFG_Visit(cfg, &walk, index);
+    //JSR 调用的子程序先算好, 计算中的是递归
+    for (int i = 0; i < walk.Count; ++i) {
+        const struct CFG_Block *block = &cfg->Blocks[walk.Order[i]];
+        if (block->Flow == OP_FLOW_CALL) {
+            const struct CFG_Routine *callee = CFG_Routine(cfg, block->Call);
+            if (!callee || callee->State == 1) {
+                walk.Flags |= CFG_RECURSION;
+            } else {
+                walk.Flags |= callee->Flags & ~CFG_NO_RETURN;
+            }
+        }
+        walk.Min[walk.Order[i]] = CFG_NO_PATH;
+        walk.Max[walk.Order[i]] = 0;
+    }
+    //按后序反复松弛: 无环时一遍就得到最长/最短路径, 有环时最短路径仍然收敛(最长路径没有上限)
+    for (int changed = 1; changed;) {
+        changed = 0;
+        for (int i = 0; i < walk.Count; ++i) {
+            int at = walk.Order[i];
+            const struct CFG_Block *block = &cfg->Blocks[at];
+            unsigned long long min = block->Min_Cycles;
+            unsigned long long max = block->Max_Cycles;
+            if (block->Flow == OP_FLOW_CALL) {
+                const struct CFG_Routine *callee = CFG_Routine(cfg, block->Call);
+                //递归的调用按 0 个周期计, Min 仍然是下限
+                if (callee && callee->State == 2) {
+                    if (callee->Min == CFG_UNBOUNDED) {
+                        continue;
+                    }
+                    min += callee->Min;
+                    max += callee->Max == CFG_UNBOUNDED ? 0 : callee->Max;
+                }
+            }
+            unsigned long long path_min, path_max;
+            if (!CFG_Path(cfg, &walk, block, min, max, &path_min, &path_max)) {
+                continue;
+            }
+            if (path_min < walk.Min[at]) {
+                walk.Min[at] = path_min;
+                changed = 1;
+            }
+            if (path_max > walk.Max[at] && !(walk.Flags & CFG_LOOP)) {
+                walk.Max[at] = path_max;
+                changed = 1;
+            }
+        }
+    }
+    for (int i = 0; i < walk.Count; ++i) {
+        walk.Flags |= cfg->Blocks[walk.Order[i]].Unresolved ? CFG_INDIRECT : 0;
+    }
+    if (walk.Min[index] == CFG_NO_PATH) {
+        walk.Flags |= CFG_NO_RETURN;
+        routine->Min = CFG_UNBOUNDED;
+    } else {
+        routine->Min = walk.Min[index] < CFG_UNBOUNDED ? walk.Min[index] : CFG_UNBOUNDED - 1;
+    }
+    if (walk.Flags || walk.Max[index] >= CFG_UNBOUNDED) {
+        routine->Max = CFG_UNBOUNDED;
+    } else {
+        routine->Max = walk.Max[index];
+    }
+    routine->Flags = walk.Flags;
+    routine->State = 2;
+    CFG_Walk_Free(&walk);
+    return routine;
+}
+
+/**
+ * 导出为 Graphviz dot: 每个块列出指令和周期范围, 虚线为 JSR 调用
+ * @param cfg
+ * @param fp
+ */
+void CFG_Export_Dot(const struct CFG *cfg, FILE *fp) {
+    char text[32];
+    fprintf(fp, "digraph cfg {\n    node [shape=box fontname=monospace];\n");
+    for (int i = 0; i < cfg->Count; ++i) {
+        const struct CFG_Block *block = &cfg->Blocks[i];
+        Short addr = block->Start;
+        fprintf(fp, "    b%04X [label=\"$%04X  %u-%u cycles\\l", block->Start, block->Start,
+                block->Min_Cycles, block->Max_Cycles);
+        for (int n = 0; n < block->Instructions; ++n) {
+            addr += OP_Disasm(cfg->Mem, addr, text, sizeof(text));
+            fprintf(fp, "%s\\l", text);
+        }
+        fprintf(fp, "%s\"];\n", block->Unresolved ? "(unresolved)\\l" : "");
+        for (int n = 0; n < block->Succ_Count; ++n) {
+            fprintf(fp, "    b%04X -> b%04X;\n", block->Start, block->Succ[n]);
+        }
+        if (block->Flow == OP_FLOW_CALL) {
+            fprintf(fp, "    b%04X -> b%04X [style=dashed];\n", block->Start, block->Call);
+        }
+    }
+    fprintf(fp, "}\n");
+}
+
+void CFG_Free(struct CFG *cfg) {
+    free(cfg->Blocks);
+    free(cfg->Routines);
+    cfg->Routines = NULL;
+    cfg->Blocks = NULL;
+    cfg->Count = cfg->Cap = 0;
+}
+
+/**
+ * 命令行: cfg <映像> <加载地址> [入口...]
+ * 没有给入口时使用映像里的 NMI/RESET/IRQ 向量, dot 输出到标准输出
+ */
+int CFG_Main(int argc, char **argv) {
+    static Byte mem[0x10000];
+    static struct CFG cfg;
+    Short entries[16];
+    int count = 0;
+    if (argc == 1 && strcmp(argv[0], "--check") == 0) {
+        int bad = OP_Check(stdout);
+        printf("%d opcode%s differ from CPU_Exec\n", bad, bad == 1 ? "" : "s");
+        return bad != 0;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: cfg <image> <load> [entry...]\n"
+                        "       cfg --check\n");
+        return 1;
+    }
+    FILE *fp = fopen(argv[0], "rb");
+    if (!fp) {
+        fprintf(stderr, "can't open %s\n", argv[0]);
+        return 1;
+    }
+    Short load = strtoul(argv[1], NULL, 0);
+    size_t size = fread(mem + load, 1, 0x10000 - load, fp);
+    fclose(fp);
+    for (int i = 2; i < argc && count < 16; ++i) {
+        entries[count++] = strtoul(argv[i], NULL, 0);
+    }
+    if (count == 0) {
+        count = CFG_Vectors(mem, entries);
+    }
+    CFG_Init(&cfg, mem, load, size ? load + size - 1 : load);
+    CFG_Build(&cfg, entries, count);
+    CFG_Export_Dot(&cfg, stdout);
+    CFG_Free(&cfg);
+    return 0;
+}
@@ -0,0 +1,589 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "include/checkpoint.h"
+
+static const char Checkpoint_Magic[4] = {'6', 'C', 'K', 'P'};
+
+static const Byte Checkpoint_Zero[256];
+
+//FNV-1a 64
+static unsigned long long Checkpoint_Hash(unsigned long long hash, const Byte *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+/**
+ * 页指向映射器的 ROM/RAM bank, 内容由 bank 选择决定
+ */
+static int Checkpoint_Is_Bank(const struct Mapper *mapper, const Byte *data) {
+    if (!mapper || !data) {
+        return 0;
+    }
+    return (mapper->ROM && data >= mapper->ROM && data < mapper->ROM + mapper->ROM_Size)
+           || (mapper->RAM && data >= mapper->RAM && data < mapper->RAM + mapper->RAM_Size);
+}
+
+//-------------编码-----------------
+
+static int Checkpoint_Put(struct Checkpoint *ckpt, Byte value) {
+    if (ckpt->Out_Len == ckpt->Out_Cap) {
+        size_t cap = ckpt->Out_Cap ? ckpt->Out_Cap * 2 : 65536;
+        Byte *out = realloc(ckpt->Out, cap);
+        if (!out) {
+            return -1;
+        }
+        ckpt->Out = out;
+        ckpt->Out_Cap = cap;
+    }
+    ckpt->Out[ckpt->Out_Len++] = value;
+    return 0;
+}
+
+static int Checkpoint_Put_Varint(struct Checkpoint *ckpt, unsigned long long value) {
+    while (value >= 0x80) {
+        if (Checkpoint_Put(ckpt, (value & 0x7F) | 0x80)) {
+            return -1;
+        }
+        value >>= 7;
+    }
+    return Checkpoint_Put(ckpt, value);
+}
+
+static int Checkpoint_Put_U64(struct Checkpoint *ckpt, unsigned long long value) {
+    for (int i = 0; i < 8; ++i) {
+        if (Checkpoint_Put(ckpt, value >> (i * 8))) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 一页相对基准的差异: (相同字节数, 不同字节数, 不同的字节)... 直到 256 字节
+ */
+static int Checkpoint_Put_Page(struct Checkpoint *ckpt, const Byte *data, const Byte *base) {
+    int pos = 0;
+    while (pos < 256) {
+        int skip = 0;
+        while (pos + skip < 256 && skip < 255 && data[pos + skip] == base[pos + skip]) {
+            skip++;
+        }
+        pos += skip;
+        int count = 0;
+        while (pos + count < 256 && count < 255 && data[pos + count] != base[pos + count]) {
+            count++;
+        }
+        if (Checkpoint_Put(ckpt, skip) || Checkpoint_Put(ckpt, count)) {
+            return -1;
+        }
+        for (int i = 0; i < count; ++i) {
+            if (Checkpoint_Put(ckpt, data[pos + i])) {
+                return -1;
+            }
+        }
+        pos += count;
+    }
+    return 0;
+}
+
+/**
+ * 把 State 编码到 Out
+ */
+static int Checkpoint_Encode(struct Checkpoint *ckpt) {
+    const struct Checkpoint_State *state = &ckpt->State;
+    const struct Mapper *mapper = ckpt->Mapper;
+    int err = 0;
+    ckpt->Out_Len = 0;
+    for (int i = 0; i < 4; ++i) {
+        err |= Checkpoint_Put(ckpt, Checkpoint_Magic[i]);
+    }
+    err |= Checkpoint_Put(ckpt, CHECKPOINT_VERSION);
+    err |= Checkpoint_Put(ckpt, CPU_VARIANT);
+    err |= Checkpoint_Put_U64(ckpt, ckpt->Base_Hash);
+    err |= Checkpoint_Put_Varint(ckpt, state->Cycles);
+    err |= Checkpoint_Put(ckpt, state->PC & 0xFF);
+    err |= Checkpoint_Put(ckpt, state->PC >> 8);
+    const Byte regs[] = {state->SP, state->A, state->X, state->Y, state->F_N, state->F_V, state->F_B, state->F_D,
+                         state->F_I, state->F_Z, state->F_C, state->Halted, state->IRQ_Line, state->NMI_Pending};
+    for (size_t i = 0; i < sizeof(regs); ++i) {
+        err |= Checkpoint_Put(ckpt, regs[i]);
+    }
+    int pages = 0;
+    for (int page = 0; page < 256; ++page) {
+        pages += !state->Skip[page] && memcmp(state->Mem + (page << 8), ckpt->Base + (page << 8), 256) != 0;
+    }
+    err |= Checkpoint_Put_Varint(ckpt, pages);
+    for (int page = 0; page < 256; ++page) {
+        const Byte *data = state->Mem + (page << 8);
+        const Byte *base = ckpt->Base + (page << 8);
+        if (!state->Skip[page] && memcmp(data, base, 256) != 0) {
+            err |= Checkpoint_Put(ckpt, page);
+            err |= Checkpoint_Put_Page(ckpt, data, base);
+        }
+    }
+    int windows = mapper ? mapper->Window_Count : 0;
+    err |= Checkpoint_Put(ckpt, windows);
+    if (windows) {
+        for (int i = 0; i < windows; ++i) {
+            err |= Checkpoint_Put_Varint(ckpt, state->Banks[i]);
+        }
+        for (int i = 0; i < 8; ++i) {
+            err |= Checkpoint_Put_Varint(ckpt, state->Regs[i]);
+        }
+        //RAM 相对全 0
+        unsigned int ram_pages = mapper->RAM_Size >> 8;
+        unsigned int changed = 0;
+        for (unsigned int page = 0; page < ram_pages; ++page) {
+            changed += memcmp(state->RAM + (page << 8), Checkpoint_Zero, 256) != 0;
+        }
+        err |= Checkpoint_Put_Varint(ckpt, changed);
+        for (unsigned int page = 0; page < ram_pages; ++page) {
+            const Byte *data = state->RAM + (page << 8);
+            if (memcmp(data, Checkpoint_Zero, 256) != 0) {
+                err |= Checkpoint_Put_Varint(ckpt, page);
+                err |= Checkpoint_Put_Page(ckpt, data, Checkpoint_Zero);
+            }
+        }
+    }
+    err |= Checkpoint_Put_U64(ckpt, Checkpoint_Hash(0xCBF29CE484222325ULL, ckpt->Out, ckpt->Out_Len));
+    return err ? -1 : 0;
+}
+
+//-------------写入线程-----------------
+
+/**
+ * 写临时文件, fsync 之后改名覆盖, 再 fsync 目录, 中途崩溃时旧的检查点仍然完整
+ */
+static int Checkpoint_Write(struct Checkpoint *ckpt, const Byte *data, size_t size) {
+    size_t len = strlen(ckpt->Path);
+    char *tmp = malloc(len + 5);
+    if (!tmp) {
+        return -1;
+    }
+    memcpy(tmp, ckpt->Path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int err = fd < 0;
+    for (size_t done = 0; !err && done < size;) {
+        ssize_t n = write(fd, data + done, size - done);
+        if (n <= 0) {
+            err = 1;
+        } else {
+            done += n;
+        }
+    }
+    if (fd >= 0) {
+        err |= fsync(fd) != 0;
+        err |= close(fd) != 0;
+    }
+    if (!err && rename(tmp, ckpt->Path) == 0) {
+        char *slash = strrchr(ckpt->Path, '/');
+        if (slash) {
+            memcpy(tmp, ckpt->Path, slash - ckpt->Path + 1);
+            tmp[slash - ckpt->Path + 1] = '\0';
+        } else {
+            strcpy(tmp, ".");
+        }
+        int dir = open(tmp, O_RDONLY);
+        if (dir >= 0) {
+            fsync(dir);
+            close(dir);
+        }
+    } else {
+        unlink(tmp);
+        err = 1;
+    }
+    free(tmp);
+    return err ? -1 : 0;
+}
+
+/**
+ * 编码完就放开 State, 写文件期间 CPU 线程可以拷贝下一个快照
+ */
+static void *Checkpoint_Thread(void *arg) {
+    struct Checkpoint *ckpt = arg;
+    Byte *data = NULL;
+    pthread_mutex_lock(&ckpt->Lock);
+    for (;;) {
+        while (!ckpt->Pending && !ckpt->Stop) {
+            pthread_cond_wait(&ckpt->Cond, &ckpt->Lock);
+        }
+        if (!ckpt->Pending) {
+            break;
+        }
+        ckpt->Writing = 1;
+        pthread_mutex_unlock(&ckpt->Lock);
+        int err = Checkpoint_Encode(ckpt);
+        size_t size = ckpt->Out_Len;
+        Byte *copy = err ? NULL : realloc(data, size);
+        if (copy) {
+            data = copy;
+            memcpy(data, ckpt->Out, size);
+        }
+        pthread_mutex_lock(&ckpt->Lock);
+        ckpt->Pending = 0;
+        pthread_cond_broadcast(&ckpt->Cond);
+        pthread_mutex_unlock(&ckpt->Lock);
+        err = copy ? Checkpoint_Write(ckpt, data, size) : -1;
+        pthread_mutex_lock(&ckpt->Lock);
+        ckpt->Error = err;
+        if (!err) {
+            ckpt->Written++;
+            ckpt->Bytes = size;
+        }
+        ckpt->Writing = ckpt->Pending;
+        pthread_cond_broadcast(&ckpt->Cond);
+    }
+    pthread_mutex_unlock(&ckpt->Lock);
+    free(data);
+    return NULL;
+}
+
+//-------------接口-----------------
+
+int Checkpoint_Init(struct Checkpoint *ckpt, struct CPU_Context *cpu, struct Mapper *mapper, const char *path) {
+    memset(ckpt, 0, sizeof(*ckpt));
+    ckpt->Cpu = cpu;
+    ckpt->Mapper = mapper;
+    ckpt->Path = strdup(path);
+    if (mapper && mapper->RAM_Size) {
+        ckpt->State.RAM = malloc(mapper->RAM_Size);
+    }
+    if (!ckpt->Path || (mapper && mapper->RAM_Size && !ckpt->State.RAM)) {
+        free(ckpt->Path);
+        free(ckpt->State.RAM);
+        return -1;
+    }
+    const struct Bus *bus = cpu->Bus;
+    for (int page = 0; page < 256; ++page) {
+        const Byte *data = bus->Backing[page];
+        memcpy(ckpt->Base + (page << 8), data ? data : Checkpoint_Zero, 256);
+    }
+    //基准: CPU 型号、地址空间和映射器的 ROM
+    Byte variant = CPU_VARIANT;
+    unsigned long long hash = Checkpoint_Hash(0xCBF29CE484222325ULL, &variant, 1);
+    hash = Checkpoint_Hash(hash, ckpt->Base, sizeof(ckpt->Base));
+    if (mapper) {
+        hash = Checkpoint_Hash(hash, (const Byte *) mapper->Type->Name, strlen(mapper->Type->Name));
+        hash = Checkpoint_Hash(hash, mapper->ROM, mapper->ROM_Size);
+    }
+    ckpt->Base_Hash = hash;
+    pthread_mutex_init(&ckpt->Lock, NULL);
+    pthread_cond_init(&ckpt->Cond, NULL);
+    if (pthread_create(&ckpt->Thread, NULL, Checkpoint_Thread, ckpt)) {
+        pthread_cond_destroy(&ckpt->Cond);
+        pthread_mutex_destroy(&ckpt->Lock);
+        free(ckpt->Path);
+        free(ckpt->State.RAM);
+        return -1;
+    }
+    return 0;
+}
+
+void Checkpoint_Free(struct Checkpoint *ckpt) {
+    pthread_mutex_lock(&ckpt->Lock);
+    ckpt->Stop = 1;
+    pthread_cond_broadcast(&ckpt->Cond);
+    pthread_mutex_unlock(&ckpt->Lock);
+    pthread_join(ckpt->Thread, NULL);
+    pthread_cond_destroy(&ckpt->Cond);
+    pthread_mutex_destroy(&ckpt->Lock);
+    free(ckpt->Path);
+    free(ckpt->State.RAM);
+    free(ckpt->Out);
+    ckpt->Path = NULL;
+    ckpt->State.RAM = NULL;
+    ckpt->Out = NULL;
+}
+
+int Checkpoint_Take(struct Checkpoint *ckpt) {
+    const struct CPU_Context *cpu = ckpt->Cpu;
+    if (cpu->Suspended || cpu->Retry) {
+        return -1;
+    }
+    pthread_mutex_lock(&ckpt->Lock);
+    int busy = ckpt->Pending;
+    ckpt->Skipped += busy;
+    pthread_mutex_unlock(&ckpt->Lock);
+    if (busy) {
+        return 1;
+    }
+    //Pending 为 0 时写入线程不读 State
+    struct Checkpoint_State *state = &ckpt->State;
+    state->PC = cpu->PC;
+    state->SP = cpu->SP;
+    state->A = cpu->A;
+    state->X = cpu->X;
+    state->Y = cpu->Y;
+    state->F_N = cpu->F_N;
+    state->F_V = cpu->F_V;
+    state->F_B = cpu->F_B;
+    state->F_D = cpu->F_D;
+    state->F_I = cpu->F_I;
+    state->F_Z = cpu->F_Z;
+    state->F_C = cpu->F_C;
+    state->Halted = cpu->Halted;
+    state->IRQ_Line = cpu->IRQ_Line;
+    state->NMI_Pending = cpu->NMI_Pending;
+    state->Cycles = cpu->Cycles;
+    const struct Bus *bus = cpu->Bus;
+    const struct Mapper *mapper = ckpt->Mapper;
+    for (int page = 0; page < 256; ++page) {
+        const Byte *data = bus->Backing[page];
+        state->Skip[page] = Checkpoint_Is_Bank(mapper, data);
+        memcpy(state->Mem + (page << 8), data ? data : Checkpoint_Zero, 256);
+    }
+    if (mapper) {
+        for (int i = 0; i < mapper->Window_Count; ++i) {
+            state->Banks[i] = mapper->Windows[i].Bank;
+        }
+        memcpy(state->Regs, mapper->Regs, sizeof(state->Regs));
+        if (mapper->RAM_Size) {
+            memcpy(state->RAM, mapper->RAM, mapper->RAM_Size);
+        }
+    }
+    pthread_mutex_lock(&ckpt->Lock);
+    ckpt->Pending = 1;
+    ckpt->Writing = 1;
+    pthread_cond_broadcast(&ckpt->Cond);
+    pthread_mutex_unlock(&ckpt->Lock);
+    return 0;
+}
+
+int Checkpoint_Wait(struct Checkpoint *ckpt) {
+    pthread_mutex_lock(&ckpt->Lock);
+    while (ckpt->Pending || ckpt->Writing) {
+        pthread_cond_wait(&ckpt->Cond, &ckpt->Lock);
+    }
+    int err = ckpt->Error;
+    pthread_mutex_unlock(&ckpt->Lock);
+    return err;
+}
+
+//-------------恢复-----------------
+
+struct Checkpoint_Reader {
+    const Byte *Data;
+    size_t Len;
+    size_t Pos;
+    //读过了结尾
+    int Bad;
+};
+
+static Byte Checkpoint_Get(struct Checkpoint_Reader *in) {
+    if (in->Pos == in->Len) {
+        in->Bad = 1;
+        return 0;
+    }
+    return in->Data[in->Pos++];
+}
+
+static unsigned long long Checkpoint_Get_Varint(struct Checkpoint_Reader *in) {
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        Byte b = Checkpoint_Get(in);
+        value |= (unsigned long long) (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+static unsigned long long Checkpoint_Get_U64(struct Checkpoint_Reader *in) {
+    unsigned long long value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= (unsigned long long) Checkpoint_Get(in) << (i * 8);
+    }
+    return value;
+}
+
+/**
+ * 把差异应用到 page(内容已经是基准)
+ * @return 0 成功
+ */
+static int Checkpoint_Get_Page(struct Checkpoint_Reader *in, Byte *page) {
+    int pos = 0;
+    while (pos < 256 && !in->Bad) {
+        int skip = Checkpoint_Get(in);
+        int count = Checkpoint_Get(in);
+        if ((skip == 0 && count == 0) || pos + skip + count > 256 || in->Len - in->Pos < (size_t) count) {
+            return -1;
+        }
+        pos += skip;
+        memcpy(page + pos, in->Data + in->Pos, count);
+        in->Pos += count;
+        pos += count;
+    }
+    return in->Bad ? -1 : 0;
+}
+
+static Byte *Checkpoint_Read_File(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    Byte *data = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    for (;;) {
+        if (len == cap) {
+            cap = cap ? cap * 2 : 65536;
+            Byte *grown = realloc(data, cap);
+            if (!grown) {
+                free(data);
+                fclose(file);
+                return NULL;
+            }
+            data = grown;
+        }
+        size_t n = fread(data + len, 1, cap - len, file);
+        if (n == 0) {
+            break;
+        }
+        len += n;
+    }
+    fclose(file);
+    *size = len;
+    return data;
+}
+
+/**
+ * 先把内容解码到临时的快照里, 全部检查通过之后才改 CPU、总线和映射器
+ */
+static int Checkpoint_Decode(struct Checkpoint *ckpt, struct Checkpoint_Reader *in, struct Checkpoint_State *state) {
+    const struct Mapper *mapper = ckpt->Mapper;
+    if (in->Len < 22 || memcmp(in->Data, Checkpoint_Magic, 4) != 0) {
+        return CHECKPOINT_BAD_FILE;
+    }
+    in->Pos = in->Len - 8;
+    unsigned long long sum = Checkpoint_Get_U64(in);
+    if (sum != Checkpoint_Hash(0xCBF29CE484222325ULL, in->Data, in->Len - 8) || in->Data[4] != CHECKPOINT_VERSION) {
+        return CHECKPOINT_BAD_FILE;
+    }
+    in->Len -= 8;
+    in->Pos = 6;
+    if (in->Data[5] != CPU_VARIANT || Checkpoint_Get_U64(in) != ckpt->Base_Hash) {
+        return CHECKPOINT_BAD_BASE;
+    }
+    state->Cycles = Checkpoint_Get_Varint(in);
+    state->PC = Checkpoint_Get(in);
+    state->PC |= Checkpoint_Get(in) << 8;
+    Byte *regs[] = {&state->SP, &state->A, &state->X, &state->Y, &state->F_N, &state->F_V, &state->F_B,
+                    &state->F_D, &state->F_I, &state->F_Z, &state->F_C, &state->Halted, &state->IRQ_Line,
+                    &state->NMI_Pending};
+    for (size_t i = 0; i < sizeof(regs) / sizeof(regs[0]); ++i) {
+        *regs[i] = Checkpoint_Get(in);
+    }
+    memcpy(state->Mem, ckpt->Base, sizeof(state->Mem));
+    memset(state->Skip, 1, sizeof(state->Skip));
+    unsigned long long pages = Checkpoint_Get_Varint(in);
+    if (pages > 256) {
+        return CHECKPOINT_BAD_FILE;
+    }
+    for (unsigned long long i = 0; i < pages; ++i) {
+        Byte page = Checkpoint_Get(in);
+        //Skip 在这里表示没有变化的页
+        state->Skip[page] = 0;
+        if (Checkpoint_Get_Page(in, state->Mem + (page << 8))) {
+            return CHECKPOINT_BAD_FILE;
+        }
+    }
+    int windows = Checkpoint_Get(in);
+    if (windows != (mapper ? mapper->Window_Count : 0)) {
+        return CHECKPOINT_BAD_BASE;
+    }
+    if (windows) {
+        for (int i = 0; i < windows; ++i) {
+            state->Banks[i] = Checkpoint_Get_Varint(in);
+        }
+        for (int i = 0; i < 8; ++i) {
+            state->Regs[i] = Checkpoint_Get_Varint(in);
+        }
+        unsigned int ram_pages = mapper->RAM_Size >> 8;
+        if (ram_pages) {
+            memset(state->RAM, 0, mapper->RAM_Size);
+        }
+        unsigned long long changed = Checkpoint_Get_Varint(in);
+        if (changed > ram_pages) {
+            return CHECKPOINT_BAD_FILE;
+        }
+        for (unsigned long long i = 0; i < changed; ++i) {
+            unsigned long long page = Checkpoint_Get_Varint(in);
+            if (page >= ram_pages || Checkpoint_Get_Page(in, state->RAM + (page << 8))) {
+                return CHECKPOINT_BAD_FILE;
+            }
+        }
+    }
+    return in->Bad || in->Pos != in->Len ? CHECKPOINT_BAD_FILE : 0;
+}
+
+int Checkpoint_Restore(struct Checkpoint *ckpt, const char *path) {
+    struct Checkpoint_Reader in = {0};
+    in.Data = Checkpoint_Read_File(path, &in.Len);
+    if (!in.Data) {
+        return CHECKPOINT_BAD_FILE;
+    }
+    //写入线程可能还在编码 State, 用单独的快照
+    struct Checkpoint_State *state = malloc(sizeof(*state));
+    struct Mapper *mapper = ckpt->Mapper;
+    int err = CHECKPOINT_BAD_FILE;
+    if (state) {
+        state->RAM = mapper && mapper->RAM_Size ? malloc(mapper->RAM_Size) : NULL;
+        if (!mapper || !mapper->RAM_Size || state->RAM) {
+            err = Checkpoint_Decode(ckpt, &in, state);
+        }
+    }
+    free((void *) in.Data);
+    if (err) {
+        if (state) {
+            free(state->RAM);
+        }
+        free(state);
+        return err;
+    }
+    //先切 bank 再写内存页, bank 页不在差异里
+    if (mapper) {
+        for (int i = 0; i < mapper->Window_Count; ++i) {
+            Mapper_Select(mapper, i, state->Banks[i]);
+        }
+        memcpy(mapper->Regs, state->Regs, sizeof(mapper->Regs));
+        if (mapper->RAM_Size) {
+            memcpy(mapper->RAM, state->RAM, mapper->RAM_Size);
+        }
+    }
+    struct Bus *bus = ckpt->Cpu->Bus;
+    for (int page = 0; page < 256; ++page) {
+        if (!state->Skip[page]) {
+            Bus_Load(bus, page << 8, state->Mem + (page << 8), 256);
+        }
+    }
+    struct CPU_Context *cpu = ckpt->Cpu;
+    cpu->PC = state->PC;
+    cpu->SP = state->SP;
+    cpu->A = state->A;
+    cpu->X = state->X;
+    cpu->Y = state->Y;
+    cpu->F_N = state->F_N;
+    cpu->F_V = state->F_V;
+    cpu->F_B = state->F_B;
+    cpu->F_D = state->F_D;
+    cpu->F_I = state->F_I;
+    cpu->F_Z = state->F_Z;
+    cpu->F_C = state->F_C;
+    cpu->Halted = state->Halted;
+    cpu->IRQ_Line = state->IRQ_Line;
+    cpu->NMI_Pending = state->NMI_Pending;
+    CPU_Set_Cycles(cpu, state->Cycles);
+    cpu->Start_PC = state->PC;
+    cpu->Start_SP = state->SP;
+    cpu->Break = 0;
+    free(state->RAM);
+    free(state);
+    return 0;
+}
@@ -1,65 +1,2885 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "include/compiler.h"
+#include "include/opcodes.h"
+#include "include/cfg.h"
 
-#include <stdio.h>
-#include <malloc.h>
-
-void compile(FILE *fp){
-    char ch[256] = {0};
-    while (!feof(fp)) {
-        int line = 1;
-        fgets(ch,sizeof(ch) ,fp);
-        char *ins_mode = malloc(4);
-        char opcode[4] = {-1};
-        char mode = '0';
-        for (int i = 0; i < sizeof(ch); ++i) {
-            char c = ch[i];
-            if(c != ';') {
-                if(i <= 2) {
-                    if((c>='A' && c<='Z') || (c>='a' && c<='z')) {
-                        ins_mode[i] = c;
-                    } else {
-                        printf("Instruction error! line:%d,pos:%d\n",line,i+1);
-                        return;
-                    }
-                }else if(i == 3 && c!= ' ') {
-                    printf("Error! expected space! line:%d,pos:%d\n",line,i+1);
+//缓存文件格式, 词法单元或输出格式变化时加 1
+#define ASM_CACHE_VERSION 2
+//FNV-1a 64
+#define ASM_HASH_BASIS 0xCBF29CE484222325ULL
+#define ASM_HASH_PRIME 0x100000001B3ULL
+//地址收敛的最多遍数
+#define ASM_PASSES 16
+//对齐每次补一处, 补完重新计算地址, 最多这么多次
+#define ASM_ALIGN_ROUNDS 32
+#define ASM_CHUNK 65536
+
+//表达式节点
+#define ASM_NODE_NUM  0
+#define ASM_NODE_SYM  1
+//当前语句的地址 *
+#define ASM_NODE_PC   2
+#define ASM_NODE_NEG  3
+#define ASM_NODE_NOT  4
+#define ASM_NODE_LNOT 5
+//<expr 低字节, >expr 高字节
+#define ASM_NODE_LO   6
+#define ASM_NODE_HI   7
+#define ASM_NODE_BIN  8
+
+//操作数的写法
+#define ASM_SHAPE_NONE  0
+//A
+#define ASM_SHAPE_ACC   1
+//#e
+#define ASM_SHAPE_IMM   2
+//e
+#define ASM_SHAPE_ADDR  3
+//e,x
+#define ASM_SHAPE_X     4
+//e,y
+#define ASM_SHAPE_Y     5
+//(e,x)
+#define ASM_SHAPE_IND_X 6
+//(e),y
+#define ASM_SHAPE_IND_Y 7
+//(e)
+#define ASM_SHAPE_IND   8
+//e,e (BBR/BBS)
+#define ASM_SHAPE_PAIR  9
+
+struct ASM_Chunk {
+    struct ASM_Chunk *Next;
+    size_t Used;
+    size_t Size;
+    Byte Data[];
+};
+
+static unsigned long long ASM_Hash(unsigned long long hash, const void *data, size_t size) {
+    const Byte *p = data;
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ p[i]) * ASM_HASH_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * 报错, 位置为当前行
+ */
+static void ASM_Error(struct Assembler *as, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    if (as->Cur_File) {
+        fprintf(stderr, "%s:%d: error: ", as->Cur_File->Path, as->Cur_Line);
+    } else {
+        fprintf(stderr, "error: ");
+    }
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+    as->Errors++;
+}
+
+/**
+ * 单元内的内存, 单元结束时一起释放
+ */
+static void *ASM_Alloc(struct Assembler *as, size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+    struct ASM_Chunk *chunk = as->Chunks;
+    if (!chunk || chunk->Size - chunk->Used < size) {
+        size_t cap = size > ASM_CHUNK ? size : ASM_CHUNK;
+        chunk = malloc(sizeof(struct ASM_Chunk) + cap);
+        if (!chunk) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        chunk->Size = cap;
+        chunk->Used = 0;
+        chunk->Next = as->Chunks;
+        as->Chunks = chunk;
+    }
+    void *p = chunk->Data + chunk->Used;
+    chunk->Used += size;
+    return p;
+}
+
+/**
+ * 数组扩容
+ */
+static void *ASM_Grow(void *items, int *cap, int count, size_t size) {
+    if (count < *cap) {
+        return items;
+    }
+    *cap = *cap ? *cap * 2 : 256;
+    items = realloc(items, size * *cap);
+    if (!items) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return items;
+}
+
+static char *ASM_Read(const char *path, size_t *size) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = length >= 0 ? malloc(length + 1) : NULL;
+    if (!data || fread(data, 1, length, fp) != (size_t) length) {
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    data[length] = '\0';
+    *size = length;
+    return data;
+}
+
+static int ASM_Is(const struct ASM_Token *token, const char *text) {
+    return token->Type == ASM_TOK_IDENT && strlen(text) == token->Len && strncasecmp(token->Text, text, token->Len) == 0;
+}
+
+static int ASM_Is_Op(const struct ASM_Token *token, long op) {
+    return token->Type == ASM_TOK_OP && token->Value == op;
+}
+
+//-------------词法分析-----------------
+
+static int ASM_Ident_Start(char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_' || c == '.' || c == '@' || c == '\\';
+}
+
+static int ASM_Ident_Char(char c) {
+    return ASM_Ident_Start(c) || (c >= '0' && c <= '9');
+}
+
+static int ASM_Digit(char c, int base) {
+    int digit = c >= '0' && c <= '9' ? c - '0'
+              : c >= 'A' && c <= 'F' ? c - 'A' + 10
+              : c >= 'a' && c <= 'f' ? c - 'a' + 10 : 99;
+    return digit < base ? digit : -1;
+}
+
+static char ASM_Escape(const char **p) {
+    char c = *(*p)++;
+    if (c != '\\') {
+        return c;
+    }
+    c = *(*p)++;
+    switch (c) {
+        case 'n':
+            return '\n';
+        case 'r':
+            return '\r';
+        case 't':
+            return '\t';
+        case '0':
+            return '\0';
+        default:
+            return c;
+    }
+}
+
+/**
+ * 把整个文件切成词法单元, 字符串和标识符复制到 Pool
+ * @return 0 成功
+ */
+static int ASM_Lex(struct Assembler *as, struct ASM_File *file, const char *text, size_t size) {
+    static const char *ops2[] = {"<<", ">>", "<=", ">=", "==", "!=", "&&", "||"};
+    const char *p = text;
+    const char *end = text + size;
+    char *pool = malloc(size + 1);
+    int cap = 0;
+    int count = 0;
+    int line = 1;
+    int line_tokens = 0;
+    struct ASM_Token *tokens = NULL;
+    size_t used = 0;
+    as->Cur_File = file;
+    while (1) {
+        if (p >= end || *p == '\n') {
+            if (line_tokens) {
+                tokens = ASM_Grow(tokens, &cap, count, sizeof(*tokens));
+                tokens[count++] = (struct ASM_Token) {ASM_TOK_EOL, 0, line, 0, NULL};
+            }
+            if (p >= end) {
+                break;
+            }
+            p++;
+            line++;
+            line_tokens = 0;
+            continue;
+        }
+        char c = *p;
+        if (c == ' ' || c == '\t' || c == '\r') {
+            p++;
+            continue;
+        }
+        if (c == ';') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+            continue;
+        }
+        struct ASM_Token token = {ASM_TOK_IDENT, 0, line, 0, pool + used};
+        const struct ASM_Token *prev = line_tokens ? &tokens[count - 1] : NULL;
+        //% 在值后面是取模, 否则是二进制数
+        int value_before = prev && (prev->Type != ASM_TOK_OP || prev->Value == ')' || prev->Value == ']');
+        if (ASM_Ident_Start(c)) {
+            while (p < end && ASM_Ident_Char(*p)) {
+                pool[used++] = *p++;
+            }
+        } else if ((c >= '0' && c <= '9') || c == '$' || (c == '%' && !value_before && p + 1 < end
+                   && (p[1] == '0' || p[1] == '1'))) {
+            int base = 10;
+            const char *start = p;
+            if (c == '$') {
+                base = 16;
+                p++;
+            } else if (c == '%') {
+                base = 2;
+                p++;
+            } else if (c == '0' && p + 1 < end && (p[1] == 'x' || p[1] == 'X')) {
+                base = 16;
+                p += 2;
+            }
+            const char *digits = p;
+            while (p < end && ASM_Ident_Char(*p)) {
+                int digit = ASM_Digit(*p, base);
+                if (digit < 0) {
+                    as->Cur_Line = line;
+                    ASM_Error(as, "bad number");
+                    free(pool);
+                    free(tokens);
+                    return -1;
+                }
+                token.Value = token.Value * base + digit;
+                p++;
+            }
+            if (p == digits) {
+                as->Cur_Line = line;
+                ASM_Error(as, "bad number");
+                free(pool);
+                free(tokens);
+                return -1;
+            }
+            token.Type = ASM_TOK_NUMBER;
+            memcpy(pool + used, start, p - start);
+            used += p - start;
+        } else if (c == '\'' && p + 2 < end) {
+            p++;
+            token.Type = ASM_TOK_NUMBER;
+            token.Value = (Byte) ASM_Escape(&p);
+            if (p >= end || *p != '\'') {
+                as->Cur_Line = line;
+                ASM_Error(as, "bad character constant");
+                free(pool);
+                free(tokens);
+                return -1;
+            }
+            p++;
+            //原文只用于宏参数拼接, 用十进制代替, 不会比原文长
+            used += sprintf(pool + used, "%ld", token.Value);
+        } else if (c == '"') {
+            p++;
+            token.Type = ASM_TOK_STRING;
+            while (p < end && *p != '"' && *p != '\n') {
+                pool[used++] = ASM_Escape(&p);
+            }
+            if (p >= end || *p != '"') {
+                as->Cur_Line = line;
+                ASM_Error(as, "unterminated string");
+                free(pool);
+                free(tokens);
+                return -1;
+            }
+            p++;
+        } else {
+            token.Type = ASM_TOK_OP;
+            token.Value = c;
+            for (int i = 0; i < 8; ++i) {
+                if (p + 1 < end && c == ops2[i][0] && p[1] == ops2[i][1]) {
+                    token.Value = ASM_OP2(c, p[1]);
+                    p++;
+                    break;
+                }
+            }
+            p++;
+            if (!strchr("+-*/%&|^~!<>()[],#:=", c)) {
+                as->Cur_Line = line;
+                ASM_Error(as, "unexpected character '%c'", c);
+                free(pool);
+                free(tokens);
+                return -1;
+            }
+        }
+        token.Len = pool + used - token.Text;
+        tokens = ASM_Grow(tokens, &cap, count, sizeof(*tokens));
+        tokens[count++] = token;
+        line_tokens++;
+    }
+    file->Tokens = tokens;
+    file->Count = count;
+    file->Pool = pool;
+    return 0;
+}
+
+//-------------文件缓存-----------------
+
+static void ASM_Cache_Path(const struct Assembler *as, char *path, size_t size, const char *kind,
+                           unsigned long long hash) {
+    snprintf(path, size, "%s/%s-%016llx", as->Cache_Dir, kind, hash);
+}
+
+/**
+ * 先写临时文件再改名, 并行构建时不会读到写了一半的缓存
+ */
+static FILE *ASM_Cache_Create(char *tmp, size_t size, const char *path) {
+    snprintf(tmp, size, "%s.%d", path, (int) getpid());
+    return fopen(tmp, "wb");
+}
+
+static void ASM_Cache_Commit(FILE *fp, const char *tmp, const char *path, int ok) {
+    if (fclose(fp) != 0 || !ok || rename(tmp, path) != 0) {
+        remove(tmp);
+    }
+}
+
+/**
+ * 词法单元缓存: 头 + 每个单元(文本改为 Pool 里的偏移) + Pool
+ */
+struct ASM_Token_Record {
+    unsigned int Type;
+    unsigned int Len;
+    int Line;
+    unsigned int Text;
+    long long Value;
+};
+
+static void ASM_Tokens_Save(const struct Assembler *as, const struct ASM_File *file) {
+    char path[4096];
+    char tmp[4200];
+    ASM_Cache_Path(as, path, sizeof(path), "tok", file->Hash);
+    FILE *fp = ASM_Cache_Create(tmp, sizeof(tmp), path);
+    if (!fp) {
+        return;
+    }
+    size_t pool = 0;
+    for (int i = 0; i < file->Count; ++i) {
+        if (file->Tokens[i].Text && (size_t) (file->Tokens[i].Text - file->Pool) + file->Tokens[i].Len > pool) {
+            pool = file->Tokens[i].Text - file->Pool + file->Tokens[i].Len;
+        }
+    }
+    unsigned int header[4] = {0x54353641, ASM_CACHE_VERSION, file->Count, pool};
+    int ok = fwrite(header, sizeof(header), 1, fp) == 1;
+    for (int i = 0; i < file->Count && ok; ++i) {
+        const struct ASM_Token *token = &file->Tokens[i];
+        struct ASM_Token_Record record = {token->Type, token->Len, token->Line,
+                                          token->Text ? token->Text - file->Pool : 0, token->Value};
+        ok = fwrite(&record, sizeof(record), 1, fp) == 1;
+    }
+    ok = ok && fwrite(file->Pool, 1, pool, fp) == pool;
+    ASM_Cache_Commit(fp, tmp, path, ok);
+}
+
+static int ASM_Tokens_Load(const struct Assembler *as, struct ASM_File *file) {
+    char path[4096];
+    ASM_Cache_Path(as, path, sizeof(path), "tok", file->Hash);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    unsigned int header[4];
+    if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != 0x54353641 || header[1] != ASM_CACHE_VERSION) {
+        fclose(fp);
+        return -1;
+    }
+    struct ASM_Token *tokens = malloc(sizeof(*tokens) * (header[2] ? header[2] : 1));
+    struct ASM_Record_Buffer {
+        struct ASM_Token_Record Records[256];
+    } *buffer = malloc(sizeof(*buffer));
+    char *pool = malloc(header[3] + 1);
+    int ok = tokens && buffer && pool;
+    for (unsigned int i = 0; i < header[2] && ok; i += 256) {
+        unsigned int n = header[2] - i < 256 ? header[2] - i : 256;
+        ok = fread(buffer->Records, sizeof(struct ASM_Token_Record), n, fp) == n;
+        for (unsigned int j = 0; j < n && ok; ++j) {
+            const struct ASM_Token_Record *record = &buffer->Records[j];
+            ok = record->Text + record->Len <= header[3];
+            tokens[i + j] = (struct ASM_Token) {record->Type, record->Len, record->Line, record->Value,
+                                                record->Type == ASM_TOK_EOL ? NULL : pool + record->Text};
+        }
+    }
+    ok = ok && fread(pool, 1, header[3], fp) == header[3];
+    fclose(fp);
+    free(buffer);
+    if (!ok) {
+        free(tokens);
+        free(pool);
+        return -1;
+    }
+    file->Tokens = tokens;
+    file->Count = header[2];
+    file->Pool = pool;
+    return 0;
+}
+
+static void ASM_Dep_Add(struct Assembler *as, const char *path, unsigned long long hash) {
+    for (int i = 0; i < as->Dep_Count; ++i) {
+        if (strcmp(as->Deps[i].Path, path) == 0) {
+            return;
+        }
+    }
+    as->Deps = ASM_Grow(as->Deps, &as->Dep_Cap, as->Dep_Count, sizeof(*as->Deps));
+    as->Deps[as->Dep_Count].Path = strdup(path);
+    as->Deps[as->Dep_Count++].Hash = hash;
+}
+
+/**
+ * 读源文件, 内容没变时用内存里或缓存目录里的词法单元
+ */
+static struct ASM_File *ASM_Load(struct Assembler *as, const char *path) {
+    size_t size;
+    char *text = ASM_Read(path, &size);
+    if (!text) {
+        ASM_Error(as, "can't open %s", path);
+        return NULL;
+    }
+    unsigned long long hash = ASM_Hash(ASM_HASH_BASIS, text, size);
+    ASM_Dep_Add(as, path, hash);
+    for (struct ASM_File *file = as->Files; file; file = file->Next) {
+        if (file->Hash == hash && strcmp(file->Path, path) == 0) {
+            free(text);
+            return file;
+        }
+    }
+    struct ASM_File *file = calloc(1, sizeof(*file));
+    file->Path = strdup(path);
+    file->Hash = hash;
+    const struct ASM_File *from = as->Cur_File;
+    int line = as->Cur_Line;
+    if (!as->Cache_Dir || ASM_Tokens_Load(as, file)) {
+        if (ASM_Lex(as, file, text, size)) {
+            free(text);
+            free(file->Path);
+            free(file);
+            as->Cur_File = from;
+            as->Cur_Line = line;
+            return NULL;
+        }
+        if (as->Cache_Dir) {
+            ASM_Tokens_Save(as, file);
+        }
+    }
+    as->Cur_File = from;
+    as->Cur_Line = line;
+    free(text);
+    file->Next = as->Files;
+    as->Files = file;
+    return file;
+}
+
+/**
+ * 相对路径先找包含它的文件所在的目录, 再找 -I 目录
+ */
+static int ASM_Resolve(const struct Assembler *as, const char *name, char *path, size_t size) {
+    if (name[0] == '/' || !as->Cur_File) {
+        snprintf(path, size, "%s", name);
+        return 0;
+    }
+    const char *slash = strrchr(as->Cur_File->Path, '/');
+    if (slash) {
+        snprintf(path, size, "%.*s/%s", (int) (slash - as->Cur_File->Path), as->Cur_File->Path, name);
+    } else {
+        snprintf(path, size, "%s", name);
+    }
+    if (access(path, R_OK) == 0) {
+        return 0;
+    }
+    for (int i = 0; i < as->Dir_Count; ++i) {
+        snprintf(path, size, "%s/%s", as->Dirs[i], name);
+        if (access(path, R_OK) == 0) {
+            return 0;
+        }
+    }
+    snprintf(path, size, "%s", name);
+    return -1;
+}
+
+//-------------符号-----------------
+
+static unsigned int ASM_Name_Hash(const char *name, int len) {
+    return (unsigned int) ASM_Hash(ASM_HASH_BASIS, name, len);
+}
+
+/**
+ * 查找符号, 没有时新建一个未定义的
+ * @return 下标
+ */
+static int ASM_Symbol(struct Assembler *as, const char *name, int len) {
+    if (as->Symbol_Count * 2 >= as->Hash_Cap) {
+        int cap = as->Hash_Cap ? as->Hash_Cap * 2 : 1024;
+        free(as->Symbol_Hash);
+        as->Symbol_Hash = calloc(cap, sizeof(int));
+        as->Hash_Cap = cap;
+        for (int i = 0; i < as->Symbol_Count; ++i) {
+            unsigned int slot = ASM_Name_Hash(as->Symbols[i].Name, as->Symbols[i].Len) & (cap - 1);
+            while (as->Symbol_Hash[slot]) {
+                slot = (slot + 1) & (cap - 1);
+            }
+            as->Symbol_Hash[slot] = i + 1;
+        }
+    }
+    unsigned int slot = ASM_Name_Hash(name, len) & (as->Hash_Cap - 1);
+    while (as->Symbol_Hash[slot]) {
+        const struct ASM_Symbol *symbol = &as->Symbols[as->Symbol_Hash[slot] - 1];
+        if (symbol->Len == len && memcmp(symbol->Name, name, len) == 0) {
+            return as->Symbol_Hash[slot] - 1;
+        }
+        slot = (slot + 1) & (as->Hash_Cap - 1);
+    }
+    as->Symbols = ASM_Grow(as->Symbols, &as->Symbol_Cap, as->Symbol_Count, sizeof(*as->Symbols));
+    struct ASM_Symbol *symbol = &as->Symbols[as->Symbol_Count];
+    memset(symbol, 0, sizeof(*symbol));
+    symbol->Name = name;
+    symbol->Len = len;
+    symbol->Pass = -1;
+    as->Symbol_Hash[slot] = ++as->Symbol_Count;
+    return as->Symbol_Count - 1;
+}
+
+/**
+ * 在当前遍定义符号, 值变化时需要再算一遍
+ */
+static void ASM_Set(struct Assembler *as, int index, Byte kind, long value) {
+    struct ASM_Symbol *symbol = &as->Symbols[index];
+    if (symbol->Kind == ASM_SYM_MACRO || (symbol->Kind && symbol->Kind != kind)
+        || (symbol->Defined && (symbol->Pass == as->Pass || !symbol->File))) {
+        if (as->Pass <= 1) {
+            ASM_Error(as, "%.*s redefined", symbol->Len, symbol->Name);
+        }
+        return;
+    }
+    if (!symbol->Defined || symbol->Value != value) {
+        as->Changed = 1;
+    }
+    symbol->Kind = kind;
+    symbol->Defined = 1;
+    symbol->Pass = as->Pass;
+    symbol->Value = value;
+    symbol->File = as->Cur_File;
+    symbol->Line = as->Cur_Line;
+}
+
+int ASM_Lookup(const struct Assembler *as, const char *name, long *value) {
+    size_t len = strlen(name);
+    if (!as->Hash_Cap) {
+        return -1;
+    }
+    unsigned int slot = ASM_Name_Hash(name, len) & (as->Hash_Cap - 1);
+    while (as->Symbol_Hash[slot]) {
+        const struct ASM_Symbol *symbol = &as->Symbols[as->Symbol_Hash[slot] - 1];
+        if (symbol->Len == len && memcmp(symbol->Name, name, len) == 0) {
+            if (!symbol->Defined || symbol->Kind == ASM_SYM_MACRO) {
+                return -1;
+            }
+            *value = symbol->Value;
+            return 0;
+        }
+        slot = (slot + 1) & (as->Hash_Cap - 1);
+    }
+    return -1;
+}
+
+//-------------表达式-----------------
+
+struct ASM_Parser {
+    struct Assembler *As;
+    const struct ASM_Token *Tokens;
+    int Pos;
+    int End;
+};
+
+static int ASM_Node(struct Assembler *as, Byte op, long value, int left, int right) {
+    as->Nodes = ASM_Grow(as->Nodes, &as->Node_Cap, as->Node_Count, sizeof(*as->Nodes));
+    as->Nodes[as->Node_Count] = (struct ASM_Node) {op, left, right, value};
+    return as->Node_Count++;
+}
+
+/**
+ * 二元运算符的优先级, 不是二元运算符时为 0
+ */
+static int ASM_Precedence(const struct ASM_Token *token) {
+    if (token->Type != ASM_TOK_OP) {
+        return 0;
+    }
+    switch (token->Value) {
+        case ASM_OP2('|', '|'):
+            return 1;
+        case ASM_OP2('&', '&'):
+            return 2;
+        case '|':
+            return 3;
+        case '^':
+            return 4;
+        case '&':
+            return 5;
+        case ASM_OP2('=', '='):
+        case ASM_OP2('!', '='):
+            return 6;
+        case '<':
+        case '>':
+        case ASM_OP2('<', '='):
+        case ASM_OP2('>', '='):
+            return 7;
+        case ASM_OP2('<', '<'):
+        case ASM_OP2('>', '>'):
+            return 8;
+        case '+':
+        case '-':
+            return 9;
+        case '*':
+        case '/':
+        case '%':
+            return 10;
+        default:
+            return 0;
+    }
+}
+
+static int ASM_Parse_Binary(struct ASM_Parser *parser, int min);
+
+static int ASM_Parse_Unary(struct ASM_Parser *parser) {
+    if (parser->Pos >= parser->End) {
+        return -1;
+    }
+    struct Assembler *as = parser->As;
+    const struct ASM_Token *token = &parser->Tokens[parser->Pos++];
+    switch (token->Type) {
+        case ASM_TOK_NUMBER:
+            return ASM_Node(as, ASM_NODE_NUM, token->Value, -1, -1);
+        case ASM_TOK_IDENT:
+            return ASM_Node(as, ASM_NODE_SYM, ASM_Symbol(as, token->Text, token->Len), -1, -1);
+        case ASM_TOK_STRING:
+            //单个字符的字符串当作字符
+            return token->Len == 1 ? ASM_Node(as, ASM_NODE_NUM, (Byte) token->Text[0], -1, -1) : -1;
+        case ASM_TOK_OP:
+            break;
+        default:
+            return -1;
+    }
+    Byte op;
+    switch (token->Value) {
+        case '*':
+            return ASM_Node(as, ASM_NODE_PC, 0, -1, -1);
+        case '(':
+        case '[': {
+            int node = ASM_Parse_Binary(parser, 1);
+            if (node < 0 || parser->Pos >= parser->End
+                || !ASM_Is_Op(&parser->Tokens[parser->Pos], token->Value == '(' ? ')' : ']')) {
+                return -1;
+            }
+            parser->Pos++;
+            return node;
+        }
+        case '+':
+            return ASM_Parse_Unary(parser);
+        case '-':
+            op = ASM_NODE_NEG;
+            break;
+        case '~':
+            op = ASM_NODE_NOT;
+            break;
+        case '!':
+            op = ASM_NODE_LNOT;
+            break;
+        case '<':
+            op = ASM_NODE_LO;
+            break;
+        case '>':
+            op = ASM_NODE_HI;
+            break;
+        default:
+            return -1;
+    }
+    int operand = ASM_Parse_Unary(parser);
+    return operand < 0 ? -1 : ASM_Node(as, op, 0, operand, -1);
+}
+
+static int ASM_Parse_Binary(struct ASM_Parser *parser, int min) {
+    int left = ASM_Parse_Unary(parser);
+    while (left >= 0 && parser->Pos < parser->End) {
+        const struct ASM_Token *token = &parser->Tokens[parser->Pos];
+        int precedence = ASM_Precedence(token);
+        if (precedence < min || precedence == 0) {
+            break;
+        }
+        parser->Pos++;
+        int right = ASM_Parse_Binary(parser, precedence + 1);
+        if (right < 0) {
+            return -1;
+        }
+        left = ASM_Node(parser->As, ASM_NODE_BIN, token->Value, left, right);
+    }
+    return left;
+}
+
+/**
+ * 解析 tokens[start, end) 为一个表达式, 必须用完所有单元
+ * @return 节点下标, -1 表示格式错误(已报错)
+ */
+static int ASM_Parse_Expr(struct Assembler *as, const struct ASM_Token *tokens, int start, int end) {
+    struct ASM_Parser parser = {as, tokens, start, end};
+    int node = start < end ? ASM_Parse_Binary(&parser, 1) : -1;
+    if (node < 0 || parser.Pos != end) {
+        ASM_Error(as, "bad expression");
+        return -1;
+    }
+    return node;
+}
+
+/**
+ * 计算表达式
+ * @param pc * 的值
+ * @param unknown 用到未定义的符号时置 1
+ */
+static long ASM_Eval(struct Assembler *as, int index, long pc, int *unknown) {
+    const struct ASM_Node *node = &as->Nodes[index];
+    long left, right;
+    switch (node->Op) {
+        case ASM_NODE_NUM:
+            return node->Value;
+        case ASM_NODE_SYM: {
+            const struct ASM_Symbol *symbol = &as->Symbols[node->Value];
+            if (!symbol->Defined || symbol->Kind == ASM_SYM_MACRO) {
+                if (as->Final) {
+                    ASM_Error(as, "undefined symbol %.*s", symbol->Len, symbol->Name);
+                }
+                *unknown = 1;
+                return 0;
+            }
+            return symbol->Value;
+        }
+        case ASM_NODE_PC:
+            if (pc < 0) {
+                *unknown = 1;
+                return 0;
+            }
+            return pc;
+        case ASM_NODE_NEG:
+            return -ASM_Eval(as, node->Left, pc, unknown);
+        case ASM_NODE_NOT:
+            return ~ASM_Eval(as, node->Left, pc, unknown);
+        case ASM_NODE_LNOT:
+            return !ASM_Eval(as, node->Left, pc, unknown);
+        case ASM_NODE_LO:
+            return ASM_Eval(as, node->Left, pc, unknown) & 0xFF;
+        case ASM_NODE_HI:
+            return ASM_Eval(as, node->Left, pc, unknown) >> 8 & 0xFF;
+        default:
+            break;
+    }
+    left = ASM_Eval(as, node->Left, pc, unknown);
+    right = ASM_Eval(as, node->Right, pc, unknown);
+    switch (node->Value) {
+        case ASM_OP2('|', '|'):
+            return left || right;
+        case ASM_OP2('&', '&'):
+            return left && right;
+        case '|':
+            return left | right;
+        case '^':
+            return left ^ right;
+        case '&':
+            return left & right;
+        case ASM_OP2('=', '='):
+            return left == right;
+        case ASM_OP2('!', '='):
+            return left != right;
+        case '<':
+            return left < right;
+        case '>':
+            return left > right;
+        case ASM_OP2('<', '='):
+            return left <= right;
+        case ASM_OP2('>', '='):
+            return left >= right;
+        case ASM_OP2('<', '<'):
+            return left << (right & 63);
+        case ASM_OP2('>', '>'):
+            return left >> (right & 63);
+        case '+':
+            return left + right;
+        case '-':
+            return left - right;
+        case '*':
+            return left * right;
+        case '/':
+        case '%':
+            if (right == 0) {
+                if (!*unknown) {
+                    ASM_Error(as, "division by zero");
+                }
+                *unknown = 1;
+                return 0;
+            }
+            return node->Value == '/' ? left / right : left % right;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * 展开时就要知道值的表达式(.if/.rept/.incbin)
+ * @return 0 成功
+ */
+static int ASM_Const(struct Assembler *as, const struct ASM_Token *tokens, int start, int end, long *value) {
+    int node = ASM_Parse_Expr(as, tokens, start, end);
+    if (node < 0) {
+        return -1;
+    }
+    int unknown = 0;
+    *value = ASM_Eval(as, node, -1, &unknown);
+    if (unknown) {
+        ASM_Error(as, "expression must be defined before use");
+        return -1;
+    }
+    return 0;
+}
+
+//-------------指令表-----------------
+
+static unsigned int ASM_Mnemonic_Slot(const char *name, int len) {
+    unsigned int hash = 0;
+    for (int i = 0; i < len; ++i) {
+        hash = hash * 31 + (name[i] & ~0x20);
+    }
+    return hash & 255;
+}
+
+/**
+ * 从 OP_Table 建立助记符到各寻址方式操作码的表
+ * 同一写法有多个操作码时(未公开的 NOP/SBC 等)用编号最小的, NOP 用 $EA
+ */
+static void ASM_Build_Mnemonics(struct Assembler *as) {
+    memset(as->Mnemonic_Hash, 0, sizeof(as->Mnemonic_Hash));
+    as->Mnemonic_Count = 0;
+    for (int i = -1; i < 256; ++i) {
+        Byte opcode = i < 0 ? 0xEA : i;
+        const struct Opcode_Info *info = &OP_Table[opcode];
+        int len = strlen(info->Name);
+        unsigned int slot = ASM_Mnemonic_Slot(info->Name, len);
+        struct ASM_Mnemonic *mnemonic = NULL;
+        while (as->Mnemonic_Hash[slot]) {
+            struct ASM_Mnemonic *entry = &as->Mnemonics[as->Mnemonic_Hash[slot] - 1];
+            if (strcmp(entry->Name, info->Name) == 0) {
+                mnemonic = entry;
+                break;
+            }
+            slot = (slot + 1) & 255;
+        }
+        if (!mnemonic) {
+            mnemonic = &as->Mnemonics[as->Mnemonic_Count++];
+            strcpy(mnemonic->Name, info->Name);
+            for (int mode = 0; mode < 16; ++mode) {
+                mnemonic->Opcode[mode] = -1;
+            }
+            as->Mnemonic_Hash[slot] = as->Mnemonic_Count;
+        }
+        if (mnemonic->Opcode[info->Mode] < 0) {
+            mnemonic->Opcode[info->Mode] = opcode;
+        }
+    }
+}
+
+static const struct ASM_Mnemonic *ASM_Find_Mnemonic(const struct Assembler *as, const struct ASM_Token *token) {
+    if (token->Type != ASM_TOK_IDENT || token->Len > 4) {
+        return NULL;
+    }
+    unsigned int slot = ASM_Mnemonic_Slot(token->Text, token->Len);
+    while (as->Mnemonic_Hash[slot]) {
+        const struct ASM_Mnemonic *entry = &as->Mnemonics[as->Mnemonic_Hash[slot] - 1];
+        if (strlen(entry->Name) == token->Len && strncasecmp(entry->Name, token->Text, token->Len) == 0) {
+            return entry;
+        }
+        slot = (slot + 1) & 255;
+    }
+    return NULL;
+}
+
+//-------------语句-----------------
+
+static struct ASM_Stmt *ASM_Stmt(struct Assembler *as, Byte kind) {
+    as->Stmts = ASM_Grow(as->Stmts, &as->Stmt_Cap, as->Stmt_Count, sizeof(*as->Stmts));
+    struct ASM_Stmt *stmt = &as->Stmts[as->Stmt_Count++];
+    memset(stmt, 0, sizeof(*stmt));
+    stmt->Kind = kind;
+    stmt->Opcode = stmt->Opcode_Abs = -1;
+    stmt->Expr = stmt->Expr2 = stmt->Expr3 = -1;
+    stmt->Symbol = -1;
+    stmt->File = as->Cur_File;
+    stmt->Line = as->Cur_Line;
+    return stmt;
+}
+
+/**
+ * 找 tokens[start, end) 里括号外的第一个逗号
+ * @return 下标, 没有时为 end
+ */
+static int ASM_Comma(const struct ASM_Token *tokens, int start, int end) {
+    int depth = 0;
+    for (int i = start; i < end; ++i) {
+        if (ASM_Is_Op(&tokens[i], '(') || ASM_Is_Op(&tokens[i], '[')) {
+            depth++;
+        } else if (ASM_Is_Op(&tokens[i], ')') || ASM_Is_Op(&tokens[i], ']')) {
+            depth--;
+        } else if (depth == 0 && ASM_Is_Op(&tokens[i], ',')) {
+            return i;
+        }
+    }
+    return end;
+}
+
+/**
+ * 和 tokens[start] 的左括号匹配的右括号
+ */
+static int ASM_Close(const struct ASM_Token *tokens, int start, int end) {
+    int depth = 0;
+    for (int i = start; i < end; ++i) {
+        if (ASM_Is_Op(&tokens[i], '(')) {
+            depth++;
+        } else if (ASM_Is_Op(&tokens[i], ')') && --depth == 0) {
+            return i;
+        }
+    }
+    return end;
+}
+
+/**
+ * 指令: 按操作数写法找出零页和绝对两种编码
+ */
+static void ASM_Instruction(struct Assembler *as, const struct ASM_Mnemonic *mnemonic,
+                            const struct ASM_Token *tokens, int start, int end) {
+    int shape = ASM_SHAPE_ADDR;
+    int expr_start = start;
+    int expr_end = end;
+    int expr2 = -1;
+    if (start == end) {
+        shape = ASM_SHAPE_NONE;
+    } else if (end - start == 1 && ASM_Is(&tokens[start], "a")) {
+        shape = ASM_SHAPE_ACC;
+    } else if (ASM_Is_Op(&tokens[start], '#')) {
+        shape = ASM_SHAPE_IMM;
+        expr_start++;
+    } else {
+        int close = ASM_Is_Op(&tokens[start], '(') ? ASM_Close(tokens, start, end) : end;
+        int comma = ASM_Comma(tokens, start, end);
+        if (close == end - 1) {
+            int inner = ASM_Comma(tokens, start + 1, close);
+            if (inner == close - 2 && ASM_Is(&tokens[inner + 1], "x")) {
+                shape = ASM_SHAPE_IND_X;
+                expr_start = start + 1;
+                expr_end = inner;
+            } else {
+                shape = ASM_SHAPE_IND;
+                expr_start = start + 1;
+                expr_end = close;
+            }
+        } else if (close == end - 3 && ASM_Is_Op(&tokens[close + 1], ',') && ASM_Is(&tokens[close + 2], "y")) {
+            shape = ASM_SHAPE_IND_Y;
+            expr_start = start + 1;
+            expr_end = close;
+        } else if (comma < end) {
+            expr_end = comma;
+            if (comma == end - 2 && ASM_Is(&tokens[comma + 1], "x")) {
+                shape = ASM_SHAPE_X;
+            } else if (comma == end - 2 && ASM_Is(&tokens[comma + 1], "y")) {
+                shape = ASM_SHAPE_Y;
+            } else {
+                shape = ASM_SHAPE_PAIR;
+                expr2 = ASM_Parse_Expr(as, tokens, comma + 1, end);
+                if (expr2 < 0) {
                     return;
-                }else if(i == 4) {
-                    if(c!= '#' && c!= '$' && c!= '('){
-                        printf("Error! expected '#' or '$' or '('! line:%d,pos:%d\n",line,i+1);
-                        return;
-                    }
-                    mode = c;
-                } else if(mode == '#') {
-                    if(i == 5) {
-                        if(c != '$'){
-                            printf("Error! expected '$'! line:%d,pos:%d\n",line,i+1);
-                            return;
-                        }
-                        ins_mode[3] = '1';
-                    }else if(i > 5 && c!=' ') {
-                        opcode[i-6] = c;
-                    }
-                }else if(mode == '$') {
-                    if(i == 5) {
-                        ins_mode[3] = '2';
-                    }
-                    if(c!=' ') {
-                        opcode[i-5] = c;
-                    }
-                }else if(mode == '(') {
-                    if(i == 5) {
-                        ins_mode[3] = '2';
-                    }
-                    if(c!=' ') {
-                        opcode[i-5] = c;
+                }
+            }
+        }
+    }
+    const short *op = mnemonic->Opcode;
+    short zp = -1;
+    short abs = -1;
+    switch (shape) {
+        case ASM_SHAPE_NONE:
+            zp = op[MODE_IMP] >= 0 ? op[MODE_IMP] : op[MODE_ACC];
+            break;
+        case ASM_SHAPE_ACC:
+            zp = op[MODE_ACC];
+            break;
+        case ASM_SHAPE_IMM:
+            zp = op[MODE_IMM];
+            break;
+        case ASM_SHAPE_ADDR:
+            zp = op[MODE_REL] >= 0 ? op[MODE_REL] : op[MODE_ZP];
+            abs = op[MODE_REL] >= 0 ? -1 : op[MODE_ABS];
+            break;
+        case ASM_SHAPE_X:
+            zp = op[MODE_ZPX];
+            abs = op[MODE_ABX];
+            break;
+        case ASM_SHAPE_Y:
+            zp = op[MODE_ZPY];
+            abs = op[MODE_ABY];
+            break;
+        case ASM_SHAPE_IND_X:
+            zp = op[MODE_IZX];
+            abs = op[MODE_AIX];
+            break;
+        case ASM_SHAPE_IND_Y:
+            zp = op[MODE_IZY];
+            break;
+        case ASM_SHAPE_IND:
+            zp = op[MODE_IZP];
+            abs = op[MODE_IND];
+            break;
+        default:
+            zp = op[MODE_ZPR];
+            break;
+    }
+    if (zp < 0 && abs < 0) {
+        ASM_Error(as, "addressing mode not available for %s", mnemonic->Name);
+        return;
+    }
+    int expr = -1;
+    if (shape != ASM_SHAPE_NONE && shape != ASM_SHAPE_ACC) {
+        expr = ASM_Parse_Expr(as, tokens, expr_start, expr_end);
+        if (expr < 0) {
+            return;
+        }
+    }
+    struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_INS);
+    stmt->Opcode = zp;
+    stmt->Opcode_Abs = abs;
+    stmt->Expr = expr;
+    stmt->Expr2 = expr2;
+    stmt->Size = OP_Length(zp >= 0 ? zp : abs);
+}
+
+/**
+ * .byte/.word 的参数表, .byte 的字符串按字节展开
+ */
+static void ASM_Data(struct Assembler *as, Byte kind, const struct ASM_Token *tokens, int start, int end) {
+    while (start < end) {
+        int comma = ASM_Comma(tokens, start, end);
+        if (kind == ASM_STMT_BYTE && comma == start + 1 && tokens[start].Type == ASM_TOK_STRING) {
+            struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_DATA);
+            stmt->Data = (const Byte *) tokens[start].Text;
+            stmt->Size = tokens[start].Len;
+        } else {
+            int expr = ASM_Parse_Expr(as, tokens, start, comma);
+            if (expr < 0) {
+                return;
+            }
+            ASM_Stmt(as, kind)->Expr = expr;
+        }
+        start = comma + 1;
+    }
+}
+
+/**
+ * .incbin "文件"[, 偏移[, 长度]]
+ */
+static void ASM_Incbin(struct Assembler *as, const struct ASM_Token *tokens, int start, int end) {
+    if (start >= end || tokens[start].Type != ASM_TOK_STRING || (start + 1 < end && !ASM_Is_Op(&tokens[start + 1], ','))) {
+        ASM_Error(as, ".incbin needs a file name");
+        return;
+    }
+    long args[2] = {0, -1};
+    for (int i = 0, pos = start + 2; i < 2 && pos < end; ++i) {
+        int comma = ASM_Comma(tokens, pos, end);
+        if (ASM_Const(as, tokens, pos, comma, &args[i])) {
+            return;
+        }
+        pos = comma + 1;
+    }
+    char name[4096];
+    char path[4096];
+    snprintf(name, sizeof(name), "%.*s", tokens[start].Len, tokens[start].Text);
+    ASM_Resolve(as, name, path, sizeof(path));
+    size_t size;
+    char *data = ASM_Read(path, &size);
+    if (!data) {
+        ASM_Error(as, "can't open %s", path);
+        return;
+    }
+    ASM_Dep_Add(as, path, ASM_Hash(ASM_HASH_BASIS, data, size));
+    if (args[0] < 0 || (size_t) args[0] > size || (args[1] >= 0 && (size_t) args[1] > size - args[0])) {
+        ASM_Error(as, ".incbin range outside %s", path);
+        free(data);
+        return;
+    }
+    size_t length = args[1] >= 0 ? (size_t) args[1] : size - args[0];
+    Byte *copy = ASM_Alloc(as, length);
+    memcpy(copy, data + args[0], length);
+    free(data);
+    struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_DATA);
+    stmt->Data = copy;
+    stmt->Size = length;
+}
+
+//-------------展开-----------------
+
+static int ASM_Push(struct Assembler *as, const struct ASM_File *file, const struct ASM_Token *tokens, int count,
+                    Byte own, long repeat) {
+    if (as->Depth == ASM_DEPTH) {
+        ASM_Error(as, "nesting too deep");
+        if (own) {
+            free((void *) tokens);
+        }
+        return -1;
+    }
+    as->Frames[as->Depth++] = (struct ASM_Frame) {file, tokens, count, 0, own, repeat, as->Cond_Depth};
+    return 0;
+}
+
+static void ASM_Include(struct Assembler *as, const struct ASM_Token *tokens, int start, int end) {
+    if (end != start + 1 || tokens[start].Type != ASM_TOK_STRING) {
+        ASM_Error(as, ".include needs a file name");
+        return;
+    }
+    char name[4096];
+    char path[4096];
+    snprintf(name, sizeof(name), "%.*s", tokens[start].Len, tokens[start].Text);
+    ASM_Resolve(as, name, path, sizeof(path));
+    const struct ASM_File *file = ASM_Load(as, path);
+    if (file) {
+        ASM_Push(as, file, file->Tokens, file->Count, 0, 0);
+    }
+}
+
+/**
+ * 宏参数的名字是否匹配 text[0, len)
+ * @return 参数下标, -1 不匹配
+ */
+static int ASM_Param(const struct ASM_Macro *macro, const char *text, int len) {
+    for (int i = 0; i < macro->Param_Count; ++i) {
+        if (macro->Params[i]->Len == len && memcmp(macro->Params[i]->Text, text, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 展开宏调用: \name 单独出现时替换成实参的所有单元, 出现在标识符里时按文本拼接(实参只能有一个单元)
+ * \@ 替换成每次展开不同的编号
+ */
+static void ASM_Expand(struct Assembler *as, int index, const struct ASM_Token *tokens, int start, int end) {
+    const struct ASM_Macro *macro = &as->Macros[index];
+    int arg_start[ASM_PARAMS];
+    int arg_end[ASM_PARAMS];
+    int args = 0;
+    while (start < end) {
+        int comma = ASM_Comma(tokens, start, end);
+        if (args == macro->Param_Count) {
+            ASM_Error(as, "too many macro arguments");
+            return;
+        }
+        arg_start[args] = start;
+        arg_end[args++] = comma;
+        start = comma + 1;
+    }
+    for (int i = args; i < macro->Param_Count; ++i) {
+        arg_start[i] = arg_end[i] = 0;
+    }
+    unsigned int unique = as->Unique++;
+    int cap = macro->Count + 16;
+    int count = 0;
+    struct ASM_Token *out = malloc(sizeof(*out) * cap);
+    for (int i = 0; i < macro->Count; ++i) {
+        const struct ASM_Token *token = &macro->Body[i];
+        if (token->Type != ASM_TOK_IDENT || !memchr(token->Text, '\\', token->Len)) {
+            out = ASM_Grow(out, &cap, count, sizeof(*out));
+            out[count++] = *token;
+            continue;
+        }
+        int param = token->Text[0] == '\\' ? ASM_Param(macro, token->Text + 1, token->Len - 1) : -1;
+        if (param >= 0) {
+            for (int j = arg_start[param]; j < arg_end[param]; ++j) {
+                out = ASM_Grow(out, &cap, count, sizeof(*out));
+                out[count] = tokens[j];
+                out[count++].Line = token->Line;
+            }
+            continue;
+        }
+        //拼接: 结果不会超过原文加上实参文本的长度
+        char text[1024];
+        int len = 0;
+        for (int j = 0; j < token->Len && len < (int) sizeof(text) - 32;) {
+            if (token->Text[j] != '\\') {
+                text[len++] = token->Text[j++];
+                continue;
+            }
+            j++;
+            if (j < token->Len && token->Text[j] == '@') {
+                len += sprintf(text + len, "_%u", unique);
+                j++;
+                continue;
+            }
+            int k = j;
+            while (k < token->Len && token->Text[k] != '\\' && ASM_Ident_Char(token->Text[k])) {
+                k++;
+            }
+            //最长的参数名
+            int found = -1;
+            for (int m = k; m > j && found < 0; --m) {
+                found = ASM_Param(macro, token->Text + j, m - j);
+                k = found >= 0 ? m : k;
+            }
+            if (found < 0 || arg_end[found] - arg_start[found] > 1) {
+                as->Cur_Line = token->Line;
+                ASM_Error(as, found < 0 ? "unknown macro parameter in %.*s" : "argument for %.*s must be one token",
+                          token->Len, token->Text);
+                free(out);
+                return;
+            }
+            if (arg_end[found] > arg_start[found]) {
+                const struct ASM_Token *arg = &tokens[arg_start[found]];
+                int n = arg->Len < (int) sizeof(text) - 32 - len ? arg->Len : (int) sizeof(text) - 32 - len;
+                memcpy(text + len, arg->Text, n);
+                len += n;
+            }
+            j = k;
+        }
+        char *copy = ASM_Alloc(as, len);
+        memcpy(copy, text, len);
+        out = ASM_Grow(out, &cap, count, sizeof(*out));
+        out[count] = *token;
+        out[count].Text = copy;
+        out[count++].Len = len;
+    }
+    ASM_Push(as, macro->File, out, count, 1, 0);
+}
+
+/**
+ * .macro/.rept 到对应的 .endm/.endr 之间的行原样收集
+ */
+static void ASM_Collect(struct Assembler *as, const struct ASM_Token *tokens, int count) {
+    const struct ASM_Token *first = &tokens[0];
+    if (ASM_Is(first, ".macro") || ASM_Is(first, ".rept")) {
+        as->Collect_Nest++;
+    } else if (ASM_Is(first, ".endm") || ASM_Is(first, ".endr")) {
+        if (as->Collect_Nest == 0) {
+            as->Collect = 0;
+            if (as->Collect_Macro >= 0) {
+                if (!ASM_Is(first, ".endm")) {
+                    ASM_Error(as, ".endr inside .macro");
+                }
+                struct ASM_Macro *macro = &as->Macros[as->Collect_Macro];
+                macro->Body = ASM_Alloc(as, sizeof(struct ASM_Token) * (as->Body_Count + 1));
+                memcpy(macro->Body, as->Body, sizeof(struct ASM_Token) * as->Body_Count);
+                macro->Count = as->Body_Count;
+            } else if (!ASM_Is(first, ".endr")) {
+                ASM_Error(as, ".endm inside .rept");
+            } else if (as->Collect_Repeat > 0 && as->Body_Count) {
+                struct ASM_Token *body = malloc(sizeof(struct ASM_Token) * as->Body_Count);
+                memcpy(body, as->Body, sizeof(struct ASM_Token) * as->Body_Count);
+                ASM_Push(as, as->Cur_File, body, as->Body_Count, 1, as->Collect_Repeat - 1);
+            }
+            return;
+        }
+        as->Collect_Nest--;
+    }
+    for (int i = 0; i <= count; ++i) {
+        as->Body = ASM_Grow(as->Body, &as->Body_Cap, as->Body_Count, sizeof(*as->Body));
+        as->Body[as->Body_Count++] = tokens[i];
+    }
+}
+
+/**
+ * .if/.ifdef/.ifndef/.else/.endif, 跳过的行里也要处理
+ * @return 1 是条件伪指令
+ */
+static int ASM_Conditional(struct Assembler *as, const struct ASM_Token *tokens, int count) {
+    const struct ASM_Token *first = &tokens[0];
+    int active = as->Cond_Depth == 0 || as->Conds[as->Cond_Depth - 1].Active;
+    if (ASM_Is(first, ".if") || ASM_Is(first, ".ifdef") || ASM_Is(first, ".ifndef")) {
+        if (as->Cond_Depth == ASM_IF_DEPTH) {
+            ASM_Error(as, ".if nesting too deep");
+            return 1;
+        }
+        long value = 0;
+        if (active) {
+            if (ASM_Is(first, ".if")) {
+                if (ASM_Const(as, tokens, 1, count, &value)) {
+                    value = 0;
+                }
+            } else if (count != 2 || tokens[1].Type != ASM_TOK_IDENT) {
+                ASM_Error(as, "%.*s needs a symbol", first->Len, first->Text);
+            } else {
+                int index = ASM_Symbol(as, tokens[1].Text, tokens[1].Len);
+                const struct ASM_Symbol *symbol = &as->Symbols[index];
+                value = (symbol->Defined || symbol->Kind == ASM_SYM_MACRO) == ASM_Is(first, ".ifdef");
+            }
+        }
+        as->Conds[as->Cond_Depth++] = (struct ASM_Cond) {active && value, active && value, active};
+        return 1;
+    }
+    if (ASM_Is(first, ".else") || ASM_Is(first, ".endif")) {
+        if (as->Cond_Depth == 0 || (as->Depth && as->Cond_Depth <= as->Frames[as->Depth - 1].Cond_Depth)) {
+            ASM_Error(as, "%.*s without .if", first->Len, first->Text);
+            return 1;
+        }
+        struct ASM_Cond *cond = &as->Conds[as->Cond_Depth - 1];
+        if (ASM_Is(first, ".endif")) {
+            as->Cond_Depth--;
+        } else {
+            cond->Active = cond->Parent && !cond->Taken;
+            cond->Taken = 1;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+//ASM_CHECK_xxx 的名字, 不区分大小写
+static const char *ASM_Check_Names[] = {"", "A", "X", "Y", "SP", "P", "N", "V", "D", "I", "Z", "C", "cycles"};
+
+const char *ASM_Check_Name(int target) {
+    return ASM_Check_Names[target];
+}
+
+/**
+ * .setup/.expect 对象, 值[, 值...]
+ * 对象为寄存器(A/X/Y/SP/P)、标志(N/V/D/I/Z/C)或 cycles 时只有一个值(同名的符号不算),
+ * 否则为内存地址, 每个值一个字节, 依次放在后面的地址
+ */
+static void ASM_Check_Directive(struct Assembler *as, Byte kind, const struct ASM_Token *tokens, int start, int end) {
+    const char *directive = kind == ASM_STMT_SETUP ? ".setup" : ".expect";
+    int comma = ASM_Comma(tokens, start, end);
+    if (comma == start || comma == end) {
+        ASM_Error(as, "%s needs a target and a value", directive);
+        return;
+    }
+    int target = ASM_CHECK_MEM;
+    for (int i = ASM_CHECK_A; comma == start + 1 && i <= ASM_CHECK_CYCLES; ++i) {
+        if (ASM_Is(&tokens[start], ASM_Check_Names[i])) {
+            target = i;
+        }
+    }
+    if (target == ASM_CHECK_CYCLES && kind == ASM_STMT_SETUP) {
+        ASM_Error(as, ".setup can't set cycles");
+        return;
+    }
+    int addr = target == ASM_CHECK_MEM ? ASM_Parse_Expr(as, tokens, start, comma) : -1;
+    if (target == ASM_CHECK_MEM && addr < 0) {
+        return;
+    }
+    int offset = 0;
+    for (int pos = comma + 1; pos <= end; ++offset) {
+        int next = ASM_Comma(tokens, pos, end);
+        if (target != ASM_CHECK_MEM && offset) {
+            ASM_Error(as, "%s %s takes one value", directive, ASM_Check_Names[target]);
+            return;
+        }
+        int value = ASM_Parse_Expr(as, tokens, pos, next);
+        if (value < 0) {
+            return;
+        }
+        struct ASM_Stmt *stmt = ASM_Stmt(as, kind);
+        stmt->Symbol = target;
+        stmt->Expr = addr;
+        stmt->Expr2 = value;
+        stmt->Expr3 = offset;
+        pos = next + 1;
+    }
+}
+
+/**
+ * 伪指令
+ */
+static void ASM_Directive(struct Assembler *as, const struct ASM_Token *tokens, int start, int end) {
+    const struct ASM_Token *name = &tokens[start++];
+    if (ASM_Is(name, ".org")) {
+        int expr = ASM_Parse_Expr(as, tokens, start, end);
+        if (expr >= 0) {
+            ASM_Stmt(as, ASM_STMT_ORG)->Expr = expr;
+        }
+    } else if (ASM_Is(name, ".byte") || ASM_Is(name, ".db")) {
+        ASM_Data(as, ASM_STMT_BYTE, tokens, start, end);
+    } else if (ASM_Is(name, ".word") || ASM_Is(name, ".dw")) {
+        ASM_Data(as, ASM_STMT_WORD, tokens, start, end);
+    } else if (ASM_Is(name, ".fill")) {
+        int comma = ASM_Comma(tokens, start, end);
+        int count = ASM_Parse_Expr(as, tokens, start, comma);
+        int value = comma < end ? ASM_Parse_Expr(as, tokens, comma + 1, end) : -2;
+        if (count >= 0 && value != -1) {
+            struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_FILL);
+            stmt->Expr = count;
+            stmt->Expr2 = value;
+        }
+    } else if (ASM_Is(name, ".assert_cycles")) {
+        //.assert_cycles 子程序, 最多周期 或者 .assert_cycles 子程序, 最少周期, 最多周期
+        int first = ASM_Comma(tokens, start, end);
+        int second = first < end ? ASM_Comma(tokens, first + 1, end) : end;
+        if (first == end) {
+            ASM_Error(as, ".assert_cycles needs a routine and a cycle limit");
+            return;
+        }
+        int routine = ASM_Parse_Expr(as, tokens, start, first);
+        int min = second < end ? ASM_Parse_Expr(as, tokens, first + 1, second) : -2;
+        int max = ASM_Parse_Expr(as, tokens, second < end ? second + 1 : first + 1, end);
+        if (routine >= 0 && min != -1 && max >= 0) {
+            struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_ASSERT);
+            stmt->Expr = routine;
+            stmt->Expr2 = max;
+            stmt->Expr3 = min >= 0 ? min : -1;
+        }
+    } else if (ASM_Is(name, ".test")) {
+        //.test "名字", 入口[, 周期上限]
+        if (start + 1 >= end || tokens[start].Type != ASM_TOK_STRING || !ASM_Is_Op(&tokens[start + 1], ',')) {
+            ASM_Error(as, ".test needs a name and an entry");
+            return;
+        }
+        int comma = ASM_Comma(tokens, start + 2, end);
+        int entry = ASM_Parse_Expr(as, tokens, start + 2, comma);
+        int cycles = comma < end ? ASM_Parse_Expr(as, tokens, comma + 1, end) : -2;
+        if (entry >= 0 && cycles != -1) {
+            char *text = ASM_Alloc(as, tokens[start].Len + 1);
+            memcpy(text, tokens[start].Text, tokens[start].Len);
+            text[tokens[start].Len] = '\0';
+            struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_TEST);
+            stmt->Data = (const Byte *) text;
+            stmt->Expr = entry;
+            stmt->Expr2 = cycles >= 0 ? cycles : -1;
+        }
+    } else if (ASM_Is(name, ".setup")) {
+        ASM_Check_Directive(as, ASM_STMT_SETUP, tokens, start, end);
+    } else if (ASM_Is(name, ".expect")) {
+        ASM_Check_Directive(as, ASM_STMT_EXPECT, tokens, start, end);
+    } else if (ASM_Is(name, ".incbin")) {
+        ASM_Incbin(as, tokens, start, end);
+    } else if (ASM_Is(name, ".include")) {
+        ASM_Include(as, tokens, start, end);
+    } else if (ASM_Is(name, ".macro")) {
+        if (start >= end || tokens[start].Type != ASM_TOK_IDENT) {
+            ASM_Error(as, ".macro needs a name");
+            return;
+        }
+        int symbol = ASM_Symbol(as, tokens[start].Text, tokens[start].Len);
+        if (as->Symbols[symbol].Kind != ASM_SYM_NONE) {
+            ASM_Error(as, "%.*s redefined", tokens[start].Len, tokens[start].Text);
+            return;
+        }
+        as->Macros = ASM_Grow(as->Macros, &as->Macro_Cap, as->Macro_Count, sizeof(*as->Macros));
+        struct ASM_Macro *macro = &as->Macros[as->Macro_Count];
+        memset(macro, 0, sizeof(*macro));
+        macro->File = as->Cur_File;
+        for (int i = start + 1; i < end; ++i) {
+            if (ASM_Is_Op(&tokens[i], ',')) {
+                continue;
+            }
+            if (tokens[i].Type != ASM_TOK_IDENT || macro->Param_Count == ASM_PARAMS) {
+                ASM_Error(as, "bad macro parameter");
+                return;
+            }
+            macro->Params[macro->Param_Count++] = &tokens[i];
+        }
+        as->Symbols[symbol].Kind = ASM_SYM_MACRO;
+        as->Symbols[symbol].Value = as->Macro_Count;
+        as->Collect = 1;
+        as->Collect_Nest = 0;
+        as->Collect_Macro = as->Macro_Count++;
+        as->Body_Count = 0;
+    } else if (ASM_Is(name, ".rept")) {
+        long count;
+        if (ASM_Const(as, tokens, start, end, &count)) {
+            count = 0;
+        }
+        as->Collect = 1;
+        as->Collect_Nest = 0;
+        as->Collect_Macro = -1;
+        as->Collect_Repeat = count;
+        as->Body_Count = 0;
+    } else if (ASM_Is(name, ".endm") || ASM_Is(name, ".endr")) {
+        ASM_Error(as, "%.*s without .macro/.rept", name->Len, name->Text);
+    } else {
+        ASM_Error(as, "unknown directive %.*s", name->Len, name->Text);
+    }
+}
+
+/**
+ * 一行: [标号:] [指令 | 伪指令 | 宏调用 | 名字 = 表达式]
+ * @param count 不含行尾
+ */
+static void ASM_Line(struct Assembler *as, const struct ASM_Token *tokens, int count) {
+    if (as->Collect) {
+        ASM_Collect(as, tokens, count);
+        return;
+    }
+    if (ASM_Conditional(as, tokens, count)) {
+        return;
+    }
+    if (as->Cond_Depth && !as->Conds[as->Cond_Depth - 1].Active) {
+        return;
+    }
+    int pos = 0;
+    if (count >= 2 && tokens[0].Type == ASM_TOK_IDENT && ASM_Is_Op(&tokens[1], ':')) {
+        struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_LABEL);
+        stmt->Symbol = ASM_Symbol(as, tokens[0].Text, tokens[0].Len);
+        pos = 2;
+    }
+    if (pos == count) {
+        return;
+    }
+    const struct ASM_Token *first = &tokens[pos];
+    if (first->Type != ASM_TOK_IDENT) {
+        ASM_Error(as, "syntax error");
+        return;
+    }
+    if (pos + 1 < count && (ASM_Is_Op(&tokens[pos + 1], '=') || ASM_Is(&tokens[pos + 1], ".equ"))) {
+        int expr = ASM_Parse_Expr(as, tokens, pos + 2, count);
+        if (expr < 0) {
+            return;
+        }
+        struct ASM_Stmt *stmt = ASM_Stmt(as, ASM_STMT_EQU);
+        stmt->Symbol = ASM_Symbol(as, first->Text, first->Len);
+        stmt->Expr = expr;
+        //前面已经能算出来的常量马上定义, .if/.rept 可以使用
+        int unknown = 0;
+        long value = ASM_Eval(as, expr, -1, &unknown);
+        if (!unknown) {
+            ASM_Set(as, stmt->Symbol, ASM_SYM_EQU, value);
+        }
+        return;
+    }
+    if (first->Text[0] == '.') {
+        ASM_Directive(as, tokens, pos, count);
+        return;
+    }
+    int symbol = ASM_Symbol(as, first->Text, first->Len);
+    if (as->Symbols[symbol].Kind == ASM_SYM_MACRO) {
+        ASM_Expand(as, as->Symbols[symbol].Value, tokens, pos + 1, count);
+        return;
+    }
+    const struct ASM_Mnemonic *mnemonic = ASM_Find_Mnemonic(as, first);
+    if (!mnemonic) {
+        ASM_Error(as, "unknown instruction %.*s", first->Len, first->Text);
+        return;
+    }
+    ASM_Instruction(as, mnemonic, tokens, pos + 1, count);
+}
+
+/**
+ * 逐行处理展开栈, 直到所有文件、宏和 .rept 结束
+ */
+static void ASM_Run(struct Assembler *as) {
+    while (as->Depth) {
+        struct ASM_Frame *frame = &as->Frames[as->Depth - 1];
+        if (frame->Pos >= frame->Count) {
+            if (frame->Repeat > 0 && !as->Collect) {
+                frame->Repeat--;
+                frame->Pos = 0;
+                continue;
+            }
+            if (as->Cond_Depth > frame->Cond_Depth) {
+                as->Cur_File = frame->File;
+                ASM_Error(as, "missing .endif");
+                as->Cond_Depth = frame->Cond_Depth;
+            }
+            if (frame->Own) {
+                free((void *) frame->Tokens);
+            }
+            as->Depth--;
+            continue;
+        }
+        const struct ASM_Token *line = &frame->Tokens[frame->Pos];
+        int count = 0;
+        while (line[count].Type != ASM_TOK_EOL) {
+            count++;
+        }
+        frame->Pos += count + 1;
+        as->Cur_File = frame->File;
+        as->Cur_Line = line[count].Line;
+        ASM_Line(as, line, count);
+    }
+    if (as->Collect) {
+        ASM_Error(as, "missing %s", as->Collect_Macro >= 0 ? ".endm" : ".endr");
+        as->Collect = 0;
+    }
+}
+
+//-------------地址和输出-----------------
+
+static void ASM_Emit(struct Assembler *as, long addr, Byte value) {
+    if (addr > 0xFFFF) {
+        return;
+    }
+    if (as->Used[addr]) {
+        ASM_Error(as, "output overlaps at $%04lX", addr);
+    }
+    as->Image[addr] = value;
+    as->Used[addr] = 1;
+}
+
+static void ASM_Emit_Value(struct Assembler *as, long addr, long value, int size) {
+    long min = size == 1 ? -128 : -32768;
+    long max = size == 1 ? 0xFF : 0xFFFF;
+    if (value < min || value > max) {
+        ASM_Error(as, "value $%lX out of range", value);
+    }
+    ASM_Emit(as, addr, value);
+    if (size == 2) {
+        ASM_Emit(as, addr + 1, value >> 8);
+    }
+}
+
+static void ASM_Emit_Branch(struct Assembler *as, long addr, long target, long next) {
+    long offset = target - next;
+    if (offset < -128 || offset > 127) {
+        ASM_Error(as, "branch out of range (%ld bytes)", offset);
+    }
+    ASM_Emit(as, addr, offset);
+}
+
+/**
+ * 长分支的大小: BRA -> JMP, Bxx -> 反向 Bxx + JMP, BBRn/BBSn -> 反向 BBSn/BBRn + JMP
+ */
+static unsigned int ASM_Long_Size(short opcode) {
+    if (OP_Table[opcode].Mode == MODE_ZPR) {
+        return 6;
+    }
+    return OP_Table[opcode].Flow == OP_FLOW_JUMP ? 3 : 5;
+}
+
+/**
+ * 选定编码: 零页和绝对都可以时按操作数选定, 第一遍之后就不再改变;
+ * 优化时每一遍都检查, 零页放不下时换成绝对, 分支超出范围时换成长分支
+ */
+static void ASM_Choose(struct Assembler *as, struct ASM_Stmt *stmt, long pc) {
+    unsigned int size = stmt->Size;
+    int unknown = 0;
+    if (stmt->Opcode >= 0 && stmt->Opcode_Abs >= 0) {
+        long value = ASM_Eval(as, stmt->Expr, pc, &unknown);
+        if (value < 0 || value > 0xFF || (unknown && !as->Optimize)) {
+            stmt->Opcode = stmt->Opcode_Abs;
+            stmt->Opcode_Abs = -1;
+        }
+    } else if (stmt->Opcode < 0) {
+        stmt->Opcode = stmt->Opcode_Abs;
+        stmt->Opcode_Abs = -1;
+    }
+    if (!as->Optimize) {
+        stmt->Opcode_Abs = -1;
+    }
+    Byte mode = OP_Table[stmt->Opcode].Mode;
+    if (as->Optimize && !stmt->Long && (mode == MODE_REL || mode == MODE_ZPR)) {
+        unknown = 0;
+        long next = pc + (mode == MODE_ZPR ? 3 : 2);
+        long offset = ASM_Eval(as, mode == MODE_ZPR ? stmt->Expr2 : stmt->Expr, pc, &unknown) - next;
+        stmt->Long = !unknown && (offset < -128 || offset > 127);
+    }
+    stmt->Size = stmt->Long ? ASM_Long_Size(stmt->Opcode) : OP_Length(stmt->Opcode);
+    if (as->Pass > 1 && stmt->Size != size) {
+        as->Changed = 1;
+    }
+}
+
+static void ASM_Emit_Long(struct Assembler *as, const struct ASM_Stmt *stmt, long pc) {
+    int unknown = 0;
+    long target;
+    if (OP_Table[stmt->Opcode].Mode == MODE_ZPR) {
+        ASM_Emit(as, pc, stmt->Opcode ^ 0x80);
+        ASM_Emit_Value(as, pc + 1, ASM_Eval(as, stmt->Expr, pc, &unknown), 1);
+        ASM_Emit(as, pc + 2, 3);
+        pc += 3;
+        target = ASM_Eval(as, stmt->Expr2, pc, &unknown);
+    } else if (OP_Table[stmt->Opcode].Flow == OP_FLOW_JUMP) {
+        target = ASM_Eval(as, stmt->Expr, pc, &unknown);
+    } else {
+        ASM_Emit(as, pc, stmt->Opcode ^ 0x20);
+        ASM_Emit(as, pc + 1, 3);
+        pc += 2;
+        target = ASM_Eval(as, stmt->Expr, pc, &unknown);
+    }
+    ASM_Emit(as, pc, 0x4C);
+    ASM_Emit_Value(as, pc + 1, target, 2);
+}
+
+static void ASM_Emit_Instruction(struct Assembler *as, const struct ASM_Stmt *stmt, long pc) {
+    if (stmt->Long) {
+        ASM_Emit_Long(as, stmt, pc);
+        return;
+    }
+    int unknown = 0;
+    Byte mode = OP_Table[stmt->Opcode].Mode;
+    long value = stmt->Expr >= 0 ? ASM_Eval(as, stmt->Expr, pc, &unknown) : 0;
+    ASM_Emit(as, pc, stmt->Opcode);
+    switch (mode) {
+        case MODE_IMP:
+        case MODE_ACC:
+            break;
+        case MODE_IMM:
+        case MODE_ZP:
+        case MODE_ZPX:
+        case MODE_ZPY:
+        case MODE_IZX:
+        case MODE_IZY:
+        case MODE_IZP:
+            if (mode != MODE_IMM && (value < 0 || value > 0xFF)) {
+                ASM_Error(as, "zero page address $%lX out of range", value);
+            }
+            ASM_Emit_Value(as, pc + 1, value, 1);
+            break;
+        case MODE_REL:
+            ASM_Emit_Branch(as, pc + 1, value, pc + 2);
+            break;
+        case MODE_ZPR:
+            ASM_Emit_Value(as, pc + 1, value, 1);
+            ASM_Emit_Branch(as, pc + 2, ASM_Eval(as, stmt->Expr2, pc, &unknown), pc + 3);
+            break;
+        default:
+            ASM_Emit_Value(as, pc + 1, value, 2);
+            break;
+    }
+}
+
+/**
+ * 按顺序计算每条语句的地址, 最后一遍输出
+ */
+static void ASM_Pass(struct Assembler *as) {
+    long pc = 0;
+    int overflow = 0;
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        struct ASM_Stmt *stmt = &as->Stmts[i];
+        int unknown = 0;
+        long value;
+        as->Cur_File = stmt->File;
+        as->Cur_Line = stmt->Line;
+        for (int j = 0; as->Final && j < stmt->Pad; ++j) {
+            ASM_Emit(as, pc + j, 0xEA);
+        }
+        pc += stmt->Pad;
+        stmt->Addr = pc;
+        switch (stmt->Kind) {
+            case ASM_STMT_ORG:
+                value = ASM_Eval(as, stmt->Expr, pc, &unknown);
+                if (!unknown && (value < 0 || value > 0xFFFF)) {
+                    ASM_Error(as, ".org $%lX out of range", value);
+                } else if (!unknown) {
+                    pc = value;
+                    overflow = 0;
+                }
+                stmt->Addr = pc;
+                break;
+            case ASM_STMT_LABEL:
+                ASM_Set(as, stmt->Symbol, ASM_SYM_LABEL, pc);
+                break;
+            case ASM_STMT_EQU:
+                value = ASM_Eval(as, stmt->Expr, pc, &unknown);
+                if (!unknown) {
+                    ASM_Set(as, stmt->Symbol, ASM_SYM_EQU, value);
+                }
+                break;
+            case ASM_STMT_INS:
+                if (as->Pass == 1 || (as->Optimize && !as->Final)) {
+                    ASM_Choose(as, stmt, pc);
+                }
+                if (as->Final) {
+                    ASM_Emit_Instruction(as, stmt, pc);
+                }
+                break;
+            case ASM_STMT_BYTE:
+            case ASM_STMT_WORD:
+                stmt->Size = stmt->Kind == ASM_STMT_BYTE ? 1 : 2;
+                if (as->Final) {
+                    ASM_Emit_Value(as, pc, ASM_Eval(as, stmt->Expr, pc, &unknown), stmt->Size);
+                }
+                break;
+            case ASM_STMT_DATA:
+                for (unsigned int j = 0; as->Final && j < stmt->Size; ++j) {
+                    ASM_Emit(as, pc + j, stmt->Data[j]);
+                }
+                break;
+            case ASM_STMT_FILL:
+                value = ASM_Eval(as, stmt->Expr, pc, &unknown);
+                if (!unknown && (value < 0 || value > 0x10000)) {
+                    ASM_Error(as, ".fill count %ld out of range", value);
+                    value = 0;
+                }
+                if (stmt->Size != (unsigned int) value) {
+                    as->Changed = 1;
+                }
+                stmt->Size = unknown ? 0 : value;
+                if (as->Final) {
+                    long fill = stmt->Expr2 >= 0 ? ASM_Eval(as, stmt->Expr2, pc, &unknown) : 0;
+                    for (unsigned int j = 0; j < stmt->Size; ++j) {
+                        ASM_Emit_Value(as, pc + j, fill, 1);
                     }
                 }
+                break;
+            default:
+                break;
+        }
+        pc += stmt->Size;
+        if (pc > 0x10000 && !overflow && as->Final) {
+            ASM_Error(as, "code runs past $FFFF");
+            overflow = 1;
+        }
+    }
+}
+
+//-------------优化-----------------
+
+/**
+ * 两个表达式的写法相同(同样的符号和运算), 不管地址怎么变, 值都相等
+ */
+static int ASM_Same_Expr(const struct Assembler *as, int a, int b) {
+    if (a < 0 || b < 0) {
+        return a == b;
+    }
+    const struct ASM_Node *x = &as->Nodes[a];
+    const struct ASM_Node *y = &as->Nodes[b];
+    if (x->Op != y->Op || x->Op == ASM_NODE_PC) {
+        return 0;
+    }
+    switch (x->Op) {
+        case ASM_NODE_NUM:
+        case ASM_NODE_SYM:
+            return x->Value == y->Value;
+        case ASM_NODE_BIN:
+            return x->Value == y->Value && ASM_Same_Expr(as, x->Left, y->Left)
+                   && ASM_Same_Expr(as, x->Right, y->Right);
+        default:
+            return ASM_Same_Expr(as, x->Left, y->Left);
+    }
+}
+
+/**
+ * 不输出、不占地址的语句(EQU, .assert_cycles, 测试), 不打断直线代码
+ */
+static int ASM_Meta(Byte kind) {
+    return kind == ASM_STMT_EQU || kind == ASM_STMT_ASSERT || kind >= ASM_STMT_TEST;
+}
+
+/**
+ * 窥孔优化时 A/X/Y 里已知的内容
+ */
+struct ASM_Known {
+    //等于这个立即数, 表达式下标, -1 为不知道
+    int Imm[3];
+    //等于这个零页地址的内容
+    int Mem[3];
+    //N/Z 按哪个寄存器设置, -1 为不知道
+    int Flags;
+};
+
+static void ASM_Forget(struct ASM_Known *known) {
+    for (int i = 0; i < 3; ++i) {
+        known->Imm[i] = known->Mem[i] = -1;
+    }
+    known->Flags = -1;
+}
+
+/**
+ * LDA/LDX/LDY, STA/STX/STY 的寄存器
+ * @return 0 A, 1 X, 2 Y, -1 不是
+ */
+static int ASM_Register(const char *name, const char *prefix) {
+    if (strncmp(name, prefix, 2) != 0 || name[3]) {
+        return -1;
+    }
+    const char *regs = "AXY";
+    const char *reg = strchr(regs, name[2]);
+    return reg && name[2] ? (int) (reg - regs) : -1;
+}
+
+static void ASM_Drop(struct Assembler *as, struct ASM_Stmt *stmt) {
+    stmt->Kind = ASM_STMT_DROP;
+    stmt->Size = 0;
+    as->Removed++;
+}
+
+/**
+ * 窥孔优化, 在地址确定(零页/绝对已经选定)之后:
+ * - 寄存器已经是这个值、N/Z 也是按它设置的, 删掉重复的 LDA/LDX/LDY(立即数, 或者刚读过/写过的零页)
+ * - JSR x / RTS 改成 JMP x, 删掉 RTS(x 不能去数栈里的返回地址)
+ * 只在两个标号之间的直线代码里做, 标号、数据和其它指令让已知的内容作废;
+ * 零页当作普通 RAM(中断程序不改它, I/O 在绝对地址), 比较表达式的写法而不是值, 地址变了结论不变
+ * @return 有改写
+ */
+static int ASM_Peephole(struct Assembler *as) {
+    int removed = as->Removed;
+    struct ASM_Known known;
+    ASM_Forget(&known);
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        struct ASM_Stmt *stmt = &as->Stmts[i];
+        if (ASM_Meta(stmt->Kind) || stmt->Kind == ASM_STMT_DROP) {
+            continue;
+        }
+        if (stmt->Kind != ASM_STMT_INS || stmt->Long) {
+            ASM_Forget(&known);
+            continue;
+        }
+        const struct Opcode_Info *info = &OP_Table[stmt->Opcode];
+        int load = ASM_Register(info->Name, "LD");
+        int store = ASM_Register(info->Name, "ST");
+        if (stmt->Opcode == 0x20) {
+            int next = i + 1;
+            while (next < as->Stmt_Count && ASM_Meta(as->Stmts[next].Kind)) {
+                next++;
+            }
+            if (next < as->Stmt_Count && as->Stmts[next].Kind == ASM_STMT_INS && as->Stmts[next].Opcode == 0x60) {
+                stmt->Opcode = 0x4C;
+                ASM_Drop(as, &as->Stmts[next]);
+            }
+            ASM_Forget(&known);
+        } else if (load >= 0 && (info->Mode == MODE_IMM || info->Mode == MODE_ZP)) {
+            int *slot = info->Mode == MODE_IMM ? known.Imm : known.Mem;
+            if (known.Flags == load && slot[load] >= 0 && ASM_Same_Expr(as, slot[load], stmt->Expr)) {
+                ASM_Drop(as, stmt);
+                continue;
+            }
+            known.Imm[load] = known.Mem[load] = -1;
+            slot[load] = stmt->Expr;
+            known.Flags = load;
+        } else if (load >= 0) {
+            known.Imm[load] = known.Mem[load] = -1;
+            known.Flags = load;
+        } else if (store >= 0) {
+            //别的寄存器记住的零页可能就是这个地址
+            for (int r = 0; r < 3; ++r) {
+                if (r != store || info->Mode != MODE_ZP) {
+                    known.Mem[r] = -1;
+                }
+            }
+            if (info->Mode == MODE_ZP) {
+                known.Mem[store] = stmt->Expr;
+            }
+        } else if (info->Mode != MODE_IMP || info->Flow != OP_FLOW_NONE || !strstr("CLC SEC CLI SEI CLD SED CLV NOP", info->Name)) {
+            ASM_Forget(&known);
+        }
+    }
+    return as->Removed != removed;
+}
+
+/**
+ * 无条件转移(JMP/BRA/RTS/RTI/STP), 后面的字节不会顺序执行到
+ */
+static int ASM_Ends_Flow(const struct ASM_Stmt *stmt) {
+    if (stmt->Kind != ASM_STMT_INS) {
+        return 0;
+    }
+    Byte flow = OP_Table[stmt->Opcode].Flow;
+    return flow == OP_FLOW_JUMP || flow == OP_FLOW_JUMP_IND || flow == OP_FLOW_RETURN || flow == OP_FLOW_HALT;
+}
+
+/**
+ * 循环对齐: 向后的分支跳转时跨页要多 1 个周期, 在循环开头前面最近的不会顺序执行到的地方
+ * (无条件转移之后)补字节, 把开头移到下一页; 一次补一处, 补过的不再减少, 每处最多 ASM_ALIGN_MAX 字节
+ * @return 补了字节
+ */
+static int ASM_Align(struct Assembler *as) {
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        if (stmt->Kind != ASM_STMT_INS || stmt->Long) {
+            continue;
+        }
+        Byte mode = OP_Table[stmt->Opcode].Mode;
+        if (mode != MODE_REL && mode != MODE_ZPR) {
+            continue;
+        }
+        int unknown = 0;
+        long next = stmt->Addr + stmt->Size;
+        long target = ASM_Eval(as, mode == MODE_ZPR ? stmt->Expr2 : stmt->Expr, stmt->Addr, &unknown);
+        if (unknown || target > stmt->Addr || (target & 0xFF00) == (next & 0xFF00) || next - target > 0x100) {
+            continue;
+        }
+        int site = i - 1;
+        while (site >= 0 && as->Stmts[site].Kind != ASM_STMT_ORG
+               && !(as->Stmts[site].Addr < target && ASM_Ends_Flow(&as->Stmts[site]))) {
+            site--;
+        }
+        if (site < 0 || as->Stmts[site].Kind == ASM_STMT_ORG || as->Stmts[site + 1].Kind == ASM_STMT_ORG) {
+            continue;
+        }
+        struct ASM_Stmt *after = &as->Stmts[site + 1];
+        long pad = 0x100 - (target & 0xFF);
+        if (after->Pad + pad > ASM_ALIGN_MAX) {
+            continue;
+        }
+        after->Pad += pad;
+        as->Padding += pad;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * 多遍计算地址, 直到符号和大小都不再变化
+ * @return 0 成功
+ */
+static int ASM_Settle(struct Assembler *as) {
+    for (int i = 0; i < ASM_PASSES; ++i) {
+        as->Pass++;
+        as->Changed = 0;
+        ASM_Pass(as);
+        if (!as->Changed) {
+            return 0;
+        }
+    }
+    as->Cur_File = NULL;
+    ASM_Error(as, "addresses do not settle after %d passes", ASM_PASSES);
+    return -1;
+}
+
+//-------------周期分析-----------------
+
+/**
+ * 标号后面(跳过同一地址的其它标号)紧跟一条指令, 作为子程序的入口
+ */
+static int ASM_Code_Label(const struct Assembler *as, int index) {
+    const struct ASM_Stmt *label = &as->Stmts[index];
+    if (label->Kind != ASM_STMT_LABEL) {
+        return 0;
+    }
+    for (int i = index + 1; i < as->Stmt_Count; ++i) {
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        if (stmt->Kind == ASM_STMT_INS) {
+            return stmt->Addr == label->Addr;
+        }
+        if (stmt->Kind != ASM_STMT_LABEL && !ASM_Meta(stmt->Kind)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int ASM_Instruction_At(const struct Assembler *as, long addr) {
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        if (as->Stmts[i].Kind == ASM_STMT_INS && as->Stmts[i].Addr == addr) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static const char *ASM_Unbounded(Byte flags) {
+    return flags & CFG_RECURSION ? "recursion" : flags & CFG_NO_RETURN ? "never returns"
+         : flags & CFG_LOOP ? "loop" : "indirect jump";
+}
+
+/**
+ * 周期范围写成 "12", "12-15", "12+"(没有上限)
+ */
+static void ASM_Format_Cycles(char *buf, size_t size, unsigned int min, unsigned int max) {
+    if (min == CFG_UNBOUNDED) {
+        snprintf(buf, size, "-");
+    } else if (max == CFG_UNBOUNDED) {
+        snprintf(buf, size, "%u+", min);
+    } else if (min == max) {
+        snprintf(buf, size, "%u", min);
+    } else {
+        snprintf(buf, size, "%u-%u", min, max);
+    }
+}
+
+/**
+ * 以每个指令前的标号和 .assert_cycles 的目标为入口建立控制流图, 检查 .assert_cycles
+ * 镜像里写过的字节都当作常量(解析 JMP (a))
+ */
+static void ASM_Timing(struct Assembler *as) {
+    int asserts = 0;
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        asserts += as->Stmts[i].Kind == ASM_STMT_ASSERT;
+    }
+    if (!asserts && !as->Analyze) {
+        return;
+    }
+    Short *entries = malloc(sizeof(Short) * (as->Stmt_Count + 1));
+    as->Cfg = malloc(sizeof(*as->Cfg));
+    if (!entries || !as->Cfg) {
+        free(entries);
+        free(as->Cfg);
+        as->Cfg = NULL;
+        as->Cur_File = NULL;
+        ASM_Error(as, "out of memory");
+        return;
+    }
+    //入口只收集能算出来的地址, 错误在检查时报告
+    int count = 0;
+    as->Final = 0;
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        int unknown = 0;
+        if (ASM_Code_Label(as, i)) {
+            entries[count++] = stmt->Addr;
+        } else if (stmt->Kind == ASM_STMT_ASSERT) {
+            long addr = ASM_Eval(as, stmt->Expr, stmt->Addr, &unknown);
+            if (!unknown && ASM_Instruction_At(as, addr)) {
+                entries[count++] = addr;
+            }
+        }
+    }
+    as->Final = 1;
+    int low = 0;
+    int high = 0xFFFF;
+    while (low < 0xFFFF && !as->Used[low]) {
+        low++;
+    }
+    while (high > low && !as->Used[high]) {
+        high--;
+    }
+    CFG_Init(as->Cfg, as->Image, low, high);
+    CFG_Build(as->Cfg, entries, count);
+    free(entries);
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        if (stmt->Kind != ASM_STMT_ASSERT) {
+            continue;
+        }
+        int unknown = 0;
+        as->Cur_File = stmt->File;
+        as->Cur_Line = stmt->Line;
+        long addr = ASM_Eval(as, stmt->Expr, stmt->Addr, &unknown);
+        long max = ASM_Eval(as, stmt->Expr2, stmt->Addr, &unknown);
+        long min = stmt->Expr3 >= 0 ? ASM_Eval(as, stmt->Expr3, stmt->Addr, &unknown) : 0;
+        if (unknown) {
+            continue;
+        }
+        const struct CFG_Routine *routine = ASM_Instruction_At(as, addr) ? CFG_Routine(as->Cfg, addr) : NULL;
+        char cycles[32];
+        if (!routine) {
+            ASM_Error(as, ".assert_cycles: $%04lX is not an instruction", addr);
+        } else if (routine->Max == CFG_UNBOUNDED) {
+            ASM_Format_Cycles(cycles, sizeof(cycles), routine->Min, routine->Max);
+            ASM_Error(as, "routine at $%04lX has no worst case (%s), takes %s cycles", addr,
+                      ASM_Unbounded(routine->Flags), cycles);
+        } else if (routine->Max > max || routine->Min < min) {
+            ASM_Format_Cycles(cycles, sizeof(cycles), routine->Min, routine->Max);
+            if (stmt->Expr3 >= 0) {
+                ASM_Error(as, "routine at $%04lX takes %s cycles, expected %ld-%ld", addr, cycles, min, max);
             } else {
-                //注释跳过
+                ASM_Error(as, "routine at $%04lX takes %s cycles, expected at most %ld", addr, cycles, max);
+            }
+        }
+    }
+}
+
+//-------------测试-----------------
+
+/**
+ * 最后一遍之后把 .test/.setup/.expect 收集到 Tests/Checks, 检查值的范围
+ */
+static void ASM_Collect_Tests(struct Assembler *as) {
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        if (stmt->Kind < ASM_STMT_TEST) {
+            continue;
+        }
+        int unknown = 0;
+        as->Cur_File = stmt->File;
+        as->Cur_Line = stmt->Line;
+        if (stmt->Kind == ASM_STMT_TEST) {
+            long entry = ASM_Eval(as, stmt->Expr, stmt->Addr, &unknown);
+            long cycles = stmt->Expr2 >= 0 ? ASM_Eval(as, stmt->Expr2, stmt->Addr, &unknown) : 0;
+            if (!unknown && (entry < 0 || entry > 0xFFFF)) {
+                ASM_Error(as, ".test entry $%lX out of range", entry);
+            }
+            if (!unknown && cycles < 0) {
+                ASM_Error(as, ".test cycle limit %ld out of range", cycles);
+            }
+            as->Tests = ASM_Grow(as->Tests, &as->Test_Cap, as->Test_Count, sizeof(*as->Tests));
+            struct ASM_Test *test = &as->Tests[as->Test_Count++];
+            test->Name = (const char *) stmt->Data;
+            test->File = stmt->File ? stmt->File->Path : "";
+            test->Line = stmt->Line;
+            test->Entry = entry;
+            test->Max_Cycles = cycles > 0 ? cycles : 0;
+            test->First = as->Check_Count;
+            test->Count = 0;
+            continue;
+        }
+        const char *directive = stmt->Kind == ASM_STMT_SETUP ? ".setup" : ".expect";
+        if (!as->Test_Count) {
+            ASM_Error(as, "%s outside a test", directive);
+            continue;
+        }
+        long addr = stmt->Expr >= 0 ? ASM_Eval(as, stmt->Expr, stmt->Addr, &unknown) + stmt->Expr3 : 0;
+        long value = ASM_Eval(as, stmt->Expr2, stmt->Addr, &unknown);
+        if (unknown) {
+            continue;
+        }
+        long low = stmt->Symbol >= ASM_CHECK_N ? 0 : -128;
+        long high = stmt->Symbol == ASM_CHECK_CYCLES ? LONG_MAX : stmt->Symbol >= ASM_CHECK_N ? 1 : 255;
+        if (addr < 0 || addr > 0xFFFF) {
+            ASM_Error(as, "%s address $%lX out of range", directive, addr);
+            continue;
+        }
+        if (value < low || value > high) {
+            ASM_Error(as, "%s %s value %ld out of range", directive,
+                      stmt->Symbol == ASM_CHECK_MEM ? "memory" : ASM_Check_Names[stmt->Symbol], value);
+            continue;
+        }
+        as->Checks = ASM_Grow(as->Checks, &as->Check_Cap, as->Check_Count, sizeof(*as->Checks));
+        struct ASM_Check *check = &as->Checks[as->Check_Count++];
+        check->Target = stmt->Symbol;
+        check->Expect = stmt->Kind == ASM_STMT_EXPECT;
+        check->Addr = addr;
+        check->Value = stmt->Symbol == ASM_CHECK_CYCLES ? (unsigned long) value : (unsigned long) value & 0xFF;
+        check->Line = stmt->Line;
+        as->Tests[as->Test_Count - 1].Count++;
+    }
+}
+
+//-------------单元缓存-----------------
+
+/**
+ * 单元的键: 路径、-D/-I/优化选项和 CPU 型号
+ */
+static unsigned long long ASM_Unit_Key(const struct Assembler *as, const char *path) {
+    unsigned long long hash = ASM_Hash(ASM_HASH_BASIS, path, strlen(path) + 1);
+    int variant = CPU_VARIANT;
+    hash = ASM_Hash(hash, &variant, sizeof(variant));
+    for (int i = 0; i < as->Define_Count; ++i) {
+        hash = ASM_Hash(hash, as->Define_Names[i], strlen(as->Define_Names[i]) + 1);
+        hash = ASM_Hash(hash, &as->Define_Values[i], sizeof(long));
+    }
+    for (int i = 0; i < as->Dir_Count; ++i) {
+        hash = ASM_Hash(hash, as->Dirs[i], strlen(as->Dirs[i]) + 1);
+    }
+    return ASM_Hash(hash, &as->Optimize, sizeof(as->Optimize));
+}
+
+static int ASM_Write_Block(FILE *fp, const void *data, unsigned int size) {
+    return fwrite(&size, sizeof(size), 1, fp) == 1 && fwrite(data, 1, size, fp) == size;
+}
+
+static char *ASM_Read_Block(FILE *fp, unsigned int *size) {
+    if (fread(size, sizeof(*size), 1, fp) != 1 || *size > 0x1000000) {
+        return NULL;
+    }
+    char *data = malloc(*size + 1);
+    if (data && fread(data, 1, *size, fp) != *size) {
+        free(data);
+        return NULL;
+    }
+    data[*size] = '\0';
+    return data;
+}
+
+/**
+ * 单元结果: 依赖(路径, 内容哈希), 输出的连续段, 符号
+ */
+static void ASM_Unit_Save(const struct Assembler *as, unsigned long long key) {
+    char path[4096];
+    char tmp[4200];
+    ASM_Cache_Path(as, path, sizeof(path), "unit", key);
+    FILE *fp = ASM_Cache_Create(tmp, sizeof(tmp), path);
+    if (!fp) {
+        return;
+    }
+    unsigned int header[3] = {0x55353641, ASM_CACHE_VERSION, as->Dep_Count};
+    int ok = fwrite(header, sizeof(header), 1, fp) == 1;
+    for (int i = 0; i < as->Dep_Count && ok; ++i) {
+        ok = ASM_Write_Block(fp, as->Deps[i].Path, strlen(as->Deps[i].Path))
+             && fwrite(&as->Deps[i].Hash, sizeof(as->Deps[i].Hash), 1, fp) == 1;
+    }
+    for (unsigned int addr = 0; addr < 0x10000 && ok;) {
+        if (!as->Used[addr]) {
+            addr++;
+            continue;
+        }
+        unsigned int end = addr;
+        while (end < 0x10000 && as->Used[end]) {
+            end++;
+        }
+        ok = fwrite(&addr, sizeof(addr), 1, fp) == 1 && ASM_Write_Block(fp, as->Image + addr, end - addr);
+        addr = end;
+    }
+    unsigned int last = 0x10000;
+    ok = ok && fwrite(&last, sizeof(last), 1, fp) == 1;
+    for (int i = 0; i < as->Symbol_Count && ok; ++i) {
+        const struct ASM_Symbol *symbol = &as->Symbols[i];
+        if (symbol->Defined && symbol->Kind != ASM_SYM_MACRO) {
+            ok = ASM_Write_Block(fp, symbol->Name, symbol->Len)
+                 && fwrite(&symbol->Kind, 1, 1, fp) == 1 && fwrite(&symbol->Value, sizeof(long), 1, fp) == 1;
+        }
+    }
+    //空名字结束符号表, 后面是测试
+    unsigned int counts[2] = {as->Test_Count, as->Check_Count};
+    ok = ok && ASM_Write_Block(fp, "", 0) && fwrite(counts, sizeof(counts), 1, fp) == 1;
+    for (int i = 0; i < as->Test_Count && ok; ++i) {
+        const struct ASM_Test *test = &as->Tests[i];
+        ok = ASM_Write_Block(fp, test->Name, strlen(test->Name)) && ASM_Write_Block(fp, test->File, strlen(test->File))
+             && fwrite(test, sizeof(*test), 1, fp) == 1;
+    }
+    ok = ok && fwrite(as->Checks, sizeof(*as->Checks), as->Check_Count, fp) == (size_t) as->Check_Count;
+    ASM_Cache_Commit(fp, tmp, path, ok);
+}
+
+/**
+ * 依赖的内容都没变时读出结果
+ * @return 0 命中
+ */
+static int ASM_Unit_Load(struct Assembler *as, unsigned long long key) {
+    char path[4096];
+    ASM_Cache_Path(as, path, sizeof(path), "unit", key);
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return -1;
+    }
+    unsigned int header[3];
+    int ok = fread(header, sizeof(header), 1, fp) == 1 && header[0] == 0x55353641 && header[1] == ASM_CACHE_VERSION;
+    for (unsigned int i = 0; ok && i < header[2]; ++i) {
+        unsigned int size;
+        unsigned long long hash;
+        char *dep = ASM_Read_Block(fp, &size);
+        ok = dep && fread(&hash, sizeof(hash), 1, fp) == 1;
+        size_t length;
+        char *data = ok ? ASM_Read(dep, &length) : NULL;
+        ok = data && ASM_Hash(ASM_HASH_BASIS, data, length) == hash;
+        free(data);
+        free(dep);
+    }
+    while (ok) {
+        unsigned int addr, size;
+        ok = fread(&addr, sizeof(addr), 1, fp) == 1;
+        if (!ok || addr == 0x10000) {
+            break;
+        }
+        char *data = ASM_Read_Block(fp, &size);
+        ok = data && addr + size <= 0x10000;
+        if (ok) {
+            memcpy(as->Image + addr, data, size);
+            memset(as->Used + addr, 1, size);
+        }
+        free(data);
+    }
+    while (ok) {
+        unsigned int size;
+        char *name = ASM_Read_Block(fp, &size);
+        ok = name != NULL;
+        if (!ok || size == 0) {
+            free(name);
+            break;
+        }
+        char *copy = ASM_Alloc(as, size);
+        memcpy(copy, name, size);
+        free(name);
+        int index = ASM_Symbol(as, copy, size);
+        struct ASM_Symbol *symbol = &as->Symbols[index];
+        ok = fread(&symbol->Kind, 1, 1, fp) == 1 && fread(&symbol->Value, sizeof(long), 1, fp) == 1;
+        symbol->Defined = 1;
+    }
+    unsigned int counts[2];
+    ok = ok && fread(counts, sizeof(counts), 1, fp) == 1;
+    for (unsigned int i = 0; ok && i < counts[0]; ++i) {
+        unsigned int size;
+        char *text[2] = {NULL, NULL};
+        for (int j = 0; j < 2 && (j == 0 || text[0]); ++j) {
+            char *block = ASM_Read_Block(fp, &size);
+            if (block) {
+                text[j] = ASM_Alloc(as, size + 1);
+                memcpy(text[j], block, size + 1);
+                free(block);
+            }
+        }
+        as->Tests = ASM_Grow(as->Tests, &as->Test_Cap, as->Test_Count, sizeof(*as->Tests));
+        struct ASM_Test *test = &as->Tests[as->Test_Count];
+        ok = text[0] && text[1] && fread(test, sizeof(*test), 1, fp) == 1
+             && test->First + test->Count <= (int) counts[1] && test->First >= 0 && test->Count >= 0;
+        if (ok) {
+            test->Name = text[0];
+            test->File = text[1];
+            as->Test_Count++;
+        }
+    }
+    for (unsigned int i = 0; ok && i < counts[1]; ++i) {
+        as->Checks = ASM_Grow(as->Checks, &as->Check_Cap, as->Check_Count, sizeof(*as->Checks));
+        ok = fread(&as->Checks[as->Check_Count++], sizeof(*as->Checks), 1, fp) == 1;
+    }
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+//-------------入口-----------------
+
+void ASM_Init(struct Assembler *as) {
+    memset(as, 0, sizeof(*as));
+    ASM_Build_Mnemonics(as);
+}
+
+/**
+ * 清掉上一个单元的状态, 保留文件缓存和选项
+ */
+static void ASM_Reset(struct Assembler *as) {
+    while (as->Chunks) {
+        struct ASM_Chunk *next = as->Chunks->Next;
+        free(as->Chunks);
+        as->Chunks = next;
+    }
+    for (int i = 0; i < as->Dep_Count; ++i) {
+        free(as->Deps[i].Path);
+    }
+    while (as->Depth) {
+        if (as->Frames[--as->Depth].Own) {
+            free((void *) as->Frames[as->Depth].Tokens);
+        }
+    }
+    if (as->Cfg) {
+        CFG_Free(as->Cfg);
+        free(as->Cfg);
+        as->Cfg = NULL;
+    }
+    as->Dep_Count = 0;
+    as->Symbol_Count = 0;
+    if (as->Symbol_Hash) {
+        memset(as->Symbol_Hash, 0, sizeof(int) * as->Hash_Cap);
+    }
+    as->Macro_Count = 0;
+    as->Stmt_Count = 0;
+    as->Node_Count = 0;
+    as->Test_Count = 0;
+    as->Check_Count = 0;
+    as->Cond_Depth = 0;
+    as->Collect = 0;
+    as->Unique = 0;
+    as->Pass = 0;
+    as->Final = 0;
+    as->Errors = 0;
+    as->Cached = 0;
+    as->Removed = 0;
+    as->Padding = 0;
+    as->Cur_File = NULL;
+    as->Cur_Line = 0;
+    memset(as->Image, 0, sizeof(as->Image));
+    memset(as->Used, 0, sizeof(as->Used));
+}
+
+void ASM_Free(struct Assembler *as) {
+    ASM_Reset(as);
+    while (as->Files) {
+        struct ASM_File *next = as->Files->Next;
+        free(as->Files->Path);
+        free(as->Files->Tokens);
+        free(as->Files->Pool);
+        free(as->Files);
+        as->Files = next;
+    }
+    free(as->Symbols);
+    free(as->Symbol_Hash);
+    free(as->Macros);
+    free(as->Stmts);
+    free(as->Nodes);
+    free(as->Deps);
+    free(as->Body);
+    free(as->Tests);
+    free(as->Checks);
+    as->Tests = NULL;
+    as->Checks = NULL;
+    as->Test_Cap = as->Check_Cap = 0;
+    as->Symbols = NULL;
+    as->Symbol_Hash = NULL;
+    as->Hash_Cap = as->Symbol_Cap = 0;
+    as->Macros = NULL;
+    as->Stmts = NULL;
+    as->Nodes = NULL;
+    as->Deps = NULL;
+    as->Body = NULL;
+    as->Macro_Cap = as->Stmt_Cap = as->Node_Cap = as->Dep_Cap = as->Body_Cap = 0;
+}
+
+int ASM_Define(struct Assembler *as, const char *name, long value) {
+    if (as->Define_Count == ASM_DEFINES) {
+        return -1;
+    }
+    as->Define_Names[as->Define_Count] = name;
+    as->Define_Values[as->Define_Count++] = value;
+    return 0;
+}
+
+int ASM_Assemble(struct Assembler *as, const char *path) {
+    ASM_Reset(as);
+    unsigned long long key = ASM_Unit_Key(as, path);
+    if (as->Cache_Dir && !as->Analyze) {
+        if (ASM_Unit_Load(as, key) == 0) {
+            as->Cached = 1;
+            return 0;
+        }
+        ASM_Reset(as);
+    }
+    for (int i = 0; i < as->Define_Count; ++i) {
+        int symbol = ASM_Symbol(as, as->Define_Names[i], strlen(as->Define_Names[i]));
+        ASM_Set(as, symbol, ASM_SYM_EQU, as->Define_Values[i]);
+    }
+    const struct ASM_File *file = ASM_Load(as, path);
+    if (!file) {
+        return as->Errors;
+    }
+    ASM_Push(as, file, file->Tokens, file->Count, 0, 0);
+    ASM_Run(as);
+    //出错后继续, 一次报告所有错误, 有错误时不输出
+    if (ASM_Settle(as)) {
+        return as->Errors;
+    }
+    if (as->Optimize && !as->Errors && ASM_Peephole(as) && ASM_Settle(as)) {
+        return as->Errors;
+    }
+    for (int round = 0; as->Optimize == ASM_OPT_SPEED && !as->Errors && round < ASM_ALIGN_ROUNDS && ASM_Align(as);
+         ++round) {
+        if (ASM_Settle(as)) {
+            return as->Errors;
+        }
+    }
+    as->Final = 1;
+    as->Pass++;
+    ASM_Pass(as);
+    if (!as->Errors) {
+        ASM_Collect_Tests(as);
+    }
+    if (!as->Errors) {
+        ASM_Timing(as);
+    }
+    if (!as->Errors && as->Cache_Dir) {
+        ASM_Unit_Save(as, key);
+    }
+    return as->Errors;
+}
+
+static const char *ASM_Extension(const char *path) {
+    const char *dot = strrchr(path, '.');
+    const char *slash = strrchr(path, '/');
+    return dot && (!slash || dot > slash) ? dot + 1 : "";
+}
+
+int ASM_Write(const struct Assembler *as, const char *path) {
+    const char *ext = ASM_Extension(path);
+    int low = 0;
+    int high = 0xFFFF;
+    while (low <= 0xFFFF && !as->Used[low]) {
+        low++;
+    }
+    while (high >= low && !as->Used[high]) {
+        high--;
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return -1;
+    }
+    if (strcasecmp(ext, "hex") == 0 || strcasecmp(ext, "ihx") == 0) {
+        for (int addr = low; addr <= high;) {
+            if (!as->Used[addr]) {
+                addr++;
+                continue;
+            }
+            int count = 0;
+            while (count < 16 && addr + count <= high && as->Used[addr + count]) {
+                count++;
+            }
+            Byte sum = count + (addr >> 8) + addr;
+            fprintf(fp, ":%02X%04X00", count, addr);
+            for (int i = 0; i < count; ++i) {
+                fprintf(fp, "%02X", as->Image[addr + i]);
+                sum += as->Image[addr + i];
+            }
+            fprintf(fp, "%02X\n", (Byte) -sum);
+            addr += count;
+        }
+        fprintf(fp, ":00000001FF\n");
+    } else if (low <= high) {
+        if (strcasecmp(ext, "prg") == 0) {
+            fputc(low & 0xFF, fp);
+            fputc(low >> 8, fp);
+        }
+        fwrite(as->Image + low, 1, high - low + 1, fp);
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+int ASM_Write_Symbols(const struct Assembler *as, const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    for (int i = 0; i < as->Symbol_Count; ++i) {
+        const struct ASM_Symbol *symbol = &as->Symbols[i];
+        if (symbol->Defined && symbol->Kind != ASM_SYM_MACRO) {
+            fprintf(fp, "%.*s = $%04lX\n", symbol->Len, symbol->Name, symbol->Value);
+        }
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * 列表用的源文件, 按行切开
+ */
+struct ASM_Source {
+    const struct ASM_File *File;
+    char *Text;
+    char **Lines;
+    int Count;
+};
+
+static const char *ASM_Source_Line(struct ASM_Source **sources, int *count, const struct ASM_File *file, int line) {
+    struct ASM_Source *source = NULL;
+    for (int i = 0; i < *count; ++i) {
+        if ((*sources)[i].File == file) {
+            source = &(*sources)[i];
+        }
+    }
+    if (!source) {
+        struct ASM_Source *grown = realloc(*sources, sizeof(**sources) * (*count + 1));
+        if (!grown) {
+            return "";
+        }
+        *sources = grown;
+        source = &grown[(*count)++];
+        memset(source, 0, sizeof(*source));
+        source->File = file;
+        size_t size;
+        source->Text = file ? ASM_Read(file->Path, &size) : NULL;
+        for (char *p = source->Text; p; p = strchr(p, '\n') ? strchr(p, '\n') + 1 : NULL) {
+            char **lines = realloc(source->Lines, sizeof(char *) * (source->Count + 1));
+            if (!lines) {
                 break;
             }
+            source->Lines = lines;
+            source->Lines[source->Count++] = p;
+        }
+        for (int i = 0; i < source->Count; ++i) {
+            source->Lines[i][strcspn(source->Lines[i], "\r\n")] = '\0';
+        }
+    }
+    return line >= 1 && line <= source->Count ? source->Lines[line - 1] : "";
+}
+
+int ASM_Write_Listing(struct Assembler *as, const char *path) {
+    if (!as->Cfg) {
+        return -1;
+    }
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    struct ASM_Source *sources = NULL;
+    int source_count = 0;
+    for (int i = 0; i < as->Stmt_Count;) {
+        //同一行的语句(标号和指令)合成一行
+        const struct ASM_Stmt *first = &as->Stmts[i];
+        int end = i + 1;
+        while (end < as->Stmt_Count && as->Stmts[end].File == first->File && as->Stmts[end].Line == first->Line) {
+            end++;
+        }
+        char bytes[32] = "";
+        char cycles[32] = "";
+        int shown = 0;
+        int addr = -1;
+        for (int j = i; j < end; ++j) {
+            const struct ASM_Stmt *stmt = &as->Stmts[j];
+            if (ASM_Code_Label(as, j)) {
+                const struct ASM_Symbol *symbol = &as->Symbols[stmt->Symbol];
+                const struct CFG_Routine *routine = CFG_Routine(as->Cfg, stmt->Addr);
+                char range[32];
+                ASM_Format_Cycles(range, sizeof(range), routine ? routine->Min : CFG_UNBOUNDED,
+                                  routine ? routine->Max : CFG_UNBOUNDED);
+                fprintf(fp, "%28s; %.*s: %s cycles%s%s%s\n", "", symbol->Len, symbol->Name, range,
+                        routine && routine->Flags ? " (" : "",
+                        routine && routine->Flags ? ASM_Unbounded(routine->Flags) : "",
+                        routine && routine->Flags ? ")" : "");
+            }
+            if (stmt->Kind == ASM_STMT_EQU) {
+                const struct ASM_Symbol *symbol = &as->Symbols[stmt->Symbol];
+                snprintf(bytes, sizeof(bytes), "= $%04lX", symbol->Value);
+                continue;
+            }
+            if (addr < 0 && (stmt->Size || stmt->Kind == ASM_STMT_LABEL || stmt->Kind == ASM_STMT_ORG)) {
+                addr = stmt->Addr;
+            }
+            for (unsigned int k = 0; k < stmt->Size && stmt->Addr + k <= 0xFFFF; ++k, ++shown) {
+                size_t len = strlen(bytes);
+                if (shown == 4) {
+                    snprintf(bytes + len, sizeof(bytes) - len, "..");
+                } else if (shown < 4) {
+                    snprintf(bytes + len, sizeof(bytes) - len, "%02X ", as->Image[stmt->Addr + k]);
+                }
+            }
+            if (stmt->Kind == ASM_STMT_INS) {
+                Byte min, max;
+                OP_Cycle_Range(as->Image, stmt->Addr, &min, &max);
+                ASM_Format_Cycles(cycles, sizeof(cycles), min, max);
+            }
+        }
+        if (addr >= 0) {
+            fprintf(fp, "%04X  %-14s %-5s %5d  %s\n", addr, bytes, cycles, first->Line,
+                    ASM_Source_Line(&sources, &source_count, first->File, first->Line));
+        } else {
+            fprintf(fp, "      %-14s %-5s %5d  %s\n", bytes, cycles, first->Line,
+                    ASM_Source_Line(&sources, &source_count, first->File, first->Line));
+        }
+        i = end;
+    }
+    for (int i = 0; i < source_count; ++i) {
+        free(sources[i].Text);
+        free(sources[i].Lines);
+    }
+    free(sources);
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+void ASM_Print_Cycles(struct Assembler *as, FILE *fp) {
+    if (!as->Cfg) {
+        return;
+    }
+    for (int i = 0; i < as->Stmt_Count; ++i) {
+        if (!ASM_Code_Label(as, i)) {
+            continue;
+        }
+        const struct ASM_Stmt *stmt = &as->Stmts[i];
+        const struct ASM_Symbol *symbol = &as->Symbols[stmt->Symbol];
+        const struct CFG_Routine *routine = CFG_Routine(as->Cfg, stmt->Addr);
+        char range[32];
+        ASM_Format_Cycles(range, sizeof(range), routine ? routine->Min : CFG_UNBOUNDED,
+                          routine ? routine->Max : CFG_UNBOUNDED);
+        fprintf(fp, "$%04X  %-10s %.*s%s%s%s\n", stmt->Addr, range, symbol->Len, symbol->Name,
+                routine && routine->Flags ? " (" : "", routine && routine->Flags ? ASM_Unbounded(routine->Flags) : "",
+                routine && routine->Flags ? ")" : "");
+    }
+}
+
+/**
+ * 输出文件名: 源文件换扩展名
+ */
+static void ASM_Output_Path(const char *source, const char *ext, char *path, size_t size) {
+    const char *dot = strrchr(source, '.');
+    const char *slash = strrchr(source, '/');
+    int len = dot && (!slash || dot > slash) ? (int) (dot - source) : (int) strlen(source);
+    snprintf(path, size, "%.*s.%s", len, source, ext);
+}
+
+int ASM_Main(int argc, char **argv) {
+    const char *output = NULL;
+    int symbols = 0;
+    int verbose = 0;
+    int listing = 0;
+    int cycles = 0;
+    int failed = 0;
+    struct Assembler *as = malloc(sizeof(*as));
+    if (!as) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    ASM_Init(as);
+    int i = 0;
+    for (; i < argc && argv[i][0] == '-'; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "--sym") == 0) {
+            symbols = 1;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            listing = 1;
+            as->Analyze = 1;
+        } else if (strcmp(argv[i], "--cycles") == 0) {
+            cycles = 1;
+            as->Analyze = 1;
+        } else if (strcmp(argv[i], "--optimize") == 0 || strcmp(argv[i], "--optimize=speed") == 0) {
+            as->Optimize = ASM_OPT_SPEED;
+        } else if (strcmp(argv[i], "--optimize=size") == 0) {
+            as->Optimize = ASM_OPT_SIZE;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            as->Cache_Dir = argv[++i];
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc && as->Dir_Count < ASM_DIRS) {
+            as->Dirs[as->Dir_Count++] = argv[++i];
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            char *define = argv[++i];
+            char *eq = strchr(define, '=');
+            long value = eq ? strtol(eq + 1, NULL, 0) : 1;
+            if (eq) {
+                *eq = '\0';
+            }
+            if (ASM_Define(as, define, value)) {
+                fprintf(stderr, "too many -D\n");
+                failed = 1;
+            }
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else {
+            failed = 1;
+            break;
+        }
+    }
+    if (failed || i == argc || (output && argc - i > 1)) {
+        fprintf(stderr, "usage: asm [-o OUT] [--sym] [-l] [--cycles] [--optimize[=speed|size]] [--cache DIR] [-I DIR]... "
+                        "[-D NAME[=VALUE]]... [-v] <file>...\n"
+                        "OUT: .prg (load address header), .hex/.ihx (Intel HEX), otherwise raw binary\n"
+                        "-l writes a listing with cycle counts next to the output (.lst),\n"
+                        "--cycles prints min-max cycles of every labelled routine\n"
+                        "--optimize picks zero page once addresses are known, turns out of range branches into\n"
+                        "  branch + JMP, removes redundant loads and JSR/RTS; speed (default) also aligns loops\n"
+                        "  so their branches do not cross a page\n");
+        ASM_Free(as);
+        free(as);
+        return 1;
+    }
+    if (as->Cache_Dir) {
+        mkdir(as->Cache_Dir, 0777);
+    }
+    for (; i < argc; ++i) {
+        char path[4096];
+        if (ASM_Assemble(as, argv[i])) {
+            failed = 1;
+            continue;
+        }
+        if (output) {
+            snprintf(path, sizeof(path), "%s", output);
+        } else {
+            ASM_Output_Path(argv[i], "bin", path, sizeof(path));
+        }
+        if (ASM_Write(as, path)) {
+            fprintf(stderr, "can't write %s\n", path);
+            failed = 1;
+            continue;
+        }
+        if (symbols) {
+            char sym[4096];
+            ASM_Output_Path(path, "sym", sym, sizeof(sym));
+            if (ASM_Write_Symbols(as, sym)) {
+                fprintf(stderr, "can't write %s\n", sym);
+                failed = 1;
+            }
+        }
+        if (listing) {
+            char lst[4096];
+            ASM_Output_Path(path, "lst", lst, sizeof(lst));
+            if (ASM_Write_Listing(as, lst)) {
+                fprintf(stderr, "can't write %s\n", lst);
+                failed = 1;
+            }
+        }
+        if (cycles) {
+            ASM_Print_Cycles(as, stdout);
+        }
+        if (verbose) {
+            int bytes = 0;
+            for (int addr = 0; addr < 0x10000; ++addr) {
+                bytes += as->Used[addr];
+            }
+            printf("%s: %d bytes, %d statements", argv[i], bytes, as->Stmt_Count);
+            if (as->Optimize && !as->Cached) {
+                printf(", %d removed, %d padding", as->Removed, as->Padding);
+            }
+            printf("%s\n", as->Cached ? " (cached)" : "");
         }
-        printf("%s %s \n",ins_mode,opcode);
-        line++;
     }
-}
\ No newline at end of file
+    ASM_Free(as);
+    free(as);
+    return failed;
+}
@@ -0,0 +1,2681 @@
+#include <string.h>
+#include "include/cpu.h"
+#include "include/metrics.h"
+#include "include/replay.h"
+#include "include/watch.h"
+
+_Thread_local struct CPU_Context *CPU_Current;
+
+//挂起后这条指令剩下的访问都走慢速路径, 不碰设备和内存
+static struct Bus CPU_Null_Bus;
+
+/**
+ * 初始化上下文并挂到总线上
+ * @param cpu
+ * @param bus
+ */
+void CPU_Init(struct CPU_Context *cpu, struct Bus *bus) {
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->Bus = bus;
+    cpu->Event_Cycle = CPU_NO_EVENT;
+    cpu->IO_Cycles = ~0ULL;
+}
+
+/**
+ * 切换当前线程执行的上下文
+ * @param cpu
+ */
+void CPU_Select(struct CPU_Context *cpu) {
+    CPU_Current = cpu;
+}
+
+void CPU_Reset(Short PCAddr) {
+    CPU.PC = PCAddr;
+    CPU.SP = 0xFF;
+    CPU.A = CPU.X = CPU.Y = 0;
+    CPU.F_B = 1;
+    CPU.F_N = CPU.F_V = CPU.F_D = CPU.F_I = CPU.F_Z = CPU.F_C = 0;
+    CPU.Halted = CPU_RUN;
+}
+
+/**
+ * 设备访问前调用: 每条指令的第一次设备访问开始新的记录, 并保存寄存器
+ * @return 1 重新执行挂起的指令, 这次访问已经完成过, 按记录重放
+ */
+static int CPU_IO_Replay() {
+    if (CPU.IO_Cycles != CPU.Cycles) {
+        CPU.IO_Cycles = CPU.Cycles;
+        CPU.IO_Count = CPU.IO_Replay = 0;
+        CPU.IO_Saved.A = CPU.A;
+        CPU.IO_Saved.X = CPU.X;
+        CPU.IO_Saved.Y = CPU.Y;
+        CPU.IO_Saved.F_N = CPU.F_N;
+        CPU.IO_Saved.F_V = CPU.F_V;
+        CPU.IO_Saved.F_D = CPU.F_D;
+        CPU.IO_Saved.F_I = CPU.F_I;
+        CPU.IO_Saved.F_Z = CPU.F_Z;
+        CPU.IO_Saved.F_C = CPU.F_C;
+    }
+    if (CPU.Retry && CPU.IO_Replay < CPU.IO_Count) {
+        CPU.IO_Replay++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * 设备访问完成, 挂起的访问不记录, 恢复后重新发给设备
+ * @param value 读到的值, 写为 0
+ */
+static void CPU_IO_Done(Byte value) {
+    if (!CPU.Suspend_Bus && CPU.IO_Count < CPU_IO_LOG) {
+        CPU.IO_Log[CPU.IO_Count++] = value;
+        CPU.IO_Replay = CPU.IO_Count;
+    }
+}
+
+/**
+ * 读 I/O 页, 录制时把读到的值写入回放日志
+ * @param device
+ * @param addr
+ * @return
+ */
+Byte CPU_Read_IO(struct Bus_Device *device, Short addr) {
+    if (CPU_IO_Replay()) {
+        return CPU.IO_Log[CPU.IO_Replay - 1];
+    }
+    Byte value = device->Read ? device->Read(device->Ctx, addr) : 0xFF;
+    if (CPU.Suspend_Bus) {
+        return 0xFF;
+    }
+    CPU_IO_Done(value);
+    if (CPU.Recorder) {
+        Replay_Log_Read(CPU.Recorder, value);
+    }
+    return value;
+}
+
+/**
+ * 页表里没有的页: I/O 或者有观察点
+ * 挂起后总线换成空总线, 也走这里
+ * @param addr
+ * @param kind 要检查的观察点类型, 取指令时为 0
+ * @return
+ */
+static Byte CPU_Read_Slow(Short addr, Byte kind) {
+    struct Bus *bus = CPU.Bus;
+    if (CPU.Suspend_Bus) {
+        return 0xFF;
+    }
+    struct Bus_Device *device = bus->IO[addr >> 8];
+    Byte value = device ? CPU_Read_IO(device, addr) : Bus_Peek(bus, addr);
+    if (bus->Armed[addr >> 8] & kind) {
+        Watch_Access(bus->Watch, addr, value, kind);
+    }
+    return value;
+}
+
+Byte CPU_Read_Addr(Short addr) {
+    CPU.INS_Cycles += 1;
+    const Byte *page = CPU.Bus->Read_Page[addr >> 8];
+    if (page) {
+        return page[addr & 0xFF];
+    }
+    return CPU_Read_Slow(addr, BUS_ARM_READ);
+}
+
+/**
+ * 取指令字节, 不触发读观察点
+ */
+Byte CPU_Get_Byte() {
+    CPU.INS_Cycles += 1;
+    Short addr = CPU.PC++;
+    const Byte *page = CPU.Bus->Read_Page[addr >> 8];
+    if (page) {
+        return page[addr & 0xFF];
+    }
+    return CPU_Read_Slow(addr, 0);
+}
+
+Short concat_byte(Byte low, Byte high) {
+    return low | (high << 8);
+}
+
+Byte CPU_Write_Addr(Short addr, Byte value) {
+    CPU.INS_Cycles += 1;
+    Byte *page = CPU.Bus->Write_Page[addr >> 8];
+    if (page) {
+        CPU.Bus->Dirty[addr >> 8] = 1;
+        return page[addr & 0xFF] = value;
+    }
+    if (CPU.Suspend_Bus) {
+        return value;
+    }
+    if (CPU.Bus->Armed[addr >> 8] & BUS_ARM_WRITE) {
+        Watch_Access(CPU.Bus->Watch, addr, value, BUS_ARM_WRITE);
+    }
+    struct Bus_Device *device = CPU.Bus->IO[addr >> 8];
+    if (device) {
+        if (!CPU_IO_Replay()) {
+            if (device->Write) {
+                device->Write(device->Ctx, addr, value);
+            }
+            CPU_IO_Done(0);
+        }
+        return value;
+    }
+    const Byte *backing = CPU.Bus->Backing[addr >> 8];
+    value = Bus_Write_Fault(CPU.Bus, addr, value);
+    if (CPU.Bus->Backing[addr >> 8] != backing) {
+        METRICS_COUNT(CPU_Current, METRIC_PAGE_FAULTS, 1);
+    }
+    return value;
+}
+
+/**
+ * 让 CPU_Run 在当前指令结束后返回, 同时停止融合和快进
+ * @param reason CPU_BREAK_xxx
+ */
+void CPU_Break(Byte reason) {
+    CPU.Break = reason;
+    CPU.Run_Limit = 0;
+}
+
+/**
+ * 设备回调里调用: 让 CPU_Run 在当前指令结束后返回, 下次从下一条指令继续
+ * @param cpu
+ */
+void CPU_Yield(struct CPU_Context *cpu) {
+    cpu->Break = CPU_BREAK_YIELD;
+    cpu->Run_Limit = 0;
+}
+
+/**
+ * 设备回调里调用: 在当前总线周期挂起 CPU
+ * 这条指令剩下的访问不再到达总线, 指令结束后回到指令开始, CPU_Resume 之前 CPU_Run 不执行
+ * 恢复后重新执行这条指令, 之前完成的设备访问按记录重放, 挂起它的那次访问重新发给设备
+ * @param cpu
+ * @return 0 不能挂起(中断响应/BRK 过程中), 访问照常完成
+ */
+int CPU_Suspend(struct CPU_Context *cpu) {
+    if (cpu->Atomic || cpu->Suspend_Bus || cpu->IO_Count >= CPU_IO_LOG) {
+        return 0;
+    }
+    cpu->Suspended = 1;
+    cpu->Suspend_Bus = cpu->Bus;
+    cpu->Bus = &CPU_Null_Bus;
+    cpu->Run_Limit = 0;
+    return 1;
+}
+
+/**
+ * 恢复挂起的 CPU, 在两次 CPU_Run 之间调用, 下次 CPU_Run 时重新执行挂起的指令
+ * @param cpu
+ */
+void CPU_Resume(struct CPU_Context *cpu) {
+    cpu->Suspended = 0;
+}
+
+/**
+ * 挂起的指令结束后回到指令开始
+ */
+static void CPU_Rewind() {
+    CPU.Bus = CPU.Suspend_Bus;
+    CPU.Suspend_Bus = NULL;
+    CPU.PC = CPU.Start_PC;
+    CPU.SP = CPU.Start_SP;
+    CPU.A = CPU.IO_Saved.A;
+    CPU.X = CPU.IO_Saved.X;
+    CPU.Y = CPU.IO_Saved.Y;
+    CPU.F_N = CPU.IO_Saved.F_N;
+    CPU.F_V = CPU.IO_Saved.F_V;
+    CPU.F_D = CPU.IO_Saved.F_D;
+    CPU.F_I = CPU.IO_Saved.F_I;
+    CPU.F_Z = CPU.IO_Saved.F_Z;
+    CPU.F_C = CPU.IO_Saved.F_C;
+    CPU.Cycles = CPU.IO_Cycles;
+    CPU.IO_Replay = 0;
+    CPU.Retry = 1;
+    //重新执行时再计数
+    CPU.Empty_Dispatch++;
+}
+
+/**
+ * 记录一条跳转边(AFL 风格的边覆盖)
+ * from 取跳转指令之后的地址, 每个跳转点唯一
+ * @param from
+ * @param to
+ */
+void CPU_Cover_Edge(Short from, Short to) {
+    CPU.Coverage[(Short) (((from << 7) | (from >> 9)) ^ to)]++;
+}
+
+/**
+ * 读-改-写指令的读取
+ * 读出原值后还有一个空写周期
+ * @param addr
+ * @return
+ */
+Byte CPU_Read_Modify(Short addr) {
+    Byte value = CPU_Read_Addr(addr);
+    CPU.INS_Cycles += 1;
+    return value;
+}
+
+//栈固定在 0x0100-0x01FF
+void CPU_Stack_Push_Byte(Byte value) {
+    CPU_Write_Addr(0x100 | CPU.SP,value);
+    CPU.SP--;
+}
+
+Byte CPU_Stack_Pull_Byte() {
+    CPU.SP++;
+    return CPU_Read_Addr(0x100 | CPU.SP);
+}
+
+//先压高字节再压低字节
+void CPU_Stack_Push_Short(Short value) {
+    CPU_Stack_Push_Byte((value>>8)&0xff);
+    CPU_Stack_Push_Byte(value&0xff);
+}
+
+Short CPU_Stack_Pull_Short() {
+    Byte low = CPU_Stack_Pull_Byte();
+    Byte high = CPU_Stack_Pull_Byte();
+    return concat_byte(low,high);
+}
+
+void Pull_Flag() {
+    Byte flag = CPU_Stack_Pull_Byte();
+    CPU.F_N = flag>>7;
+    CPU.F_V = (flag>>6)&1;
+    CPU.F_D = (flag>>3)&1;
+    CPU.F_I = (flag>>2)&1;
+    CPU.F_Z = (flag>>1)&1;
+    CPU.F_C = flag&1;
+    CPU.INS_Cycles += 1;
+}
+
+/**
+ * 状态寄存器入栈
+ * @param brk PHP/BRK 为1, IRQ/NMI 为0 (B位)
+ */
+void Push_Flag(Byte brk) {
+    Byte flag = (CPU.F_N<<7)
+                | (CPU.F_V<<6)
+                | 0x20
+                | (brk<<4)
+                | (CPU.F_D<<3)
+                | (CPU.F_I<<2)
+                | (CPU.F_Z<<1)
+                | CPU.F_C;
+    CPU_Stack_Push_Byte(flag);
+}
+
+//-------------寻址方式开始-----------------
+// AM: Addressing Mode
+
+/**
+ * 直接寻址
+ * @param reg
+ * @return
+ */
+Byte AM_IMM() {
+
+    return CPU_Get_Byte();
+}
+
+/**
+ * 绝对寻址
+ * Absolute: a
+ * @param low
+ * @param high
+ * @return
+ */
+Short AM_Abs() {
+    Byte low = CPU_Get_Byte();
+    Byte high = CPU_Get_Byte();
+    return concat_byte(low, high);
+}
+
+/**
+ * 绝对索引寻址
+ * Absolute Indexed with REG: a,REG
+ * REG = CPU.X/CPU.Y
+ * @param low
+ * @param high
+ * @param reg
+ * @return
+ */
+Short AM_Abs_XY(Byte reg) {
+    Short abs = AM_Abs();
+    Short absRegAddr = abs + reg;
+    //page boundary is crossed
+    CPU.INS_Cycles += ((abs ^ absRegAddr) >> 8) > 0;
+    return absRegAddr;
+}
+
+/**
+ * 绝对索引寻址(写/读-改-写)
+ * 不论是否跨页都多一个周期
+ * @param reg
+ * @return
+ */
+Short AM_Abs_XY_W(Byte reg) {
+    CPU.INS_Cycles++;
+    return AM_Abs() + reg;
+}
+
+/**
+ * 零页寻址
+ * @return
+ */
+Short AM_ZP() {
+
+    return CPU_Get_Byte();
+}
+
+/**
+ * 零页索引寻址
+ * @param reg
+ * @return
+ */
+Short AM_ZP_XY(Byte reg) {
+    CPU.INS_Cycles++;
+    //不会越出零页
+    return (Byte)(AM_ZP() + reg);
+}
+
+/**
+ * 零页索引间接寻址 X
+ * @return
+ */
+Short AM_ZP_IND_X() {
+    Short low = AM_ZP_XY(CPU.X);
+    return concat_byte(CPU_Read_Addr(low), CPU_Read_Addr((Byte)(low + 1)));
+}
+
+/**
+ * 零页间接索引寻址 Y
+ * @return
+ */
+Short AM_ZP_IND_Y() {
+    Short low = AM_ZP();
+    Short address_1 = concat_byte(CPU_Read_Addr(low), CPU_Read_Addr((Byte)(low + 1)));
+    Short address_2 = address_1 + CPU.Y;
+    //page boundary is crossed
+    CPU.INS_Cycles += ((address_1 ^ address_2) >> 8) > 0;
+    return address_2;
+}
+
+/**
+ * 零页间接索引寻址 Y (写/读-改-写)
+ * 不论是否跨页都多一个周期
+ * @return
+ */
+Short AM_ZP_IND_Y_W() {
+    Short low = AM_ZP();
+    CPU.INS_Cycles++;
+    return concat_byte(CPU_Read_Addr(low), CPU_Read_Addr((Byte)(low + 1))) + CPU.Y;
+}
+
+/**
+ * 零页间接寻址 (65C02)
+ * @return
+ */
+Short AM_ZP_IND() {
+    Short low = AM_ZP();
+    return concat_byte(CPU_Read_Addr(low), CPU_Read_Addr((Byte)(low + 1)));
+}
+
+/**
+ * 间接寻址
+ * NMOS: 指针在页尾(xxFF)时高字节从同一页的 xx00 读取
+ * 65C02: 修正了该问题, 多一个周期
+ * @return
+ */
+Short AM_ZP_INDIRECT() {
+    Short addr = AM_Abs();
+#if CPU_IS_CMOS
+    CPU.INS_Cycles++;
+    return concat_byte(CPU_Read_Addr(addr), CPU_Read_Addr(addr + 1));
+#else
+    return concat_byte(CPU_Read_Addr(addr), CPU_Read_Addr((addr & 0xFF00) | (Byte)(addr + 1)));
+#endif
+}
+
+/**
+ * 绝对索引间接寻址 (65C02 JMP (a,x))
+ * @return
+ */
+Short AM_Abs_X_IND() {
+    Short addr = AM_Abs() + CPU.X;
+    CPU.INS_Cycles++;
+    return concat_byte(CPU_Read_Addr(addr), CPU_Read_Addr(addr + 1));
+}
+
+#if CPU_IS_CMOS
+//65C02 移位指令 a,x 只在跨页时多一个周期
+#define AM_Abs_X_Shift() AM_Abs_XY(CPU.X)
+#else
+#define AM_Abs_X_Shift() AM_Abs_XY_W(CPU.X)
+#endif
+
+//-------------寻址方式结束-----------------
+
+//-------------FLAG设置开始-----------------
+
+void CPU_F_NZ(Byte data) {
+    CPU.F_N = data >> 7;
+    CPU.F_Z = data == 0;
+}
+
+/**
+ *  A - M
+ *  注意: 实际使用的是 REG_x - input(M) 是减法
+ *          	        N	Z	C
+ *  Register < Memory	1	0	0
+ *  Register = Memory	0	1	1
+ *  Register > Memory	0	0	1
+ * @param input
+ */
+void CPU_F_Compare(Byte reg, Byte input) {
+    CPU.INS_Cycles += 1;
+    Byte res = reg - input;
+    CPU_F_NZ(res);
+    //unsigned
+    CPU.F_C = reg >= input;
+}
+
+//-------------FLAG设置结束-----------------
+
+//-------------指令开始-----------------
+
+/**
+ * AXY寄存器设置值
+ * @param value 值
+ * @param reg AXY寄存器
+ */
+void INS_Set_REG(Byte value, Byte *reg) {
+    *reg = value;
+    CPU_F_NZ(*reg);
+    CPU.INS_Cycles += 1;
+}
+
+/**
+ * 保存寄存器的值到内存地址
+ * @param value 值
+ * @param reg AXY寄存器
+ */
+void INS_REG_To_MEM(Short address, Byte REG_Value) {
+    CPU.INS_Cycles += 1;
+    CPU_Write_Addr(address, REG_Value);
+}
+
+/**
+ * 二进制加法
+ * A + M + C -> A
+ * Flags: N, V, Z, C
+ * @param value M值
+ */
+void ALU_ADC_Bin(Byte value) {
+    Short sum_value = CPU.A + value + CPU.F_C;
+    //同符号相加结果符号改变->溢出 -128-127
+    CPU.F_V = ((CPU.A ^ sum_value) & (value ^ sum_value) & 0x80) != 0;
+    //无符号数越界->进位 0-256
+    CPU.F_C = sum_value > 0xFF;
+    CPU.A = sum_value & 0xFF;
+    CPU_F_NZ(CPU.A);
+}
+
+#if CPU_HAS_DECIMAL
+/**
+ * 十进制(BCD)加法
+ * NMOS: Z 取二进制结果, N/V 取高位调整前的中间结果
+ * 65C02: N/Z 取最终结果
+ * @param value M值
+ */
+void ALU_ADC_BCD(Byte value) {
+    Byte a = CPU.A;
+    Byte carry = CPU.F_C;
+    int low = (a & 0x0F) + (value & 0x0F) + carry;
+    if(low >= 0x0A) {
+        low = ((low + 0x06) & 0x0F) + 0x10;
+    }
+    int sum = (a & 0xF0) + (value & 0xF0) + low;
+    Byte mid = sum & 0xFF;
+    CPU.F_V = ((a ^ mid) & (value ^ mid) & 0x80) != 0;
+    if(sum >= 0xA0) {
+        sum += 0x60;
+    }
+    CPU.F_C = sum >= 0x100;
+#if CPU_IS_CMOS
+    CPU.A = sum & 0xFF;
+    CPU_F_NZ(CPU.A);
+#else
+    CPU.F_Z = ((a + value + carry) & 0xFF) == 0;
+    CPU.F_N = mid >> 7;
+    CPU.A = sum & 0xFF;
+#endif
+}
+
+/**
+ * 十进制(BCD)减法
+ * C/V 与二进制减法相同, NMOS 的 N/Z 也取二进制结果
+ * @param value M值
+ */
+void ALU_SBC_BCD(Byte value) {
+    Byte a = CPU.A;
+    int low = (a & 0x0F) - (value & 0x0F) + CPU.F_C - 1;
+#if CPU_IS_CMOS
+    int res = a - value + CPU.F_C - 1;
+    if(res < 0) {
+        res -= 0x60;
+    }
+    if(low < 0) {
+        res -= 0x06;
+    }
+    ALU_ADC_Bin(~value);
+    CPU.A = res & 0xFF;
+    CPU_F_NZ(CPU.A);
+#else
+    if(low < 0) {
+        low = ((low - 0x06) & 0x0F) - 0x10;
+    }
+    int res = (a & 0xF0) - (value & 0xF0) + low;
+    if(res < 0) {
+        res -= 0x60;
+    }
+    ALU_ADC_Bin(~value);
+    CPU.A = res & 0xFF;
+#endif
+}
+#endif
+
+/**
+ * 加法(按 D 标志选择二进制/十进制), 不计周期
+ * @param value M值
+ */
+void ALU_ADC(Byte value) {
+#if CPU_HAS_DECIMAL
+    if(CPU.F_D) {
+        ALU_ADC_BCD(value);
+        return;
+    }
+#endif
+    ALU_ADC_Bin(value);
+}
+
+/**
+ * 减法(按 D 标志选择二进制/十进制), 不计周期
+ * A - M - ~C -> A
+ * @param value M值
+ */
+void ALU_SBC(Byte value) {
+#if CPU_HAS_DECIMAL
+    if(CPU.F_D) {
+        ALU_SBC_BCD(value);
+        return;
+    }
+#endif
+    ALU_ADC_Bin(~value);
+}
+
+/**
+ * 相加保存寄存器A
+ * A + M + C -> A
+ * Flags: N, V, Z, C
+ * @param value M值
+ */
+void INS_ADC(Byte value) {
+    CPU.INS_Cycles += 1;
+#if CPU_IS_CMOS
+    //65C02 十进制模式多一个周期
+    CPU.INS_Cycles += CPU.F_D;
+#endif
+    ALU_ADC(value);
+}
+
+/**
+ * 相减保存寄存器A
+ * A - M - ~C -> A
+ * Flags: N, V, Z, C
+ * @param value M值
+ */
+void INS_SBC(Byte value) {
+    CPU.INS_Cycles += 1;
+#if CPU_IS_CMOS
+    CPU.INS_Cycles += CPU.F_D;
+#endif
+    ALU_SBC(value);
+}
+
+/**
+ * 内存值加减
+ * M + 1 -> M
+ * Flags: N, Z
+ * @param value M值
+ * @param value2 1/-1
+ */
+void INS_INC_DEC(Short address,byte value) {
+    CPU.INS_Cycles += 2;
+    Byte data = CPU_Read_Addr(address);
+    data = data + value;
+    CPU_Write_Addr(address, data);
+    CPU_F_NZ(data);
+}
+
+/**
+ * 内存值加减
+ * M + 1 -> M
+ * Flags: N, Z
+ * @param value M值
+ * @param value2 1/-1
+ */
+void INS_INC_DEC_XY(Byte *REG,byte value) {
+    CPU.INS_Cycles += 2;
+    *REG = *REG + value;
+    CPU_F_NZ(*REG);
+}
+
+/**
+ * 算术左移一位
+ * Flags: N, Z, C
+ * @param value 值
+ */
+Byte INS_ASL(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.F_C = value>>7;
+    value<<=1;
+    CPU_F_NZ(value);
+    return value;
+}
+
+/**
+ * 逻辑右移一位
+ * Flags: N, Z, C
+ * @param value 值
+ */
+Byte INS_LSR(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.F_C = value & 1;
+    value>>=1;
+    CPU_F_NZ(value);
+    return value;
+}
+
+
+/**
+ * 循环左移一位
+ * Flags: N, Z, C
+ * @param value 值
+ */
+Byte INS_ROL(Byte value) {
+    CPU.INS_Cycles += 1;
+    //经过进位循环: C <- 7..0 <- C
+    Byte carry = CPU.F_C;
+    CPU.F_C = (value>>7) & 0x1;
+    value = (value<<1) | carry;
+    CPU_F_NZ(value);
+    return value;
+}
+
+/**
+ * 循环右移一位
+ * Flags: N, Z, C
+ * @param value 值
+ */
+Byte INS_ROR(Byte value) {
+    CPU.INS_Cycles += 1;
+    //经过进位循环: C -> 7..0 -> C
+    Byte carry = CPU.F_C;
+    CPU.F_C = value & 0x1;
+    value = (value>>1) | (carry<<7);
+    CPU_F_NZ(value);
+    return value;
+}
+
+/**
+ * 与
+ * A & M -> A
+ * Flags: N, Z
+ * @param value 值
+ */
+void INS_AND(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.A&=value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ * 或
+ * A | M -> A
+ * Flags: N, Z
+ * @param value 值
+ */
+void INS_ORA(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.A|=value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ * 异或
+ * A ^ M -> A
+ * Flags: N, Z
+ * @param value 值
+ */
+void INS_EOR(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.A^=value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ *  N = M7, V = M6, Z = A & M
+ * @param input
+ */
+void INS_BIT(Byte input) {
+    CPU.INS_Cycles += 1;
+    CPU.F_Z = (CPU.A & input) == 0;
+    CPU.F_V = (input>>6)&1;
+    CPU.F_N = input >> 7;
+}
+
+/**
+ * 65C02 BIT #, 只影响 Z
+ * @param input
+ */
+void INS_BIT_IMM(Byte input) {
+    CPU.INS_Cycles += 1;
+    CPU.F_Z = (CPU.A & input) == 0;
+}
+
+/**
+ *  Branch on Carry Clear
+ *  Branch if C = 0
+ * @param input
+ */
+void INS_Branch(byte input,Byte condition) {
+    CPU.INS_Cycles += 1;
+    if(CPU.Coverage) {
+        CPU_Cover_Edge(CPU.PC, condition ? CPU.PC + input : CPU.PC);
+    }
+    if(condition) {
+        //目标先截成 16 位, 向回跳过 $0000 时也算跨页
+        CPU.INS_Cycles += (((Short) (CPU.PC + input) ^ CPU.PC) & 0xFF00) ? 2 : 1;
+        CPU.PC += input;
+    }
+}
+
+/**
+ * 寄存器间值转移
+ * @param source 源寄存器
+ * @param target 目标寄存器
+ * @param set_flag 是否要设置状态寄存器
+ */
+void INS_Transfer(Byte source,Byte *target,Byte set_flag) {
+    CPU.INS_Cycles += 2;
+    *target = source;
+    if(set_flag) {
+        CPU_F_NZ(*target);
+    }
+}
+
+/**
+ * 寄存器间值转移
+ * @param source 源寄存器
+ * @param target 目标寄存器
+ * @param set_flag 是否要设置状态寄存器
+ */
+void INS_SET_CLEAR(Byte *FLAG,Byte value) {
+    CPU.INS_Cycles += 2;
+    *FLAG = value;
+}
+
+/**
+ * 将寄存器推送到栈中
+ * REG -> S
+ * Flags: none
+ */
+void INS_PH_REG(Byte REG_Value) {
+    CPU.INS_Cycles +=2;
+    CPU_Stack_Push_Byte(REG_Value);
+}
+
+/**
+ * 从栈中拉取一个字节到寄存器
+ * S -> REG
+ * Flags: N, Z
+ */
+void INS_PL_REG(Byte *REG) {
+    CPU.INS_Cycles +=3;
+    *REG = CPU_Stack_Pull_Byte();
+    CPU_F_NZ(*REG);
+}
+
+/**
+ * 将寄存器A推送到栈中
+ * A -> S
+ * Flags: none
+ */
+void INS_PHA() {
+    INS_PH_REG(CPU.A);
+}
+
+/**
+ * 从栈中拉取一个字节到寄存器A
+ * A -> S
+ * Flags: N, Z
+ */
+void INS_PLA() {
+    INS_PL_REG(&CPU.A);
+}
+
+/**
+ * 将状态寄存器放入栈
+ * P -> S
+ * Flags: none
+ */
+void INS_PHP() {
+    CPU.INS_Cycles +=2;
+    Push_Flag(1);
+}
+
+/**
+ * 将栈数据放入状态寄存器
+ * S -> P
+ * Flags: ALL
+ */
+void INS_PLP() {
+    CPU.INS_Cycles +=2;
+    Pull_Flag();
+}
+
+/**
+ * 跳转到地址
+ * Flags: none
+ */
+void INS_JMP(Short address) {
+    CPU.INS_Cycles ++;
+    if(CPU.Coverage) {
+        CPU_Cover_Edge(CPU.PC, address);
+    }
+    CPU.PC = address;
+}
+
+/**
+ * 跳转到地址
+ * Jump to New Location Saving Return Address
+ * Flags: none
+ */
+void INS_JSR(Short address) {
+    CPU.INS_Cycles +=2;
+    CPU_Stack_Push_Short(CPU.PC-1);
+    if(CPU.Coverage) {
+        CPU_Cover_Edge(CPU.PC, address);
+    }
+    CPU.PC = address;
+}
+
+/**
+ * 返回到保存的地址
+ * Return from Subroutine
+ * Flags: none
+ */
+void INS_RTS() {
+    CPU.INS_Cycles +=3;
+    INS_JMP(CPU_Stack_Pull_Short() + 1);
+}
+/**
+ * 从异常返回
+ * ReTurn from Interrupt
+ * Flags: none
+ */
+void INS_RTI() {
+    CPU.INS_Cycles +=2;
+    Pull_Flag();
+    CPU.PC = CPU_Stack_Pull_Short();
+}
+
+/**
+ * break 异常
+ */
+void INS_BRK() {
+    CPU.Atomic = 1;
+    CPU.INS_Cycles += 2;
+    CPU_Stack_Push_Short(CPU.PC + 1);
+    CPU.F_B = 1;
+    Push_Flag(1);
+    CPU.PC = concat_byte(CPU_Read_Addr(0xFFFE),CPU_Read_Addr(0xFFFF));
+    CPU.F_I = 1;
+#if CPU_IS_CMOS
+    CPU.F_D = 0;
+#endif
+    CPU.Atomic = 0;
+}
+
+/**
+ * JAM/STP: 锁死在当前指令
+ */
+void INS_Halt(Byte state) {
+    CPU.INS_Cycles++;
+    CPU.PC--;
+    CPU.Halted = state;
+    //让 CPU_Run 退出指令循环
+    CPU.Run_Limit = 0;
+}
+
+/**
+ * 带内存读取的 NOP
+ * @param address
+ */
+void INS_NOP_Read(Short address) {
+    CPU_Read_Addr(address);
+    CPU.INS_Cycles++;
+}
+
+#if CPU_IS_CMOS
+//-------------65C02 扩展指令-----------------
+
+/**
+ * 测试并置位
+ * M | A -> M, Z = A & M
+ * @param address
+ */
+void INS_TSB(Short address) {
+    Byte value = CPU_Read_Modify(address);
+    CPU.INS_Cycles++;
+    CPU.F_Z = (CPU.A & value) == 0;
+    CPU_Write_Addr(address, value | CPU.A);
+}
+
+/**
+ * 测试并清位
+ * M & ~A -> M, Z = A & M
+ * @param address
+ */
+void INS_TRB(Short address) {
+    Byte value = CPU_Read_Modify(address);
+    CPU.INS_Cycles++;
+    CPU.F_Z = (CPU.A & value) == 0;
+    CPU_Write_Addr(address, value & ~CPU.A);
+}
+
+/**
+ * 零页位清除/置位 RMB/SMB
+ * @param bit 位
+ * @param set 1置位 0清除
+ */
+void INS_RMB_SMB(Byte bit, Byte set) {
+    Short address = AM_ZP();
+    Byte value = CPU_Read_Modify(address);
+    CPU.INS_Cycles++;
+    value = set ? value | (1 << bit) : value & ~(1 << bit);
+    CPU_Write_Addr(address, value);
+}
+
+/**
+ * 零页位测试分支 BBR/BBS
+ * @param bit 位
+ * @param set 1:位为1时跳转 0:位为0时跳转
+ */
+void INS_BBR_BBS(Byte bit, Byte set) {
+    Byte value = CPU_Read_Addr(AM_ZP());
+    byte offset = AM_IMM();
+    CPU.INS_Cycles++;
+    INS_Branch(offset, ((value >> bit) & 1) == set);
+}
+
+#else
+//-------------NMOS 未公开指令 (Undocumented)-----------------
+
+/**
+ * LAX: M -> A -> X
+ * Flags: N, Z
+ */
+void INS_LAX(Byte value) {
+    INS_Set_REG(value, &CPU.A);
+    CPU.X = CPU.A;
+}
+
+/**
+ * SLO: ASL M, A | M -> A
+ * Flags: N, Z, C
+ */
+void INS_SLO(Short address) {
+    Byte value = INS_ASL(CPU_Read_Modify(address));
+    CPU_Write_Addr(address, value);
+    CPU.A |= value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ * RLA: ROL M, A & M -> A
+ * Flags: N, Z, C
+ */
+void INS_RLA(Short address) {
+    Byte value = INS_ROL(CPU_Read_Modify(address));
+    CPU_Write_Addr(address, value);
+    CPU.A &= value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ * SRE: LSR M, A ^ M -> A
+ * Flags: N, Z, C
+ */
+void INS_SRE(Short address) {
+    Byte value = INS_LSR(CPU_Read_Modify(address));
+    CPU_Write_Addr(address, value);
+    CPU.A ^= value;
+    CPU_F_NZ(CPU.A);
+}
+
+/**
+ * RRA: ROR M, A + M + C -> A
+ * Flags: N, V, Z, C
+ */
+void INS_RRA(Short address) {
+    Byte value = INS_ROR(CPU_Read_Modify(address));
+    CPU_Write_Addr(address, value);
+    ALU_ADC(value);
+}
+
+/**
+ * DCP: M - 1 -> M, CMP
+ * Flags: N, Z, C
+ */
+void INS_DCP(Short address) {
+    Byte value = CPU_Read_Modify(address) - 1;
+    CPU_Write_Addr(address, value);
+    CPU_F_Compare(CPU.A, value);
+}
+
+/**
+ * ISC: M + 1 -> M, SBC
+ * Flags: N, V, Z, C
+ */
+void INS_ISC(Short address) {
+    Byte value = CPU_Read_Modify(address) + 1;
+    CPU_Write_Addr(address, value);
+    INS_SBC(value);
+}
+
+/**
+ * ARR: A & M, ROR A
+ * C = bit6, V = bit6 ^ bit5
+ */
+void INS_ARR(Byte value) {
+    CPU.INS_Cycles += 1;
+    CPU.A = ((CPU.A & value) >> 1) | (CPU.F_C << 7);
+    CPU_F_NZ(CPU.A);
+    CPU.F_C = (CPU.A >> 6) & 1;
+    CPU.F_V = CPU.F_C ^ ((CPU.A >> 5) & 1);
+}
+
+/**
+ * SBX: (A & X) - M -> X
+ * Flags: N, Z, C
+ */
+void INS_SBX(Byte value) {
+    Byte ax = CPU.A & CPU.X;
+    CPU_F_Compare(ax, value);
+    CPU.X = ax - value;
+}
+
+/**
+ * SHA/SHX/SHY/TAS: 写入 REG & (基址高字节 + 1)
+ * 跨页时地址高字节也被替换为写入值
+ * @param address 已加上索引的地址
+ * @param index 索引寄存器
+ * @param REG_Value
+ */
+void INS_SH(Short address, Byte index, Byte REG_Value) {
+    Byte high = (Byte)((Short)(address - index) >> 8);
+    Byte value = REG_Value & (high + 1);
+    if(high != address >> 8) {
+        address = concat_byte(address & 0xFF, value);
+    }
+    INS_REG_To_MEM(address, value);
+}
+#endif
+
+//-------------指令结束-----------------
+
+//-------------中断-----------------
+
+/**
+ * 响应中断: 压入 PC 和状态(B=0), 跳到向量
+ * 7 个周期
+ * @param nmi 1:NMI($FFFA) 0:IRQ($FFFE)
+ */
+void CPU_Interrupt(Byte nmi) {
+    if (CPU.Recorder) {
+        Replay_Log_Interrupt(CPU.Recorder, nmi ? REPLAY_NMI : REPLAY_IRQ, CPU.Cycles);
+    }
+    METRICS_COUNT(CPU_Current, METRIC_INTERRUPTS, 1);
+    CPU.Atomic = 1;
+    CPU.INS_Cycles = 2;
+    CPU_Stack_Push_Short(CPU.PC);
+    Push_Flag(0);
+    CPU.F_I = 1;
+#if CPU_IS_CMOS
+    CPU.F_D = 0;
+#endif
+    Short vector = nmi ? 0xFFFA : 0xFFFE;
+    CPU.PC = concat_byte(CPU_Read_Addr(vector), CPU_Read_Addr(vector + 1));
+    CPU.Cycles += CPU.INS_Cycles;
+    CPU.Atomic = 0;
+}
+
+/**
+ * 唤醒 WAI 状态的 CPU, 从 WAI 的下一条指令继续
+ * @param cpu
+ */
+static void CPU_Wake(struct CPU_Context *cpu) {
+    if (cpu->Halted == CPU_WAIT) {
+        if (cpu->Recorder) {
+            Replay_Log_Interrupt(cpu->Recorder, REPLAY_WAKE, cpu->Cycles);
+        }
+        cpu->Halted = CPU_RUN;
+        cpu->PC++;
+    }
+}
+
+/**
+ * 设置 IRQ 电平
+ * 需要在执行该 CPU 的线程里调用(设备回调或两次 CPU_Run 之间)
+ * @param cpu
+ * @param source 中断源位
+ * @param level 1:有效 0:撤销
+ */
+void CPU_Set_IRQ(struct CPU_Context *cpu, Byte source, Byte level) {
+    if (level) {
+        cpu->IRQ_Line |= source;
+        CPU_Wake(cpu);
+    } else {
+        cpu->IRQ_Line &= ~source;
+    }
+}
+
+/**
+ * 触发 NMI(边沿)
+ * @param cpu
+ */
+void CPU_NMI(struct CPU_Context *cpu) {
+    cpu->NMI_Pending = 1;
+    CPU_Wake(cpu);
+}
+
+/**
+ * 设置下一个事件的周期, 正在执行的 CPU_Run 会在该周期所在的指令边界停下
+ * @param cpu
+ * @param cycle
+ */
+void CPU_Schedule(struct CPU_Context *cpu, unsigned long long cycle) {
+    cpu->Event_Cycle = cycle;
+    if (cycle < cpu->Run_Limit) {
+        cpu->Run_Limit = cycle;
+    }
+}
+
+//-------------定时器-----------------
+
+/**
+ * 定时器使用事件槽时的 On_Event: 依次触发到期的定时器, 再把事件槽设为下一个
+ */
+static void CPU_Timer_Event(struct CPU_Context *cpu) {
+    while (cpu->Timers && cpu->Timers->Cycle <= cpu->Cycles) {
+        struct CPU_Timer *timer = cpu->Timers;
+        cpu->Timers = timer->Next;
+        timer->Armed = 0;
+        timer->Fire(timer, cpu);
+    }
+    cpu->Event_Cycle = CPU_NO_EVENT;
+    if (cpu->Timers) {
+        CPU_Schedule(cpu, cpu->Timers->Cycle);
+    }
+}
+
+/**
+ * 启动定时器, 在 cycle 所在的指令边界触发; 已经启动的定时器改到新的周期
+ * 定时器接管事件槽(On_Event), 设备和回放都通过定时器使用它
+ * @param cpu
+ * @param timer Fire 已经设置
+ * @param cycle 绝对周期, 不晚于当前周期时在下一个指令边界触发
+ */
+void CPU_Timer_Start(struct CPU_Context *cpu, struct CPU_Timer *timer, unsigned long long cycle) {
+    if (timer->Armed) {
+        CPU_Timer_Stop(cpu, timer);
+    }
+    struct CPU_Timer **link = &cpu->Timers;
+    while (*link && (*link)->Cycle <= cycle) {
+        link = &(*link)->Next;
+    }
+    timer->Cycle = cycle;
+    timer->Next = *link;
+    timer->Armed = 1;
+    *link = timer;
+    cpu->On_Event = CPU_Timer_Event;
+    if (cpu->Timers == timer) {
+        CPU_Schedule(cpu, cycle);
+    }
+}
+
+/**
+ * 停止定时器, 没有启动时什么都不做
+ * @param cpu
+ * @param timer
+ */
+void CPU_Timer_Stop(struct CPU_Context *cpu, struct CPU_Timer *timer) {
+    if (!timer->Armed) {
+        return;
+    }
+    struct CPU_Timer **link = &cpu->Timers;
+    while (*link != timer) {
+        link = &(*link)->Next;
+    }
+    *link = timer->Next;
+    timer->Armed = 0;
+    //事件槽可能还指向它, 提前醒来时 CPU_Timer_Event 什么都不触发
+    if (!cpu->Timers) {
+        cpu->Event_Cycle = CPU_NO_EVENT;
+    }
+}
+
+/**
+ * 把周期计数改成 cycles (恢复检查点、开始回放), 启动中的定时器跟着移动, 离触发的周期数不变
+ * @param cpu
+ * @param cycles
+ */
+void CPU_Set_Cycles(struct CPU_Context *cpu, unsigned long long cycles) {
+    for (struct CPU_Timer *timer = cpu->Timers; timer; timer = timer->Next) {
+        timer->Cycle = cycles + (timer->Cycle > cpu->Cycles ? timer->Cycle - cpu->Cycles : 0);
+    }
+    cpu->Cycles = cycles;
+    if (cpu->Timers) {
+        CPU_Schedule(cpu, cpu->Timers->Cycle);
+    }
+}
+
+//-------------空转循环快进-----------------
+// 识别没有副作用的等待循环, 把周期直接推进到 Run_Limit (下一个事件或 CPU_Run 的终点)
+// 每跳过一轮循环后的状态都和逐条执行相同, 中断只会在事件里产生, 所以不会错过
+//  JMP * / BRA * / Bxx *   条件不变, 永远跳转
+//  DEX/DEY + BNE *         倒数计数, 跳到只剩最后一轮
+//  LDA zp/abs + Bxx *      轮询内存(不能是 I/O 页), 值不变时永远跳转;
+//                          总线被 Bus_Run_Parallel 的多个线程共用时不快进, 别的 CPU 随时可能写入
+
+#if CPU_IDLE_SKIP
+/**
+ * 跳转回 head 后, 检查 [head, branch] 是否是空转循环, 是则跳过尽可能多的整轮
+ * @param branch 循环末尾跳转指令的地址
+ * @param cost 跳转指令的周期
+ */
+static void Idle_Skip(Short branch, Byte cost) {
+    Short head = CPU.PC;
+    struct Bus *bus = CPU.Bus;
+    unsigned long long now = CPU.Cycles + CPU.INS_Cycles;
+    //覆盖率需要每一轮的计数
+    if (now >= CPU.Run_Limit || CPU.Coverage || CPU.NMI_Pending || (CPU.IRQ_Line && !CPU.F_I)
+        || !bus->Read_Page[head >> 8] || !bus->Read_Page[(Short) (branch + 2) >> 8]) {
+        return;
+    }
+    unsigned long long room = CPU.Run_Limit - now;
+    Byte opcode = Bus_Peek(bus, head);
+    unsigned long long count;
+    if (head == branch) {
+        count = room / cost;
+        METRICS_COUNT(CPU_Current, METRIC_INSTRUCTIONS, count);
+    } else if ((opcode == 0xCA || opcode == 0x88) && (Short) (head + 1) == branch && Bus_Peek(bus, branch) == 0xD0) {
+        //每轮 DEX 2 周期, 最后一轮不跳转, 留给正常执行
+        Byte *REG = opcode == 0xCA ? &CPU.X : &CPU.Y;
+        count = room / (cost + 2);
+        if (count > (Byte) (*REG - 1)) {
+            count = (Byte) (*REG - 1);
+        }
+        if (!count) {
+            return;
+        }
+        *REG -= count;
+        CPU_F_NZ(*REG);
+        CPU.Cycles += count * (cost + 2);
+        METRICS_COUNT(CPU_Current, METRIC_INSTRUCTIONS, count * 2);
+        METRICS_COUNT(CPU_Current, METRIC_IDLE_CYCLES, count * (cost + 2));
+        return;
+    } else {
+        Short addr;
+        Byte load;
+        if (bus->Threads > 1) {
+            return;
+        }
+        if (opcode == 0xA5 && (Short) (head + 2) == branch) {
+            addr = Bus_Peek(bus, (Short) (head + 1));
+            load = 3;
+        } else if (opcode == 0xAD && (Short) (head + 3) == branch) {
+            addr = Bus_Peek(bus, (Short) (head + 1)) | Bus_Peek(bus, (Short) (head + 2)) << 8;
+            load = 4;
+        } else {
+            return;
+        }
+        //A 和标志已经是读这个值之后的结果, 再读一次状态不变, 跳转条件也不变
+        Byte value = Bus_Peek(bus, addr);
+        if (!bus->Read_Page[addr >> 8] || CPU.A != value || CPU.F_Z != (value == 0) || CPU.F_N != value >> 7) {
+            return;
+        }
+        cost += load;
+        count = room / cost;
+        METRICS_COUNT(CPU_Current, METRIC_INSTRUCTIONS, count * 2);
+    }
+    CPU.Cycles += count * cost;
+    METRICS_COUNT(CPU_Current, METRIC_IDLE_CYCLES, count * cost);
+}
+#endif
+
+/**
+ * 条件跳转, 向回跳转时检查空转循环
+ * @param input 偏移
+ * @param condition 是否跳转
+ */
+static void INS_Branch_Idle(byte input, Byte condition) {
+    INS_Branch(input, condition);
+#if CPU_IDLE_SKIP
+    if (condition && input < 0) {
+        Short branch = CPU.PC - input - 2;
+        Idle_Skip(branch, ((CPU.PC ^ (Short) (branch + 2)) >> 8) ? 4 : 3);
+    }
+#endif
+}
+
+//-------------指令融合-----------------
+// 一次分派执行一组常见指令, 寄存器、标志、内存和周期与逐条执行完全相同
+// 只在 CPU_Run 里生效(需要 Run_Limit), 单独调用 CPU_Exec 时 Run_Limit 为 0 不会融合
+
+//融合执行了一组指令, 分派只计了第一条
+#define FUSE_COUNT(extra) do { \
+        METRICS_COUNT(CPU_Current, METRIC_FUSED, 1); \
+        METRICS_COUNT(CPU_Current, METRIC_INSTRUCTIONS, extra); \
+    } while (0)
+
+#if CPU_FUSE
+/**
+ * 读取指令字节, 不计周期
+ */
+static Byte Fuse_Peek(Short addr) {
+    const Byte *page = CPU.Bus->Read_Page[addr >> 8];
+    return page ? page[addr & 0xFF] : Bus_Peek(CPU.Bus, addr);
+}
+
+/**
+ * 融合的前提: 后面的指令字节都在页表里的页上(不是 I/O, 没有观察点),
+ * 并且执行到最后一条指令之前还没有到 Run_Limit (逐条执行时 CPU_Run 也会继续)
+ * @param span 当前 PC 之后的指令字节数
+ * @param cycles 最后一条指令之前的周期数
+ */
+static int Fuse_Ready(Byte span, Byte cycles) {
+    return CPU.Cycles + cycles < CPU.Run_Limit
+           && CPU.Bus->Read_Page[CPU.PC >> 8]
+           && CPU.Bus->Read_Page[(Short) (CPU.PC + span) >> 8];
+}
+#endif
+
+#if CPU_FUSE & FUSE_LDA_ADC_STA
+/**
+ * LDA zp / CLC / ADC # / STA zp
+ * LDA 的 N/Z 会被 ADC 覆盖, 不需要计算
+ * @return 0 不匹配, 按普通 LDA zp 执行
+ */
+static int Fuse_LDA_ADC_STA() {
+    //A5 zz 18 69 ii 85 yy, 零页必须在页表里(不是 I/O), 并且没有观察点, 否则读写之间要能停下
+    if (Fuse_Peek(CPU.PC + 1) != 0x18 || Fuse_Peek(CPU.PC + 2) != 0x69 || Fuse_Peek(CPU.PC + 4) != 0x85
+        || !CPU.Bus->Read_Page[0] || CPU.Bus->Armed[0] || !Fuse_Ready(5, 7)) {
+        return 0;
+    }
+    Byte src = Fuse_Peek(CPU.PC);
+    Byte imm = Fuse_Peek(CPU.PC + 3);
+    Byte dst = Fuse_Peek(CPU.PC + 5);
+    CPU.PC += 6;
+    //LDA zp 3 + CLC 2 + ADC # 2 + STA zp 3, 读写各 1 个已由 CPU_Read_Addr/CPU_Write_Addr 计入
+    CPU.INS_Cycles += 7;
+    CPU.A = CPU_Read_Addr(src);
+    CPU.F_C = 0;
+    INS_ADC(imm);
+    CPU_Write_Addr(dst, CPU.A);
+    FUSE_COUNT(3);
+    return 1;
+}
+#endif
+
+#if CPU_FUSE & FUSE_INY_CPY_BNE
+/**
+ * INY + CPY # + BNE (或 INX + CPX # + BNE)
+ * INY 的 N/Z 会被 CPY 覆盖, 不需要计算
+ * @param REG X/Y
+ * @param compare CPY #/CPX # 的操作码
+ */
+static void Fuse_INC_CMP_BNE(Byte *REG, Byte compare) {
+    if (Fuse_Peek(CPU.PC) != compare || Fuse_Peek(CPU.PC + 2) != 0xD0 || !Fuse_Ready(3, 4)) {
+        INS_INC_DEC_XY(REG, 1);
+        return;
+    }
+    CPU.INS_Cycles += 2;
+    (*REG)++;
+    CPU.PC++;
+    CPU_F_Compare(*REG, AM_IMM());
+    CPU.PC++;
+    INS_Branch(AM_IMM(), CPU.F_Z == 0);
+    FUSE_COUNT(2);
+}
+#endif
+
+void CPU_Exec() {
+    //指令边界响应中断, 重新执行挂起的指令时不响应
+    if (CPU.NMI_Pending && !CPU.Retry) {
+        CPU.NMI_Pending = 0;
+        CPU_Interrupt(1);
+        CPU.Empty_Dispatch++;
+        return;
+    }
+    if (CPU.IRQ_Line && !CPU.F_I && !CPU.Retry) {
+        CPU_Interrupt(0);
+        CPU.Empty_Dispatch++;
+        return;
+    }
+    if (!CPU.Bus->Read_Page[CPU.PC >> 8] && (CPU.Bus->Armed[CPU.PC >> 8] & BUS_ARM_EXEC)
+        && !CPU.Retry && Watch_Exec(CPU.Bus->Watch, CPU.PC)) {
+        CPU.Empty_Dispatch++;
+        return;
+    }
+    CPU.Start_PC = CPU.PC;
+    CPU.Start_SP = CPU.SP;
+    Byte opcode = CPU_Get_Byte();
+    CPU.INS_Cycles = 0;
+    Short addr;
+    switch (opcode) {
+        // ------------Load(加载到寄存器)------------
+            //LDA #
+        case 0xA9:
+            INS_Set_REG(AM_IMM(), &CPU.A);
+            break;
+            //LDA a
+        case 0xAD:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.A);
+            break;
+            //LDA a,x
+        case 0xBD:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.X)), &CPU.A);
+            break;
+            //LDA a,y
+        case 0xB9:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.Y)), &CPU.A);
+            break;
+            //LDA zp
+        case 0xA5:
+#if CPU_FUSE & FUSE_LDA_ADC_STA
+            if (Fuse_LDA_ADC_STA()) {
+                break;
+            }
+#endif
+            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.A);
+            break;
+            //LDA zp,x
+        case 0xB5:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.X)), &CPU.A);
+            break;
+            //LDA (Indirect,X)
+        case 0xA1:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_IND_X()), &CPU.A);
+            break;
+            //LDA (Indirect),Y
+        case 0xB1:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_IND_Y()), &CPU.A);
+            break;
+
+            //LDX #
+        case 0xA2:
+            INS_Set_REG(AM_IMM(), &CPU.X);
+            break;
+            //LDX a
+        case 0xAE:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.X);
+            break;
+            //LDX a,y
+        case 0xBE:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.Y)), &CPU.X);
+            break;
+            //LDX zp
+        case 0xA6:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.X);
+            break;
+            //LDX zp,y
+        case 0xB6:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.Y)), &CPU.X);
+            break;
+
+            //LDY #
+        case 0xA0:
+            INS_Set_REG(AM_IMM(), &CPU.Y);
+            break;
+            //LDY a
+        case 0xAC:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.Y);
+            break;
+            //LDY a,x
+        case 0xBC:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.X)), &CPU.Y);
+            break;
+            //LDY zp
+        case 0xA4:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.Y);
+            break;
+            //LDY zp,x
+        case 0xB4:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.X)), &CPU.Y);
+            break;
+        // ------------Store(寄存器存储到内存)------------
+            //STA a
+        case 0x8D:
+            INS_REG_To_MEM(AM_Abs(), CPU.A);
+            break;
+            //STA a,x
+        case 0x9D:
+            INS_REG_To_MEM(AM_Abs_XY_W(CPU.X), CPU.A);
+            break;
+            //STA a,y
+        case 0x99:
+            INS_REG_To_MEM(AM_Abs_XY_W(CPU.Y), CPU.A);
+            break;
+            //STA zp
+        case 0x85:
+            INS_REG_To_MEM(AM_ZP(), CPU.A);
+            break;
+            //STA zp,x
+        case 0x95:
+            INS_REG_To_MEM(AM_ZP_XY(CPU.X), CPU.A);
+            break;
+            //STA (zp,x)
+        case 0x81:
+            INS_REG_To_MEM(AM_ZP_IND_X(), CPU.A);
+            break;
+            //STA (zp),y
+        case 0x91:
+            INS_REG_To_MEM(AM_ZP_IND_Y_W(), CPU.A);
+            break;
+
+            //STX a
+        case 0x8E:
+            INS_REG_To_MEM(AM_Abs(), CPU.X);
+            break;
+            //STX zp
+        case 0x86:
+            INS_REG_To_MEM(AM_ZP(), CPU.X);
+            break;
+            //STX zp,y
+        case 0x96:
+            INS_REG_To_MEM(AM_ZP_XY(CPU.Y), CPU.X);
+            break;
+
+            //STY a
+        case 0x8C:
+            INS_REG_To_MEM(AM_Abs(), CPU.Y);
+            break;
+            //STY zp
+        case 0x84:
+            INS_REG_To_MEM(AM_ZP(), CPU.Y);
+            break;
+            //STY zp,x
+        case 0x94:
+            INS_REG_To_MEM(AM_ZP_XY(CPU.X), CPU.Y);
+            break;
+        // ------------Arithmetic(算数)------------
+            //ADC #   (Add Memory to Accumulator with Carry)
+        case 0x69:
+            INS_ADC(AM_IMM());
+            break;
+            //ADC a
+        case 0x6D:
+            INS_ADC(CPU_Read_Addr(AM_Abs()));
+            break;
+            //ADC a,x
+        case 0x7D:
+            INS_ADC(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //ADC a,y
+        case 0x79:
+            INS_ADC(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //ADC zp
+        case 0x65:
+            INS_ADC(CPU_Read_Addr(AM_ZP()));
+            break;
+            //ADC zp,x
+        case 0x75:
+            INS_ADC(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //ADC (Indirect,X)
+        case 0x61:
+            INS_ADC(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //ADC (Indirect),Y
+        case 0x71:
+            INS_ADC(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+            //SBC #   (Subtract Memory from Accumulator with Borrow)
+        case 0xE9:
+            INS_SBC(AM_IMM());
+            break;
+            //SBC a
+        case 0xED:
+            INS_SBC(CPU_Read_Addr(AM_Abs()));
+            break;
+            //SBC a,x
+        case 0xFD:
+            INS_SBC(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //SBC a,y
+        case 0xF9:
+            INS_SBC(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //SBC zp
+        case 0xE5:
+            INS_SBC(CPU_Read_Addr(AM_ZP()));
+            break;
+            //SBC zp,x
+        case 0xF5:
+            INS_SBC(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //SBC (Indirect,X)
+        case 0xE1:
+            INS_SBC(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //SBC (Indirect),Y
+        case 0xF1:
+            INS_SBC(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+        // ------------Increment and Decrement(加减)------------
+            //INC a
+        case 0xEE:
+            INS_INC_DEC(AM_Abs(),1);
+            break;
+            //INC a,x
+        case 0xFE:
+            INS_INC_DEC(AM_Abs_XY_W(CPU.X),1);
+            break;
+            //INC zp
+        case 0xE6:
+            INS_INC_DEC(AM_ZP(),1);
+            break;
+            //INC zp,x
+        case 0xF6:
+            INS_INC_DEC(AM_ZP_XY(CPU.X),1);
+            break;
+            //INX #
+        case 0xE8:
+#if CPU_FUSE & FUSE_INY_CPY_BNE
+            Fuse_INC_CMP_BNE(&CPU.X, 0xE0);
+#else
+            INS_INC_DEC_XY(&CPU.X,1);
+#endif
+            break;
+            //INY #
+        case 0xC8:
+#if CPU_FUSE & FUSE_INY_CPY_BNE
+            Fuse_INC_CMP_BNE(&CPU.Y, 0xC0);
+#else
+            INS_INC_DEC_XY(&CPU.Y,1);
+#endif
+            break;
+
+            //DEC a
+        case 0xCE:
+            INS_INC_DEC(AM_Abs(),-1);
+            break;
+            //DEC a,x
+        case 0xDE:
+            INS_INC_DEC(AM_Abs_XY_W(CPU.X),-1);
+            break;
+            //DEC zp
+        case 0xC6:
+            INS_INC_DEC(AM_ZP(),-1);
+            break;
+            //DEC zp,x
+        case 0xD6:
+            INS_INC_DEC(AM_ZP_XY(CPU.X),-1);
+            break;
+            //DEX #
+        case 0xCA:
+            INS_INC_DEC_XY(&CPU.X,-1);
+            break;
+            //DEY #
+        case 0x88:
+            INS_INC_DEC_XY(&CPU.Y,-1);
+            break;
+
+        // ------------Shift and Rotate(位运算与位翻转)------------
+            //ASL a
+        case 0x0E:
+            addr = AM_Abs();
+            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Modify(addr)));
+            break;
+            //ASL a,x
+        case 0x1E:
+            addr = AM_Abs_X_Shift();
+            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Modify(addr)));
+            break;
+            //ASL A
+        case 0x0A:
+            CPU.A = INS_ASL(CPU.A);
+            CPU.INS_Cycles += 1;
+            break;
+            //ASL zp
+        case 0x06:
+            addr = AM_ZP();
+            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Modify(addr)));
+            break;
+            //ASL zp,x
+        case 0x16:
+            addr = AM_ZP_XY(CPU.X);
+            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Modify(addr)));
+            break;
+
+            //LSR a
+        case 0x4E:
+            addr = AM_Abs();
+            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Modify(addr)));
+            break;
+            //LSR a,x
+        case 0x5E:
+            addr = AM_Abs_X_Shift();
+            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Modify(addr)));
+            break;
+            //LSR A 寄存器
+        case 0x4A:
+            CPU.A = INS_LSR(CPU.A);
+            CPU.INS_Cycles += 1;
+            break;
+            //LSR zp
+        case 0x46:
+            addr = AM_ZP();
+            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Modify(addr)));
+            break;
+            //LSR zp,x
+        case 0x56:
+            addr = AM_ZP_XY(CPU.X);
+            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Modify(addr)));
+            break;
+
+            //ROL a
+        case 0x2E:
+            addr = AM_Abs();
+            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Modify(addr)));
+            break;
+            //ROL a,x
+        case 0x3E:
+            addr = AM_Abs_X_Shift();
+            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Modify(addr)));
+            break;
+            //ROL A 寄存器
+        case 0x2A:
+            CPU.A = INS_ROL(CPU.A);
+            CPU.INS_Cycles += 1;
+            break;
+            //ROL zp
+        case 0x26:
+            addr = AM_ZP();
+            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Modify(addr)));
+            break;
+            //ROL zp,x
+        case 0x36:
+            addr = AM_ZP_XY(CPU.X);
+            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Modify(addr)));
+            break;
+
+            //ROR a
+        case 0x6E:
+            addr = AM_Abs();
+            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Modify(addr)));
+            break;
+            //ROR a,x
+        case 0x7E:
+            addr = AM_Abs_X_Shift();
+            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Modify(addr)));
+            break;
+            //ROR A 寄存器
+        case 0x6A:
+            CPU.A = INS_ROR(CPU.A);
+            CPU.INS_Cycles += 1;
+            break;
+            //ROR zp
+        case 0x66:
+            addr = AM_ZP();
+            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Modify(addr)));
+            break;
+            //ROR zp,x
+        case 0x76:
+            addr = AM_ZP_XY(CPU.X);
+            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Modify(addr)));
+            break;
+
+        // ------------Logic(逻辑运算)------------
+            //AND a  AND Memory with Accumulator
+        case 0x2D:
+            INS_AND(CPU_Read_Addr(AM_Abs()));
+            break;
+            //AND a,x
+        case 0x3D:
+            INS_AND(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //AND a,y
+        case 0x39:
+            INS_AND(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //AND #
+        case 0x29:
+            INS_AND(AM_IMM());
+            break;
+            //AND zp
+        case 0x25:
+            INS_AND(CPU_Read_Addr(AM_ZP()));
+            break;
+            //AND (zp,x)
+        case 0x21:
+            INS_AND(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //AND zp,x
+        case 0x35:
+            INS_AND(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //AND (zp),y
+        case 0x31:
+            INS_AND(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+            //ORA a  OR Memory with Accumulator
+        case 0x0D:
+            INS_ORA(CPU_Read_Addr(AM_Abs()));
+            break;
+            //ORA a,x
+        case 0x1D:
+            INS_ORA(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //ORA a,y
+        case 0x19:
+            INS_ORA(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //ORA #
+        case 0x09:
+            INS_ORA(AM_IMM());
+            break;
+            //ORA zp
+        case 0x05:
+            INS_ORA(CPU_Read_Addr(AM_ZP()));
+            break;
+            //ORA (zp,x)
+        case 0x01:
+            INS_ORA(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //ORA zp,x
+        case 0x15:
+            INS_ORA(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //ORA (zp),y
+        case 0x11:
+            INS_ORA(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+            //EOR a   Exclusive-OR Memory with Accumulator
+        case 0x4D:
+            INS_EOR(CPU_Read_Addr(AM_Abs()));
+            break;
+            //EOR a,x
+        case 0x5D:
+            INS_EOR(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //EOR a,y
+        case 0x59:
+            INS_EOR(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //EOR #
+        case 0x49:
+            INS_EOR(AM_IMM());
+            break;
+            //EOR zp
+        case 0x45:
+            INS_EOR(CPU_Read_Addr(AM_ZP()));
+            break;
+            //EOR (zp,x)
+        case 0x41:
+            INS_EOR(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //EOR zp,x
+        case 0x55:
+            INS_EOR(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //EOR (zp),y
+        case 0x51:
+            INS_EOR(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+        // ------------Compare and Test Bit(比较和检测位)------------
+            //CMP a   Compare Memory and Accumulator
+        case 0xCD:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs()));
+            break;
+            //CMP a,x
+        case 0xDD:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //CMP a,y
+        case 0xD9:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //CMP #
+        case 0xC9:
+            CPU_F_Compare(CPU.A, AM_IMM());
+            break;
+            //CMP zp
+        case 0xC5:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP()));
+            break;
+            //CMP (zp,x)
+        case 0xC1:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //CMP zp,x
+        case 0xD5:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //CMP (zp),y
+        case 0xD1:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+
+            //CPX a   Compare Memory and Index X
+        case 0xEC:
+            CPU_F_Compare(CPU.X, CPU_Read_Addr(AM_Abs()));
+            break;
+            //CPX #
+        case 0xE0:
+            CPU_F_Compare(CPU.X, AM_IMM());
+            break;
+            //CPX zp
+        case 0xE4:
+            CPU_F_Compare(CPU.X, CPU_Read_Addr(AM_ZP()));
+            break;
+
+            //CPY a   Compare Memory and Index X
+        case 0xCC:
+            CPU_F_Compare(CPU.Y, CPU_Read_Addr(AM_Abs()));
+            break;
+            //CPY #
+        case 0xC0:
+            CPU_F_Compare(CPU.Y, AM_IMM());
+            break;
+            //CPY zp
+        case 0xC4:
+            CPU_F_Compare(CPU.Y, CPU_Read_Addr(AM_ZP()));
+            break;
+
+            //BIT a   Test Bits in Memory with Accumulator
+        case 0x2C:
+            INS_BIT(CPU_Read_Addr(AM_Abs()));
+            break;
+            //BIT zp
+        case 0x24:
+            INS_BIT(CPU_Read_Addr(AM_ZP()));
+            break;
+        // ------------Branch(分支跳转)------------
+            //BCC r
+        case 0x90:
+            INS_Branch_Idle(AM_IMM(),CPU.F_C == 0);
+            break;
+            //BCS r
+        case 0xB0:
+            INS_Branch_Idle(AM_IMM(),CPU.F_C == 1);
+            break;
+            //BNE r
+        case 0xD0:
+            INS_Branch_Idle(AM_IMM(),CPU.F_Z == 0);
+            break;
+            //BEQ r
+        case 0xF0:
+            INS_Branch_Idle(AM_IMM(),CPU.F_Z == 1);
+            break;
+            //BPL r
+        case 0x10:
+            INS_Branch_Idle(AM_IMM(),CPU.F_N == 0);
+            break;
+            //BMI r
+        case 0x30:
+            INS_Branch_Idle(AM_IMM(),CPU.F_N == 1);
+            break;
+            //BVC r
+        case 0x50:
+            INS_Branch_Idle(AM_IMM(),CPU.F_V == 0);
+            break;
+            //BVS r
+        case 0x70:
+            INS_Branch_Idle(AM_IMM(),CPU.F_V == 1);
+            break;
+
+        // ------------Transfer(转移)------------
+            //TAX
+        case 0xAA:
+            INS_Transfer(CPU.A,&CPU.X,1);
+            break;
+            //TXA
+        case 0x8A:
+            INS_Transfer(CPU.X,&CPU.A,1);
+            break;
+            //TAY
+        case 0xA8:
+            INS_Transfer(CPU.A,&CPU.Y,1);
+            break;
+            //TYA
+        case 0x98:
+            INS_Transfer(CPU.Y,&CPU.A,1);
+            break;
+            //TSX
+        case 0xBA:
+            INS_Transfer(CPU.SP,&CPU.X,1);
+            break;
+            //TXS
+        case 0x9A:
+            INS_Transfer(CPU.X,&CPU.SP,0);
+            break;
+
+        // ------------Set and Clear------------
+            //CLC
+        case 0x18:
+            INS_SET_CLEAR(&CPU.F_C,0);
+            break;
+            //SEC
+        case 0x38:
+            INS_SET_CLEAR(&CPU.F_C,1);
+            break;
+            //CLD
+        case 0xD8:
+            INS_SET_CLEAR(&CPU.F_D,0);
+            break;
+            //SED
+        case 0xF8:
+            INS_SET_CLEAR(&CPU.F_D,1);
+            break;
+            //CLI
+        case 0x58:
+            INS_SET_CLEAR(&CPU.F_I,0);
+            break;
+            //SEI
+        case 0x78:
+            INS_SET_CLEAR(&CPU.F_I,1);
+            break;
+            //CLV
+        case 0xB8:
+            INS_SET_CLEAR(&CPU.F_V,0);
+            break;
+
+        // ------------Stack(栈)------------
+            //PHA
+        case 0x48:
+            INS_PHA();
+            break;
+            //PLA
+        case 0x68:
+            INS_PLA();
+            break;
+            //PHP
+        case 0x08:
+            INS_PHP();
+            break;
+            //PHP
+        case 0x28:
+            INS_PLP();
+            break;
+
+        // ------------Subroutines and Jump(跳转)------------
+            //JMP a
+        case 0x4C:
+            addr = AM_Abs();
+#if CPU_IDLE_SKIP
+            //JMP *
+            if (addr == (Short) (CPU.PC - 3)) {
+                INS_JMP(addr);
+                Idle_Skip(addr, 3);
+                break;
+            }
+#endif
+            INS_JMP(addr);
+            break;
+            //JMP (a)
+        case 0x6C:
+            INS_JMP(AM_ZP_INDIRECT());
+            break;
+            //JSR a
+        case 0x20:
+            INS_JSR(AM_Abs());
+            break;
+            //RTS
+        case 0x60:
+            INS_RTS();
+            break;
+            //RTI
+        case 0x40:
+            INS_RTI();
+            break;
+
+        // ------------Miscellaneous------------
+            //BRK
+        case 0x00:
+            INS_BRK();
+            break;
+            //NOP
+        case 0xEA:
+            CPU.INS_Cycles += 2;
+            break;
+
+#if CPU_IS_CMOS
+        // ------------65C02 扩展指令------------
+            //BRA r
+        case 0x80:
+            INS_Branch_Idle(AM_IMM(),1);
+            break;
+            //BIT #
+        case 0x89:
+            INS_BIT_IMM(AM_IMM());
+            break;
+            //BIT zp,x
+        case 0x34:
+            INS_BIT(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
+            break;
+            //BIT a,x
+        case 0x3C:
+            INS_BIT(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
+            break;
+            //STZ zp
+        case 0x64:
+            INS_REG_To_MEM(AM_ZP(), 0);
+            break;
+            //STZ zp,x
+        case 0x74:
+            INS_REG_To_MEM(AM_ZP_XY(CPU.X), 0);
+            break;
+            //STZ a
+        case 0x9C:
+            INS_REG_To_MEM(AM_Abs(), 0);
+            break;
+            //STZ a,x
+        case 0x9E:
+            INS_REG_To_MEM(AM_Abs_XY_W(CPU.X), 0);
+            break;
+            //PHX
+        case 0xDA:
+            INS_PH_REG(CPU.X);
+            break;
+            //PLX
+        case 0xFA:
+            INS_PL_REG(&CPU.X);
+            break;
+            //PHY
+        case 0x5A:
+            INS_PH_REG(CPU.Y);
+            break;
+            //PLY
+        case 0x7A:
+            INS_PL_REG(&CPU.Y);
+            break;
+            //TSB zp
+        case 0x04:
+            INS_TSB(AM_ZP());
+            break;
+            //TSB a
+        case 0x0C:
+            INS_TSB(AM_Abs());
+            break;
+            //TRB zp
+        case 0x14:
+            INS_TRB(AM_ZP());
+            break;
+            //TRB a
+        case 0x1C:
+            INS_TRB(AM_Abs());
+            break;
+            //INC A
+        case 0x1A:
+            INS_INC_DEC_XY(&CPU.A,1);
+            break;
+            //DEC A
+        case 0x3A:
+            INS_INC_DEC_XY(&CPU.A,-1);
+            break;
+            //ORA (zp)
+        case 0x12:
+            INS_ORA(CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //AND (zp)
+        case 0x32:
+            INS_AND(CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //EOR (zp)
+        case 0x52:
+            INS_EOR(CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //ADC (zp)
+        case 0x72:
+            INS_ADC(CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //STA (zp)
+        case 0x92:
+            INS_REG_To_MEM(AM_ZP_IND(), CPU.A);
+            break;
+            //LDA (zp)
+        case 0xB2:
+            INS_Set_REG(CPU_Read_Addr(AM_ZP_IND()), &CPU.A);
+            break;
+            //CMP (zp)
+        case 0xD2:
+            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //SBC (zp)
+        case 0xF2:
+            INS_SBC(CPU_Read_Addr(AM_ZP_IND()));
+            break;
+            //JMP (a,x)
+        case 0x7C:
+            INS_JMP(AM_Abs_X_IND());
+            break;
+            //RMB0-7 zp
+        case 0x07: case 0x17: case 0x27: case 0x37:
+        case 0x47: case 0x57: case 0x67: case 0x77:
+            INS_RMB_SMB(opcode >> 4, 0);
+            break;
+            //SMB0-7 zp
+        case 0x87: case 0x97: case 0xA7: case 0xB7:
+        case 0xC7: case 0xD7: case 0xE7: case 0xF7:
+            INS_RMB_SMB((opcode >> 4) & 7, 1);
+            break;
+            //BBR0-7 zp,r
+        case 0x0F: case 0x1F: case 0x2F: case 0x3F:
+        case 0x4F: case 0x5F: case 0x6F: case 0x7F:
+            INS_BBR_BBS(opcode >> 4, 0);
+            break;
+            //BBS0-7 zp,r
+        case 0x8F: case 0x9F: case 0xAF: case 0xBF:
+        case 0xCF: case 0xDF: case 0xEF: case 0xFF:
+            INS_BBR_BBS((opcode >> 4) & 7, 1);
+            break;
+            //WAI
+        case 0xCB:
+            CPU.INS_Cycles += 2;
+            INS_Halt(CPU_WAIT);
+            break;
+            //STP
+        case 0xDB:
+            CPU.INS_Cycles += 2;
+            INS_Halt(CPU_STOP);
+            break;
+            //未定义: 2字节 NOP
+        case 0x02: case 0x22: case 0x42: case 0x62: case 0x82: case 0xC2: case 0xE2:
+            AM_IMM();
+            CPU.INS_Cycles += 1;
+            break;
+            //未定义: 2字节 NOP zp
+        case 0x44:
+            INS_NOP_Read(AM_ZP());
+            break;
+            //未定义: 2字节 NOP zp,x
+        case 0x54: case 0xD4: case 0xF4:
+            INS_NOP_Read(AM_ZP_XY(CPU.X));
+            break;
+            //未定义: 3字节 NOP
+        case 0xDC: case 0xFC:
+            INS_NOP_Read(AM_Abs());
+            break;
+            //未定义: 3字节 8周期 NOP
+        case 0x5C:
+            AM_Abs();
+            CPU.INS_Cycles += 6;
+            break;
+            //未定义: 1字节 1周期 NOP (x3, xB)
+        case 0x03: case 0x13: case 0x23: case 0x33: case 0x43: case 0x53: case 0x63: case 0x73:
+        case 0x83: case 0x93: case 0xA3: case 0xB3: case 0xC3: case 0xD3: case 0xE3: case 0xF3:
+        case 0x0B: case 0x1B: case 0x2B: case 0x3B: case 0x4B: case 0x5B: case 0x6B: case 0x7B:
+        case 0x8B: case 0x9B: case 0xAB: case 0xBB: case 0xEB: case 0xFB:
+            CPU.INS_Cycles += 1;
+            break;
+#else
+        // ------------NMOS 未公开指令 (Undocumented)------------
+            //LAX zp
+        case 0xA7:
+            INS_LAX(CPU_Read_Addr(AM_ZP()));
+            break;
+            //LAX zp,y
+        case 0xB7:
+            INS_LAX(CPU_Read_Addr(AM_ZP_XY(CPU.Y)));
+            break;
+            //LAX a
+        case 0xAF:
+            INS_LAX(CPU_Read_Addr(AM_Abs()));
+            break;
+            //LAX a,y
+        case 0xBF:
+            INS_LAX(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
+            break;
+            //LAX (zp,x)
+        case 0xA3:
+            INS_LAX(CPU_Read_Addr(AM_ZP_IND_X()));
+            break;
+            //LAX (zp),y
+        case 0xB3:
+            INS_LAX(CPU_Read_Addr(AM_ZP_IND_Y()));
+            break;
+            //LXA # (不稳定, 取常用的 0xEE 常数)
+        case 0xAB:
+            INS_LAX((CPU.A | 0xEE) & AM_IMM());
+            break;
+
+            //SAX zp
+        case 0x87:
+            INS_REG_To_MEM(AM_ZP(), CPU.A & CPU.X);
+            break;
+            //SAX zp,y
+        case 0x97:
+            INS_REG_To_MEM(AM_ZP_XY(CPU.Y), CPU.A & CPU.X);
+            break;
+            //SAX a
+        case 0x8F:
+            INS_REG_To_MEM(AM_Abs(), CPU.A & CPU.X);
+            break;
+            //SAX (zp,x)
+        case 0x83:
+            INS_REG_To_MEM(AM_ZP_IND_X(), CPU.A & CPU.X);
+            break;
+
+            //SLO zp / zp,x / a / a,x / a,y / (zp,x) / (zp),y
+        case 0x07: INS_SLO(AM_ZP()); break;
+        case 0x17: INS_SLO(AM_ZP_XY(CPU.X)); break;
+        case 0x0F: INS_SLO(AM_Abs()); break;
+        case 0x1F: INS_SLO(AM_Abs_XY_W(CPU.X)); break;
+        case 0x1B: INS_SLO(AM_Abs_XY_W(CPU.Y)); break;
+        case 0x03: INS_SLO(AM_ZP_IND_X()); break;
+        case 0x13: INS_SLO(AM_ZP_IND_Y_W()); break;
+            //RLA
+        case 0x27: INS_RLA(AM_ZP()); break;
+        case 0x37: INS_RLA(AM_ZP_XY(CPU.X)); break;
+        case 0x2F: INS_RLA(AM_Abs()); break;
+        case 0x3F: INS_RLA(AM_Abs_XY_W(CPU.X)); break;
+        case 0x3B: INS_RLA(AM_Abs_XY_W(CPU.Y)); break;
+        case 0x23: INS_RLA(AM_ZP_IND_X()); break;
+        case 0x33: INS_RLA(AM_ZP_IND_Y_W()); break;
+            //SRE
+        case 0x47: INS_SRE(AM_ZP()); break;
+        case 0x57: INS_SRE(AM_ZP_XY(CPU.X)); break;
+        case 0x4F: INS_SRE(AM_Abs()); break;
+        case 0x5F: INS_SRE(AM_Abs_XY_W(CPU.X)); break;
+        case 0x5B: INS_SRE(AM_Abs_XY_W(CPU.Y)); break;
+        case 0x43: INS_SRE(AM_ZP_IND_X()); break;
+        case 0x53: INS_SRE(AM_ZP_IND_Y_W()); break;
+            //RRA
+        case 0x67: INS_RRA(AM_ZP()); break;
+        case 0x77: INS_RRA(AM_ZP_XY(CPU.X)); break;
+        case 0x6F: INS_RRA(AM_Abs()); break;
+        case 0x7F: INS_RRA(AM_Abs_XY_W(CPU.X)); break;
+        case 0x7B: INS_RRA(AM_Abs_XY_W(CPU.Y)); break;
+        case 0x63: INS_RRA(AM_ZP_IND_X()); break;
+        case 0x73: INS_RRA(AM_ZP_IND_Y_W()); break;
+            //DCP
+        case 0xC7: INS_DCP(AM_ZP()); break;
+        case 0xD7: INS_DCP(AM_ZP_XY(CPU.X)); break;
+        case 0xCF: INS_DCP(AM_Abs()); break;
+        case 0xDF: INS_DCP(AM_Abs_XY_W(CPU.X)); break;
+        case 0xDB: INS_DCP(AM_Abs_XY_W(CPU.Y)); break;
+        case 0xC3: INS_DCP(AM_ZP_IND_X()); break;
+        case 0xD3: INS_DCP(AM_ZP_IND_Y_W()); break;
+            //ISC
+        case 0xE7: INS_ISC(AM_ZP()); break;
+        case 0xF7: INS_ISC(AM_ZP_XY(CPU.X)); break;
+        case 0xEF: INS_ISC(AM_Abs()); break;
+        case 0xFF: INS_ISC(AM_Abs_XY_W(CPU.X)); break;
+        case 0xFB: INS_ISC(AM_Abs_XY_W(CPU.Y)); break;
+        case 0xE3: INS_ISC(AM_ZP_IND_X()); break;
+        case 0xF3: INS_ISC(AM_ZP_IND_Y_W()); break;
+
+            //ANC #
+        case 0x0B:
+        case 0x2B:
+            INS_AND(AM_IMM());
+            CPU.F_C = CPU.F_N;
+            break;
+            //ALR #
+        case 0x4B:
+            CPU.A &= AM_IMM();
+            CPU.A = INS_LSR(CPU.A);
+            break;
+            //ARR #
+        case 0x6B:
+            INS_ARR(AM_IMM());
+            break;
+            //SBX #
+        case 0xCB:
+            INS_SBX(AM_IMM());
+            break;
+            //SBC # (重复)
+        case 0xEB:
+            INS_SBC(AM_IMM());
+            break;
+            //XAA # (不稳定)
+        case 0x8B:
+            INS_Set_REG((CPU.A | 0xEE) & CPU.X & AM_IMM(), &CPU.A);
+            break;
+            //LAS a,y
+        case 0xBB:
+            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.Y)) & CPU.SP, &CPU.A);
+            CPU.X = CPU.SP = CPU.A;
+            break;
+            //SHA a,y
+        case 0x9F:
+            addr = AM_Abs_XY_W(CPU.Y);
+            INS_SH(addr, CPU.Y, CPU.A & CPU.X);
+            break;
+            //SHA (zp),y
+        case 0x93:
+            addr = AM_ZP_IND_Y_W();
+            INS_SH(addr, CPU.Y, CPU.A & CPU.X);
+            break;
+            //SHX a,y
+        case 0x9E:
+            addr = AM_Abs_XY_W(CPU.Y);
+            INS_SH(addr, CPU.Y, CPU.X);
+            break;
+            //SHY a,x
+        case 0x9C:
+            addr = AM_Abs_XY_W(CPU.X);
+            INS_SH(addr, CPU.X, CPU.Y);
+            break;
+            //TAS a,y
+        case 0x9B:
+            CPU.SP = CPU.A & CPU.X;
+            addr = AM_Abs_XY_W(CPU.Y);
+            INS_SH(addr, CPU.Y, CPU.SP);
+            break;
+
+            //NOP (implied)
+        case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:
+            CPU.INS_Cycles += 2;
+            break;
+            //NOP #
+        case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2:
+            AM_IMM();
+            CPU.INS_Cycles += 1;
+            break;
+            //NOP zp
+        case 0x04: case 0x44: case 0x64:
+            INS_NOP_Read(AM_ZP());
+            break;
+            //NOP zp,x
+        case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4:
+            INS_NOP_Read(AM_ZP_XY(CPU.X));
+            break;
+            //NOP a
+        case 0x0C:
+            INS_NOP_Read(AM_Abs());
+            break;
+            //NOP a,x
+        case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:
+            INS_NOP_Read(AM_Abs_XY(CPU.X));
+            break;
+            //JAM
+        case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
+        case 0x62: case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
+            INS_Halt(CPU_STOP);
+            break;
+#endif
+    }
+    CPU.Cycles += CPU.INS_Cycles;
+}
+
+/**
+ * CPU_Run/CPU_Step 开始: 取得当前线程的分片
+ */
+static void CPU_Metrics_Begin() {
+#if CPU_METRICS
+    CPU.Shard = CPU.Metrics ? Metrics_Shard(CPU.Metrics) : NULL;
+    CPU.Empty_Dispatch = 0;
+#endif
+}
+
+/**
+ * CPU_Run/CPU_Step 结束: 分派次数减去没有执行指令的分派, 加上经过的周期
+ */
+static void CPU_Metrics_End(unsigned long long dispatched, unsigned long long cycles) {
+#if CPU_METRICS
+    if (CPU.Shard) {
+        METRICS_ADD(CPU.Shard, METRIC_INSTRUCTIONS, dispatched - CPU.Empty_Dispatch);
+        METRICS_ADD(CPU.Shard, METRIC_CYCLES, cycles);
+        METRICS_ADD(CPU.Shard, METRIC_RUNS, 1);
+    }
+#else
+    (void) dispatched;
+    (void) cycles;
+#endif
+}
+
+/**
+ * CPU_Step 的执行部分
+ * @return 分派了 CPU_Exec
+ */
+static int CPU_Step_Exec() {
+    int dispatched = 0;
+    CPU.Run_Limit = 0;
+    if (CPU.Halted == CPU_RUN || CPU.NMI_Pending || (CPU.IRQ_Line && !CPU.F_I)) {
+        CPU_Exec();
+        dispatched = 1;
+    }
+    if (CPU.Suspend_Bus) {
+        CPU_Rewind();
+    } else {
+        CPU.Retry = 0;
+    }
+    return dispatched;
+}
+
+/**
+ * 执行指令直到至少经过 cycles 个周期或 CPU 锁死(JAM/STP)
+ * 到达 Event_Cycle 时调用 On_Event; WAI 期间周期空转
+ * @param cycles
+ * @return 实际执行的周期数
+ */
+unsigned long long CPU_Run(unsigned long long cycles) {
+    unsigned long long start = CPU.Cycles;
+    unsigned long long end = start + cycles;
+    unsigned long long dispatched = 0;
+    CPU.Break = 0;
+    if (CPU.Suspended) {
+        return 0;
+    }
+    CPU_Metrics_Begin();
+    while (CPU.Cycles < end) {
+        if (CPU.Retry) {
+            dispatched += CPU_Step_Exec();
+            if (CPU.Suspended || CPU.Break) {
+                break;
+            }
+            continue;
+        }
+        if (CPU.Cycles >= CPU.Event_Cycle) {
+            CPU.Event_Cycle = CPU_NO_EVENT;
+            CPU.On_Event(CPU_Current);
+            continue;
+        }
+        CPU.Run_Limit = CPU.Event_Cycle < end ? CPU.Event_Cycle : end;
+        if (CPU.Halted == CPU_STOP) {
+            //锁死后只有复位能恢复, 不再推进周期
+            break;
+        }
+        if (CPU.Halted == CPU_WAIT) {
+            CPU.Cycles = CPU.Run_Limit;
+            continue;
+        }
+        while (CPU.Cycles < CPU.Run_Limit) {
+            CPU_Exec();
+#if CPU_METRICS
+            dispatched++;
+#endif
+        }
+        if (CPU.Suspend_Bus) {
+            CPU_Rewind();
+            break;
+        }
+        if (CPU.Break) {
+            break;
+        }
+    }
+    CPU_Metrics_End(dispatched, CPU.Cycles - start);
+    return CPU.Cycles - start;
+}
+
+/**
+ * 单步执行一条指令或响应一个中断, 不融合不快进
+ * 挂起时不执行; 指令被挂起时回到指令开始
+ */
+void CPU_Step() {
+    if (CPU.Suspended) {
+        return;
+    }
+    unsigned long long start = CPU.Cycles;
+    CPU_Metrics_Begin();
+    int dispatched = CPU_Step_Exec();
+    CPU_Metrics_End(dispatched, CPU.Cycles - start);
+}
+
+/**
+ * 协作式时间片: 最多执行 cycles 个周期, 返回停下的原因
+ * 嵌入方可以在多个 CPU 之间轮转, 或在 CPU_SLICE_IO 时等待设备就绪后 CPU_Resume
+ * @param cycles 周期预算
+ * @param ran 非 NULL 时写入实际执行的周期数
+ * @return CPU_SLICE_xxx
+ */
+int CPU_Slice(unsigned long long cycles, unsigned long long *ran) {
+    unsigned long long done = CPU_Run(cycles);
+    if (ran) {
+        *ran = done;
+    }
+    if (CPU.Suspended) {
+        return CPU_SLICE_IO;
+    }
+    if (CPU.Break == CPU_BREAK_YIELD) {
+        return CPU_SLICE_YIELD;
+    }
+    if (CPU.Break) {
+        return CPU_SLICE_BREAK;
+    }
+    if (CPU.Halted == CPU_STOP) {
+        return CPU_SLICE_HALT;
+    }
+    if (CPU.Halted == CPU_WAIT) {
+        return CPU_SLICE_WAIT;
+    }
+    return CPU_SLICE_BUDGET;
+}
@@ -0,0 +1,107 @@
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/disk.h"
+
+/**
+ * 把 LBA 扇区映射到窗口, 超出扇区数时窗口变成空内存并置错误位
+ */
+static void Disk_Map(struct Disk *disk) {
+    unsigned long lba = disk->LBA[0] | disk->LBA[1] << 8 | (unsigned long) disk->LBA[2] << 16;
+    if (lba >= disk->Sectors) {
+        Bus_Map_Bank(disk->Bus, disk->Window, NULL, DISK_SECTOR, 0);
+        disk->Status = (disk->Status & ~DISK_ST_MAPPED) | DISK_ST_ERROR;
+        return;
+    }
+    Bus_Map_Bank(disk->Bus, disk->Window, disk->Data + lba * DISK_SECTOR, DISK_SECTOR, !disk->Read_Only);
+    disk->Status |= DISK_ST_MAPPED;
+}
+
+Byte Disk_Read(void *ctx, Short addr) {
+    struct Disk *disk = ctx;
+    int reg = addr & 7;
+    if (reg < DISK_COMMAND) {
+        return disk->LBA[reg];
+    }
+    if (reg == DISK_COMMAND) {
+        return disk->Status;
+    }
+    return reg < DISK_COUNT + 3 ? (Byte) (disk->Sectors >> ((reg - DISK_COUNT) * 8)) : 0xFF;
+}
+
+void Disk_Write(void *ctx, Short addr, Byte value) {
+    struct Disk *disk = ctx;
+    int reg = addr & 7;
+    if (reg < DISK_COMMAND) {
+        disk->LBA[reg] = value;
+        return;
+    }
+    if (reg != DISK_COMMAND) {
+        return;
+    }
+    disk->Status &= ~DISK_ST_ERROR;
+    switch (value) {
+        case DISK_CMD_NEXT:
+            if (++disk->LBA[0] == 0 && ++disk->LBA[1] == 0) {
+                disk->LBA[2]++;
+            }
+            //fallthrough
+        case DISK_CMD_MAP:
+            Disk_Map(disk);
+            break;
+        case DISK_CMD_FLUSH:
+            if (!disk->Read_Only && msync(disk->Data, disk->Size, MS_SYNC)) {
+                disk->Status |= DISK_ST_ERROR;
+            }
+            break;
+        default:
+            disk->Status |= DISK_ST_ERROR;
+            break;
+    }
+}
+
+int Disk_Open(struct Disk *disk, struct Bus *bus, const char *path, Short window, int read_only) {
+    memset(disk, 0, sizeof(*disk));
+    int fd = open(path, read_only ? O_RDONLY : O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || st.st_size < DISK_SECTOR) {
+        close(fd);
+        return -1;
+    }
+    void *data = mmap(NULL, st.st_size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    //映射之后不再需要文件描述符
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    disk->Bus = bus;
+    disk->Data = data;
+    disk->Size = st.st_size;
+    //末尾不满一个扇区的部分不用; LBA 只有 24 位
+    disk->Sectors = st.st_size / DISK_SECTOR < 0xFFFFFF ? st.st_size / DISK_SECTOR : 0xFFFFFF;
+    disk->Window = window & 0xFF00;
+    disk->Read_Only = read_only;
+    disk->Status = read_only ? DISK_ST_READ_ONLY : 0;
+    disk->Device.Read = Disk_Read;
+    disk->Device.Write = Disk_Write;
+    disk->Device.Ctx = disk;
+    Disk_Map(disk);
+    return 0;
+}
+
+void Disk_Close(struct Disk *disk) {
+    if (!disk->Data) {
+        return;
+    }
+    Bus_Map_Bank(disk->Bus, disk->Window, NULL, DISK_SECTOR, 0);
+    if (!disk->Read_Only) {
+        msync(disk->Data, disk->Size, MS_SYNC);
+    }
+    munmap(disk->Data, disk->Size);
+    disk->Data = NULL;
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/shm.h>
+#include "include/fuzz.h"
+
+/**
+ * 记录初始状态
+ * 调用前填好 Cpu/Entry/Exit/Input_xxx/Cycle_Cap/Map, 程序映像已经加载到总线
+ * @param fuzz
+ */
+void Fuzz_Init(struct Fuzz *fuzz) {
+    struct CPU_Context *cpu = fuzz->Cpu;
+    struct Bus *bus = cpu->Bus;
+    Short ret = fuzz->Exit - 1;
+    Bus_Poke(bus, fuzz->Exit, CPU_HALT_OPCODE);
+    //像 JSR 一样压入返回地址, 入口 RTS 后回到 Exit
+    Bus_Poke(bus, 0x100 | cpu->SP--, ret >> 8);
+    Bus_Poke(bus, 0x100 | cpu->SP--, ret & 0xFF);
+    cpu->PC = fuzz->Entry;
+    cpu->Coverage = fuzz->Map;
+    fuzz->Initial = *cpu;
+    for (int page = 0; page < 256; ++page) {
+        if (bus->Backing[page]) {
+            memcpy(fuzz->Snapshot + (page << 8), bus->Backing[page], 256);
+        } else {
+            memset(fuzz->Snapshot + (page << 8), 0, 256);
+        }
+    }
+    Bus_Clear_Dirty(bus);
+}
+
+/**
+ * 恢复上一次执行写脏的页和寄存器
+ */
+static void Fuzz_Reset(struct Fuzz *fuzz) {
+    struct Bus *bus = fuzz->Cpu->Bus;
+    for (int page = 0; page < 256; ++page) {
+        if (bus->Dirty[page]) {
+            Bus_Load(bus, page << 8, fuzz->Snapshot + (page << 8), 256);
+            bus->Dirty[page] = 0;
+        }
+    }
+    *fuzz->Cpu = fuzz->Initial;
+}
+
+static void Fuzz_Store(struct Bus *bus, Short addr, const Byte *data, unsigned int size) {
+    if (size == 0) {
+        return;
+    }
+    Bus_Load(bus, addr, data, size);
+    for (unsigned int page = addr >> 8; page <= (addr + size - 1) >> 8 && page < 256; ++page) {
+        bus->Dirty[page] = 1;
+    }
+}
+
+/**
+ * 执行一个输入
+ * @param fuzz
+ * @param data
+ * @param size 超过 Input_Size 的部分截断
+ * @return FUZZ_OK/FUZZ_HANG/FUZZ_CRASH
+ */
+int Fuzz_Exec(struct Fuzz *fuzz, const Byte *data, unsigned int size) {
+    struct CPU_Context *cpu = fuzz->Cpu;
+    Fuzz_Reset(fuzz);
+    if (size > fuzz->Input_Size) {
+        size = fuzz->Input_Size;
+    }
+    Fuzz_Store(cpu->Bus, fuzz->Input_Addr, data, size);
+    if (fuzz->Length_Addr) {
+        Byte length[2] = {size & 0xFF, size >> 8};
+        Fuzz_Store(cpu->Bus, fuzz->Length_Addr, length, 2);
+    }
+    CPU_Select(cpu);
+    CPU_Run(fuzz->Cycle_Cap);
+    if (cpu->Halted != CPU_STOP) {
+        return FUZZ_HANG;
+    }
+    return cpu->PC == fuzz->Exit ? FUZZ_OK : FUZZ_CRASH;
+}
+
+static Byte *Fuzz_Read_File(FILE *fp, unsigned int *size) {
+    unsigned int cap = 4096;
+    Byte *data = malloc(cap);
+    *size = 0;
+    size_t n;
+    while ((n = fread(data + *size, 1, cap - *size, fp)) > 0) {
+        *size += n;
+        if (*size == cap) {
+            cap *= 2;
+            data = realloc(data, cap);
+        }
+    }
+    return data;
+}
+
+/**
+ * AFL 模式下的下一个输入: 用 afl-clang-fast/afl-gcc-fast 编译时是持久模式,
+ * 一个进程执行 FUZZ_PERSIST 个输入, 之间只由 Fuzz_Exec 恢复写脏的页; 普通编译器每个进程一个输入
+ * @param runs 已经执行的输入数
+ */
+static int Fuzz_Next(unsigned int *runs) {
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+    (*runs)++;
+    return __AFL_LOOP(FUZZ_PERSIST);
+#else
+    return (*runs)++ == 0;
+#endif
+}
+
+/**
+ * 从标准输入读一个输入, 最多 cap 字节; 持久模式下 AFL 每次重写输入文件并回到开头, 所以不用 stdio 的缓冲
+ */
+static unsigned int Fuzz_Read_Stdin(Byte *data, unsigned int cap) {
+    unsigned int size = 0;
+    ssize_t n;
+    while (size < cap && (n = read(STDIN_FILENO, data + size, cap - size)) > 0) {
+        size += n;
+    }
+    return size;
+}
+
+/**
+ * 命令行: fuzz <映像> <加载地址> <入口> <结束地址> <输入地址> <输入大小> <周期上限> [输入文件...]
+ * 没有输入文件时从标准输入读输入(AFL 模式), forkserver 在加载完映像之后启动
+ * 设置了 __AFL_SHM_ID 时覆盖表写到 AFL 的共享内存, 崩溃时 abort()
+ */
+int Fuzz_Main(int argc, char **argv) {
+    static struct Bus bus;
+    static struct CPU_Context cpu;
+    static struct Fuzz fuzz;
+    static Byte local_map[FUZZ_MAP_SIZE];
+    const char *names[] = {"ok", "hang", "crash"};
+    if (argc < 7) {
+        fprintf(stderr, "usage: fuzz <image> <load> <entry> <exit> <input> <input_size> <cycles> [files...]\n");
+        return 1;
+    }
+    FILE *fp = fopen(argv[0], "rb");
+    if (!fp) {
+        fprintf(stderr, "can't open %s\n", argv[0]);
+        return 1;
+    }
+    unsigned int size;
+    Byte *image = Fuzz_Read_File(fp, &size);
+    fclose(fp);
+    Bus_Init(&bus);
+    Bus_Load(&bus, strtoul(argv[1], NULL, 0), image, size);
+    free(image);
+    CPU_Init(&cpu, &bus);
+    CPU_Select(&cpu);
+    CPU_Reset(0);
+
+    fuzz.Cpu = &cpu;
+    fuzz.Entry = strtoul(argv[2], NULL, 0);
+    fuzz.Exit = strtoul(argv[3], NULL, 0);
+    fuzz.Input_Addr = strtoul(argv[4], NULL, 0);
+    unsigned long input_size = strtoul(argv[5], NULL, 0);
+    if (input_size > 0xFFFF) {
+        fprintf(stderr, "input size %s exceeds 0xFFFF\n", argv[5]);
+        return 1;
+    }
+    fuzz.Input_Size = input_size;
+    fuzz.Cycle_Cap = strtoull(argv[6], NULL, 0);
+    fuzz.Map = local_map;
+    const char *shm_id = getenv("__AFL_SHM_ID");
+    if (shm_id) {
+        void *map = shmat(atoi(shm_id), NULL, 0);
+        if (map != (void *) -1) {
+            fuzz.Map = map;
+        }
+    }
+    Fuzz_Init(&fuzz);
+
+    if (argc == 7) {
+        static Byte data[0x10000];
+        unsigned int runs = 0;
+        int result = FUZZ_OK;
+#ifdef __AFL_HAVE_MANUAL_CONTROL
+        __AFL_INIT();
+#endif
+        while (Fuzz_Next(&runs)) {
+            result = Fuzz_Exec(&fuzz, data, Fuzz_Read_Stdin(data, fuzz.Input_Size));
+            if (result == FUZZ_CRASH && shm_id) {
+                abort();
+            }
+        }
+        return result;
+    }
+    for (int i = 7; i < argc; ++i) {
+        fp = fopen(argv[i], "rb");
+        if (!fp) {
+            fprintf(stderr, "can't open %s\n", argv[i]);
+            continue;
+        }
+        Byte *data = Fuzz_Read_File(fp, &size);
+        fclose(fp);
+        int result = Fuzz_Exec(&fuzz, data, size);
+        printf("%s: %s pc=$%04X cycles=%llu\n", argv[i], names[result], cpu.PC, cpu.Cycles - fuzz.Initial.Cycles);
+        free(data);
+    }
+    return 0;
+}
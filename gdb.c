@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "include/gdb.h"
+
+static const char GDB_Target_XML[] =
+        "<?xml version=\"1.0\"?>"
+        "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+        "<target version=\"1.0\">"
+        "<feature name=\"org.gnu.gdb.m6502.core\">"
+        "<reg name=\"a\" bitsize=\"8\" regnum=\"0\"/>"
+        "<reg name=\"x\" bitsize=\"8\"/>"
+        "<reg name=\"y\" bitsize=\"8\"/>"
+        "<reg name=\"p\" bitsize=\"8\"/>"
+        "<reg name=\"sp\" bitsize=\"8\"/>"
+        "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+        "</feature>"
+        "</target>";
+
+#define GDB_XFER_TARGET "qXfer:features:read:target.xml:"
+
+static const char GDB_Hex[] = "0123456789abcdef";
+
+static int GDB_Digit(char c) {
+    return c >= '0' && c <= '9' ? c - '0'
+         : c >= 'a' && c <= 'f' ? c - 'a' + 10
+         : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+/**
+ * 解析十六进制数, text 指向数字之后
+ */
+static unsigned long GDB_Parse(const char **text) {
+    unsigned long value = 0;
+    while (GDB_Digit(**text) >= 0) {
+        value = value << 4 | GDB_Digit(**text);
+        (*text)++;
+    }
+    return value;
+}
+
+static char *GDB_Put_Byte(char *out, Byte value) {
+    *out++ = GDB_Hex[value >> 4];
+    *out++ = GDB_Hex[value & 0xF];
+    return out;
+}
+
+static int GDB_Get_Byte(const char **text) {
+    int high = GDB_Digit((*text)[0]);
+    int low = high < 0 ? -1 : GDB_Digit((*text)[1]);
+    if (low < 0) {
+        return -1;
+    }
+    *text += 2;
+    return high << 4 | low;
+}
+
+//-------------连接-----------------
+
+static int GDB_Read_Char(struct GDB_Server *server) {
+    unsigned char c;
+    return read(server->Fd, &c, 1) == 1 ? c : -1;
+}
+
+static void GDB_Write(struct GDB_Server *server, const char *data, size_t size) {
+    while (size) {
+        ssize_t done = send(server->Fd, data, size, MSG_NOSIGNAL);
+        if (done <= 0) {
+            return;
+        }
+        data += done;
+        size -= done;
+    }
+}
+
+/**
+ * 发送 $data#xx, 没有关闭确认时等待 '+'
+ */
+static void GDB_Send(struct GDB_Server *server, const char *data) {
+    size_t size = strlen(data);
+    char *frame = malloc(size + 4);
+    Byte sum = 0;
+    frame[0] = '$';
+    for (size_t i = 0; i < size; ++i) {
+        frame[i + 1] = data[i];
+        sum += (Byte) data[i];
+    }
+    frame[size + 1] = '#';
+    GDB_Put_Byte(frame + size + 2, sum);
+    GDB_Write(server, frame, size + 4);
+    free(frame);
+    if (!server->No_Ack) {
+        int c;
+        while ((c = GDB_Read_Char(server)) >= 0 && c != '+' && c != '-') {
+        }
+    }
+}
+
+/**
+ * 读取一个包到 Packet
+ * @return 0 成功, 1 收到中断(^C), -1 连接断开
+ */
+static int GDB_Receive(struct GDB_Server *server) {
+    for (;;) {
+        int c = GDB_Read_Char(server);
+        if (c < 0) {
+            return -1;
+        }
+        if (c == 0x03) {
+            return 1;
+        }
+        if (c != '$') {
+            continue;
+        }
+        size_t len = 0;
+        Byte sum = 0;
+        while ((c = GDB_Read_Char(server)) >= 0 && c != '#') {
+            if (len < GDB_PACKET_SIZE - 1) {
+                server->Packet[len++] = c;
+            }
+            sum += c;
+        }
+        int high = GDB_Digit(GDB_Read_Char(server));
+        int low = GDB_Digit(GDB_Read_Char(server));
+        if (c < 0 || high < 0 || low < 0) {
+            return -1;
+        }
+        server->Packet[len] = '\0';
+        if (!server->No_Ack) {
+            int ok = (high << 4 | low) == sum;
+            GDB_Write(server, ok ? "+" : "-", 1);
+            if (!ok) {
+                continue;
+            }
+        }
+        return 0;
+    }
+}
+
+static void GDB_Remove_Breaks(struct GDB_Server *server) {
+    for (int i = 0; i < WATCH_MAX; ++i) {
+        if (server->Breaks[i].Used) {
+            Watch_Remove(server->Watch, server->Breaks[i].Id);
+            server->Breaks[i].Used = 0;
+        }
+    }
+}
+
+static void GDB_Disconnect(struct GDB_Server *server) {
+    GDB_Remove_Breaks(server);
+    close(server->Fd);
+    server->Fd = -1;
+    server->Running = 0;
+    server->No_Ack = 0;
+}
+
+int GDB_Listen(struct GDB_Server *server, const char *address, struct CPU_Context *cpu, struct Watch *watch) {
+    memset(server, 0, sizeof(*server));
+    server->Listen_Fd = -1;
+    server->Fd = -1;
+    server->Cpu = cpu;
+    server->Watch = watch;
+    int fd;
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        strcpy(addr.sun_path, address + 5);
+        unlink(addr.sun_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            goto fail;
+        }
+    } else {
+        struct sockaddr_in addr = {0};
+        const char *colon = strrchr(address, ':');
+        char host[64] = "127.0.0.1";
+        if (colon && (size_t) (colon - address) < sizeof(host)) {
+            memcpy(host, address, colon - address);
+            host[colon - address] = '\0';
+        }
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(colon ? colon + 1 : address));
+        if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+            return -1;
+        }
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0
+            || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            goto fail;
+        }
+    }
+    if (listen(fd, 1) < 0) {
+        goto fail;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    server->Listen_Fd = fd;
+    return 0;
+fail:
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+void GDB_Close(struct GDB_Server *server) {
+    if (server->Fd >= 0) {
+        GDB_Disconnect(server);
+    }
+    if (server->Listen_Fd >= 0) {
+        close(server->Listen_Fd);
+        server->Listen_Fd = -1;
+    }
+}
+
+//-------------命令-----------------
+
+static Byte GDB_Get_P(const struct CPU_Context *cpu) {
+    return (cpu->F_N << 7) | (cpu->F_V << 6) | 0x20 | (cpu->F_D << 3)
+           | (cpu->F_I << 2) | (cpu->F_Z << 1) | cpu->F_C;
+}
+
+static void GDB_Set_P(struct CPU_Context *cpu, Byte p) {
+    cpu->F_N = p >> 7;
+    cpu->F_V = (p >> 6) & 1;
+    cpu->F_D = (p >> 3) & 1;
+    cpu->F_I = (p >> 2) & 1;
+    cpu->F_Z = (p >> 1) & 1;
+    cpu->F_C = p & 1;
+}
+
+/**
+ * 寄存器 n 写成十六进制(小端)
+ */
+static char *GDB_Put_Reg(char *out, const struct CPU_Context *cpu, int n) {
+    switch (n) {
+        case 0:
+            return GDB_Put_Byte(out, cpu->A);
+        case 1:
+            return GDB_Put_Byte(out, cpu->X);
+        case 2:
+            return GDB_Put_Byte(out, cpu->Y);
+        case 3:
+            return GDB_Put_Byte(out, GDB_Get_P(cpu));
+        case 4:
+            return GDB_Put_Byte(out, cpu->SP);
+        default:
+            return GDB_Put_Byte(GDB_Put_Byte(out, cpu->PC & 0xFF), cpu->PC >> 8);
+    }
+}
+
+/**
+ * 从十六进制读取寄存器 n
+ * @return 0 成功
+ */
+static int GDB_Set_Reg(const char **text, struct CPU_Context *cpu, int n) {
+    int value = GDB_Get_Byte(text);
+    if (value < 0) {
+        return -1;
+    }
+    switch (n) {
+        case 0:
+            cpu->A = value;
+            break;
+        case 1:
+            cpu->X = value;
+            break;
+        case 2:
+            cpu->Y = value;
+            break;
+        case 3:
+            GDB_Set_P(cpu, value);
+            break;
+        case 4:
+            cpu->SP = value;
+            break;
+        default: {
+            int high = GDB_Get_Byte(text);
+            if (high < 0) {
+                return -1;
+            }
+            cpu->PC = value | high << 8;
+        }
+    }
+    return 0;
+}
+
+/**
+ * 停止原因: 观察点命中时带上地址
+ */
+static void GDB_Stop_Reply(struct GDB_Server *server, int signal) {
+    char reply[64];
+    const struct Watch_Hit *hit = &server->Watch->Last;
+    if (signal == 5 && server->Cpu->Break == CPU_BREAK_WATCH && hit->Kind != WATCH_EXEC) {
+        snprintf(reply, sizeof(reply), "T05%s:%04x;",
+                 hit->Kind == WATCH_WRITE ? "watch" : "rwatch", hit->Addr);
+    } else {
+        snprintf(reply, sizeof(reply), "S%02x", signal);
+    }
+    GDB_Send(server, reply);
+}
+
+/**
+ * Z/z: 0/1 执行断点, 2 写, 3 读, 4 读写
+ */
+static void GDB_Break_Point(struct GDB_Server *server, int insert) {
+    const char *text = server->Packet + 1;
+    int type = GDB_Parse(&text);
+    Short addr = 0;
+    unsigned long len = 1;
+    if (*text == ',') {
+        text++;
+        addr = GDB_Parse(&text);
+    }
+    if (*text == ',') {
+        text++;
+        len = GDB_Parse(&text);
+    }
+    if (type > 4) {
+        GDB_Send(server, "");
+        return;
+    }
+    if (len == 0 || type < 2) {
+        len = 1;
+    }
+    if (!insert) {
+        for (int i = 0; i < WATCH_MAX; ++i) {
+            struct GDB_Break *brk = &server->Breaks[i];
+            if (brk->Used && brk->Type == type && brk->Addr == addr) {
+                Watch_Remove(server->Watch, brk->Id);
+                brk->Used = 0;
+                break;
+            }
+        }
+        GDB_Send(server, "OK");
+        return;
+    }
+    static const Byte kinds[] = {WATCH_EXEC, WATCH_EXEC, WATCH_WRITE, WATCH_READ, WATCH_READ | WATCH_WRITE};
+    struct Watch_Point point = {0};
+    point.Kind = kinds[type];
+    point.Start = addr;
+    point.End = addr + len - 1 < 0x10000 ? addr + len - 1 : 0xFFFF;
+    point.Mask = 0xFF;
+    for (int i = 0; i < WATCH_MAX; ++i) {
+        struct GDB_Break *brk = &server->Breaks[i];
+        if (!brk->Used) {
+            brk->Id = Watch_Add(server->Watch, &point);
+            if (brk->Id < 0) {
+                break;
+            }
+            brk->Used = 1;
+            brk->Type = type;
+            brk->Addr = addr;
+            brk->Len = len;
+            GDB_Send(server, "OK");
+            return;
+        }
+    }
+    GDB_Send(server, "E01");
+}
+
+/**
+ * 执行一条指令, 当前 PC 上的执行断点不拦截
+ */
+static void GDB_Step(struct GDB_Server *server) {
+    struct CPU_Context *cpu = server->Cpu;
+    struct CPU_Context *prev = CPU_Current;
+    server->Watch->Stop_Cpu = cpu;
+    server->Watch->Stop_PC = cpu->PC;
+    server->Watch->Stop_Cycles = cpu->Cycles;
+    CPU_Select(cpu);
+    CPU.Break = 0;
+    CPU_Step();
+    CPU_Select(prev);
+}
+
+static void GDB_Read_Memory(struct GDB_Server *server) {
+    const char *text = server->Packet + 1;
+    unsigned long addr = GDB_Parse(&text);
+    unsigned long len = *text == ',' ? (text++, GDB_Parse(&text)) : 0;
+    char reply[GDB_PACKET_SIZE];
+    char *out = reply;
+    if (len > (GDB_PACKET_SIZE - 1) / 2) {
+        len = (GDB_PACKET_SIZE - 1) / 2;
+    }
+    for (unsigned long i = 0; i < len && addr + i <= 0xFFFF; ++i) {
+        out = GDB_Put_Byte(out, Bus_Peek(server->Cpu->Bus, addr + i));
+    }
+    *out = '\0';
+    GDB_Send(server, out == reply && len ? "E01" : reply);
+}
+
+static void GDB_Write_Memory(struct GDB_Server *server) {
+    const char *text = server->Packet + 1;
+    unsigned long addr = GDB_Parse(&text);
+    unsigned long len = *text == ',' ? (text++, GDB_Parse(&text)) : 0;
+    if (*text++ != ':') {
+        GDB_Send(server, "E01");
+        return;
+    }
+    for (unsigned long i = 0; i < len && addr + i <= 0xFFFF; ++i) {
+        int value = GDB_Get_Byte(&text);
+        if (value < 0) {
+            GDB_Send(server, "E01");
+            return;
+        }
+        Bus_Poke(server->Cpu->Bus, addr + i, value);
+    }
+    GDB_Send(server, "OK");
+}
+
+/**
+ * qXfer:features:read:target.xml:偏移,长度
+ */
+static void GDB_Features(struct GDB_Server *server, const char *text) {
+    unsigned long offset = GDB_Parse(&text);
+    unsigned long len = *text == ',' ? (text++, GDB_Parse(&text)) : 0;
+    char reply[GDB_PACKET_SIZE];
+    size_t size = sizeof(GDB_Target_XML) - 1;
+    if (offset >= size) {
+        GDB_Send(server, "l");
+        return;
+    }
+    if (len > GDB_PACKET_SIZE - 2) {
+        len = GDB_PACKET_SIZE - 2;
+    }
+    if (len > size - offset) {
+        len = size - offset;
+    }
+    reply[0] = offset + len < size ? 'm' : 'l';
+    memcpy(reply + 1, GDB_Target_XML + offset, len);
+    reply[len + 1] = '\0';
+    GDB_Send(server, reply);
+}
+
+/**
+ * CPU 停下时处理命令
+ * @return 0 继续执行, -1 调试器断开
+ */
+static int GDB_Session(struct GDB_Server *server) {
+    struct CPU_Context *cpu = server->Cpu;
+    for (;;) {
+        int result = GDB_Receive(server);
+        if (result < 0) {
+            GDB_Disconnect(server);
+            return -1;
+        }
+        if (result > 0) {
+            GDB_Stop_Reply(server, 2);
+            continue;
+        }
+        char *packet = server->Packet;
+        char reply[64];
+        const char *text = packet + 1;
+        switch (packet[0]) {
+            case '?':
+                GDB_Stop_Reply(server, 5);
+                break;
+            case 'g': {
+                char *out = reply;
+                for (int n = 0; n < 6; ++n) {
+                    out = GDB_Put_Reg(out, cpu, n);
+                }
+                *out = '\0';
+                GDB_Send(server, reply);
+                break;
+            }
+            case 'G': {
+                int error = 0;
+                for (int n = 0; n < 6 && !error; ++n) {
+                    error = GDB_Set_Reg(&text, cpu, n);
+                }
+                GDB_Send(server, error ? "E01" : "OK");
+                break;
+            }
+            case 'p': {
+                unsigned long n = GDB_Parse(&text);
+                if (n > 5) {
+                    GDB_Send(server, "E01");
+                    break;
+                }
+                *GDB_Put_Reg(reply, cpu, n) = '\0';
+                GDB_Send(server, reply);
+                break;
+            }
+            case 'P': {
+                unsigned long n = GDB_Parse(&text);
+                GDB_Send(server, n > 5 || *text++ != '=' || GDB_Set_Reg(&text, cpu, n) ? "E01" : "OK");
+                break;
+            }
+            case 'm':
+                GDB_Read_Memory(server);
+                break;
+            case 'M':
+                GDB_Write_Memory(server);
+                break;
+            case 'Z':
+            case 'z':
+                GDB_Break_Point(server, packet[0] == 'Z');
+                break;
+            case 's':
+            case 'c':
+                if (*text) {
+                    cpu->PC = GDB_Parse(&text);
+                }
+                if (packet[0] == 's') {
+                    GDB_Step(server);
+                    GDB_Stop_Reply(server, 5);
+                    break;
+                }
+                //从断点处继续时先执行这条指令
+                server->Watch->Stop_Cpu = cpu;
+                server->Watch->Stop_PC = cpu->PC;
+                server->Watch->Stop_Cycles = cpu->Cycles;
+                server->Running = 1;
+                return 0;
+            case 'D':
+                GDB_Send(server, "OK");
+                GDB_Disconnect(server);
+                return -1;
+            case 'k':
+                //只断开调试器, 实例继续运行
+                GDB_Disconnect(server);
+                return -1;
+            case 'H':
+                GDB_Send(server, "OK");
+                break;
+            case 'q':
+                if (strncmp(packet, "qSupported", 10) == 0) {
+                    snprintf(reply, sizeof(reply), "PacketSize=%x;qXfer:features:read+;QStartNoAckMode+",
+                             GDB_PACKET_SIZE);
+                    GDB_Send(server, reply);
+                } else if (strncmp(packet, GDB_XFER_TARGET, sizeof(GDB_XFER_TARGET) - 1) == 0) {
+                    GDB_Features(server, packet + sizeof(GDB_XFER_TARGET) - 1);
+                } else if (strcmp(packet, "qAttached") == 0) {
+                    GDB_Send(server, "1");
+                } else if (strcmp(packet, "qC") == 0) {
+                    GDB_Send(server, "QC1");
+                } else if (strcmp(packet, "qfThreadInfo") == 0) {
+                    GDB_Send(server, "m1");
+                } else if (strcmp(packet, "qsThreadInfo") == 0) {
+                    GDB_Send(server, "l");
+                } else {
+                    GDB_Send(server, "");
+                }
+                break;
+            case 'Q':
+                if (strcmp(packet, "QStartNoAckMode") == 0) {
+                    GDB_Send(server, "OK");
+                    server->No_Ack = 1;
+                } else {
+                    GDB_Send(server, "");
+                }
+                break;
+            default:
+                GDB_Send(server, "");
+        }
+    }
+}
+
+int GDB_Poll(struct GDB_Server *server) {
+    if (server->Fd < 0) {
+        if (server->Listen_Fd < 0) {
+            return 0;
+        }
+        int fd = accept(server->Listen_Fd, NULL, NULL);
+        if (fd < 0) {
+            return 0;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        server->Fd = fd;
+        //连接后 CPU 停下, 等调试器的命令
+        return GDB_Session(server) == 0;
+    }
+    if (!server->Running) {
+        return GDB_Session(server) == 0;
+    }
+    if (server->Cpu->Break == CPU_BREAK_WATCH) {
+        server->Running = 0;
+        GDB_Stop_Reply(server, 5);
+        server->Cpu->Break = 0;
+        return GDB_Session(server) == 0;
+    }
+    struct pollfd pfd = {server->Fd, POLLIN, 0};
+    if (poll(&pfd, 1, 0) > 0) {
+        int c = GDB_Read_Char(server);
+        if (c < 0) {
+            GDB_Disconnect(server);
+            return 0;
+        }
+        if (c == 0x03) {
+            server->Running = 0;
+            GDB_Stop_Reply(server, 2);
+            return GDB_Session(server) == 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,99 @@
+#ifndef CPU_6502_ACIA_H
+#define CPU_6502_ACIA_H
+
+#include "cpu.h"
+#include "ring.h"
+
+//寄存器(地址低 2 位, 整页内重复)
+#define ACIA_DATA    0
+#define ACIA_STATUS  1
+#define ACIA_COMMAND 2
+#define ACIA_CONTROL 3
+
+//状态寄存器
+#define ACIA_ST_OVERRUN 0x04
+//接收数据寄存器满
+#define ACIA_ST_RDRF    0x08
+//发送数据寄存器空
+#define ACIA_ST_TDRE    0x10
+//没有载波: 输入已经结束并且读完, 或者没有输入
+#define ACIA_ST_DCD     0x20
+#define ACIA_ST_IRQ     0x80
+
+//命令寄存器
+//DTR: 收发器工作
+#define ACIA_CMD_DTR    0x01
+//禁止接收中断
+#define ACIA_CMD_IRD    0x02
+//位 3-2: 00 发送器关闭, 01 发送并允许发送中断, 10/11 发送
+#define ACIA_CMD_TIC    0x0C
+#define ACIA_CMD_TX_IRQ 0x04
+#define ACIA_CMD_PARITY 0x20
+
+//默认时钟频率(Hz), 按波特率计算字符时间
+#define ACIA_CLOCK 1000000.0
+//接收缓冲区空时再次检查的间隔(周期)
+#define ACIA_IDLE_CYCLES 1000
+//收发缓冲区大小
+#define ACIA_RING_SIZE 65536
+
+/**
+ * 6551 ACIA 串口, 数据经过无锁环形缓冲区和后台线程接到主机文件(管道、终端、普通文件)
+ * 收发都由 CPU 定时器驱动, 不轮询:
+ * - 接收: RDR 被读走并经过一个字符时间后, 定时器从缓冲区取下一个字节; 缓冲区空时每 ACIA_IDLE_CYCLES 再看一次
+ * - 发送: 写 TDR 后经过一个字符时间, 定时器把字节放进缓冲区, TDRE 置位; 缓冲区满时等它有空间
+ * 两个方向都像有 RTS/CTS 流控一样不丢数据, 速度受波特率(控制寄存器为 0 时不限速)和主机文件两边限制
+ * 所有寄存器访问和定时器都在执行 CPU 的线程里, 只有缓冲区的另一端在后台线程
+ */
+struct ACIA {
+    struct CPU_Context *Cpu;
+    struct Bus_Device Device;
+    //中断源位, 0 时不接中断
+    Byte IRQ_Source;
+    double Clock;
+    Byte RDR;
+    Byte TDR;
+    Byte Status;
+    Byte Command;
+    Byte Control;
+    //TDR 里有还没发出的字节
+    Byte TX_Busy;
+    //一个字符的周期数, 0 为不限速
+    unsigned long long Char_Cycles;
+    struct CPU_Timer RX_Timer;
+    struct CPU_Timer TX_Timer;
+    //没有输入/输出文件时为 NULL: 没有载波/发送的数据丢弃
+    struct Ring *Rx;
+    struct Ring *Tx;
+    struct Ring RX_Ring;
+    struct Ring TX_Ring;
+    struct Ring_Pump RX_Pump;
+    struct Ring_Pump TX_Pump;
+    unsigned long long RX_Bytes;
+    unsigned long long TX_Bytes;
+};
+
+/**
+ * 创建缓冲区和后台线程, 硬件复位; 寄存器页由调用方映射到 acia->Device
+ * @param in_fd 接收的数据来源, -1 时没有输入
+ * @param out_fd 发送的数据写到这里, -1 时丢弃
+ * @param irq 中断源位, 0 不接中断
+ * @param clock CPU 时钟频率, 0 为 ACIA_CLOCK
+ * @return 0 成功
+ */
+int ACIA_Open(struct ACIA *acia, struct CPU_Context *cpu, int in_fd, int out_fd, Byte irq, double clock);
+
+/**
+ * 停止定时器, 把 TDR 里的字节和缓冲区里的数据写完, 结束后台线程
+ * 调用之前取消寄存器页的映射
+ */
+void ACIA_Close(struct ACIA *acia);
+
+//硬件复位
+void ACIA_Reset(struct ACIA *acia);
+
+Byte ACIA_Read(void *ctx, Short addr);
+
+void ACIA_Write(void *ctx, Short addr, Byte value);
+
+#endif
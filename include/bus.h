@@ -0,0 +1,93 @@
+#ifndef CPU_6502_BUS_H
+#define CPU_6502_BUS_H
+
+#define Byte unsigned char
+#define byte signed char
+#define Short unsigned short
+
+struct CPU_Context;
+struct Watch;
+struct Mapper;
+struct Pool;
+
+//缓存行大小, 上下文和总线按它对齐
+#define BUS_CACHE_LINE 64
+
+//Bus.Armed: 页上有观察点, 对应的访问走慢路径
+#define BUS_ARM_READ  1
+#define BUS_ARM_WRITE 2
+#define BUS_ARM_EXEC  4
+
+/**
+ * 映射到总线上的设备(I/O 区域), 按 256 字节页挂载
+ * Read/Write 为 NULL 时读返回 0xFF, 写被丢弃
+ */
+struct Bus_Device {
+    Byte (*Read)(void *ctx, Short addr);
+    void (*Write)(void *ctx, Short addr, Byte value);
+    void *Ctx;
+};
+
+/**
+ * 地址总线: 64K 地址空间, 可以被多个 CPU 上下文共享
+ * 按 256 字节页查表: Read_Page/Write_Page 为 NULL 的页走慢路径
+ * - 内存页: 第一次写入时才清零 Mem 里对应的页(之前读到的是 0), 没写过的页不占物理内存
+ * - 只读页: 直接指向外部数据(例如 mmap 的 ROM 文件), 不拷贝, CPU 写入被丢弃
+ * - I/O 页: 两个指针都为 NULL, 读写交给 IO[page]
+ * - 有观察点的页: 对应的指针为 NULL, 访问在慢路径里交给 Watch 检查
+ * - bank 页: Backing 直接指向映射器的 ROM/RAM bank, 切换 bank 只改指针; RAM bank 直接写入 bank
+ * - 有映射器控制寄存器的页: Write_Page 为 NULL, 写入先交给 Mapper
+ * - 共享页: Backing 指向 Pool 里的页, Write_Page 为 NULL, 第一次写入时拷贝回 Mem
+ */
+struct Bus {
+    //每次访问都查的页表和写内存时置位的 Dirty 放在最前面, 只在慢路径用的表放在后面
+    _Alignas(BUS_CACHE_LINE) const Byte *Read_Page[256];
+    Byte *Write_Page[256];
+    //CPU 写过的页, 由使用者清零
+    Byte Dirty[256];
+    struct Bus_Device *IO[256];
+    //页的内容, NULL 表示还没写过的内存页, 不是只读页时可以写入
+    const Byte *Backing[256];
+    //只读页
+    Byte ROM[256];
+    //BUS_ARM_xxx
+    Byte Armed[256];
+    //写入先交给映射器的页
+    Byte Control[256];
+    //Backing 指向 Pool 里的共享页
+    Byte Shared[256];
+    struct Watch *Watch;
+    struct Mapper *Mapper;
+    struct Pool *Pool;
+    //Bus_Run_Parallel 中同时执行的 CPU 数, 大于 1 时内存随时可能被别的线程改写
+    int Threads;
+    _Alignas(BUS_CACHE_LINE) Byte Mem[0x10000];
+};
+
+void Bus_Init(struct Bus *bus);
+
+void Bus_Clear_Dirty(struct Bus *bus);
+
+void Bus_Map_IO(struct Bus *bus, Short start, Short end, struct Bus_Device *device);
+
+void Bus_Load(struct Bus *bus, Short addr, const Byte *data, unsigned int size);
+
+void Bus_Map_ROM(struct Bus *bus, Short addr, const Byte *data, unsigned int size);
+
+void Bus_Arm(struct Bus *bus, int page, Byte armed);
+
+void Bus_Map_Bank(struct Bus *bus, Short addr, const Byte *data, unsigned int size, int writable);
+
+void Bus_Map_Control(struct Bus *bus, Short start, Short end, Byte on);
+
+Byte Bus_Write_Fault(struct Bus *bus, Short addr, Byte value);
+
+Byte Bus_Peek(const struct Bus *bus, Short addr);
+
+void Bus_Poke(struct Bus *bus, Short addr, Byte value);
+
+void Bus_Run_Interleaved(struct CPU_Context **cpus, int count, unsigned int quantum, unsigned long long cycles);
+
+int Bus_Run_Parallel(struct CPU_Context **cpus, int count, unsigned int sync_cycles, unsigned long long cycles);
+
+#endif
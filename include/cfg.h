@@ -0,0 +1,100 @@
+#ifndef CPU_6502_CFG_H
+#define CPU_6502_CFG_H
+
+#include <stdio.h>
+#include "cpu.h"
+#include "lib6502.h"
+
+//CFG.Mark[addr]
+//指令首字节
+#define CFG_CODE    1
+//指令操作数
+#define CFG_OPERAND 2
+//基本块起点
+#define CFG_LEADER  4
+
+/**
+ * 基本块: 只有第一条指令能被跳入, 只有最后一条指令会跳出
+ */
+struct CFG_Block {
+    Short Start;
+    //最后一条指令的地址
+    Short Last;
+    unsigned short Length;
+    unsigned short Instructions;
+    //不跳转、不跨页时的周期
+    unsigned int Min_Cycles;
+    //索引跨页、分支跳转(含跨页)时的周期
+    unsigned int Max_Cycles;
+    //最后一条指令的 OP_FLOW_xxx
+    Byte Flow;
+    Byte Succ_Count;
+    Short Succ[2];
+    //JSR 的目标, Flow == OP_FLOW_CALL 时有效
+    Short Call;
+    //间接跳转无法静态解析
+    Byte Unresolved;
+};
+
+//CFG_Routine.Max 没有上限, Min 为它时从入口到不了返回
+#define CFG_UNBOUNDED 0xFFFFFFFFu
+//CFG_Routine.Flags: 没有上限的原因
+//循环(回到入口的跳转算一次迭代的结束, 不算循环)
+#define CFG_LOOP      1
+//递归调用
+#define CFG_RECURSION 2
+//无法静态解析的间接跳转
+#define CFG_INDIRECT  4
+//到不了 RTS/RTI(也不回到入口)
+#define CFG_NO_RETURN 8
+
+/**
+ * 从一个入口执行到 RTS/RTI(或者跳回入口, 即循环的一次迭代)的周期范围, 含 JSR 调用的子程序
+ */
+struct CFG_Routine {
+    unsigned int Min;
+    unsigned int Max;
+    Byte Flags;
+    //0 没有计算, 1 计算中, 2 已计算
+    Byte State;
+};
+
+/**
+ * 从入口开始递归反汇编得到的控制流图
+ * Rom_Start-Rom_End 内的数据当作常量, 用来解析 JMP (a)
+ */
+struct CFG {
+    const Byte *Mem;
+    Short Rom_Start;
+    Short Rom_End;
+    Byte Mark[0x10000];
+    //按 Start 排序
+    struct CFG_Block *Blocks;
+    int Count;
+    int Cap;
+    //按块下标缓存的 CFG_Routine 结果, 第一次调用时分配
+    struct CFG_Routine *Routines;
+};
+
+void CFG_Init(struct CFG *cfg, const Byte *mem, Short rom_start, Short rom_end);
+
+void CFG_Build(struct CFG *cfg, const Short *entries, int count);
+
+int CFG_Vectors(const Byte *mem, Short *entries);
+
+int CFG_Find(const struct CFG *cfg, Short addr);
+
+/**
+ * 计算以 entry 开头的子程序的周期范围(最好/最坏情况), 结果缓存在 cfg 里
+ * @return NULL entry 不是块的起点
+ */
+const struct CFG_Routine *CFG_Routine(struct CFG *cfg, Short entry);
+
+void CFG_Export_Dot(const struct CFG *cfg, FILE *fp);
+
+void CFG_Free(struct CFG *cfg);
+
+//命令行入口, 导出给 cpu_6502 使用
+LIB6502_API int CFG_Main(int argc, char **argv);
+
+#endif
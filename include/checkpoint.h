@@ -0,0 +1,111 @@
+#ifndef CPU_6502_CHECKPOINT_H
+#define CPU_6502_CHECKPOINT_H
+
+#include <pthread.h>
+#include "cpu.h"
+#include "mapper.h"
+
+#define CHECKPOINT_VERSION 1
+
+//Checkpoint_Restore 的错误
+//文件打不开、格式或校验和不对
+#define CHECKPOINT_BAD_FILE  (-1)
+//文件不是从同一个镜像(或同一个 CPU 型号)开始的运行
+#define CHECKPOINT_BAD_BASE  (-2)
+
+/**
+ * 指令边界上的一致快照: 寄存器、64K 地址空间看到的内容、映射器状态
+ */
+struct Checkpoint_State {
+    Short PC;
+    Byte SP, A, X, Y;
+    Byte F_N, F_V, F_B, F_D, F_I, F_Z, F_C;
+    Byte Halted;
+    Byte IRQ_Line;
+    Byte NMI_Pending;
+    unsigned long long Cycles;
+    //不保存的页(映射器 bank 页, 由 Banks 恢复)
+    Byte Skip[256];
+    Byte Mem[0x10000];
+    unsigned int Banks[MAPPER_WINDOWS];
+    unsigned int Regs[8];
+    //映射器 RAM 的拷贝, 大小为 mapper->RAM_Size
+    Byte *RAM;
+};
+
+/**
+ * 周期性的检查点: 写入磁盘时不阻塞 CPU
+ * Checkpoint_Take 在 CPU 线程的指令边界上(两次执行之间)拷贝快照, 后台线程编码、写临时文件、
+ * fsync 之后改名, 所以磁盘上总是一个完整的检查点
+ * 只保存和基准(Checkpoint_Init 时总线的内容, 即加载的镜像)不同的部分, 恢复时先加载同一个镜像
+ * 文件格式(小端, 数字为 varint):
+ *   "6CKP" 版本(1) CPU型号(1) 基准哈希(8)
+ *   周期 PC(2) SP A X Y N V B D I Z C Halted IRQ_Line NMI_Pending
+ *   页数, 每页: 页号(1) 差异
+ *   窗口数 每个窗口的 bank, 映射器寄存器(8), RAM 页数, 每页: 页号 差异
+ *   FNV-1a 校验和(8)
+ *   差异: 直到 256 字节: 相同字节数(1) 不同字节数(1) 不同的字节
+ * 设备(I/O 回调)的状态由使用者自己保存
+ */
+struct Checkpoint {
+    struct CPU_Context *Cpu;
+    struct Mapper *Mapper;
+    char *Path;
+    unsigned long long Base_Hash;
+    Byte Base[0x10000];
+    //写入中的快照和编码结果
+    struct Checkpoint_State State;
+    Byte *Out;
+    size_t Out_Len;
+    size_t Out_Cap;
+    pthread_t Thread;
+    pthread_mutex_t Lock;
+    pthread_cond_t Cond;
+    //State 等待编码
+    Byte Pending;
+    //后台线程正在编码或写文件
+    Byte Writing;
+    Byte Stop;
+    //最近一次写入的结果, 0 成功
+    int Error;
+    //写完的检查点数, 上一个还在写时放弃的次数, 最近一个文件的大小
+    unsigned long long Written;
+    unsigned long long Skipped;
+    unsigned long long Bytes;
+};
+
+/**
+ * 以总线当前的内容为基准, 启动写入线程; 在加载镜像(和映射器)之后、执行之前调用
+ * @param ckpt
+ * @param cpu
+ * @param mapper 总线上的映射器, 没有时为 NULL
+ * @param path 检查点文件, 每次覆盖
+ * @return 0 成功
+ */
+int Checkpoint_Init(struct Checkpoint *ckpt, struct CPU_Context *cpu, struct Mapper *mapper, const char *path);
+
+/**
+ * 等待写完, 停止线程
+ */
+void Checkpoint_Free(struct Checkpoint *ckpt);
+
+/**
+ * 在 CPU 线程拷贝快照交给写入线程, CPU 不在执行(两次执行之间)时调用
+ * @return 0 已提交, 1 上一个检查点还在编码, 这次放弃, -1 CPU 挂起在指令中间
+ */
+int Checkpoint_Take(struct Checkpoint *ckpt);
+
+/**
+ * 等待已提交的检查点写完
+ * @return 最近一次写入的结果, 0 成功
+ */
+int Checkpoint_Wait(struct Checkpoint *ckpt);
+
+/**
+ * 把检查点恢复到 CPU 和总线上, 总线的内容必须还是基准(刚加载完镜像)
+ * 设备状态不在检查点里, 启动中的定时器随周期计数移动, 离触发的周期数不变
+ * @return 0 成功, CHECKPOINT_BAD_xxx
+ */
+int Checkpoint_Restore(struct Checkpoint *ckpt, const char *path);
+
+#endif
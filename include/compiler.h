@@ -1,3 +1,373 @@
+#ifndef CPU_6502_COMPILER_H
+#define CPU_6502_COMPILER_H
+
 #include <stdio.h>
+#include "cpu.h"
+#include "lib6502.h"
+
+//-------------汇编器-----------------
+// 源文件 -> 词法单元(按文件内容哈希缓存) -> 展开(.include/.macro/.rept/.if) -> 语句
+// -> 多遍计算地址(-> 优化, 再算地址) -> 输出镜像
+// 指令编码查 OP_Table, 和 CPU_VARIANT 一致
+
+//include/宏/.rept 的嵌套层数
+#define ASM_DEPTH 64
+//.if 的嵌套层数
+#define ASM_IF_DEPTH 64
+//宏参数个数
+#define ASM_PARAMS 16
+//-I 目录和 -D 定义的个数
+#define ASM_DIRS 16
+#define ASM_DEFINES 64
+
+//词法单元类型
+//行尾, 每个非空行以它结束
+#define ASM_TOK_EOL    0
+//标识符, 指令, 伪指令(以 . 开头), 宏参数(\name)
+#define ASM_TOK_IDENT  1
+#define ASM_TOK_NUMBER 2
+#define ASM_TOK_STRING 3
+//运算符和标点, Value 为字符, 两个字符的运算符为 ASM_OP2
+#define ASM_TOK_OP     4
+
+#define ASM_OP2(a, b) ((a) << 8 | (b))
+
+/**
+ * 词法单元, Text 指向文件的字符串池(字符串已去掉引号和转义, 数字为原文)
+ */
+struct ASM_Token {
+    Byte Type;
+    unsigned short Len;
+    int Line;
+    //NUMBER 的值, OP 的运算符
+    long Value;
+    const char *Text;
+};
+
+/**
+ * 读过的源文件, 在多次汇编之间保留, 内容哈希不变时不再做词法分析
+ */
+struct ASM_File {
+    char *Path;
+    unsigned long long Hash;
+    struct ASM_Token *Tokens;
+    int Count;
+    char *Pool;
+    struct ASM_File *Next;
+};
+
+//符号类型
+#define ASM_SYM_NONE  0
+#define ASM_SYM_LABEL 1
+#define ASM_SYM_EQU   2
+#define ASM_SYM_MACRO 3
+
+struct ASM_Symbol {
+    const char *Name;
+    unsigned short Len;
+    Byte Kind;
+    Byte Defined;
+    //最后一次定义它的遍数, 同一遍里定义两次为重复定义
+    int Pass;
+    long Value;
+    //定义的位置, 命令行定义时 File 为 NULL
+    const struct ASM_File *File;
+    int Line;
+};
+
+struct ASM_Macro {
+    const struct ASM_File *File;
+    int Param_Count;
+    const struct ASM_Token *Params[ASM_PARAMS];
+    struct ASM_Token *Body;
+    int Count;
+};
+
+/**
+ * 表达式节点, 在 Nodes 里用下标引用
+ */
+struct ASM_Node {
+    Byte Op;
+    int Left;
+    int Right;
+    //NUM 的值, SYM 的符号下标, BIN 的运算符
+    long Value;
+};
+
+//语句类型
+#define ASM_STMT_INS   0
+#define ASM_STMT_LABEL 1
+#define ASM_STMT_EQU   2
+#define ASM_STMT_ORG   3
+#define ASM_STMT_BYTE  4
+#define ASM_STMT_WORD  5
+#define ASM_STMT_DATA  6
+#define ASM_STMT_FILL  7
+//.assert_cycles, 在最后一遍之后检查
+#define ASM_STMT_ASSERT 8
+//被窥孔优化删掉的指令, 不占地址
+#define ASM_STMT_DROP  9
+//.test/.setup/.expect, 在最后一遍之后收集到 Tests/Checks
+#define ASM_STMT_TEST   10
+#define ASM_STMT_SETUP  11
+#define ASM_STMT_EXPECT 12
+
+//优化(--optimize)
+#define ASM_OPT_NONE  0
+//零页/绝对在地址确定后再选, 超出范围的分支改成反向分支 + JMP, 窥孔优化
+#define ASM_OPT_SIZE  1
+//再加上循环对齐: 向后的分支跨页时在前面跳不到的地方补字节, 让循环落在同一页
+#define ASM_OPT_SPEED 2
+//每处对齐最多补的字节数
+#define ASM_ALIGN_MAX 16
+
+/**
+ * 展开后的一条语句
+ * 指令的零页/绝对两种编码都存在时, 第一遍能算出操作数且小于 $100 时用零页, 否则用绝对(之后不再改变);
+ * 优化时先用零页, 哪一遍算出的操作数不是零页再换成绝对, 编码和分支只会变长, 所以多遍一定会收敛
+ */
+struct ASM_Stmt {
+    Byte Kind;
+    //指令: 零页编码和绝对编码, 没有的为 -1, 第一遍之后 Opcode 为选定的编码(优化时 Opcode_Abs 留到地址确定)
+    short Opcode;
+    short Opcode_Abs;
+    //分支超出范围, 输出为反向分支跳过一个 JMP(BRA 直接为 JMP)
+    Byte Long;
+    //对齐: 语句前面补的字节数
+    Byte Pad;
+    unsigned int Size;
+    Short Addr;
+    //操作数/值/数量, -1 表示没有
+    int Expr;
+    //BBR/BBS 的跳转目标, .fill 的填充值, .assert_cycles 的最多周期, .test 的周期上限, .setup/.expect 的值
+    int Expr2;
+    //.assert_cycles 的最少周期, -1 表示没有; .setup/.expect 内存的第几个字节
+    int Expr3;
+    //LABEL/EQU 的符号, .setup/.expect 的 ASM_CHECK_xxx
+    int Symbol;
+    //DATA 的内容, .test 的名字
+    const Byte *Data;
+    const struct ASM_File *File;
+    int Line;
+};
+
+//展开栈: 文件, 宏展开, .rept
+struct ASM_Frame {
+    const struct ASM_File *File;
+    const struct ASM_Token *Tokens;
+    int Count;
+    int Pos;
+    //Tokens 由这一帧分配
+    Byte Own;
+    //.rept 还要重复的次数
+    long Repeat;
+    int Cond_Depth;
+};
+
+struct ASM_Cond {
+    //当前分支有效
+    Byte Active;
+    //已经有分支有效过
+    Byte Taken;
+    //外层有效
+    Byte Parent;
+};
+
+//单元依赖的文件和内容哈希
+struct ASM_Dep {
+    char *Path;
+    unsigned long long Hash;
+};
+
+struct ASM_Mnemonic {
+    char Name[5];
+    short Opcode[16];
+};
+
+//.setup/.expect 的对象: 内存, 寄存器, 标志(0/1), 周期数(只能 .expect)
+#define ASM_CHECK_MEM    0
+#define ASM_CHECK_A      1
+#define ASM_CHECK_X      2
+#define ASM_CHECK_Y      3
+#define ASM_CHECK_SP     4
+#define ASM_CHECK_P      5
+#define ASM_CHECK_N      6
+#define ASM_CHECK_V      7
+#define ASM_CHECK_D      8
+#define ASM_CHECK_I      9
+#define ASM_CHECK_Z      10
+#define ASM_CHECK_C      11
+#define ASM_CHECK_CYCLES 12
+
+/**
+ * 测试的一个初始值或期望值, 内存为一个字节
+ */
+struct ASM_Check {
+    Byte Target;
+    //.expect 为 1, .setup 为 0
+    Byte Expect;
+    Short Addr;
+    unsigned long Value;
+    int Line;
+};
+
+/**
+ * .test "名字", 入口[, 周期上限]
+ * 之后的 .setup/.expect 属于它, 直到下一个 .test
+ * 字符串在单元内存里, 下一次汇编时释放
+ */
+struct ASM_Test {
+    const char *Name;
+    //定义所在的文件
+    const char *File;
+    int Line;
+    Short Entry;
+    //0 表示由运行器决定
+    unsigned long Max_Cycles;
+    //Checks 里的下标和个数
+    int First;
+    int Count;
+};
+
+struct ASM_Chunk;
+
+struct CFG;
+
+/**
+ * 汇编器: 一次汇编一个单元(顶层源文件), 文件的词法单元在单元之间共享
+ * Cache_Dir 非 NULL 时:
+ * - 词法单元按文件内容哈希存到 tok-<哈希>, 其它单元和以后的运行直接读取
+ * - 单元的输出和符号表存到 unit-<路径和选项的哈希>, 记录所有依赖文件的内容哈希,
+ *   依赖都没变时直接读出结果, 不再汇编
+ */
+struct Assembler {
+    //-------------选项-----------------
+    const char *Cache_Dir;
+    const char *Dirs[ASM_DIRS];
+    int Dir_Count;
+    const char *Define_Names[ASM_DEFINES];
+    long Define_Values[ASM_DEFINES];
+    int Define_Count;
+    //需要语句和周期分析(列表、--cycles), 不读单元缓存
+    Byte Analyze;
+    //ASM_OPT_xxx
+    Byte Optimize;
+    //-------------跨单元-----------------
+    struct ASM_File *Files;
+    struct ASM_Mnemonic Mnemonics[128];
+    int Mnemonic_Count;
+    short Mnemonic_Hash[256];
+    //-------------单元-----------------
+    struct ASM_Symbol *Symbols;
+    int Symbol_Count;
+    int Symbol_Cap;
+    //开放寻址, 存 Symbols 下标 + 1
+    int *Symbol_Hash;
+    int Hash_Cap;
+    struct ASM_Macro *Macros;
+    int Macro_Count;
+    int Macro_Cap;
+    struct ASM_Stmt *Stmts;
+    int Stmt_Count;
+    int Stmt_Cap;
+    struct ASM_Node *Nodes;
+    int Node_Count;
+    int Node_Cap;
+    struct ASM_Dep *Deps;
+    int Dep_Count;
+    int Dep_Cap;
+    struct ASM_Chunk *Chunks;
+    struct ASM_Frame Frames[ASM_DEPTH];
+    int Depth;
+    struct ASM_Cond Conds[ASM_IF_DEPTH];
+    int Cond_Depth;
+    //收集 .macro/.rept 的内容
+    Byte Collect;
+    int Collect_Nest;
+    int Collect_Macro;
+    long Collect_Repeat;
+    struct ASM_Token *Body;
+    int Body_Count;
+    int Body_Cap;
+    //\@ 的计数
+    unsigned int Unique;
+    int Pass;
+    Byte Final;
+    Byte Changed;
+    //报错位置
+    const struct ASM_File *Cur_File;
+    int Cur_Line;
+    int Errors;
+    //结果来自单元缓存
+    Byte Cached;
+    //优化删掉的指令数、对齐补的字节数
+    int Removed;
+    int Padding;
+    //周期分析: 有 .assert_cycles 或者 Analyze 时在最后一遍之后, 以每个指令前的标号为入口建立
+    struct CFG *Cfg;
+    //测试用例, 也存在单元缓存里
+    struct ASM_Test *Tests;
+    int Test_Count;
+    int Test_Cap;
+    struct ASM_Check *Checks;
+    int Check_Count;
+    int Check_Cap;
+    //-------------输出-----------------
+    Byte Image[0x10000];
+    //写过的字节
+    Byte Used[0x10000];
+};
+
+void ASM_Init(struct Assembler *as);
+
+void ASM_Free(struct Assembler *as);
+
+/**
+ * 命令行 -D, 每个单元开始时定义
+ */
+int ASM_Define(struct Assembler *as, const char *name, long value);
+
+/**
+ * 汇编一个单元, 结果在 Image/Used 和符号表里
+ * @return 错误数
+ */
+int ASM_Assemble(struct Assembler *as, const char *path);
+
+/**
+ * ASM_CHECK_xxx 的名字, 用于报告
+ */
+const char *ASM_Check_Name(int target);
+
+/**
+ * 查找符号
+ * @return 0 找到并且有定义
+ */
+int ASM_Lookup(const struct Assembler *as, const char *name, long *value);
+
+/**
+ * 按扩展名输出: .prg(带 2 字节装载地址), .hex/.ihx(Intel HEX), 其它为裸二进制
+ * 裸二进制和 .prg 从写过的最低地址到最高地址, 中间的空隙填 0
+ * @return 0 成功
+ */
+int ASM_Write(const struct Assembler *as, const char *path);
+
+/**
+ * 输出符号表, 每行 "名字 = $值"
+ */
+int ASM_Write_Symbols(const struct Assembler *as, const char *path);
+
+/**
+ * 输出列表: 每条语句所在的源代码行, 前面是地址、字节和指令的周期(有跨页或分支时为范围),
+ * 指令前的标号另起一行给出子程序的最少/最多周期; 需要 Analyze
+ */
+int ASM_Write_Listing(struct Assembler *as, const char *path);
+
+/**
+ * 打印每个子程序(指令前的标号)的最少/最多周期, 需要 Analyze
+ */
+void ASM_Print_Cycles(struct Assembler *as, FILE *fp);
+
+//命令行入口, 导出给 cpu_6502 使用
+LIB6502_API int ASM_Main(int argc, char **argv);
 
-void compile(FILE *fp);
\ No newline at end of file
+#endif
@@ -0,0 +1,222 @@
+#ifndef CPU_6502_CPU_H
+#define CPU_6502_CPU_H
+
+#include <stddef.h>
+#include "bus.h"
+
+//-------------CPU型号(编译期选择)-----------------
+// -DCPU_VARIANT=CPU_NMOS/CPU_65C02/CPU_2A03
+// 每个型号编译出各自的 CPU_Exec 分支表, 执行循环中没有任何型号判断
+#define CPU_NMOS  0
+#define CPU_65C02 1
+#define CPU_2A03  2
+
+#ifndef CPU_VARIANT
+#define CPU_VARIANT CPU_NMOS
+#endif
+
+//65C02: WDC 扩展指令, 修正后的 JMP (a), 十进制模式多一个周期且 N/Z 有效
+#define CPU_IS_CMOS (CPU_VARIANT == CPU_65C02)
+//2A03: NES 使用的 NMOS 核心, 去掉了十进制模式
+#define CPU_HAS_DECIMAL (CPU_VARIANT != CPU_2A03)
+
+//-------------指令融合(编译期选择)-----------------
+// -DCPU_FUSE=(FUSE_xxx|FUSE_yyy), 按热点循环的 profile 选择
+// 每种融合在 bench 里有对应的内核(sum, fill), 和 CPU_FUSE 为空的构建对比收益
+//LDA zp / CLC / ADC # / STA zp
+#define FUSE_LDA_ADC_STA 1
+//INY/INX + CPY #/CPX # + BNE
+#define FUSE_INY_CPY_BNE 2
+
+#ifndef CPU_FUSE
+#define CPU_FUSE (FUSE_LDA_ADC_STA | FUSE_INY_CPY_BNE)
+#endif
+
+//空转循环快进, -DCPU_IDLE_SKIP=0 关闭
+#ifndef CPU_IDLE_SKIP
+#define CPU_IDLE_SKIP 1
+#endif
+
+//计数(指令、周期、中断等, 见 metrics.h), -DCPU_METRICS=0 关闭
+#ifndef CPU_METRICS
+#define CPU_METRICS 1
+#endif
+
+//CPU.Halted
+#define CPU_RUN  0
+//JAM/STP 锁死, 只有复位可以恢复
+#define CPU_STOP 1
+//WAI 等待中断
+#define CPU_WAIT 2
+
+//停机指令, 执行后 Halted 为 CPU_STOP, PC 停在它上面; 用作子程序返回的落点
+#if CPU_IS_CMOS
+#define CPU_HALT_OPCODE 0xDB
+#else
+#define CPU_HALT_OPCODE 0x02
+#endif
+
+//CPU.Break
+#define CPU_BREAK_WATCH 1
+#define CPU_BREAK_YIELD 2
+
+//CPU_Slice 返回的原因
+//用完周期
+#define CPU_SLICE_BUDGET 0
+//设备挂起了 CPU, CPU_Resume 之前不会执行
+#define CPU_SLICE_IO     1
+//观察点或调试器
+#define CPU_SLICE_BREAK  2
+//设备要求让出
+#define CPU_SLICE_YIELD  3
+//JAM/STP 锁死
+#define CPU_SLICE_HALT   4
+//WAI 等待中断
+#define CPU_SLICE_WAIT   5
+
+//一条指令里最多记录的设备访问
+#define CPU_IO_LOG 8
+
+//CPU.Event_Cycle: 没有待处理的事件
+#define CPU_NO_EVENT 0xFFFFFFFFFFFFFFFFULL
+
+struct Replay;
+struct Metrics;
+struct Metrics_Shard;
+struct CPU_Context;
+
+/**
+ * 周期定时器: 多个设备共用 CPU 唯一的事件槽
+ * 按 Cycle 排序挂在 CPU.Timers 上, 事件槽总是设为最早的一个, 到期时在指令边界调用 Fire
+ * 定时器由设备持有, 不分配内存; 只能在执行该 CPU 的线程里启动和停止
+ */
+struct CPU_Timer {
+    unsigned long long Cycle;
+    //到期时调用, 已经从链表上摘下, 可以重新启动(Cycle 要在当前周期之后)
+    void (*Fire)(struct CPU_Timer *timer, struct CPU_Context *cpu);
+    void *Ctx;
+    struct CPU_Timer *Next;
+    Byte Armed;
+};
+
+/**
+ * 一个 CPU 上下文: 只有寄存器和状态
+ * 内存在 Bus 上, 通过页表访问, 多个上下文可以挂在同一个 Bus 上
+ * 前一个缓存行是每条指令都要用的热数据, 后面是事件/录制/挂起等冷数据,
+ * 上下文按缓存行对齐, 相邻的上下文(多实例、多线程)不共享缓存行
+ */
+struct CPU_Context {
+    //-------------热数据(一个缓存行)-----------------
+    _Alignas(BUS_CACHE_LINE) Short PC;
+    Byte SP;
+    Byte A, X, Y;
+    Byte F_N;
+    Byte F_V;
+    Byte F_B;
+    Byte F_D;
+    Byte F_I;
+    Byte F_Z;
+    Byte F_C;
+    Byte INS_Cycles;
+    Byte Halted;
+    //IRQ 电平, 每个中断源占一位
+    Byte IRQ_Line;
+    //NMI 边沿锁存
+    Byte NMI_Pending;
+    //非 0 时 CPU_Run 在当前指令结束后返回, CPU_BREAK_xxx
+    Byte Break;
+    //下一条指令是重新执行的挂起指令, 执行完之前不响应中断
+    Byte Retry;
+    //当前指令开始时的 PC/SP, 挂起时回到这里
+    Short Start_PC;
+    Byte Start_SP;
+    //累计周期数
+    unsigned long long Cycles;
+    //CPU_Run 执行到 Run_Limit 为止(min(批次结束, Event_Cycle))
+    unsigned long long Run_Limit;
+    //到达 Event_Cycle 时在指令边界调用 On_Event
+    unsigned long long Event_Cycle;
+    struct Bus *Bus;
+    //非 NULL 时记录跳转边覆盖, 64K 计数表
+    Byte *Coverage;
+    //-------------冷数据-----------------
+    _Alignas(BUS_CACHE_LINE) void (*On_Event)(struct CPU_Context *cpu);
+    void *Event_Ctx;
+    //启动中的定时器, 按周期排序, 见 CPU_Timer_Start
+    struct CPU_Timer *Timers;
+    //非 NULL 时记录 I/O 读取和中断
+    struct Replay *Recorder;
+    //-------------挂起-----------------
+    // 设备在总线周期里调用 CPU_Suspend: 这条指令剩下的访问转到空总线, 指令结束后回到指令开始,
+    // CPU_Resume 之后重新执行, 已经完成的设备访问按 IO_Log 重放, 所以每个设备访问只发生一次
+    Byte Suspended;
+    //中断响应和 BRK 过程中不能挂起
+    Byte Atomic;
+    //挂起前的总线
+    struct Bus *Suspend_Bus;
+    //IO_Cycles 时开始的指令的设备访问记录, 和第一次设备访问时的寄存器
+    unsigned long long IO_Cycles;
+    Byte IO_Log[CPU_IO_LOG];
+    Byte IO_Count;
+    Byte IO_Replay;
+    struct {
+        Byte A, X, Y, F_N, F_V, F_D, F_I, F_Z, F_C;
+    } IO_Saved;
+    //-------------计数-----------------
+    //非 NULL 时计数, 见 Metrics_Attach
+    struct Metrics *Metrics;
+    //执行它的线程的分片, CPU_Run/CPU_Step 开始时取得
+    struct Metrics_Shard *Shard;
+    //CPU_Exec 没有执行指令就返回的次数(响应中断、执行观察点停下), 从分派次数里减掉
+    unsigned long long Empty_Dispatch;
+};
+
+_Static_assert(offsetof(struct CPU_Context, On_Event) == BUS_CACHE_LINE, "CPU_Context hot fields exceed one cache line");
+
+//当前线程正在执行的上下文, 核心代码通过 CPU.xxx 访问
+extern _Thread_local struct CPU_Context *CPU_Current;
+#define CPU (*CPU_Current)
+
+void CPU_Init(struct CPU_Context *cpu, struct Bus *bus);
+
+void CPU_Select(struct CPU_Context *cpu);
+
+void CPU_Reset(Short PCAddr);
+
+Byte CPU_Read_Addr(Short addr);
+
+Byte CPU_Write_Addr(Short addr, Byte value);
+
+void CPU_Cover_Edge(Short from, Short to);
+
+void CPU_Break(Byte reason);
+
+int CPU_Suspend(struct CPU_Context *cpu);
+
+void CPU_Resume(struct CPU_Context *cpu);
+
+void CPU_Yield(struct CPU_Context *cpu);
+
+void CPU_Exec();
+
+void CPU_Interrupt(Byte nmi);
+
+void CPU_Set_IRQ(struct CPU_Context *cpu, Byte source, Byte level);
+
+void CPU_NMI(struct CPU_Context *cpu);
+
+void CPU_Schedule(struct CPU_Context *cpu, unsigned long long cycle);
+
+void CPU_Timer_Start(struct CPU_Context *cpu, struct CPU_Timer *timer, unsigned long long cycle);
+
+void CPU_Timer_Stop(struct CPU_Context *cpu, struct CPU_Timer *timer);
+
+void CPU_Set_Cycles(struct CPU_Context *cpu, unsigned long long cycles);
+
+unsigned long long CPU_Run(unsigned long long cycles);
+
+void CPU_Step();
+
+int CPU_Slice(unsigned long long cycles, unsigned long long *ran);
+
+#endif
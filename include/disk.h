@@ -0,0 +1,65 @@
+#ifndef CPU_6502_DISK_H
+#define CPU_6502_DISK_H
+
+#include <stddef.h>
+#include "bus.h"
+
+#define DISK_SECTOR 512
+
+//寄存器(地址低 3 位, 整页内重复)
+//0-2: 扇区号(LBA), 低字节在前
+#define DISK_LBA     0
+//写: DISK_CMD_xxx; 读: DISK_ST_xxx
+#define DISK_COMMAND 3
+//4-6: 扇区总数(只读)
+#define DISK_COUNT   4
+
+//把 LBA 扇区映射到窗口
+#define DISK_CMD_MAP   1
+//把改动写回文件(msync)
+#define DISK_CMD_FLUSH 2
+//LBA 加 1 再映射, 顺序读写时不用每次写扇区号
+#define DISK_CMD_NEXT  3
+
+//窗口里是 LBA 扇区
+#define DISK_ST_MAPPED    0x01
+#define DISK_ST_READ_ONLY 0x40
+//LBA 超出扇区数或 msync 失败, 下一个命令清除
+#define DISK_ST_ERROR     0x80
+
+/**
+ * 主机文件做的块设备: 整个文件 mmap(MAP_SHARED), 窗口(两页)直接指向当前扇区,
+ * CPU 对窗口的读写就是对文件页缓存的读写, 没有拷贝, 也不需要传输周期和事件;
+ * 切换扇区只改两个页表指针
+ * 窗口所在的页属于设备, 原来的内存内容不保留
+ */
+struct Disk {
+    struct Bus *Bus;
+    struct Bus_Device Device;
+    Byte *Data;
+    size_t Size;
+    unsigned long Sectors;
+    Short Window;
+    int Read_Only;
+    Byte LBA[3];
+    Byte Status;
+};
+
+/**
+ * 映射文件并把 0 号扇区放进窗口; 寄存器页由调用方映射到 disk->Device
+ * @param window 页对齐, 占 DISK_SECTOR 字节
+ * @param read_only 非 0 时 CPU 对窗口的写入被丢弃
+ * @return 0 成功, -1 打不开或者不满一个扇区
+ */
+int Disk_Open(struct Disk *disk, struct Bus *bus, const char *path, Short window, int read_only);
+
+/**
+ * 写回改动, 取消窗口的映射
+ */
+void Disk_Close(struct Disk *disk);
+
+Byte Disk_Read(void *ctx, Short addr);
+
+void Disk_Write(void *ctx, Short addr, Byte value);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CPU_6502_FUZZ_H
+#define CPU_6502_FUZZ_H
+
+#include "cpu.h"
+#include "lib6502.h"
+
+//AFL 共享内存覆盖表大小
+#define FUZZ_MAP_SIZE 65536
+//持久模式下一个进程执行的输入数, 之后 AFL 重新 fork
+#define FUZZ_PERSIST 10000
+
+//Fuzz_Exec 结果
+#define FUZZ_OK    0
+#define FUZZ_HANG  1
+#define FUZZ_CRASH 2
+
+/**
+ * 模糊测试: 输入映射到一段内存, 从 Entry 以子程序方式调用,
+ * 返回到 Exit(放了一条停机指令)算正常结束, 其它地方停机算崩溃, 超过周期上限算挂起
+ * 每次执行前只恢复上一次写脏的页
+ */
+struct Fuzz {
+    struct CPU_Context *Cpu;
+    Short Entry;
+    Short Exit;
+    //输入放在 Input_Addr 开始的 Input_Size 字节
+    Short Input_Addr;
+    Short Input_Size;
+    //非 0 时把输入长度(16位小端)写到这里
+    Short Length_Addr;
+    unsigned long long Cycle_Cap;
+    //覆盖表, FUZZ_MAP_SIZE 字节
+    Byte *Map;
+    //Fuzz_Init 时的状态
+    struct CPU_Context Initial;
+    Byte Snapshot[0x10000];
+};
+
+void Fuzz_Init(struct Fuzz *fuzz);
+
+int Fuzz_Exec(struct Fuzz *fuzz, const Byte *data, unsigned int size);
+
+//命令行入口, 导出给 cpu_6502 使用
+LIB6502_API int Fuzz_Main(int argc, char **argv);
+
+#endif
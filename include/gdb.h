@@ -0,0 +1,62 @@
+#ifndef CPU_6502_GDB_H
+#define CPU_6502_GDB_H
+
+#include "cpu.h"
+#include "watch.h"
+
+#define GDB_PACKET_SIZE 4096
+
+/**
+ * 调试器设置的断点/观察点, 对应 Watch 里的一个观察点
+ */
+struct GDB_Break {
+    Byte Used;
+    //Z 包的类型 0-4
+    Byte Type;
+    Short Addr;
+    Short Len;
+    int Id;
+};
+
+/**
+ * GDB 远程串行协议(RSP)服务端, 监听本机 TCP 端口或 Unix 套接字, 同时只接受一个调试器
+ * 不开线程: 运行循环在每个批次结束时调用 GDB_Poll, 没有连接和请求时只有一次非阻塞 poll
+ * CPU 停下时 GDB_Poll 阻塞处理调试器的命令, 直到继续执行或断开
+ * 寄存器顺序: a x y p sp (各 8 位) pc (16 位), 通过 target.xml 告诉调试器
+ * 断点和观察点用 Watch 实现, 只有它们所在的页变慢
+ */
+struct GDB_Server {
+    int Listen_Fd;
+    int Fd;
+    struct CPU_Context *Cpu;
+    struct Watch *Watch;
+    //调试器让 CPU 继续执行中
+    Byte Running;
+    Byte No_Ack;
+    struct GDB_Break Breaks[WATCH_MAX];
+    char Packet[GDB_PACKET_SIZE];
+};
+
+/**
+ * 开始监听
+ * @param server
+ * @param address "unix:路径", "端口" 或 "主机:端口" (默认 127.0.0.1)
+ * @param cpu 被调试的 CPU
+ * @param watch CPU 所在总线的观察点, 用来设置断点
+ * @return 0 成功, -1 失败
+ */
+int GDB_Listen(struct GDB_Server *server, const char *address, struct CPU_Context *cpu, struct Watch *watch);
+
+/**
+ * 断开调试器, 删除它设置的断点, 停止监听
+ */
+void GDB_Close(struct GDB_Server *server);
+
+/**
+ * 在批次边界调用: 接受连接, 报告断点命中, 响应中断请求(^C)
+ * CPU 停下时在这里处理调试器命令, 直到继续执行或断开
+ * @return 1 有调试器连接
+ */
+int GDB_Poll(struct GDB_Server *server);
+
+#endif
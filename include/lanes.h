@@ -0,0 +1,79 @@
+#ifndef CPU_6502_LANES_H
+#define CPU_6502_LANES_H
+
+#include "cpu.h"
+
+//最多同时执行的实例数
+#define LANES_MAX 64
+
+/**
+ * 多实例同步执行: 多个 CPU 跑同一段程序, 每个实例有自己的 64K 内存(输入数据不同)
+ * 寄存器和标志按 SoA 存放, 内存按地址交错存放(同一地址的所有实例连续),
+ * PC 相同的实例一起执行一条指令, 每条指令的按实例循环可以被编译器向量化(-O3 -march=native)
+ * PC 分叉后先执行 PC 最小的一组, 循环结束后自然重新汇合
+ * 不支持的指令和十进制运算逐个实例交给 CPU_Exec (通过映射到交错内存的设备)
+ * 结果(寄存器、内存、周期)和每个实例单独 CPU_Run 相同; 实例只有内存, 没有 I/O 和中断
+ */
+struct Lanes {
+    int Count;
+    //地址 addr 的第 i 个实例在 Mem[addr * Count + i]
+    Byte *Mem;
+    Short PC[LANES_MAX];
+    Byte SP[LANES_MAX];
+    Byte A[LANES_MAX];
+    Byte X[LANES_MAX];
+    Byte Y[LANES_MAX];
+    Byte F_N[LANES_MAX];
+    Byte F_V[LANES_MAX];
+    Byte F_D[LANES_MAX];
+    Byte F_I[LANES_MAX];
+    Byte F_Z[LANES_MAX];
+    Byte F_C[LANES_MAX];
+    Byte Halted[LANES_MAX];
+    unsigned long long Cycles[LANES_MAX];
+    //逐个实例执行时 CPU_Exec 使用的总线, 所有页都映射到 Device, 访问第 Scalar_Lane 个实例
+    struct Bus *Scalar_Bus;
+    struct Bus_Device Device;
+    int Scalar_Lane;
+    //统计: 按组执行的指令数, 逐个实例执行的指令数
+    unsigned long long Vector_Ops;
+    unsigned long long Scalar_Ops;
+};
+
+/**
+ * 分配内存(清零)并复位
+ * @param count 不超过 LANES_MAX
+ * @return 0 成功, -1 内存不足
+ */
+int Lanes_Init(struct Lanes *lanes, int count);
+
+void Lanes_Free(struct Lanes *lanes);
+
+void Lanes_Reset(struct Lanes *lanes, Short pc);
+
+/**
+ * 写入一个实例的内存
+ * @param lane 小于 0 时写入所有实例
+ */
+void Lanes_Load(struct Lanes *lanes, int lane, Short addr, const Byte *data, unsigned int size);
+
+Byte Lanes_Peek(const struct Lanes *lanes, int lane, Short addr);
+
+void Lanes_Poke(struct Lanes *lanes, int lane, Short addr, Byte value);
+
+/**
+ * 取出一个实例的寄存器
+ */
+void Lanes_Get(const struct Lanes *lanes, int lane, struct CPU_Context *cpu);
+
+/**
+ * 写回一个实例的寄存器
+ */
+void Lanes_Set(struct Lanes *lanes, int lane, const struct CPU_Context *cpu);
+
+/**
+ * 每个实例执行到至少经过 cycles 个周期或锁死(JAM/STP)
+ */
+void Lanes_Run(struct Lanes *lanes, unsigned long long cycles);
+
+#endif
@@ -0,0 +1,540 @@
+#ifndef LIB6502_H
+#define LIB6502_H
+
+/**
+ * lib6502: 嵌入用的 C 接口
+ * 只通过不透明句柄访问, 内部结构(CPU_Context/Bus)的变化不影响调用方
+ * 一个句柄 = 一个 CPU + 一条 64K 总线, 同一个句柄不能同时在多个线程里使用
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(LIB6502_SHARED)
+#ifdef LIB6502_BUILD
+#define LIB6502_API __declspec(dllexport)
+#else
+#define LIB6502_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define LIB6502_API __attribute__((visibility("default")))
+#else
+#define LIB6502_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//接口版本, 不兼容的修改时递增
+#define LIB6502_VERSION 1
+
+//Lib6502_Variant
+#define LIB6502_NMOS  0
+#define LIB6502_65C02 1
+#define LIB6502_2A03  2
+
+//Lib6502_Regs.P 的标志位
+#define LIB6502_F_C 0x01
+#define LIB6502_F_Z 0x02
+#define LIB6502_F_I 0x04
+#define LIB6502_F_D 0x08
+#define LIB6502_F_V 0x40
+#define LIB6502_F_N 0x80
+
+//Lib6502_Regs.Halted
+#define LIB6502_RUN  0
+#define LIB6502_STOP 1
+#define LIB6502_WAIT 2
+
+//Lib6502_Watch 的访问类型, 可以组合
+#define LIB6502_WATCH_READ  1
+#define LIB6502_WATCH_WRITE 2
+#define LIB6502_WATCH_EXEC  4
+
+//Lib6502_Step_Async 返回的原因
+//用完周期预算
+#define LIB6502_BUDGET  0
+//设备回调挂起了 CPU, Lib6502_Resume 之前不会执行
+#define LIB6502_IO_WAIT 1
+//观察点或调试器
+#define LIB6502_BREAK   2
+//设备回调调用了 Lib6502_Yield
+#define LIB6502_YIELD   3
+//JAM/STP 锁死
+#define LIB6502_HALT    4
+//WAI 等待中断
+#define LIB6502_IDLE    5
+
+typedef struct Lib6502 Lib6502;
+
+typedef struct Lib6502_Image Lib6502_Image;
+
+typedef struct Lib6502_Pool Lib6502_Pool;
+
+typedef struct Lib6502_Checkpoint Lib6502_Checkpoint;
+
+typedef struct Lib6502_Replay Lib6502_Replay;
+
+typedef struct Lib6502_Lanes Lib6502_Lanes;
+
+/**
+ * 寄存器快照
+ */
+typedef struct Lib6502_Regs {
+    uint16_t PC;
+    uint8_t SP, A, X, Y;
+    //N V - B D I Z C, 读取时 bit5 为 1, B 为 0
+    uint8_t P;
+    uint8_t Halted;
+    uint64_t Cycles;
+} Lib6502_Regs;
+
+/**
+ * 页共享的统计, 页为 256 字节
+ */
+typedef struct Lib6502_Pool_Stats {
+    //池里不同内容的页, 指向它们的句柄页
+    uint64_t Pages, Refs;
+    //池占用的内存, 共享省下的内存
+    uint64_t Pool_Bytes, Saved_Bytes;
+    //累计: 还原成没写过的全 0 页, 写入时拆开的共享页, 还给系统的内存
+    uint64_t Zero_Pages, Splits, Released_Bytes;
+} Lib6502_Pool_Stats;
+
+/**
+ * 多实例同步执行的统计
+ */
+typedef struct Lib6502_Lanes_Stats {
+    //按组执行的指令数, 逐个实例交给 CPU 核心执行的指令数
+    uint64_t Vector_Ops, Scalar_Ops;
+} Lib6502_Lanes_Stats;
+
+/**
+ * 实时执行的统计, 时间为纳秒
+ */
+typedef struct Lib6502_Pace_Stats {
+    uint64_t Batches, Cycles;
+    //批次执行完时已经晚于实际时间, 落后太多放弃追赶
+    uint64_t Overruns, Resyncs;
+    //睡眠醒来相对截止时间的误差: 平均、最大
+    uint64_t Jitter_Avg, Jitter_Max;
+    //执行和等待的总时间
+    uint64_t Busy, Sleep;
+    //最近一批结束时实际时间比模拟时间慢多少, 负数为超前
+    int64_t Drift;
+} Lib6502_Pace_Stats;
+
+/**
+ * 计数, 指令和周期在每次执行返回时更新
+ */
+typedef struct Lib6502_Metrics {
+    //融合执行、空转快进的每条指令都计入
+    uint64_t Instructions, Cycles;
+    //响应的 IRQ/NMI
+    uint64_t Interrupts;
+    //融合执行的指令组, 空转循环快进跳过的周期
+    uint64_t Fused, Idle_Cycles;
+    //第一次写入还没有自己内存的页(清零或拷贝共享页), 观察点命中
+    uint64_t Page_Faults, Watch_Hits;
+    //执行的次数
+    uint64_t Runs;
+} Lib6502_Metrics;
+
+/**
+ * 总线读写回调, 按 256 字节页挂载
+ */
+typedef uint8_t (*Lib6502_Read_Fn)(void *ctx, uint16_t addr);
+
+typedef void (*Lib6502_Write_Fn)(void *ctx, uint16_t addr, uint8_t value);
+
+/**
+ * 观察点命中回调, 读/写为访问的值, 执行为操作码
+ * @return 非 0 时让 Lib6502_Run_Cycles 返回
+ */
+typedef int (*Lib6502_Watch_Fn)(void *ctx, uint16_t addr, uint8_t value, int kind);
+
+/**
+ * @return 编译时的 LIB6502_VERSION
+ */
+LIB6502_API int Lib6502_Version(void);
+
+/**
+ * @return 库编译时选择的 CPU 型号 LIB6502_NMOS/65C02/2A03
+ */
+LIB6502_API int Lib6502_Variant(void);
+
+/**
+ * 创建一个 CPU, 内存清零, 没有映射设备
+ * @return 内存不足时为 NULL
+ */
+LIB6502_API Lib6502 *Lib6502_Create(void);
+
+LIB6502_API void Lib6502_Destroy(Lib6502 *emu);
+
+/**
+ * 复位, PC 取 0xFFFC 处的复位向量
+ */
+LIB6502_API void Lib6502_Reset(Lib6502 *emu);
+
+/**
+ * 把数据写入内存(不经过设备), 超出 0xFFFF 的部分被截掉
+ * @return 实际写入的字节数
+ */
+LIB6502_API size_t Lib6502_Load(Lib6502 *emu, uint16_t addr, const void *data, size_t size);
+
+/**
+ * 把只读数据映射到 [addr, addr + size), 完整的页直接引用 data 不拷贝,
+ * data 在句柄销毁或重新映射之前必须有效; CPU 写入这些页被丢弃
+ */
+LIB6502_API void Lib6502_Map_ROM(Lib6502 *emu, uint16_t addr, const void *data, size_t size);
+
+/**
+ * 打开程序映像(mmap), 格式按文件头和扩展名判断:
+ * iNES(.nes)、Atari(.xex)、Intel HEX(.hex/.ihx)、C64(.prg), 其它按裸二进制装到 addr
+ * 同一个映像可以映射到多个句柄, 共享同一份只读页
+ * @return 打不开或格式错误时为 NULL
+ */
+LIB6502_API Lib6502_Image *Lib6502_Image_Open(const char *path, uint16_t addr);
+
+/**
+ * 映射过这个映像的句柄都销毁之后才能关闭
+ */
+LIB6502_API void Lib6502_Image_Close(Lib6502_Image *image);
+
+/**
+ * @return 映像里记录的入口地址, 没有时为 -1
+ */
+LIB6502_API int Lib6502_Image_Entry(const Lib6502_Image *image);
+
+/**
+ * 把映像映射到句柄
+ * @param rom 非 0 时只读映射, 否则拷贝到内存
+ */
+LIB6502_API void Lib6502_Map_Image(Lib6502 *emu, const Lib6502_Image *image, int rom);
+
+/**
+ * @return iNES 映像头里的映射器号, 其它格式为 -1
+ */
+LIB6502_API int Lib6502_Image_Mapper(const Lib6502_Image *image);
+
+/**
+ * 挂上 bank 映射器, 替换之前的映射器; spec 为 NULL 时只摘下
+ * 写控制寄存器切换 bank 时只改页表指针, 不拷贝数据
+ * @param spec 类型名("nrom" "mmc1" "uxrom" "axrom" 或 "#iNES号")和/或窗口
+ *             BASE/SIZE[=BANK][@CTRL[-END]][:ram], 逗号分隔, 可以加 ram=大小,
+ *             例如 "8000/16k@8000-bfff,c000/16k=-1"
+ * @param rom 全部 bank 的数据, 在句柄销毁或重新映射之前必须有效
+ * @return 0 成功, -1 配置错误
+ */
+LIB6502_API int Lib6502_Set_Mapper(Lib6502 *emu, const char *spec, const void *rom, size_t size);
+
+/**
+ * 用映像里的完整 ROM(iNES 的 PRG ROM, 裸二进制的整个文件)挂上映射器
+ * @param spec 为 NULL 时按 iNES 头里的映射器号
+ * @return 0 成功, -1 映像没有 bank 数据或配置错误
+ */
+LIB6502_API int Lib6502_Map_Image_Banks(Lib6502 *emu, const Lib6502_Image *image, const char *spec);
+
+/**
+ * 直接读写内存(不经过设备, 不计周期), 只读页也可以写入
+ */
+LIB6502_API uint8_t Lib6502_Peek(const Lib6502 *emu, uint16_t addr);
+
+LIB6502_API void Lib6502_Poke(Lib6502 *emu, uint16_t addr, uint8_t value);
+
+/**
+ * 执行到至少经过 cycles 个周期, CPU 锁死(JAM/STP)或者观察点让它停下时提前返回
+ * @return 实际执行的周期数
+ */
+LIB6502_API uint64_t Lib6502_Run_Cycles(Lib6502 *emu, uint64_t cycles);
+
+/**
+ * 执行一条指令(或响应一个中断)
+ * @return 用掉的周期数
+ */
+LIB6502_API unsigned int Lib6502_Step(Lib6502 *emu);
+
+/**
+ * 设置 Lib6502_Run_Realtime 的时钟频率和倍速, hz 或 speed 为 0 时不限速
+ * @param hz 例如 1000000, 1789773 (NES), 2000000
+ * @param speed 1 为实际速度
+ */
+LIB6502_API void Lib6502_Set_Clock(Lib6502 *emu, double hz, double speed);
+
+/**
+ * 和 Lib6502_Run_Cycles 一样, 但按 Lib6502_Set_Clock 的频率和实际时间同步:
+ * 每批执行 1ms 的周期, 睡到这一批的截止时间; 截止时间按累计周期计算, 不累积漂移
+ */
+LIB6502_API uint64_t Lib6502_Run_Realtime(Lib6502 *emu, uint64_t cycles);
+
+LIB6502_API void Lib6502_Get_Pace_Stats(const Lib6502 *emu, Lib6502_Pace_Stats *stats);
+
+/**
+ * 协作式时间片: 最多执行 budget 个周期, 返回停下的原因
+ * 不检查调试器, 适合在事件循环或协程里轮转多个句柄
+ * @param ran 非 NULL 时写入实际执行的周期数
+ * @return LIB6502_BUDGET/IO_WAIT/BREAK/YIELD/HALT/IDLE
+ */
+LIB6502_API int Lib6502_Step_Async(Lib6502 *emu, uint64_t budget, uint64_t *ran);
+
+/**
+ * 在设备读写回调里调用: 在这个总线周期挂起 CPU, Lib6502_Step_Async 返回 LIB6502_IO_WAIT,
+ * PC 仍指向这条指令. Lib6502_Resume 后重新执行这条指令, 挂起它的访问再次调用回调,
+ * 之前已经完成的设备访问不会重复调用
+ * 回调的返回值(读)在挂起时被忽略
+ * @return 0 不能挂起(中断响应过程中), 访问照常完成
+ */
+LIB6502_API int Lib6502_Suspend(Lib6502 *emu);
+
+/**
+ * 恢复挂起的句柄, 在两次执行之间调用, 下一次执行时生效
+ */
+LIB6502_API void Lib6502_Resume(Lib6502 *emu);
+
+/**
+ * 在设备回调里调用: 这条指令结束后 Lib6502_Step_Async 返回 LIB6502_YIELD
+ */
+LIB6502_API void Lib6502_Yield(Lib6502 *emu);
+
+LIB6502_API void Lib6502_Get_Regs(const Lib6502 *emu, Lib6502_Regs *regs);
+
+/**
+ * 设置寄存器, Halted 非 0 时同时设置停机状态
+ * 改变 Cycles 时已经启动的定时器(串口收发)一起平移, 离触发还差的周期数不变
+ */
+LIB6502_API void Lib6502_Set_Regs(Lib6502 *emu, const Lib6502_Regs *regs);
+
+/**
+ * 把 [start, end] 所在的页映射到回调, 覆盖之前的映射
+ * read/write 为 NULL 时读返回 0xFF, 写被丢弃
+ * @return 0 成功, -1 映射的设备过多
+ */
+LIB6502_API int Lib6502_Map_IO(Lib6502 *emu, uint16_t start, uint16_t end,
+                               Lib6502_Read_Fn read, Lib6502_Write_Fn write, void *ctx);
+
+/**
+ * 取消 [start, end] 所在页的映射, 恢复为内存
+ */
+LIB6502_API void Lib6502_Unmap_IO(Lib6502 *emu, uint16_t start, uint16_t end);
+
+/**
+ * 在 [start, end] 上设置观察点, 只有覆盖到的页上的访问会变慢
+ * 取指令的操作数不算读
+ * @param kinds LIB6502_WATCH_xxx 的组合
+ * @param cond 值的条件: "== 0x42"、"& 0x80 != 0"、"< 10"、"changed"(写入的值不同), NULL 表示总是命中
+ * @param hit 为 NULL 或者返回非 0 时, Lib6502_Run_Cycles 在这条指令结束后返回;
+ *            执行观察点在指令执行之前返回, 再次执行时从这条指令继续
+ * @return 编号, -1 表示条件格式错误或者观察点过多
+ */
+LIB6502_API int Lib6502_Watch(Lib6502 *emu, uint16_t start, uint16_t end, int kinds, const char *cond,
+                              Lib6502_Watch_Fn hit, void *ctx);
+
+LIB6502_API void Lib6502_Unwatch(Lib6502 *emu, int id);
+
+/**
+ * 在本机套接字上启动 GDB 远程调试服务, 同时只接受一个调试器
+ * 每次 Lib6502_Run_Cycles 返回前检查调试器的请求(连接、^C、断点命中),
+ * CPU 停下期间 Lib6502_Run_Cycles 阻塞, 直到调试器让它继续或者断开
+ * @param address "unix:路径", "端口" 或 "主机:端口" (默认 127.0.0.1)
+ * @return 0 成功, -1 失败
+ */
+LIB6502_API int Lib6502_Debug_Listen(Lib6502 *emu, const char *address);
+
+/**
+ * 创建页共享池, 可以被多个线程里的句柄共用
+ */
+LIB6502_API Lib6502_Pool *Lib6502_Pool_Create(void);
+
+/**
+ * 共享过页的句柄都销毁之后才能销毁
+ */
+LIB6502_API void Lib6502_Pool_Destroy(Lib6502_Pool *pool);
+
+/**
+ * 把句柄里和池中内容相同的内存页换成共享页(写时复制), 全 0 页还原成不占内存的页,
+ * 不再使用的内存还给系统; 适合在大量句柄装好相同的程序之后调用, 之后可以再次调用
+ * 调用期间句柄不能在执行; 一个句柄只能用一个池
+ * @return 换掉的页数
+ */
+LIB6502_API int Lib6502_Share(Lib6502 *emu, Lib6502_Pool *pool);
+
+LIB6502_API void Lib6502_Pool_Get_Stats(Lib6502_Pool *pool, Lib6502_Pool_Stats *stats);
+
+//Lib6502_Checkpoint_Restore 的错误: 文件损坏, 不是同一个镜像(或 CPU 型号)的检查点
+#define LIB6502_CHECKPOINT_BAD_FILE (-1)
+#define LIB6502_CHECKPOINT_BAD_BASE (-2)
+
+/**
+ * 检查点: 以句柄当前的内存(加载好的镜像和映射器)为基准, 只保存之后改变的页
+ * 在加载镜像之后、执行之前创建; 每次保存覆盖 path, 崩溃时 path 仍然是上一个完整的检查点
+ * 文件和主机无关, 可以在另一台机器上加载同一个镜像后恢复, 之后的执行逐周期一致
+ * 设备回调的状态不在检查点里; 块设备的窗口写在主机文件上, 串口的状态和定时器也不在检查点里,
+ * 挂着块设备或串口时不能创建检查点
+ * @return NULL 失败, 或者挂着块设备、串口
+ */
+LIB6502_API Lib6502_Checkpoint *Lib6502_Checkpoint_Create(Lib6502 *emu, const char *path);
+
+/**
+ * 等待还在写的检查点, 在句柄销毁之前调用
+ */
+LIB6502_API void Lib6502_Checkpoint_Destroy(Lib6502_Checkpoint *ckpt);
+
+/**
+ * 在两次执行之间拷贝快照, 编码和写文件在后台线程进行, 不阻塞执行
+ * @return 0 已提交, 1 上一个检查点还没编码完, 这次放弃, -1 CPU 挂起在指令中间
+ */
+LIB6502_API int Lib6502_Checkpoint_Save(Lib6502_Checkpoint *ckpt);
+
+/**
+ * 等待已提交的检查点写到磁盘
+ * @return 0 成功
+ */
+LIB6502_API int Lib6502_Checkpoint_Wait(Lib6502_Checkpoint *ckpt);
+
+/**
+ * 恢复检查点, 句柄的内存必须还是创建检查点时的基准
+ * @return 0 成功, LIB6502_CHECKPOINT_BAD_xxx
+ */
+LIB6502_API int Lib6502_Checkpoint_Restore(Lib6502_Checkpoint *ckpt, const char *path);
+
+/**
+ * 开始录制外部输入: 之后设备读到的值和中断(IRQ/NMI/WAI 唤醒)按周期写进 path, 直到 Lib6502_Replay_Close
+ * 在挂好设备、设置好寄存器之后开始执行之前调用; 映射到窗口的内存(块设备)不录制
+ * @return NULL 打不开文件
+ */
+LIB6502_API Lib6502_Replay *Lib6502_Record_Start(Lib6502 *emu, const char *path);
+
+/**
+ * 离线回放录制的日志: 日志里的 I/O 页换成回放设备, 中断按录制时的周期注入, 周期计数设为开始录制时的值
+ * 句柄的内存和寄存器必须和开始录制时相同(同一个镜像, 同样的检查点), 不需要也不要挂设备
+ * @return NULL 打不开或者不是日志文件
+ */
+LIB6502_API Lib6502_Replay *Lib6502_Replay_Start(Lib6502 *emu, const char *path);
+
+/**
+ * 结束录制(写完日志)或回放(I/O 页恢复成内存), 在销毁句柄之前调用
+ * @return 回放时日志和执行不一致的次数(日志没有用完算一次), 0 表示逐周期一致; 录制时为 0
+ */
+LIB6502_API uint64_t Lib6502_Replay_Close(Lib6502_Replay *replay);
+
+//Lib6502_Lanes_Create 最多的实例数
+#define LIB6502_LANES_MAX 64
+
+/**
+ * 多实例同步执行: count 个 CPU 跑同一段程序, 每个实例有自己的 64K 内存(输入数据不同)
+ * PC 和指令字节相同的实例一起执行一条指令, 寄存器按实例数组存放, 适合大批量的相同内核
+ * 结果(寄存器、内存、周期)和每个实例单独用 Lib6502_Run_Cycles 执行相同
+ * 实例只有内存, 没有设备、映射器和中断; 内存清零, 复位前 PC 为 0
+ * @param count 1 到 LIB6502_LANES_MAX
+ * @return NULL 参数不对或者内存不足
+ */
+LIB6502_API Lib6502_Lanes *Lib6502_Lanes_Create(int count);
+
+LIB6502_API void Lib6502_Lanes_Destroy(Lib6502_Lanes *lanes);
+
+/**
+ * 复位所有实例, 每个实例的 PC 取自己内存 0xFFFC 处的复位向量
+ */
+LIB6502_API void Lib6502_Lanes_Reset(Lib6502_Lanes *lanes);
+
+/**
+ * 把数据写入一个实例的内存, 超出 0xFFFF 的部分被截掉
+ * @param lane 小于 0 时写入所有实例
+ * @return 实际写入的字节数
+ */
+LIB6502_API size_t Lib6502_Lanes_Load(Lib6502_Lanes *lanes, int lane, uint16_t addr, const void *data, size_t size);
+
+LIB6502_API uint8_t Lib6502_Lanes_Peek(const Lib6502_Lanes *lanes, int lane, uint16_t addr);
+
+LIB6502_API void Lib6502_Lanes_Poke(Lib6502_Lanes *lanes, int lane, uint16_t addr, uint8_t value);
+
+LIB6502_API void Lib6502_Lanes_Get_Regs(const Lib6502_Lanes *lanes, int lane, Lib6502_Regs *regs);
+
+LIB6502_API void Lib6502_Lanes_Set_Regs(Lib6502_Lanes *lanes, int lane, const Lib6502_Regs *regs);
+
+/**
+ * 每个实例执行到至少经过 cycles 个周期, 或者锁死(JAM/STP); WAI 和 Lib6502_Run_Cycles 一样空转到结束
+ */
+LIB6502_API void Lib6502_Lanes_Run_Cycles(Lib6502_Lanes *lanes, uint64_t cycles);
+
+LIB6502_API void Lib6502_Lanes_Get_Stats(const Lib6502_Lanes *lanes, Lib6502_Lanes_Stats *stats);
+
+/**
+ * 设置 IRQ 电平, 多个中断源(0-7)线与
+ */
+LIB6502_API void Lib6502_Set_IRQ(Lib6502 *emu, int source, int level);
+
+/**
+ * 触发 NMI 边沿
+ */
+LIB6502_API void Lib6502_NMI(Lib6502 *emu);
+
+/**
+ * 在 addr 所在页挂一个 6551 ACIA 串口(4 个寄存器在页内重复), 替换之前的串口
+ * 收发的数据经过无锁环形缓冲区, 由后台线程直接和 in_fd/out_fd 交换;
+ * 字符按控制寄存器的波特率和 hz 计时(控制寄存器为 0 时不限速), 缓冲区空/满时 CPU 一侧等待, 不丢数据
+ * 串口用定时器占用 CPU 的事件槽, 不能和回放同时使用; 串口的状态不在检查点里, 挂上以后不要再保存或恢复检查点
+ * @param in_fd 接收的数据来源(管道、终端、文件), -1 时没有输入; 读完以后状态寄存器的 DCD 位(0x20)置 1
+ * @param out_fd 发送的数据写到这里, -1 时丢弃; 两个文件都不会被关闭
+ * @param irq IRQ 源(0-7), -1 不接中断
+ * @param hz CPU 时钟频率, 0 为 1MHz
+ * @return 0 成功, -1 失败
+ */
+LIB6502_API int Lib6502_Attach_Serial(Lib6502 *emu, uint16_t addr, int in_fd, int out_fd, int irq, double hz);
+
+/**
+ * 摘下串口: 写完还在发送的数据, 结束后台线程; Lib6502_Destroy 时自动调用
+ */
+LIB6502_API void Lib6502_Detach_Serial(Lib6502 *emu);
+
+/**
+ * 把主机文件当作块设备, 替换之前的块设备: 寄存器在 regs 所在页, 512 字节的扇区映射到 window 开始的两页
+ * 寄存器: +0..+2 扇区号(低字节在前), +3 写命令(1 映射, 2 写回文件, 3 下一个扇区)/读状态, +4..+6 扇区总数
+ * 文件整个 mmap, 窗口直接指向文件的页缓存, 读写扇区不拷贝, 切换扇区只改页表
+ * 窗口和扇区寄存器不在检查点和录制日志里, 挂上以后不要再保存或恢复检查点
+ * @param read_only 非 0 时只读打开, CPU 对窗口的写入被丢弃
+ * @return 0 成功, -1 打不开文件、不满一个扇区或者窗口和寄存器页重叠
+ */
+LIB6502_API int Lib6502_Attach_Disk(Lib6502 *emu, uint16_t regs, uint16_t window, const char *path, int read_only);
+
+/**
+ * 摘下块设备, 把改动写回文件; Lib6502_Destroy 时自动调用
+ */
+LIB6502_API void Lib6502_Detach_Disk(Lib6502 *emu);
+
+/**
+ * 导出时的 instance 标签, 默认为 "cpu<编号>", 最长 31 字节
+ */
+LIB6502_API void Lib6502_Set_Name(Lib6502 *emu, const char *name);
+
+LIB6502_API void Lib6502_Get_Metrics(const Lib6502 *emu, Lib6502_Metrics *metrics);
+
+/**
+ * 进程里所有句柄(包括已经销毁的)的总计
+ * @return 现有的句柄数
+ */
+LIB6502_API int Lib6502_Get_Fleet_Metrics(Lib6502_Metrics *metrics);
+
+/**
+ * 把所有句柄的计数写入文件: .json 为 JSON, 其它为 Prometheus 文本
+ * 先写临时文件再改名, 可以直接写到 node_exporter 的 textfile 目录
+ * @return 0 成功
+ */
+LIB6502_API int Lib6502_Metrics_Save(const char *path);
+
+/**
+ * 在后台线程里回答 HTTP GET, 供 Prometheus 抓取; 路径以 .json 结尾时返回 JSON
+ * 进程里只有一个导出服务
+ * @param address "unix:路径", "端口" 或 "主机:端口" (默认 127.0.0.1)
+ * @return 0 成功, -1 失败或者已经启动
+ */
+LIB6502_API int Lib6502_Metrics_Listen(const char *address);
+
+LIB6502_API void Lib6502_Metrics_Close(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
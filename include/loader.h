@@ -0,0 +1,73 @@
+#ifndef CPU_6502_LOADER_H
+#define CPU_6502_LOADER_H
+
+#include <stddef.h>
+#include "bus.h"
+
+//映像格式
+#define LOADER_AUTO 0
+//裸二进制, 装到指定地址
+#define LOADER_RAW  1
+//Intel HEX 文本
+#define LOADER_IHEX 2
+//C64 .prg: 2 字节装载地址 + 数据
+#define LOADER_PRG  3
+//Atari .xex: FFFF 头, 多段 起始/结束地址 + 数据
+#define LOADER_XEX  4
+//iNES: 只取 PRG ROM, 装到 $8000-$FFFF (只有一个 16K 时镜像)
+#define LOADER_NES  5
+
+//最多的段数
+#define LOADER_SEGMENTS 64
+
+/**
+ * 一段连续的数据
+ */
+struct Loader_Segment {
+    Short Addr;
+    unsigned int Size;
+    const Byte *Data;
+};
+
+/**
+ * 打开的程序映像: 文件只读 mmap, 段直接指向映射的内容
+ * 只有 Intel HEX 需要解码到 Buffer
+ * 同一个映像可以映射到任意多条总线, 关闭前这些总线不能再执行
+ */
+struct Loader_Image {
+    int Format;
+    void *Map;
+    size_t Map_Size;
+    Byte *Buffer;
+    int Count;
+    struct Loader_Segment Segments[LOADER_SEGMENTS];
+    //映像里记录的入口地址(Intel HEX 起始地址, .xex RUNAD), 没有时为 -1
+    int Entry;
+    //可以交给映射器按 bank 使用的完整 ROM: iNES 的全部 PRG ROM, 裸二进制的整个文件, 其它格式为 NULL
+    const Byte *Banks;
+    size_t Bank_Size;
+    //iNES 头里的映射器号, 其它格式为 -1
+    int Mapper;
+};
+
+/**
+ * 打开并解析映像
+ * @param image
+ * @param path
+ * @param format LOADER_xxx, LOADER_AUTO 按文件头和扩展名判断
+ * @param addr 裸二进制的装载地址
+ * @return 0 成功, -1 文件打不开或者格式错误
+ */
+int Loader_Open(struct Loader_Image *image, const char *path, int format, Short addr);
+
+/**
+ * 把映像映射到总线
+ * @param image
+ * @param bus
+ * @param rom 非 0 时只读映射(按页对齐的部分不拷贝), 否则拷贝到内存
+ */
+void Loader_Map(const struct Loader_Image *image, struct Bus *bus, int rom);
+
+void Loader_Close(struct Loader_Image *image);
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef CPU_6502_MAPPER_H
+#define CPU_6502_MAPPER_H
+
+#include "bus.h"
+#include "lib6502.h"
+
+//每个映射器的窗口数
+#define MAPPER_WINDOWS 8
+//可以注册的映射器类型数(含内置)
+#define MAPPER_TYPES 32
+//窗口没有控制寄存器
+#define MAPPER_NO_CONTROL (-1)
+
+/**
+ * 总线上的一个 bank 窗口: [Base, Base + Size) 映射 ROM 或 RAM 里的第 Bank 个 Size 大小的块
+ * 写 [Control_Start, Control_End] 时用写入的值选择 bank (通用映射器)
+ */
+struct Mapper_Window {
+    Short Base;
+    unsigned int Size;
+    int Control_Start;
+    int Control_End;
+    //bank 来自 RAM
+    Byte RAM;
+    //可选的 bank 数
+    unsigned int Count;
+    unsigned int Bank;
+};
+
+struct Mapper;
+
+/**
+ * 映射器类型(插件接口), 用 Mapper_Register 注册后可以按名字使用
+ */
+struct Mapper_Type {
+    const char *Name;
+    //iNES 映射器号, 没有时为 -1
+    int Number;
+    //默认的 RAM 大小, 配置里的 ram= 优先
+    unsigned int RAM_Size;
+    /**
+     * 用 Mapper_Add_Window 建立窗口, 设置上电时的 bank, 可以为 NULL
+     * @return 0 成功
+     */
+    int (*Init)(struct Mapper *mapper);
+    /**
+     * 写控制寄存器所在的页, NULL 时按窗口的 Control_Start/Control_End 选择 bank
+     * @return 1 写入由映射器处理, 0 按普通写入处理(只读页丢弃)
+     */
+    int (*Write)(struct Mapper *mapper, Short addr, Byte value);
+};
+
+/**
+ * 映射器: 把超过 64K 的 ROM/RAM 按窗口映射到总线
+ * 切换 bank 只改窗口里每页的页表指针, 不拷贝数据, 切到当前 bank 时什么都不做
+ * ROM 由调用者持有, 必须在映射器使用期间有效; RAM 由映射器分配
+ */
+struct Mapper {
+    const struct Mapper_Type *Type;
+    struct Bus *Bus;
+    const Byte *ROM;
+    unsigned int ROM_Size;
+    Byte *RAM;
+    unsigned int RAM_Size;
+    struct Mapper_Window Windows[MAPPER_WINDOWS];
+    int Window_Count;
+    //映射器自己的寄存器, 由类型解释
+    unsigned int Regs[8];
+    //实际切换 bank 的次数
+    unsigned long long Switches;
+};
+
+/**
+ * 注册映射器类型, type 必须一直有效
+ * @return 0 成功, -1 表满或者重名
+ */
+LIB6502_API int Mapper_Register(const struct Mapper_Type *type);
+
+/**
+ * 按名字或 iNES 映射器号("#2")查找类型
+ */
+LIB6502_API const struct Mapper_Type *Mapper_Find(const char *name);
+
+/**
+ * 按配置创建映射器并挂到总线上
+ * 配置为逗号分隔的项:
+ * - 类型名, 或者 #iNES 映射器号
+ * - ram=大小, 可以带 k
+ * - 窗口 BASE/SIZE[=BANK][@CTRL[-END]][:ram], 数字为十六进制, SIZE 可以带 k, BANK 为负数时从最后一个往前数
+ *   只有窗口没有类型名时为通用映射器, 例如 "8000/16k@8000-bfff,c000/16k=-1"
+ * @param mapper
+ * @param bus
+ * @param spec
+ * @param rom
+ * @param rom_size
+ * @return 0 成功, -1 配置错误
+ */
+LIB6502_API int Mapper_Init(struct Mapper *mapper, struct Bus *bus, const char *spec, const Byte *rom,
+                            unsigned int rom_size);
+
+/**
+ * 从总线上摘下, 窗口恢复成没写过的内存页, 释放 RAM
+ */
+LIB6502_API void Mapper_Free(struct Mapper *mapper);
+
+/**
+ * 增加窗口, 映射初始 bank
+ * @param control_start 控制寄存器起始地址, MAPPER_NO_CONTROL 表示固定窗口
+ * @param bank 初始 bank, 负数从最后一个往前数
+ * @return 窗口下标, -1 参数错误
+ */
+LIB6502_API int Mapper_Add_Window(struct Mapper *mapper, Short base, unsigned int size, int control_start,
+                                  int control_end, int ram, int bank);
+
+/**
+ * 切换窗口的 bank, bank 超出时取模
+ */
+LIB6502_API void Mapper_Select(struct Mapper *mapper, int window, unsigned int bank);
+
+/**
+ * 总线写控制寄存器所在的页时调用
+ * @return 1 写入由映射器处理
+ */
+int Mapper_Write(struct Mapper *mapper, Short addr, Byte value);
+
+#endif
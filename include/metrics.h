@@ -0,0 +1,141 @@
+#ifndef CPU_6502_METRICS_H
+#define CPU_6502_METRICS_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "cpu.h"
+
+//计数器
+//执行的指令(融合的每条指令、快进跳过的每条指令都计入, 中断响应不计入)
+#define METRIC_INSTRUCTIONS 0
+#define METRIC_CYCLES       1
+//响应的 IRQ/NMI
+#define METRIC_INTERRUPTS   2
+//融合执行的指令组(一次分派执行多条指令)
+#define METRIC_FUSED        3
+//空转循环快进跳过的周期
+#define METRIC_IDLE_CYCLES  4
+//第一次写入还没有自己内存的页(清零或拷贝共享页)
+#define METRIC_PAGE_FAULTS  5
+#define METRIC_WATCH_HITS   6
+//CPU_Run/CPU_Step 的次数
+#define METRIC_RUNS         7
+#define METRIC_COUNT        8
+
+/**
+ * 一个线程执行一个实例的计数, 只有这个线程写, 读取时合并
+ * 计数占一个缓存行, 不和别的线程、别的实例共享
+ */
+struct Metrics_Shard {
+    _Alignas(BUS_CACHE_LINE) _Atomic unsigned long long Values[METRIC_COUNT];
+    //所属线程
+    const void *Thread;
+    struct Metrics_Shard *Next;
+};
+
+//只由拥有分片的线程调用: 普通的读、加、写, 没有加锁的指令
+#define METRICS_ADD(shard, id, n) \
+    atomic_store_explicit(&(shard)->Values[id], \
+                          atomic_load_explicit(&(shard)->Values[id], memory_order_relaxed) + (n), \
+                          memory_order_relaxed)
+
+//在执行 cpu 的线程里计数, CPU_METRICS 为 0 时什么都不做
+#if CPU_METRICS
+#define METRICS_COUNT(cpu, id, n) do { \
+        if ((cpu)->Shard) { \
+            METRICS_ADD((cpu)->Shard, id, n); \
+        } \
+    } while (0)
+#else
+#define METRICS_COUNT(cpu, id, n) ((void) 0)
+#endif
+
+/**
+ * 一个实例(CPU 上下文)的计数器, 登记在进程的实例表里
+ * 执行的线程第一次用到时给自己加一个分片(无锁地挂到 Shards 上), 执行中只写自己的分片;
+ * 指令和周期数在每次 CPU_Run 结束时加上, 中断、缺页等事件立即加上
+ * 实例表只在登记、注销和导出时加锁
+ */
+struct Metrics {
+    char Name[32];
+    //进程内唯一, 线程用它识别缓存的分片
+    unsigned long long Id;
+    _Atomic(struct Metrics_Shard *) Shards;
+    struct Metrics *Prev;
+    struct Metrics *Next;
+};
+
+/**
+ * 登记实例
+ * @param metrics
+ * @param name 导出时的 instance 标签, NULL 时为 "cpu<编号>"
+ */
+void Metrics_Init(struct Metrics *metrics, const char *name);
+
+/**
+ * 注销实例, 计数并入进程的总计; 没有线程在执行它时调用
+ */
+void Metrics_Free(struct Metrics *metrics);
+
+void Metrics_Set_Name(struct Metrics *metrics, const char *name);
+
+/**
+ * 把 CPU 的计数记到 metrics, NULL 时不计数
+ */
+void Metrics_Attach(struct CPU_Context *cpu, struct Metrics *metrics);
+
+/**
+ * 当前线程的分片, 没有时创建
+ * @return NULL 内存不足
+ */
+struct Metrics_Shard *Metrics_Shard(struct Metrics *metrics);
+
+/**
+ * 合并所有线程的分片
+ */
+void Metrics_Read(const struct Metrics *metrics, unsigned long long values[METRIC_COUNT]);
+
+/**
+ * 整个进程所有实例(包括已经注销的)的总计
+ * @return 当前登记的实例数
+ */
+int Metrics_Read_Fleet(unsigned long long values[METRIC_COUNT]);
+
+/**
+ * Prometheus 文本格式: 每个实例一行 lib6502_xxx_total{instance="..."}, 总计为 lib6502_fleet_xxx_total
+ */
+void Metrics_Write_Prometheus(FILE *fp);
+
+/**
+ * JSON: {"instances":[{"instance":"...","instructions":...},...],"fleet":{"instances":N,...}}
+ */
+void Metrics_Write_JSON(FILE *fp);
+
+/**
+ * 写入文件: .json 为 JSON, 其它为 Prometheus 文本(node_exporter 的 textfile 目录);
+ * 先写临时文件再改名, 读的一方不会看到写了一半的文件
+ * @return 0 成功
+ */
+int Metrics_Save(const char *path);
+
+/**
+ * 导出服务: 后台线程在本机端口或 Unix 套接字上回答 HTTP GET,
+ * 路径以 .json 结尾时为 JSON, 其它为 Prometheus 文本
+ */
+struct Metrics_Server {
+    int Listen_Fd;
+    //写入一个字节让线程退出
+    int Wake_Fd[2];
+    pthread_t Thread;
+};
+
+/**
+ * @param address "unix:路径", "端口" 或 "主机:端口" (默认 127.0.0.1)
+ * @return 0 成功
+ */
+int Metrics_Listen(struct Metrics_Server *server, const char *address);
+
+void Metrics_Close(struct Metrics_Server *server);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef CPU_6502_OPCODES_H
+#define CPU_6502_OPCODES_H
+
+#include <stdio.h>
+#include "cpu.h"
+
+//寻址方式
+#define MODE_IMP 0
+#define MODE_ACC 1
+#define MODE_IMM 2
+#define MODE_ZP  3
+#define MODE_ZPX 4
+#define MODE_ZPY 5
+#define MODE_IZX 6
+#define MODE_IZY 7
+//(zp) 65C02
+#define MODE_IZP 8
+#define MODE_REL 9
+#define MODE_ABS 10
+#define MODE_ABX 11
+#define MODE_ABY 12
+#define MODE_IND 13
+//(a,x) 65C02
+#define MODE_AIX 14
+//zp,r 65C02 BBR/BBS
+#define MODE_ZPR 15
+
+//控制流类型
+#define OP_FLOW_NONE     0
+//条件分支: 顺序执行 + 目标
+#define OP_FLOW_BRANCH   1
+//无条件跳转: JMP a, BRA
+#define OP_FLOW_JUMP     2
+//间接跳转: JMP (a), JMP (a,x)
+#define OP_FLOW_JUMP_IND 3
+#define OP_FLOW_CALL     4
+//RTS/RTI
+#define OP_FLOW_RETURN   5
+#define OP_FLOW_BRK      6
+//JAM/STP
+#define OP_FLOW_HALT     7
+
+struct Opcode_Info {
+    char Name[5];
+    Byte Mode;
+    Byte Cycles;
+    //读指令索引跨页时多出的周期
+    Byte Page;
+    Byte Flow;
+};
+
+extern const struct Opcode_Info OP_Table[256];
+
+Byte OP_Length(Byte opcode);
+
+Short OP_Branch_Target(Short addr, Byte offset, Byte length);
+
+void OP_Cycle_Range(const Byte *mem, Short addr, Byte *min, Byte *max);
+
+Byte OP_Disasm(const Byte *mem, Short addr, char *buf, int size);
+
+int OP_Check(FILE *fp);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef CPU_6502_PACE_H
+#define CPU_6502_PACE_H
+
+#include "cpu.h"
+
+//默认每批的模拟时间(纳秒), 也是睡眠的粒度
+#define PACE_SLICE_NS 1000000ULL
+//落后超过这么多(纳秒)时不再追赶, 从现在重新计时
+#define PACE_MAX_LAG_NS 100000000ULL
+//睡眠提前醒来的上限(纳秒), 剩下的时间自旋等待
+#define PACE_SPIN_MAX_NS 200000ULL
+
+/**
+ * 实时节奏统计, 时间都是纳秒
+ */
+struct Pace_Stats {
+    unsigned long long Batches;
+    unsigned long long Cycles;
+    //批次执行完时已经过了截止时间(模拟比实时慢)
+    unsigned long long Overruns;
+    //落后超过 PACE_MAX_LAG_NS, 放弃追赶重新计时
+    unsigned long long Resyncs;
+    //醒来时间和截止时间之差(抖动): 平均、最大
+    unsigned long long Jitter_Avg;
+    unsigned long long Jitter_Max;
+    //执行、睡眠(含自旋)的总时间
+    unsigned long long Busy;
+    unsigned long long Sleep;
+    //最近一批结束时实际时间比模拟时间慢多少, 负数为超前
+    long long Drift;
+};
+
+/**
+ * 按实际时钟频率执行: 每批执行 Slice 纳秒的周期, 然后睡到这一批的截止时间
+ * 截止时间从起点按累计周期数算出(绝对时间), 睡眠误差和批次超出的周期不会累积成漂移;
+ * 睡眠用绝对时间的 clock_nanosleep, 提前 Margin 醒来再自旋到截止时间,
+ * Margin 跟踪最近的睡眠误差, 抖动在几微秒以内而不用一直自旋
+ * 节奏只在批次之间, 不影响 CPU_Run 的执行循环
+ */
+struct Pace {
+    //时钟频率(Hz)
+    double Hz;
+    //倍速, 0 表示不限速
+    double Speed;
+    unsigned long long Slice;
+    //计时起点: 实际时间和当时的周期数, Origin_Ns 为 0 时下一次执行重新计时
+    unsigned long long Origin_Ns;
+    unsigned long long Origin_Cycles;
+    //每个周期的纳秒数(Hz 和 Speed 决定)
+    double Cycle_Ns;
+    unsigned long long Margin;
+    unsigned long long Jitter_Sum;
+    unsigned long long Wakes;
+    struct Pace_Stats Stats;
+};
+
+/**
+ * @param pace
+ * @param hz 时钟频率, 例如 1000000, 1789773
+ */
+void Pace_Init(struct Pace *pace, double hz);
+
+/**
+ * 修改倍速, 0 为不限速; 从下一次执行重新计时
+ */
+void Pace_Set_Speed(struct Pace *pace, double speed);
+
+/**
+ * 执行 cycles 个周期, 和实际时间同步; 不限速时直接执行
+ * 在两次调用之间暂停(例如调试器停下)后落后太多时自动重新计时
+ * @return 实际执行的周期数, 少于 cycles 时 CPU 停下了(锁死、观察点、挂起)
+ */
+unsigned long long Pace_Run(struct Pace *pace, struct CPU_Context *cpu, unsigned long long cycles);
+
+void Pace_Get_Stats(const struct Pace *pace, struct Pace_Stats *stats);
+
+#endif
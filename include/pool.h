@@ -0,0 +1,90 @@
+#ifndef CPU_6502_POOL_H
+#define CPU_6502_POOL_H
+
+#include <pthread.h>
+#include "bus.h"
+
+//每次分配的页数
+#define POOL_SLAB 64
+
+/**
+ * 池里的一页, 总线的 Backing 指向 Data
+ */
+struct Pool_Page {
+    //哈希链, 空闲时为空闲链表
+    struct Pool_Page *Next;
+    unsigned long long Hash;
+    unsigned int Refs;
+    _Alignas(BUS_CACHE_LINE) Byte Data[256];
+};
+
+struct Pool_Slab {
+    struct Pool_Slab *Next;
+    struct Pool_Page Pages[POOL_SLAB];
+};
+
+/**
+ * 统计, 字节数都按 256 字节的页计算
+ */
+struct Pool_Stats {
+    //池里不同内容的页
+    unsigned long long Pages;
+    //总线指向池的页
+    unsigned long long Refs;
+    //池本身占用的内存(按已分配的块)
+    unsigned long long Pool_Bytes;
+    //共享省下的内存: (Refs - Pages) * 256
+    unsigned long long Saved_Bytes;
+    //累计: 全 0 页还原成没写过的页
+    unsigned long long Zero_Pages;
+    //累计: 写入时拆开的共享页
+    unsigned long long Splits;
+    //累计: 还给系统的 Mem 字节数(整块 4K 不再使用时)
+    unsigned long long Released_Bytes;
+};
+
+/**
+ * 按内容哈希共享的只读页, 可以被多条总线(多个线程)同时使用
+ * 共享页在总线上是只读的, 第一次写入时拷贝回总线自己的 Mem (写时复制)
+ * 必须在所有使用它的总线释放(Bus_Unshare)之后销毁
+ */
+struct Pool {
+    pthread_mutex_t Lock;
+    struct Pool_Page **Buckets;
+    unsigned int Bucket_Count;
+    struct Pool_Page *Free;
+    struct Pool_Slab *Slabs;
+    struct Pool_Stats Stats;
+};
+
+void Pool_Init(struct Pool *pool);
+
+void Pool_Free(struct Pool *pool);
+
+void Pool_Get_Stats(struct Pool *pool, struct Pool_Stats *stats);
+
+/**
+ * 把总线上自己的内存页(Backing 指向 Mem 的页)换成池里相同内容的页, 全 0 的页还原成没写过的页,
+ * 然后把不再使用的整块 4K Mem 还给系统
+ * 只读页也可以共享, 仍然只读; 外部数据(ROM 映射、bank)和 I/O 页不变
+ * @return 换成共享页或全 0 页的页数
+ */
+int Bus_Share(struct Bus *bus, struct Pool *pool);
+
+/**
+ * 释放总线对池的所有引用, 共享页拷贝回 Mem, 销毁总线或池之前调用
+ */
+void Bus_Unshare(struct Bus *bus);
+
+/**
+ * 取和 data 内容相同的共享页, 没有时加入一份拷贝, 引用数加 1
+ * @return 共享页的内容
+ */
+const Byte *Pool_Intern(struct Pool *pool, const Byte *data);
+
+/**
+ * 总线不再引用这一页, 没有引用时回收
+ */
+void Pool_Release(struct Pool *pool, const Byte *data);
+
+#endif
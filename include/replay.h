@@ -0,0 +1,57 @@
+#ifndef CPU_6502_REPLAY_H
+#define CPU_6502_REPLAY_H
+
+#include <stdio.h>
+#include "cpu.h"
+
+//日志记录类型
+#define REPLAY_READ 0
+#define REPLAY_IRQ  1
+#define REPLAY_NMI  2
+#define REPLAY_WAKE 3
+#define REPLAY_END  0xFF
+
+#define REPLAY_RECORD 1
+#define REPLAY_PLAY   2
+
+#define REPLAY_BUF_SIZE 65536
+
+/**
+ * 外部输入的录制/回放
+ * 文件格式(小端):
+ *   "6RPL" 版本(1) I/O页位图(32) 起始周期(8)
+ *   记录: 00 值           I/O 读
+ *         01/02/03 间隔   IRQ/NMI/WAI唤醒, 间隔为距上一个中断记录的周期数(varint)
+ *         FF              结束
+ */
+struct Replay {
+    FILE *File;
+    Byte Mode;
+    struct CPU_Context *Cpu;
+    //上一个中断记录的周期
+    unsigned long long Stamp;
+    //回放: 已预读的下一条记录
+    Byte Next;
+    unsigned long long Next_Stamp;
+    //回放: 日志与执行不一致的次数(0 表示逐位一致)
+    unsigned long long Mismatch;
+    //回放: 替代原设备挂在 I/O 页上
+    struct Bus_Device Device;
+    //回放: 在下一个中断记录的周期触发
+    struct CPU_Timer Timer;
+    unsigned int Len;
+    unsigned int Pos;
+    Byte Buf[REPLAY_BUF_SIZE];
+};
+
+struct Replay *Replay_Record(struct CPU_Context *cpu, const char *path);
+
+struct Replay *Replay_Play(struct CPU_Context *cpu, const char *path);
+
+void Replay_Close(struct Replay *replay);
+
+void Replay_Log_Read(struct Replay *replay, Byte value);
+
+void Replay_Log_Interrupt(struct Replay *replay, Byte type, unsigned long long cycle);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef CPU_6502_RING_H
+#define CPU_6502_RING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "bus.h"
+
+//缓冲区满或空时搬运线程的等待时间(纳秒)
+#define RING_IDLE_NS 100000L
+//搬运线程等待文件可读/可写的超时(毫秒), 也是发现 Stop 的延迟
+#define RING_POLL_MS 10
+
+/**
+ * 单生产者单消费者的无锁环形缓冲区
+ * Head 只由生产者写, Tail 只由消费者写, 各占一个缓存行; 双方各自缓存对方的位置,
+ * 只有缓存的位置不够用时才读对方的缓存行
+ * 位置单调递增, 下标为位置 & Mask, 大小是 2 的幂
+ */
+struct Ring {
+    //-------------生产者-----------------
+    _Alignas(BUS_CACHE_LINE) _Atomic size_t Head;
+    size_t Tail_Cache;
+    //-------------消费者-----------------
+    _Alignas(BUS_CACHE_LINE) _Atomic size_t Tail;
+    size_t Head_Cache;
+    //-------------只读-----------------
+    _Alignas(BUS_CACHE_LINE) Byte *Data;
+    size_t Mask;
+    //生产者不会再写入(输入结束)
+    _Atomic int Closed;
+};
+
+/**
+ * @param size 向上取整到 2 的幂
+ * @return 0 成功, -1 内存不足
+ */
+int Ring_Init(struct Ring *ring, size_t size);
+
+void Ring_Free(struct Ring *ring);
+
+/**
+ * 生产者: 可以直接写入的连续空间, 写完后 Ring_Produce
+ * @param data 写入起始位置
+ * @return 字节数, 0 表示满
+ */
+size_t Ring_Write_Span(struct Ring *ring, Byte **data);
+
+void Ring_Produce(struct Ring *ring, size_t count);
+
+/**
+ * 消费者: 可以直接读取的连续数据, 读完后 Ring_Consume
+ * @param data 读取起始位置
+ * @return 字节数, 0 表示空
+ */
+size_t Ring_Read_Span(struct Ring *ring, const Byte **data);
+
+void Ring_Consume(struct Ring *ring, size_t count);
+
+/**
+ * @return 0 成功, -1 满
+ */
+int Ring_Put(struct Ring *ring, Byte value);
+
+/**
+ * @return 读到的字节, -1 空
+ */
+int Ring_Get(struct Ring *ring);
+
+//生产者: 不会再写入
+void Ring_Close(struct Ring *ring);
+
+/**
+ * 消费者: 生产者已经关闭, 并且数据都读完了
+ */
+int Ring_Ended(struct Ring *ring);
+
+/**
+ * 在文件和环形缓冲区之间搬运数据的线程, 直接 read 到缓冲区里、从缓冲区 write 出去, 不经过中间缓冲
+ * 输入: 读到文件结束或出错时 Ring_Close
+ * 输出: 停止时先把缓冲区里的数据写完; 生产者 Ring_Close 并且写完时自己结束
+ */
+struct Ring_Pump {
+    struct Ring *Ring;
+    int Fd;
+    //非 0 时从 Fd 读入 Ring, 否则从 Ring 写到 Fd
+    int Input;
+    _Atomic int Stop;
+    //线程已经结束
+    _Atomic int Done;
+    //出错时的 errno
+    int Error;
+    _Atomic unsigned long long Bytes;
+    pthread_t Thread;
+};
+
+/**
+ * @return 0 成功
+ */
+int Ring_Pump_Start(struct Ring_Pump *pump, struct Ring *ring, int fd, int input);
+
+/**
+ * 停止并等待线程结束, 输出时先写完缓冲区
+ */
+void Ring_Pump_Stop(struct Ring_Pump *pump);
+
+#endif
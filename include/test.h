@@ -0,0 +1,110 @@
+#ifndef CPU_6502_TEST_H
+#define CPU_6502_TEST_H
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include "cpu.h"
+#include "compiler.h"
+#include "lib6502.h"
+
+//没有 .test 周期上限时的默认值
+#define TEST_MAX_CYCLES 10000000ULL
+//每个用例的默认时间上限(秒)
+#define TEST_MAX_SECONDS 10.0
+//两次检查时间之间执行的周期数
+#define TEST_BATCH 1000000ULL
+
+//Test_Case.Result
+#define TEST_PASS    0
+//返回了, 但有 .expect 不符
+#define TEST_FAIL    1
+//超过周期上限或时间上限还没有返回
+#define TEST_TIMEOUT 2
+//在返回地址以外的地方停机(JAM/STP)
+#define TEST_HALT    3
+//单元汇编失败
+#define TEST_ERROR   4
+
+/**
+ * 一个源文件汇编出的镜像, 每个用例执行前装到 [Low, Low + Size)
+ */
+struct Test_Unit {
+    char *Path;
+    Short Low;
+    unsigned int Size;
+    Byte *Image;
+    //返回地址: 镜像和 .setup/.expect 都没用到的字节, 执行时放停机指令
+    Short Exit;
+    Byte Failed;
+};
+
+/**
+ * 一个用例和它的结果
+ */
+struct Test_Case {
+    struct Test_Unit *Unit;
+    char *Name;
+    char *File;
+    int Line;
+    Short Entry;
+    unsigned long long Max_Cycles;
+    struct ASM_Check *Checks;
+    int Count;
+    //-------------结果-----------------
+    Byte Result;
+    //从入口到返回的周期, 包括返回的 RTS
+    unsigned long long Cycles;
+    double Seconds;
+    //失败原因, 一行一条
+    char *Message;
+};
+
+/**
+ * 测试运行器: 依次汇编源文件, 收集 .test 用例, 再由 Jobs 个线程并行执行
+ * 每个用例有自己的 CPU 上下文和总线, 以子程序方式从入口调用, RTS 回到 Exit 上的停机指令算结束,
+ * 之后比较 .expect
+ */
+struct Test_Runner {
+    struct Test_Unit **Units;
+    int Unit_Count;
+    int Unit_Cap;
+    struct Test_Case *Cases;
+    int Case_Count;
+    int Case_Cap;
+    //.test 没有给出时的周期上限
+    unsigned long long Max_Cycles;
+    //每个用例的时间上限(秒), 0 不限
+    double Timeout;
+    int Jobs;
+    //下一个要执行的用例
+    _Atomic int Next;
+    //停机指令本身的周期, 从结果里减掉
+    unsigned int Halt_Cycles;
+    double Seconds;
+};
+
+void Test_Init(struct Test_Runner *runner);
+
+void Test_Free(struct Test_Runner *runner);
+
+/**
+ * 加入刚汇编完的单元和它的用例
+ * @param failed 汇编失败, 记为一个出错的用例
+ * @return 0 成功, -1 镜像占满了地址空间, 找不到返回地址
+ */
+int Test_Add(struct Test_Runner *runner, const struct Assembler *as, const char *path, int failed);
+
+/**
+ * 并行执行所有用例
+ * @return 没有通过的用例数
+ */
+int Test_Run(struct Test_Runner *runner);
+
+void Test_Write_TAP(const struct Test_Runner *runner, FILE *fp);
+
+void Test_Write_JUnit(const struct Test_Runner *runner, FILE *fp);
+
+//命令行入口, 导出给 cpu_6502 使用
+LIB6502_API int Test_Main(int argc, char **argv);
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef CPU_6502_WATCH_H
+#define CPU_6502_WATCH_H
+
+#include <stdio.h>
+#include "cpu.h"
+
+//观察的访问类型, 可以组合
+#define WATCH_READ  BUS_ARM_READ
+#define WATCH_WRITE BUS_ARM_WRITE
+#define WATCH_EXEC  BUS_ARM_EXEC
+
+//条件: (值 & Mask) 与 Operand 比较
+#define WATCH_ALWAYS  0
+#define WATCH_EQ      1
+#define WATCH_NE      2
+#define WATCH_LT      3
+#define WATCH_GT      4
+//写入的值和原来的值不同
+#define WATCH_CHANGED 5
+
+#define WATCH_MAX 32
+
+/**
+ * 一次命中
+ * 读/写为访问的值, 执行为操作码; Old 为写入前内存里的值
+ */
+struct Watch_Hit {
+    int Point;
+    Short Addr;
+    Byte Kind;
+    Byte Value;
+    Byte Old;
+    unsigned long long Cycles;
+};
+
+/**
+ * 观察点: [Start, End] 上的一类或几类访问
+ * Hit 为 NULL 或返回非 0 时让 CPU_Run 在当前指令结束后返回,
+ * 执行观察点在指令执行之前返回, PC 指向这条指令
+ */
+struct Watch_Point {
+    Byte Used;
+    Byte Kind;
+    Short Start;
+    Short End;
+    Byte Cond;
+    Byte Mask;
+    Byte Operand;
+    int (*Hit)(void *ctx, const struct Watch_Hit *hit);
+    void *Ctx;
+    unsigned long long Count;
+};
+
+/**
+ * 一条总线上的观察点
+ * 只有观察点覆盖的页在 Bus.Armed 里标记, 其它页的访问仍然直接查页表
+ */
+struct Watch {
+    struct Bus *Bus;
+    struct Watch_Point Points[WATCH_MAX];
+    //最后一次让 CPU 停下的命中
+    struct Watch_Hit Last;
+    //在执行观察点停下的位置, 从这里恢复时不再命中
+    const struct CPU_Context *Stop_Cpu;
+    Short Stop_PC;
+    unsigned long long Stop_Cycles;
+};
+
+void Watch_Init(struct Watch *watch, struct Bus *bus);
+
+/**
+ * 取消所有观察点并从总线上摘下
+ */
+void Watch_Free(struct Watch *watch);
+
+/**
+ * 添加观察点
+ * @param watch
+ * @param point 填好 Kind/Start/End/Cond/Mask/Operand/Hit/Ctx
+ * @return 编号, -1 表示观察点已满
+ */
+int Watch_Add(struct Watch *watch, const struct Watch_Point *point);
+
+void Watch_Remove(struct Watch *watch, int id);
+
+/**
+ * 解析条件, 格式为 "[& 掩码] 比较符 值" 或 "changed", 比较符为 == != < >
+ * 例如 "== 0x42", "& 0x80 != 0"
+ * @return 0 成功, -1 格式错误
+ */
+int Watch_Parse_Cond(struct Watch_Point *point, const char *text);
+
+/**
+ * CPU 读写有观察点的页时调用
+ * @param kind WATCH_READ/WATCH_WRITE
+ */
+void Watch_Access(struct Watch *watch, Short addr, Byte value, Byte kind);
+
+/**
+ * CPU 在有执行观察点的页上取指令之前调用
+ * @return 非 0 时不执行这条指令
+ */
+int Watch_Exec(struct Watch *watch, Short pc);
+
+/**
+ * 访问跟踪: 把命中打印到 ctx (FILE *), 不让 CPU 停下
+ */
+int Watch_Trace(void *ctx, const struct Watch_Hit *hit);
+
+#endif
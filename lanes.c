@@ -0,0 +1,723 @@
+#include <stdlib.h>
+#include <string.h>
+#include "include/lanes.h"
+#include "include/opcodes.h"
+
+//按组执行的操作
+#define LANE_LOAD   1
+#define LANE_STORE  2
+#define LANE_ADC    3
+#define LANE_SBC    4
+#define LANE_AND    5
+#define LANE_ORA    6
+#define LANE_EOR    7
+#define LANE_CMP    8
+#define LANE_BIT    9
+#define LANE_INC    10
+#define LANE_DEC    11
+#define LANE_INC_R  12
+#define LANE_DEC_R  13
+#define LANE_MOVE   14
+#define LANE_FLAG   15
+#define LANE_ASL    16
+#define LANE_LSR    17
+#define LANE_ROL    18
+#define LANE_ROR    19
+#define LANE_BRANCH 20
+#define LANE_JMP    21
+#define LANE_JSR    22
+#define LANE_RTS    23
+#define LANE_NOP    24
+#define LANE_PUSH   25
+#define LANE_PULL   26
+
+//组内实例循环, m[i] 为 1 的实例参与
+#define LANES_FOR for (int i = 0; i < n; ++i)
+//按掩码写入, 写成选择的形式方便编译器向量化
+#define LANE_PUT(reg, value) (reg)[i] = m[i] ? (Byte) (value) : (reg)[i]
+
+//第 i 个实例地址 addr 处的字节
+#define LANE_MEM(addr) lanes->Mem[(size_t) (addr) * n + i]
+
+/**
+ * 逐个实例执行时的总线设备: 访问交错内存里的第 Scalar_Lane 个实例
+ */
+static Byte Lanes_Device_Read(void *ctx, Short addr) {
+    struct Lanes *lanes = ctx;
+    return lanes->Mem[(size_t) addr * lanes->Count + lanes->Scalar_Lane];
+}
+
+static void Lanes_Device_Write(void *ctx, Short addr, Byte value) {
+    struct Lanes *lanes = ctx;
+    lanes->Mem[(size_t) addr * lanes->Count + lanes->Scalar_Lane] = value;
+}
+
+int Lanes_Init(struct Lanes *lanes, int count) {
+    memset(lanes, 0, sizeof(*lanes));
+    lanes->Count = count > LANES_MAX ? LANES_MAX : count;
+    lanes->Mem = calloc(0x10000, lanes->Count);
+    lanes->Scalar_Bus = aligned_alloc(BUS_CACHE_LINE, sizeof(struct Bus));
+    if (!lanes->Mem || !lanes->Scalar_Bus) {
+        Lanes_Free(lanes);
+        return -1;
+    }
+    lanes->Device.Read = Lanes_Device_Read;
+    lanes->Device.Write = Lanes_Device_Write;
+    lanes->Device.Ctx = lanes;
+    Bus_Init(lanes->Scalar_Bus);
+    Bus_Map_IO(lanes->Scalar_Bus, 0x0000, 0xFFFF, &lanes->Device);
+    Lanes_Reset(lanes, 0);
+    return 0;
+}
+
+void Lanes_Free(struct Lanes *lanes) {
+    free(lanes->Mem);
+    free(lanes->Scalar_Bus);
+    lanes->Mem = NULL;
+    lanes->Scalar_Bus = NULL;
+}
+
+/**
+ * 和 CPU_Reset 相同
+ */
+void Lanes_Reset(struct Lanes *lanes, Short pc) {
+    for (int i = 0; i < lanes->Count; ++i) {
+        lanes->PC[i] = pc;
+        lanes->SP[i] = 0xFF;
+        lanes->A[i] = lanes->X[i] = lanes->Y[i] = 0;
+        lanes->F_N[i] = lanes->F_V[i] = lanes->F_D[i] = lanes->F_I[i] = lanes->F_Z[i] = lanes->F_C[i] = 0;
+        lanes->Halted[i] = CPU_RUN;
+    }
+}
+
+void Lanes_Load(struct Lanes *lanes, int lane, Short addr, const Byte *data, unsigned int size) {
+    int n = lanes->Count;
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    for (unsigned int k = 0; k < size; ++k) {
+        for (int i = lane < 0 ? 0 : lane; i < (lane < 0 ? n : lane + 1); ++i) {
+            LANE_MEM(addr + k) = data[k];
+        }
+    }
+}
+
+Byte Lanes_Peek(const struct Lanes *lanes, int lane, Short addr) {
+    return lanes->Mem[(size_t) addr * lanes->Count + lane];
+}
+
+void Lanes_Poke(struct Lanes *lanes, int lane, Short addr, Byte value) {
+    lanes->Mem[(size_t) addr * lanes->Count + lane] = value;
+}
+
+/**
+ * 寄存器之外的状态(中断、事件)为空, Bus 是逐个执行用的总线
+ */
+void Lanes_Get(const struct Lanes *lanes, int lane, struct CPU_Context *cpu) {
+    CPU_Init(cpu, lanes->Scalar_Bus);
+    cpu->PC = lanes->PC[lane];
+    cpu->SP = lanes->SP[lane];
+    cpu->A = lanes->A[lane];
+    cpu->X = lanes->X[lane];
+    cpu->Y = lanes->Y[lane];
+    cpu->F_N = lanes->F_N[lane];
+    cpu->F_V = lanes->F_V[lane];
+    cpu->F_B = 1;
+    cpu->F_D = lanes->F_D[lane];
+    cpu->F_I = lanes->F_I[lane];
+    cpu->F_Z = lanes->F_Z[lane];
+    cpu->F_C = lanes->F_C[lane];
+    cpu->Halted = lanes->Halted[lane];
+    cpu->Cycles = lanes->Cycles[lane];
+}
+
+void Lanes_Set(struct Lanes *lanes, int lane, const struct CPU_Context *cpu) {
+    lanes->PC[lane] = cpu->PC;
+    lanes->SP[lane] = cpu->SP;
+    lanes->A[lane] = cpu->A;
+    lanes->X[lane] = cpu->X;
+    lanes->Y[lane] = cpu->Y;
+    lanes->F_N[lane] = cpu->F_N;
+    lanes->F_V[lane] = cpu->F_V;
+    lanes->F_D[lane] = cpu->F_D;
+    lanes->F_I[lane] = cpu->F_I;
+    lanes->F_Z[lane] = cpu->F_Z;
+    lanes->F_C[lane] = cpu->F_C;
+    lanes->Halted[lane] = cpu->Halted;
+    lanes->Cycles[lane] = cpu->Cycles;
+}
+
+/**
+ * 一个实例单独执行一条指令
+ */
+static void Lanes_Scalar(struct Lanes *lanes, int lane) {
+    struct CPU_Context cpu;
+    Lanes_Get(lanes, lane, &cpu);
+    lanes->Scalar_Lane = lane;
+    CPU_Select(&cpu);
+    CPU_Exec();
+    Lanes_Set(lanes, lane, &cpu);
+    lanes->Scalar_Ops++;
+}
+
+/**
+ * 组内实例写内存
+ * @param uniform 1 表示所有实例地址相同(ea[0]), 整行写入
+ */
+static void Lanes_Write(struct Lanes *lanes, const Byte *m, Byte uniform, const Short *ea, const Byte *value) {
+    int n = lanes->Count;
+    if (uniform) {
+        Byte *row = &lanes->Mem[(size_t) ea[0] * n];
+        LANES_FOR {
+            LANE_PUT(row, value[i]);
+        }
+    } else {
+        LANES_FOR {
+            if (m[i]) {
+                LANE_MEM(ea[i]) = value[i];
+            }
+        }
+    }
+}
+
+/**
+ * 操作码对应的组操作和寄存器
+ * 只收录所有型号含义相同的公开指令(65C02 另加 (zp) 和 INC/DEC A)
+ * @param reg 操作的寄存器(LOAD/STORE/CMP/INC_R/DEC_R/MOVE 目标/FLAG/BRANCH 标志)
+ * @param src MOVE 的来源, FLAG/BRANCH 的值
+ * @return 0 不支持
+ */
+static Byte Lanes_Decode(struct Lanes *lanes, Byte opcode, Byte **reg, Byte **src, Byte *value) {
+    *reg = lanes->A;
+    switch (opcode) {
+        case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9: case 0xA1: case 0xB1:
+#if CPU_IS_CMOS
+        case 0xB2:
+#endif
+            return LANE_LOAD;
+        case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE:
+            *reg = lanes->X;
+            return LANE_LOAD;
+        case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC:
+            *reg = lanes->Y;
+            return LANE_LOAD;
+        case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99: case 0x81: case 0x91:
+#if CPU_IS_CMOS
+        case 0x92:
+#endif
+            return LANE_STORE;
+        case 0x86: case 0x96: case 0x8E:
+            *reg = lanes->X;
+            return LANE_STORE;
+        case 0x84: case 0x94: case 0x8C:
+            *reg = lanes->Y;
+            return LANE_STORE;
+        case 0x69: case 0x65: case 0x75: case 0x6D: case 0x7D: case 0x79: case 0x61: case 0x71:
+#if CPU_IS_CMOS
+        case 0x72:
+#endif
+            return LANE_ADC;
+        case 0xE9: case 0xE5: case 0xF5: case 0xED: case 0xFD: case 0xF9: case 0xE1: case 0xF1:
+#if CPU_IS_CMOS
+        case 0xF2:
+#endif
+            return LANE_SBC;
+        case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39: case 0x21: case 0x31:
+#if CPU_IS_CMOS
+        case 0x32:
+#endif
+            return LANE_AND;
+        case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19: case 0x01: case 0x11:
+#if CPU_IS_CMOS
+        case 0x12:
+#endif
+            return LANE_ORA;
+        case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59: case 0x41: case 0x51:
+#if CPU_IS_CMOS
+        case 0x52:
+#endif
+            return LANE_EOR;
+        case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9: case 0xC1: case 0xD1:
+#if CPU_IS_CMOS
+        case 0xD2:
+#endif
+            return LANE_CMP;
+        case 0xE0: case 0xE4: case 0xEC:
+            *reg = lanes->X;
+            return LANE_CMP;
+        case 0xC0: case 0xC4: case 0xCC:
+            *reg = lanes->Y;
+            return LANE_CMP;
+        case 0x24: case 0x2C:
+            return LANE_BIT;
+        case 0xE6: case 0xF6: case 0xEE: case 0xFE:
+            return LANE_INC;
+        case 0xC6: case 0xD6: case 0xCE: case 0xDE:
+            return LANE_DEC;
+        case 0xE8:
+            *reg = lanes->X;
+            return LANE_INC_R;
+        case 0xC8:
+            *reg = lanes->Y;
+            return LANE_INC_R;
+        case 0xCA:
+            *reg = lanes->X;
+            return LANE_DEC_R;
+        case 0x88:
+            *reg = lanes->Y;
+            return LANE_DEC_R;
+#if CPU_IS_CMOS
+        case 0x1A:
+            return LANE_INC_R;
+        case 0x3A:
+            return LANE_DEC_R;
+#endif
+        case 0xAA:
+            *reg = lanes->X;
+            *src = lanes->A;
+            return LANE_MOVE;
+        case 0xA8:
+            *reg = lanes->Y;
+            *src = lanes->A;
+            return LANE_MOVE;
+        case 0x8A:
+            *src = lanes->X;
+            return LANE_MOVE;
+        case 0x98:
+            *src = lanes->Y;
+            return LANE_MOVE;
+        case 0xBA:
+            *reg = lanes->X;
+            *src = lanes->SP;
+            return LANE_MOVE;
+        case 0x9A:
+            //TXS 不影响标志
+            *reg = lanes->SP;
+            *src = lanes->X;
+            return LANE_MOVE;
+        case 0x18: case 0x38:
+            *reg = lanes->F_C;
+            *value = opcode == 0x38;
+            return LANE_FLAG;
+        case 0x58: case 0x78:
+            *reg = lanes->F_I;
+            *value = opcode == 0x78;
+            return LANE_FLAG;
+        case 0xD8: case 0xF8:
+            *reg = lanes->F_D;
+            *value = opcode == 0xF8;
+            return LANE_FLAG;
+        case 0xB8:
+            *reg = lanes->F_V;
+            *value = 0;
+            return LANE_FLAG;
+        case 0x0A: case 0x06: case 0x16: case 0x0E: case 0x1E:
+            return LANE_ASL;
+        case 0x4A: case 0x46: case 0x56: case 0x4E: case 0x5E:
+            return LANE_LSR;
+        case 0x2A: case 0x26: case 0x36: case 0x2E: case 0x3E:
+            return LANE_ROL;
+        case 0x6A: case 0x66: case 0x76: case 0x6E: case 0x7E:
+            return LANE_ROR;
+        case 0x48:
+            return LANE_PUSH;
+        case 0x68:
+            return LANE_PULL;
+        case 0x10: case 0x30:
+            *reg = lanes->F_N;
+            *value = opcode == 0x30;
+            return LANE_BRANCH;
+        case 0x50: case 0x70:
+            *reg = lanes->F_V;
+            *value = opcode == 0x70;
+            return LANE_BRANCH;
+        case 0x90: case 0xB0:
+            *reg = lanes->F_C;
+            *value = opcode == 0xB0;
+            return LANE_BRANCH;
+        case 0xD0: case 0xF0:
+            *reg = lanes->F_Z;
+            *value = opcode == 0xF0;
+            return LANE_BRANCH;
+        case 0x4C:
+            return LANE_JMP;
+        case 0x20:
+            return LANE_JSR;
+        case 0x60:
+            return LANE_RTS;
+        case 0xEA:
+            return LANE_NOP;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * 组内所有实例执行同一条指令
+ * @param m 参与的实例
+ * @param pc 组的 PC
+ * @param opcode
+ * @param op1 操作数第一个字节
+ * @param op2 操作数第二个字节
+ * @return 0 不支持, 没有修改任何状态
+ */
+static int Lanes_Vector(struct Lanes *lanes, const Byte *m, Short pc, Byte opcode, Byte op1, Byte op2) {
+    const struct Opcode_Info *info = &OP_Table[opcode];
+    int n = lanes->Count;
+    Byte *reg;
+    Byte *src = NULL;
+    Byte value = 0;
+    Byte op = Lanes_Decode(lanes, opcode, &reg, &src, &value);
+    if (!op) {
+        return 0;
+    }
+#if CPU_HAS_DECIMAL
+    if (op == LANE_ADC || op == LANE_SBC) {
+        LANES_FOR {
+            if (m[i] && lanes->F_D[i]) {
+                return 0;
+            }
+        }
+    }
+#endif
+    Byte length = OP_Length(opcode);
+    Short base = op1 | op2 << 8;
+    Short ea[LANES_MAX];
+    Byte cross[LANES_MAX];
+    Byte v[LANES_MAX];
+    Byte out[LANES_MAX];
+    //零页和绝对寻址所有实例地址相同, 读写整行(连续的 n 个字节)
+    Byte uniform = info->Mode == MODE_ZP || info->Mode == MODE_ABS;
+
+    //有效地址, 间接寻址要从每个实例自己的零页取指针
+    switch (info->Mode) {
+        case MODE_ZP:
+        case MODE_ABS:
+            LANES_FOR {
+                ea[i] = info->Mode == MODE_ZP ? op1 : base;
+                cross[i] = 0;
+            }
+            break;
+        case MODE_ZPX:
+        case MODE_ZPY:
+            LANES_FOR {
+                ea[i] = (Byte) (op1 + (info->Mode == MODE_ZPX ? lanes->X[i] : lanes->Y[i]));
+                cross[i] = 0;
+            }
+            break;
+        case MODE_ABX:
+        case MODE_ABY:
+            LANES_FOR {
+                ea[i] = base + (info->Mode == MODE_ABX ? lanes->X[i] : lanes->Y[i]);
+                cross[i] = (ea[i] ^ base) >> 8 != 0;
+            }
+            break;
+        case MODE_IZX:
+            LANES_FOR {
+                if (m[i]) {
+                    Byte ptr = op1 + lanes->X[i];
+                    ea[i] = LANE_MEM(ptr) | LANE_MEM((Byte) (ptr + 1)) << 8;
+                }
+                cross[i] = 0;
+            }
+            break;
+        case MODE_IZY:
+        case MODE_IZP: {
+            const Byte *low = &lanes->Mem[(size_t) op1 * n];
+            const Byte *high = &lanes->Mem[(size_t) (Byte) (op1 + 1) * n];
+            LANES_FOR {
+                Short ptr = low[i] | high[i] << 8;
+                ea[i] = ptr + (info->Mode == MODE_IZY ? lanes->Y[i] : 0);
+                cross[i] = (ea[i] ^ ptr) >> 8 != 0;
+            }
+            break;
+        }
+        default:
+            LANES_FOR {
+                cross[i] = 0;
+            }
+            break;
+    }
+
+    //读操作数: 立即数相同, 内存按实例取
+    if (info->Mode == MODE_IMM) {
+        LANES_FOR {
+            v[i] = op1;
+        }
+    } else if (op != LANE_STORE && op != LANE_JMP && op != LANE_JSR && info->Mode != MODE_IMP
+               && info->Mode != MODE_ACC && info->Mode != MODE_REL) {
+        if (uniform) {
+            const Byte *row = &lanes->Mem[(size_t) ea[0] * n];
+            LANES_FOR {
+                v[i] = row[i];
+            }
+        } else {
+            LANES_FOR {
+                v[i] = m[i] ? LANE_MEM(ea[i]) : 0;
+            }
+        }
+    }
+
+    Byte page = info->Page != 0;
+    Short next = pc + length;
+    LANES_FOR {
+        lanes->Cycles[i] += m[i] * (info->Cycles + (page & cross[i]));
+    }
+    LANES_FOR {
+        lanes->PC[i] = m[i] ? next : lanes->PC[i];
+    }
+
+    switch (op) {
+        case LANE_LOAD:
+            LANES_FOR {
+                LANE_PUT(reg, v[i]);
+            }
+            break;
+        case LANE_STORE:
+            Lanes_Write(lanes, m, uniform, ea, reg);
+            return 1;
+        case LANE_SBC:
+            LANES_FOR {
+                v[i] = ~v[i];
+            }
+            //SBC 等于加反码
+            //fallthrough
+        case LANE_ADC:
+            LANES_FOR {
+                Short sum = lanes->A[i] + v[i] + lanes->F_C[i];
+                LANE_PUT(lanes->F_V, ((lanes->A[i] ^ sum) & (v[i] ^ sum) & 0x80) != 0);
+                LANE_PUT(lanes->F_C, sum > 0xFF);
+                LANE_PUT(lanes->A, sum);
+            }
+            break;
+        case LANE_AND:
+            LANES_FOR {
+                LANE_PUT(lanes->A, lanes->A[i] & v[i]);
+            }
+            break;
+        case LANE_ORA:
+            LANES_FOR {
+                LANE_PUT(lanes->A, lanes->A[i] | v[i]);
+            }
+            break;
+        case LANE_EOR:
+            LANES_FOR {
+                LANE_PUT(lanes->A, lanes->A[i] ^ v[i]);
+            }
+            break;
+        case LANE_CMP:
+            LANES_FOR {
+                Byte res = reg[i] - v[i];
+                LANE_PUT(lanes->F_C, reg[i] >= v[i]);
+                LANE_PUT(lanes->F_N, res >> 7);
+                LANE_PUT(lanes->F_Z, res == 0);
+            }
+            return 1;
+        case LANE_BIT:
+            LANES_FOR {
+                LANE_PUT(lanes->F_Z, (lanes->A[i] & v[i]) == 0);
+                LANE_PUT(lanes->F_V, (v[i] >> 6) & 1);
+                LANE_PUT(lanes->F_N, v[i] >> 7);
+            }
+            return 1;
+        case LANE_INC:
+        case LANE_DEC:
+            LANES_FOR {
+                out[i] = v[i] + (op == LANE_INC ? 1 : -1);
+                LANE_PUT(lanes->F_N, out[i] >> 7);
+                LANE_PUT(lanes->F_Z, out[i] == 0);
+            }
+            Lanes_Write(lanes, m, uniform, ea, out);
+            return 1;
+        case LANE_INC_R:
+        case LANE_DEC_R:
+            LANES_FOR {
+                LANE_PUT(reg, reg[i] + (op == LANE_INC_R ? 1 : -1));
+            }
+            break;
+        case LANE_MOVE:
+            LANES_FOR {
+                LANE_PUT(reg, src[i]);
+            }
+            if (reg == lanes->SP) {
+                return 1;
+            }
+            break;
+        case LANE_FLAG:
+            LANES_FOR {
+                LANE_PUT(reg, value);
+            }
+            return 1;
+        case LANE_ASL:
+        case LANE_LSR:
+        case LANE_ROL:
+        case LANE_ROR: {
+            //累加器或内存, 经过进位移位
+            if (info->Mode == MODE_ACC) {
+                LANES_FOR {
+                    v[i] = lanes->A[i];
+                }
+            }
+            if (op == LANE_ASL || op == LANE_ROL) {
+                LANES_FOR {
+                    out[i] = v[i] << 1 | (op == LANE_ROL ? lanes->F_C[i] : 0);
+                    LANE_PUT(lanes->F_C, v[i] >> 7);
+                }
+            } else {
+                LANES_FOR {
+                    out[i] = v[i] >> 1 | (op == LANE_ROR ? lanes->F_C[i] << 7 : 0);
+                    LANE_PUT(lanes->F_C, v[i] & 1);
+                }
+            }
+            if (info->Mode == MODE_ACC) {
+                LANES_FOR {
+                    LANE_PUT(lanes->A, out[i]);
+                }
+                break;
+            }
+            LANES_FOR {
+                LANE_PUT(lanes->F_N, out[i] >> 7);
+                LANE_PUT(lanes->F_Z, out[i] == 0);
+            }
+            Lanes_Write(lanes, m, uniform, ea, out);
+            return 1;
+        }
+        case LANE_PUSH:
+            LANES_FOR {
+                if (m[i]) {
+                    LANE_MEM(0x100 | lanes->SP[i]) = lanes->A[i];
+                    lanes->SP[i]--;
+                }
+            }
+            return 1;
+        case LANE_PULL:
+            LANES_FOR {
+                if (m[i]) {
+                    lanes->SP[i]++;
+                    lanes->A[i] = LANE_MEM(0x100 | lanes->SP[i]);
+                }
+            }
+            break;
+        case LANE_BRANCH: {
+            //跳转加 1 周期, 跨页再加 1, 实例在这里分叉
+            Short next = pc + length;
+            Short target = OP_Branch_Target(pc, op1, length);
+            Byte penalty = 1 + ((next ^ target) >> 8 != 0);
+            LANES_FOR {
+                Byte taken = m[i] && reg[i] == value;
+                lanes->Cycles[i] += taken ? penalty : 0;
+                lanes->PC[i] = taken ? target : lanes->PC[i];
+            }
+            return 1;
+        }
+        case LANE_JMP:
+            LANES_FOR {
+                lanes->PC[i] = m[i] ? base : lanes->PC[i];
+            }
+            return 1;
+        case LANE_JSR:
+            //压入 JSR 最后一个字节的地址
+            LANES_FOR {
+                if (m[i]) {
+                    Short ret = pc + 2;
+                    LANE_MEM(0x100 | lanes->SP[i]) = ret >> 8;
+                    LANE_MEM(0x100 | (Byte) (lanes->SP[i] - 1)) = ret & 0xFF;
+                    lanes->SP[i] -= 2;
+                    lanes->PC[i] = base;
+                }
+            }
+            return 1;
+        case LANE_RTS:
+            LANES_FOR {
+                if (m[i]) {
+                    Byte low = LANE_MEM(0x100 | (Byte) (lanes->SP[i] + 1));
+                    Byte high = LANE_MEM(0x100 | (Byte) (lanes->SP[i] + 2));
+                    lanes->SP[i] += 2;
+                    lanes->PC[i] = (Short) ((low | high << 8) + 1);
+                }
+            }
+            return 1;
+        default:
+            return 1;
+    }
+    //结果写回了 reg (或 A), 更新 N/Z
+    if (op != LANE_LOAD && op != LANE_INC_R && op != LANE_DEC_R && op != LANE_MOVE) {
+        reg = lanes->A;
+    }
+    LANES_FOR {
+        LANE_PUT(lanes->F_N, reg[i] >> 7);
+        LANE_PUT(lanes->F_Z, reg[i] == 0);
+    }
+    return 1;
+}
+
+/**
+ * 实例没有中断源, WAI 和 CPU_Run 一样空转到结束
+ */
+static void Lanes_Idle(struct Lanes *lanes, const unsigned long long *end) {
+    for (int i = 0; i < lanes->Count; ++i) {
+        if (lanes->Halted[i] == CPU_WAIT && lanes->Cycles[i] < end[i]) {
+            lanes->Cycles[i] = end[i];
+        }
+    }
+}
+
+void Lanes_Run(struct Lanes *lanes, unsigned long long cycles) {
+    int n = lanes->Count;
+    unsigned long long end[LANES_MAX];
+    struct CPU_Context *saved = CPU_Current;
+    for (int i = 0; i < n; ++i) {
+        end[i] = lanes->Cycles[i] + cycles;
+    }
+    Lanes_Idle(lanes, end);
+    for (;;) {
+        Byte act[LANES_MAX];
+        Byte any = 0;
+        for (int i = 0; i < n; ++i) {
+            act[i] = (lanes->Halted[i] == CPU_RUN) & (lanes->Cycles[i] < end[i]);
+            any |= act[i];
+        }
+        if (!any) {
+            break;
+        }
+        //PC 最小的实例先执行, 分叉的循环会在后面汇合
+        Short pc = 0xFFFF;
+        for (int i = 0; i < n; ++i) {
+            Short key = act[i] ? lanes->PC[i] : 0xFFFF;
+            pc = key < pc ? key : pc;
+        }
+        int lead = 0;
+        while (!act[lead] || lanes->PC[lead] != pc) {
+            lead++;
+        }
+        Short pc1 = pc + 1;
+        Short pc2 = pc + 2;
+        Byte opcode = lanes->Mem[(size_t) pc * n + lead];
+        Byte op1 = lanes->Mem[(size_t) pc1 * n + lead];
+        Byte op2 = lanes->Mem[(size_t) pc2 * n + lead];
+        Byte length = OP_Length(opcode);
+        //每个实例的内存是独立的, 指令字节相同才能成组, 其余的留到下一轮
+        const Byte *row0 = &lanes->Mem[(size_t) pc * n];
+        const Byte *row1 = &lanes->Mem[(size_t) pc1 * n];
+        const Byte *row2 = &lanes->Mem[(size_t) pc2 * n];
+        Byte any1 = length > 1;
+        Byte any2 = length > 2;
+        Byte m[LANES_MAX];
+        for (int i = 0; i < n; ++i) {
+            m[i] = act[i] & (lanes->PC[i] == pc) & (row0[i] == opcode)
+                   & (!any1 | (row1[i] == op1)) & (!any2 | (row2[i] == op2));
+        }
+        if (Lanes_Vector(lanes, m, pc, opcode, op1, op2)) {
+            lanes->Vector_Ops++;
+            continue;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (m[i]) {
+                Lanes_Scalar(lanes, i);
+            }
+        }
+        //只有逐个执行的指令会停机
+        Lanes_Idle(lanes, end);
+    }
+    CPU_Select(saved);
+}
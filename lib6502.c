@@ -0,0 +1,690 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/lib6502.h"
+#include "include/cpu.h"
+#include "include/loader.h"
+#include "include/watch.h"
+#include "include/gdb.h"
+#include "include/mapper.h"
+#include "include/pool.h"
+#include "include/checkpoint.h"
+#include "include/replay.h"
+#include "include/pace.h"
+#include "include/metrics.h"
+#include "include/acia.h"
+#include "include/disk.h"
+#include "include/lanes.h"
+
+struct Lib6502_Watcher {
+    Lib6502_Watch_Fn Hit;
+    void *Ctx;
+};
+
+/**
+ * 句柄: 一个 CPU 和它独占的总线
+ * Devices 是总线 IO 表指向的设备, 最多每页一个
+ * Watchers 是每个观察点的回调, 下标和观察点编号相同
+ */
+struct Lib6502 {
+    struct Bus Bus;
+    struct CPU_Context Cpu;
+    struct Bus_Device Devices[256];
+    struct Watch Watch;
+    struct Lib6502_Watcher Watchers[WATCH_MAX];
+    struct GDB_Server *Debug;
+    struct Mapper *Mapper;
+    struct Pace Pace;
+    struct Metrics Metrics;
+    //串口和块设备, 寄存器页在 Serial_Addr/Disk_Regs
+    struct ACIA *Serial;
+    struct Disk *Disk;
+    Short Serial_Addr;
+    Short Disk_Regs;
+};
+
+struct Lib6502_Image {
+    struct Loader_Image Image;
+};
+
+struct Lib6502_Pool {
+    struct Pool Pool;
+};
+
+struct Lib6502_Checkpoint {
+    struct Checkpoint Checkpoint;
+};
+
+struct Lib6502_Lanes {
+    struct Lanes Lanes;
+};
+
+_Static_assert(LIB6502_LANES_MAX == LANES_MAX, "LIB6502_LANES_MAX differs from LANES_MAX");
+
+struct Lib6502_Replay {
+    struct Replay *Replay;
+};
+
+int Lib6502_Version(void) {
+    return LIB6502_VERSION;
+}
+
+int Lib6502_Variant(void) {
+#if CPU_VARIANT == CPU_65C02
+    return LIB6502_65C02;
+#elif CPU_VARIANT == CPU_2A03
+    return LIB6502_2A03;
+#else
+    return LIB6502_NMOS;
+#endif
+}
+
+Lib6502 *Lib6502_Create(void) {
+    Lib6502 *emu = aligned_alloc(BUS_CACHE_LINE, sizeof(*emu));
+    if (!emu) {
+        return NULL;
+    }
+    memset(emu->Devices, 0, sizeof(emu->Devices));
+    Bus_Init(&emu->Bus);
+    CPU_Init(&emu->Cpu, &emu->Bus);
+    Watch_Init(&emu->Watch, &emu->Bus);
+    emu->Debug = NULL;
+    emu->Mapper = NULL;
+    emu->Serial = NULL;
+    emu->Disk = NULL;
+    Pace_Init(&emu->Pace, 0);
+    Metrics_Init(&emu->Metrics, NULL);
+    Metrics_Attach(&emu->Cpu, &emu->Metrics);
+    return emu;
+}
+
+void Lib6502_Destroy(Lib6502 *emu) {
+    if (emu && emu->Debug) {
+        GDB_Close(emu->Debug);
+        free(emu->Debug);
+    }
+    if (emu) {
+        Lib6502_Detach_Serial(emu);
+        Lib6502_Detach_Disk(emu);
+    }
+    if (emu && emu->Mapper) {
+        Mapper_Free(emu->Mapper);
+        free(emu->Mapper);
+    }
+    if (emu && emu->Bus.Pool) {
+        Bus_Unshare(&emu->Bus);
+    }
+    if (emu) {
+        Metrics_Free(&emu->Metrics);
+    }
+    free(emu);
+}
+
+void Lib6502_Reset(Lib6502 *emu) {
+    CPU_Select(&emu->Cpu);
+    CPU_Reset(Bus_Peek(&emu->Bus, 0xFFFC) | Bus_Peek(&emu->Bus, 0xFFFD) << 8);
+}
+
+size_t Lib6502_Load(Lib6502 *emu, uint16_t addr, const void *data, size_t size) {
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    Bus_Load(&emu->Bus, addr, data, size);
+    return size;
+}
+
+void Lib6502_Map_ROM(Lib6502 *emu, uint16_t addr, const void *data, size_t size) {
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    Bus_Map_ROM(&emu->Bus, addr, data, size);
+}
+
+Lib6502_Image *Lib6502_Image_Open(const char *path, uint16_t addr) {
+    Lib6502_Image *image = malloc(sizeof(*image));
+    if (!image) {
+        return NULL;
+    }
+    if (Loader_Open(&image->Image, path, LOADER_AUTO, addr)) {
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+void Lib6502_Image_Close(Lib6502_Image *image) {
+    if (image) {
+        Loader_Close(&image->Image);
+        free(image);
+    }
+}
+
+int Lib6502_Image_Entry(const Lib6502_Image *image) {
+    return image->Image.Entry;
+}
+
+void Lib6502_Map_Image(Lib6502 *emu, const Lib6502_Image *image, int rom) {
+    Loader_Map(&image->Image, &emu->Bus, rom);
+}
+
+int Lib6502_Image_Mapper(const Lib6502_Image *image) {
+    return image->Image.Mapper;
+}
+
+int Lib6502_Set_Mapper(Lib6502 *emu, const char *spec, const void *rom, size_t size) {
+    if (emu->Mapper) {
+        Mapper_Free(emu->Mapper);
+        free(emu->Mapper);
+        emu->Mapper = NULL;
+    }
+    if (!spec) {
+        return 0;
+    }
+    struct Mapper *mapper = malloc(sizeof(*mapper));
+    if (!mapper || size > 0xFFFFFFFFu || Mapper_Init(mapper, &emu->Bus, spec, rom, size)) {
+        free(mapper);
+        return -1;
+    }
+    emu->Mapper = mapper;
+    return 0;
+}
+
+int Lib6502_Map_Image_Banks(Lib6502 *emu, const Lib6502_Image *image, const char *spec) {
+    char number[16];
+    if (!image->Image.Banks) {
+        return -1;
+    }
+    if (!spec) {
+        if (image->Image.Mapper < 0) {
+            return -1;
+        }
+        snprintf(number, sizeof(number), "#%d", image->Image.Mapper);
+        spec = number;
+    }
+    return Lib6502_Set_Mapper(emu, spec, image->Image.Banks, image->Image.Bank_Size);
+}
+
+uint8_t Lib6502_Peek(const Lib6502 *emu, uint16_t addr) {
+    return Bus_Peek(&emu->Bus, addr);
+}
+
+void Lib6502_Poke(Lib6502 *emu, uint16_t addr, uint8_t value) {
+    Bus_Poke(&emu->Bus, addr, value);
+}
+
+uint64_t Lib6502_Run_Cycles(Lib6502 *emu, uint64_t cycles) {
+    CPU_Select(&emu->Cpu);
+    unsigned long long done = CPU_Run(cycles);
+    //批次边界: 调试器可能在这里让 CPU 停下
+    if (emu->Debug) {
+        GDB_Poll(emu->Debug);
+    }
+    return done;
+}
+
+void Lib6502_Set_Clock(Lib6502 *emu, double hz, double speed) {
+    emu->Pace.Hz = hz;
+    Pace_Set_Speed(&emu->Pace, speed);
+}
+
+uint64_t Lib6502_Run_Realtime(Lib6502 *emu, uint64_t cycles) {
+    unsigned long long done = Pace_Run(&emu->Pace, &emu->Cpu, cycles);
+    if (emu->Debug) {
+        GDB_Poll(emu->Debug);
+    }
+    return done;
+}
+
+void Lib6502_Get_Pace_Stats(const Lib6502 *emu, Lib6502_Pace_Stats *stats) {
+    struct Pace_Stats value;
+    Pace_Get_Stats(&emu->Pace, &value);
+    stats->Batches = value.Batches;
+    stats->Cycles = value.Cycles;
+    stats->Overruns = value.Overruns;
+    stats->Resyncs = value.Resyncs;
+    stats->Jitter_Avg = value.Jitter_Avg;
+    stats->Jitter_Max = value.Jitter_Max;
+    stats->Busy = value.Busy;
+    stats->Sleep = value.Sleep;
+    stats->Drift = value.Drift;
+}
+
+unsigned int Lib6502_Step(Lib6502 *emu) {
+    CPU_Select(&emu->Cpu);
+    unsigned long long start = CPU.Cycles;
+    //单步时不融合、不快进
+    CPU_Step();
+    return CPU.Cycles - start;
+}
+
+int Lib6502_Step_Async(Lib6502 *emu, uint64_t budget, uint64_t *ran) {
+    CPU_Select(&emu->Cpu);
+    unsigned long long done;
+    int reason = CPU_Slice(budget, &done);
+    if (ran) {
+        *ran = done;
+    }
+    //CPU_SLICE_xxx 和 LIB6502_xxx 一一对应
+    return reason;
+}
+
+int Lib6502_Suspend(Lib6502 *emu) {
+    return CPU_Suspend(&emu->Cpu);
+}
+
+void Lib6502_Resume(Lib6502 *emu) {
+    CPU_Resume(&emu->Cpu);
+}
+
+void Lib6502_Yield(Lib6502 *emu) {
+    CPU_Yield(&emu->Cpu);
+}
+
+/**
+ * 寄存器快照和 CPU 上下文之间的转换, 句柄和多实例共用
+ */
+static void Lib6502_Regs_Get(const struct CPU_Context *cpu, Lib6502_Regs *regs) {
+    regs->PC = cpu->PC;
+    regs->SP = cpu->SP;
+    regs->A = cpu->A;
+    regs->X = cpu->X;
+    regs->Y = cpu->Y;
+    regs->P = (cpu->F_N << 7) | (cpu->F_V << 6) | 0x20 | (cpu->F_D << 3)
+              | (cpu->F_I << 2) | (cpu->F_Z << 1) | cpu->F_C;
+    regs->Halted = cpu->Halted;
+    regs->Cycles = cpu->Cycles;
+}
+
+static void Lib6502_Regs_Set(struct CPU_Context *cpu, const Lib6502_Regs *regs) {
+    cpu->PC = regs->PC;
+    cpu->SP = regs->SP;
+    cpu->A = regs->A;
+    cpu->X = regs->X;
+    cpu->Y = regs->Y;
+    cpu->F_N = regs->P >> 7;
+    cpu->F_V = (regs->P >> 6) & 1;
+    cpu->F_D = (regs->P >> 3) & 1;
+    cpu->F_I = (regs->P >> 2) & 1;
+    cpu->F_Z = (regs->P >> 1) & 1;
+    cpu->F_C = regs->P & 1;
+    cpu->Halted = regs->Halted;
+    CPU_Set_Cycles(cpu, regs->Cycles);
+}
+
+void Lib6502_Get_Regs(const Lib6502 *emu, Lib6502_Regs *regs) {
+    Lib6502_Regs_Get(&emu->Cpu, regs);
+}
+
+void Lib6502_Set_Regs(Lib6502 *emu, const Lib6502_Regs *regs) {
+    Lib6502_Regs_Set(&emu->Cpu, regs);
+}
+
+/**
+ * 找一个没有被任何页引用的设备槽
+ */
+static struct Bus_Device *Lib6502_Free_Device(Lib6502 *emu) {
+    Byte used[256] = {0};
+    for (int page = 0; page < 256; ++page) {
+        if (emu->Bus.IO[page]) {
+            used[emu->Bus.IO[page] - emu->Devices] = 1;
+        }
+    }
+    for (int i = 0; i < 256; ++i) {
+        if (!used[i]) {
+            return &emu->Devices[i];
+        }
+    }
+    return NULL;
+}
+
+int Lib6502_Map_IO(Lib6502 *emu, uint16_t start, uint16_t end,
+                   Lib6502_Read_Fn read, Lib6502_Write_Fn write, void *ctx) {
+    //先取消映射, 被完全覆盖的旧设备槽可以复用
+    Lib6502_Unmap_IO(emu, start, end);
+    struct Bus_Device *device = Lib6502_Free_Device(emu);
+    if (!device) {
+        return -1;
+    }
+    device->Read = read;
+    device->Write = write;
+    device->Ctx = ctx;
+    Bus_Map_IO(&emu->Bus, start, end, device);
+    return 0;
+}
+
+void Lib6502_Unmap_IO(Lib6502 *emu, uint16_t start, uint16_t end) {
+    Bus_Map_IO(&emu->Bus, start, end, NULL);
+}
+
+static int Lib6502_Watch_Hit(void *ctx, const struct Watch_Hit *hit) {
+    Lib6502 *emu = ctx;
+    struct Lib6502_Watcher *watcher = &emu->Watchers[hit->Point];
+    return !watcher->Hit || watcher->Hit(watcher->Ctx, hit->Addr, hit->Value, hit->Kind);
+}
+
+int Lib6502_Watch(Lib6502 *emu, uint16_t start, uint16_t end, int kinds, const char *cond,
+                  Lib6502_Watch_Fn hit, void *ctx) {
+    struct Watch_Point point = {0};
+    point.Kind = kinds & (WATCH_READ | WATCH_WRITE | WATCH_EXEC);
+    point.Start = start;
+    point.End = end;
+    point.Hit = Lib6502_Watch_Hit;
+    point.Ctx = emu;
+    if (!point.Kind || Watch_Parse_Cond(&point, cond ? cond : "")) {
+        return -1;
+    }
+    int id = Watch_Add(&emu->Watch, &point);
+    if (id >= 0) {
+        emu->Watchers[id].Hit = hit;
+        emu->Watchers[id].Ctx = ctx;
+    }
+    return id;
+}
+
+void Lib6502_Unwatch(Lib6502 *emu, int id) {
+    Watch_Remove(&emu->Watch, id);
+}
+
+int Lib6502_Debug_Listen(Lib6502 *emu, const char *address) {
+    if (emu->Debug) {
+        GDB_Close(emu->Debug);
+    } else {
+        emu->Debug = malloc(sizeof(*emu->Debug));
+        if (!emu->Debug) {
+            return -1;
+        }
+    }
+    if (GDB_Listen(emu->Debug, address, &emu->Cpu, &emu->Watch)) {
+        free(emu->Debug);
+        emu->Debug = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void Lib6502_Set_IRQ(Lib6502 *emu, int source, int level) {
+    CPU_Set_IRQ(&emu->Cpu, 1 << (source & 7), level != 0);
+}
+
+void Lib6502_NMI(Lib6502 *emu) {
+    CPU_NMI(&emu->Cpu);
+}
+
+int Lib6502_Attach_Serial(Lib6502 *emu, uint16_t addr, int in_fd, int out_fd, int irq, double hz) {
+    Lib6502_Detach_Serial(emu);
+    struct ACIA *acia = malloc(sizeof(*acia));
+    if (!acia || ACIA_Open(acia, &emu->Cpu, in_fd, out_fd, irq < 0 ? 0 : 1 << (irq & 7), hz)) {
+        free(acia);
+        return -1;
+    }
+    if (Lib6502_Map_IO(emu, addr, addr, ACIA_Read, ACIA_Write, acia)) {
+        ACIA_Close(acia);
+        free(acia);
+        return -1;
+    }
+    emu->Serial = acia;
+    emu->Serial_Addr = addr;
+    return 0;
+}
+
+void Lib6502_Detach_Serial(Lib6502 *emu) {
+    if (emu->Serial) {
+        Lib6502_Unmap_IO(emu, emu->Serial_Addr, emu->Serial_Addr);
+        ACIA_Close(emu->Serial);
+        free(emu->Serial);
+        emu->Serial = NULL;
+    }
+}
+
+int Lib6502_Attach_Disk(Lib6502 *emu, uint16_t regs, uint16_t window, const char *path, int read_only) {
+    Lib6502_Detach_Disk(emu);
+    //窗口占两页, 不能盖住寄存器页
+    int page = window >> 8;
+    if (page + (DISK_SECTOR >> 8) > 256 || ((regs >> 8) >= page && (regs >> 8) < page + (DISK_SECTOR >> 8))) {
+        return -1;
+    }
+    struct Disk *disk = malloc(sizeof(*disk));
+    if (!disk || Disk_Open(disk, &emu->Bus, path, window, read_only)) {
+        free(disk);
+        return -1;
+    }
+    if (Lib6502_Map_IO(emu, regs, regs, Disk_Read, Disk_Write, disk)) {
+        Disk_Close(disk);
+        free(disk);
+        return -1;
+    }
+    emu->Disk = disk;
+    emu->Disk_Regs = regs;
+    return 0;
+}
+
+void Lib6502_Detach_Disk(Lib6502 *emu) {
+    if (emu->Disk) {
+        Lib6502_Unmap_IO(emu, emu->Disk_Regs, emu->Disk_Regs);
+        Disk_Close(emu->Disk);
+        free(emu->Disk);
+        emu->Disk = NULL;
+    }
+}
+
+Lib6502_Pool *Lib6502_Pool_Create(void) {
+    Lib6502_Pool *pool = malloc(sizeof(*pool));
+    if (pool) {
+        Pool_Init(&pool->Pool);
+    }
+    return pool;
+}
+
+void Lib6502_Pool_Destroy(Lib6502_Pool *pool) {
+    if (pool) {
+        Pool_Free(&pool->Pool);
+        free(pool);
+    }
+}
+
+int Lib6502_Share(Lib6502 *emu, Lib6502_Pool *pool) {
+    return Bus_Share(&emu->Bus, &pool->Pool);
+}
+
+void Lib6502_Pool_Get_Stats(Lib6502_Pool *pool, Lib6502_Pool_Stats *stats) {
+    struct Pool_Stats value;
+    Pool_Get_Stats(&pool->Pool, &value);
+    stats->Pages = value.Pages;
+    stats->Refs = value.Refs;
+    stats->Pool_Bytes = value.Pool_Bytes;
+    stats->Saved_Bytes = value.Saved_Bytes;
+    stats->Zero_Pages = value.Zero_Pages;
+    stats->Splits = value.Splits;
+    stats->Released_Bytes = value.Released_Bytes;
+}
+
+Lib6502_Checkpoint *Lib6502_Checkpoint_Create(Lib6502 *emu, const char *path) {
+    //块设备的窗口映射在文件上, 恢复时会把内存写进当时选中的扇区;
+    //串口的状态和定时器不在检查点里, 恢复出来的 IRQ 线对不上串口
+    if (emu->Disk || emu->Serial) {
+        return NULL;
+    }
+    Lib6502_Checkpoint *ckpt = malloc(sizeof(*ckpt));
+    if (ckpt && Checkpoint_Init(&ckpt->Checkpoint, &emu->Cpu, emu->Mapper, path)) {
+        free(ckpt);
+        ckpt = NULL;
+    }
+    return ckpt;
+}
+
+void Lib6502_Checkpoint_Destroy(Lib6502_Checkpoint *ckpt) {
+    if (ckpt) {
+        Checkpoint_Free(&ckpt->Checkpoint);
+        free(ckpt);
+    }
+}
+
+int Lib6502_Checkpoint_Save(Lib6502_Checkpoint *ckpt) {
+    return Checkpoint_Take(&ckpt->Checkpoint);
+}
+
+int Lib6502_Checkpoint_Wait(Lib6502_Checkpoint *ckpt) {
+    return Checkpoint_Wait(&ckpt->Checkpoint);
+}
+
+int Lib6502_Checkpoint_Restore(Lib6502_Checkpoint *ckpt, const char *path) {
+    return Checkpoint_Restore(&ckpt->Checkpoint, path);
+}
+
+/**
+ * 录制和回放共用的包装
+ * @param play 1 回放, 0 录制
+ */
+static Lib6502_Replay *Lib6502_Replay_Open(Lib6502 *emu, const char *path, int play) {
+    Lib6502_Replay *replay = malloc(sizeof(*replay));
+    if (!replay) {
+        return NULL;
+    }
+    replay->Replay = play ? Replay_Play(&emu->Cpu, path) : Replay_Record(&emu->Cpu, path);
+    if (!replay->Replay) {
+        free(replay);
+        return NULL;
+    }
+    return replay;
+}
+
+Lib6502_Replay *Lib6502_Record_Start(Lib6502 *emu, const char *path) {
+    return Lib6502_Replay_Open(emu, path, 0);
+}
+
+Lib6502_Replay *Lib6502_Replay_Start(Lib6502 *emu, const char *path) {
+    return Lib6502_Replay_Open(emu, path, 1);
+}
+
+uint64_t Lib6502_Replay_Close(Lib6502_Replay *replay) {
+    if (!replay) {
+        return 0;
+    }
+    //回放结束时日志还没用完也算不一致
+    uint64_t mismatch = replay->Replay->Mismatch
+                        + (replay->Replay->Mode == REPLAY_PLAY && replay->Replay->Next != REPLAY_END);
+    Replay_Close(replay->Replay);
+    free(replay);
+    return mismatch;
+}
+
+Lib6502_Lanes *Lib6502_Lanes_Create(int count) {
+    if (count < 1 || count > LIB6502_LANES_MAX) {
+        return NULL;
+    }
+    Lib6502_Lanes *lanes = malloc(sizeof(*lanes));
+    if (lanes && Lanes_Init(&lanes->Lanes, count)) {
+        free(lanes);
+        lanes = NULL;
+    }
+    return lanes;
+}
+
+void Lib6502_Lanes_Destroy(Lib6502_Lanes *lanes) {
+    if (lanes) {
+        Lanes_Free(&lanes->Lanes);
+        free(lanes);
+    }
+}
+
+void Lib6502_Lanes_Reset(Lib6502_Lanes *lanes) {
+    struct Lanes *group = &lanes->Lanes;
+    Lanes_Reset(group, 0);
+    for (int i = 0; i < group->Count; ++i) {
+        group->PC[i] = Lanes_Peek(group, i, 0xFFFC) | Lanes_Peek(group, i, 0xFFFD) << 8;
+    }
+}
+
+size_t Lib6502_Lanes_Load(Lib6502_Lanes *lanes, int lane, uint16_t addr, const void *data, size_t size) {
+    if (size > 0x10000u - addr) {
+        size = 0x10000u - addr;
+    }
+    Lanes_Load(&lanes->Lanes, lane, addr, data, size);
+    return size;
+}
+
+uint8_t Lib6502_Lanes_Peek(const Lib6502_Lanes *lanes, int lane, uint16_t addr) {
+    return Lanes_Peek(&lanes->Lanes, lane, addr);
+}
+
+void Lib6502_Lanes_Poke(Lib6502_Lanes *lanes, int lane, uint16_t addr, uint8_t value) {
+    Lanes_Poke(&lanes->Lanes, lane, addr, value);
+}
+
+void Lib6502_Lanes_Get_Regs(const Lib6502_Lanes *lanes, int lane, Lib6502_Regs *regs) {
+    struct CPU_Context cpu;
+    Lanes_Get(&lanes->Lanes, lane, &cpu);
+    Lib6502_Regs_Get(&cpu, regs);
+}
+
+void Lib6502_Lanes_Set_Regs(Lib6502_Lanes *lanes, int lane, const Lib6502_Regs *regs) {
+    struct CPU_Context cpu;
+    Lanes_Get(&lanes->Lanes, lane, &cpu);
+    Lib6502_Regs_Set(&cpu, regs);
+    Lanes_Set(&lanes->Lanes, lane, &cpu);
+}
+
+void Lib6502_Lanes_Run_Cycles(Lib6502_Lanes *lanes, uint64_t cycles) {
+    Lanes_Run(&lanes->Lanes, cycles);
+}
+
+void Lib6502_Lanes_Get_Stats(const Lib6502_Lanes *lanes, Lib6502_Lanes_Stats *stats) {
+    stats->Vector_Ops = lanes->Lanes.Vector_Ops;
+    stats->Scalar_Ops = lanes->Lanes.Scalar_Ops;
+}
+
+//导出服务, 进程里只有一个
+static struct Metrics_Server *Lib6502_Metrics_Server;
+
+static void Lib6502_Copy_Metrics(Lib6502_Metrics *metrics, const unsigned long long values[METRIC_COUNT]) {
+    metrics->Instructions = values[METRIC_INSTRUCTIONS];
+    metrics->Cycles = values[METRIC_CYCLES];
+    metrics->Interrupts = values[METRIC_INTERRUPTS];
+    metrics->Fused = values[METRIC_FUSED];
+    metrics->Idle_Cycles = values[METRIC_IDLE_CYCLES];
+    metrics->Page_Faults = values[METRIC_PAGE_FAULTS];
+    metrics->Watch_Hits = values[METRIC_WATCH_HITS];
+    metrics->Runs = values[METRIC_RUNS];
+}
+
+void Lib6502_Set_Name(Lib6502 *emu, const char *name) {
+    Metrics_Set_Name(&emu->Metrics, name);
+}
+
+void Lib6502_Get_Metrics(const Lib6502 *emu, Lib6502_Metrics *metrics) {
+    unsigned long long values[METRIC_COUNT];
+    Metrics_Read(&emu->Metrics, values);
+    Lib6502_Copy_Metrics(metrics, values);
+}
+
+int Lib6502_Get_Fleet_Metrics(Lib6502_Metrics *metrics) {
+    unsigned long long values[METRIC_COUNT];
+    int count = Metrics_Read_Fleet(values);
+    Lib6502_Copy_Metrics(metrics, values);
+    return count;
+}
+
+int Lib6502_Metrics_Save(const char *path) {
+    return Metrics_Save(path);
+}
+
+int Lib6502_Metrics_Listen(const char *address) {
+    if (Lib6502_Metrics_Server) {
+        return -1;
+    }
+    struct Metrics_Server *server = malloc(sizeof(*server));
+    if (!server || Metrics_Listen(server, address)) {
+        free(server);
+        return -1;
+    }
+    Lib6502_Metrics_Server = server;
+    return 0;
+}
+
+void Lib6502_Metrics_Close(void) {
+    if (Lib6502_Metrics_Server) {
+        Metrics_Close(Lib6502_Metrics_Server);
+        free(Lib6502_Metrics_Server);
+        Lib6502_Metrics_Server = NULL;
+    }
+}
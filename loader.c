@@ -0,0 +1,260 @@
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "include/loader.h"
+
+#define NES_BANK 0x4000
+//Atari 的运行地址向量
+#define XEX_RUNAD 0x02E0
+
+static int Loader_Add(struct Loader_Image *image, unsigned long addr, const Byte *data, unsigned long size) {
+    if (image->Count == LOADER_SEGMENTS || addr > 0xFFFF || size > 0x10000 - addr) {
+        return -1;
+    }
+    struct Loader_Segment *segment = &image->Segments[image->Count++];
+    segment->Addr = addr;
+    segment->Size = size;
+    segment->Data = data;
+    return 0;
+}
+
+static int Loader_Extension(const char *path, const char *ext) {
+    const char *dot = strrchr(path, '.');
+    return dot && strcasecmp(dot + 1, ext) == 0;
+}
+
+static int Loader_Guess(const Byte *data, size_t size, const char *path) {
+    if (size >= 4 && memcmp(data, "NES\x1A", 4) == 0) {
+        return LOADER_NES;
+    }
+    if (size >= 2 && data[0] == 0xFF && data[1] == 0xFF) {
+        return LOADER_XEX;
+    }
+    if (Loader_Extension(path, "hex") || Loader_Extension(path, "ihx") || Loader_Extension(path, "ihex")) {
+        return LOADER_IHEX;
+    }
+    if (Loader_Extension(path, "prg")) {
+        return LOADER_PRG;
+    }
+    return LOADER_RAW;
+}
+
+static int Loader_Hex(const Byte *p, const Byte *end, unsigned int count, unsigned long *value) {
+    *value = 0;
+    if (end - p < count) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        Byte c = p[i];
+        int digit = c >= '0' && c <= '9' ? c - '0'
+                  : c >= 'A' && c <= 'F' ? c - 'A' + 10
+                  : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        *value = *value << 4 | digit;
+    }
+    return 0;
+}
+
+/**
+ * 解码 Intel HEX, 数据解码到 Buffer 的对应地址, 地址连续的记录合并成一段
+ * 只支持 64K 以内的地址(扩展地址记录必须为 0)
+ */
+static int Loader_IHEX(struct Loader_Image *image) {
+    const Byte *p = image->Map;
+    const Byte *end = p + image->Map_Size;
+    image->Buffer = calloc(1, 0x10000);
+    if (!image->Buffer) {
+        return -1;
+    }
+    while (p < end) {
+        if (*p != ':') {
+            p++;
+            continue;
+        }
+        p++;
+        unsigned long count, addr, type, value;
+        if (Loader_Hex(p, end, 2, &count) || Loader_Hex(p + 2, end, 4, &addr) || Loader_Hex(p + 6, end, 2, &type)) {
+            return -1;
+        }
+        //字节数 + 地址 + 类型 + 数据 + 校验和
+        Byte sum = count + (addr >> 8) + addr + type;
+        Byte record[255];
+        p += 8;
+        for (unsigned long i = 0; i <= count; ++i, p += 2) {
+            if (Loader_Hex(p, end, 2, &value)) {
+                return -1;
+            }
+            sum += value;
+            if (i < count) {
+                record[i] = value;
+            }
+        }
+        if (sum) {
+            return -1;
+        }
+        value = 0;
+        for (unsigned long i = 0; i < count && i < 4; ++i) {
+            value = value << 8 | record[i];
+        }
+        if (type == 0) {
+            if (addr + count > 0x10000) {
+                return -1;
+            }
+            memcpy(image->Buffer + addr, record, count);
+            struct Loader_Segment *last = image->Count ? &image->Segments[image->Count - 1] : NULL;
+            if (last && last->Addr + last->Size == addr) {
+                last->Size += count;
+            } else if (count && Loader_Add(image, addr, image->Buffer + addr, count)) {
+                return -1;
+            }
+        } else if (type == 1) {
+            break;
+        } else if (type == 2 || type == 4) {
+            if (value) {
+                return -1;
+            }
+        } else if (type == 3 || type == 5) {
+            //03 为 CS:IP
+            value = type == 3 ? (value >> 16) * 16 + (value & 0xFFFF) : value;
+            image->Entry = value <= 0xFFFF ? (int) value : -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int Loader_XEX(struct Loader_Image *image) {
+    const Byte *data = image->Map;
+    size_t size = image->Map_Size;
+    size_t pos = 0;
+    while (pos < size) {
+        if (size - pos >= 2 && data[pos] == 0xFF && data[pos + 1] == 0xFF) {
+            pos += 2;
+            continue;
+        }
+        if (size - pos < 4) {
+            return -1;
+        }
+        unsigned long start = data[pos] | data[pos + 1] << 8;
+        unsigned long last = data[pos + 2] | data[pos + 3] << 8;
+        pos += 4;
+        if (last < start || size - pos < last - start + 1) {
+            return -1;
+        }
+        if (Loader_Add(image, start, data + pos, last - start + 1)) {
+            return -1;
+        }
+        if (start <= XEX_RUNAD && last >= XEX_RUNAD + 1) {
+            image->Entry = data[pos + XEX_RUNAD - start] | data[pos + XEX_RUNAD + 1 - start] << 8;
+        }
+        pos += last - start + 1;
+    }
+    return 0;
+}
+
+/**
+ * 第一个 PRG 块在 $8000, 最后一个在 $C000 (NROM 和 UxROM 上电时的布局)
+ */
+static int Loader_NES(struct Loader_Image *image) {
+    const Byte *data = image->Map;
+    size_t size = image->Map_Size;
+    if (size < 16) {
+        return -1;
+    }
+    size_t banks = data[4];
+    size_t offset = 16 + (data[6] & 0x04 ? 512 : 0);
+    if (banks == 0 || size < offset + banks * NES_BANK) {
+        return -1;
+    }
+    image->Banks = data + offset;
+    image->Bank_Size = banks * NES_BANK;
+    image->Mapper = data[6] >> 4 | (data[7] & 0xF0);
+    Loader_Add(image, 0x8000, data + offset, NES_BANK);
+    return Loader_Add(image, 0xC000, data + offset + (banks - 1) * NES_BANK, NES_BANK);
+}
+
+int Loader_Open(struct Loader_Image *image, const char *path, int format, Short addr) {
+    memset(image, 0, sizeof(*image));
+    image->Entry = -1;
+    image->Mapper = -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+    image->Map_Size = st.st_size;
+    if (image->Map_Size) {
+        image->Map = mmap(NULL, image->Map_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (image->Map == MAP_FAILED) {
+        image->Map = NULL;
+        return -1;
+    }
+    const Byte *data = image->Map;
+    if (format == LOADER_AUTO) {
+        format = Loader_Guess(data, image->Map_Size, path);
+    }
+    image->Format = format;
+    int result;
+    switch (format) {
+        case LOADER_RAW:
+            image->Banks = data;
+            image->Bank_Size = image->Map_Size;
+            result = Loader_Add(image, addr, data, image->Map_Size < 0x10000u - addr ? image->Map_Size : 0x10000u - addr);
+            break;
+        case LOADER_IHEX:
+            result = Loader_IHEX(image);
+            break;
+        case LOADER_PRG:
+            result = image->Map_Size < 2 ? -1 :
+                     Loader_Add(image, data[0] | data[1] << 8, data + 2, image->Map_Size - 2);
+            break;
+        case LOADER_XEX:
+            result = Loader_XEX(image);
+            break;
+        case LOADER_NES:
+            result = Loader_NES(image);
+            break;
+        default:
+            result = -1;
+    }
+    if (result) {
+        Loader_Close(image);
+    }
+    return result;
+}
+
+void Loader_Map(const struct Loader_Image *image, struct Bus *bus, int rom) {
+    for (int i = 0; i < image->Count; ++i) {
+        const struct Loader_Segment *segment = &image->Segments[i];
+        if (rom) {
+            Bus_Map_ROM(bus, segment->Addr, segment->Data, segment->Size);
+        } else {
+            Bus_Load(bus, segment->Addr, segment->Data, segment->Size);
+        }
+    }
+}
+
+void Loader_Close(struct Loader_Image *image) {
+    if (image->Map) {
+        munmap(image->Map, image->Map_Size);
+    }
+    free(image->Buffer);
+    image->Map = NULL;
+    image->Buffer = NULL;
+    image->Banks = NULL;
+    image->Bank_Size = 0;
+    image->Count = 0;
+}
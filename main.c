@@ -1,1204 +1,388 @@
 #include <stdio.h>
-#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "include/compiler.h"
-
-#define Byte unsigned char
-#define byte char
-#define Short unsigned short
-
-struct CPU {
-    Short PC;
-    Byte SP;
-    Short Mem[0XFFFF];
-    Byte A, X, Y;
-    Byte F_N;
-    Byte F_V;
-    Byte F_B;
-    Byte F_D;
-    Byte F_I;
-    Byte F_Z;
-    Byte F_C;
-    Byte INS_Cycles;
-} CPU;
-
-void CPU_Reset(Short PCAddr) {
-    CPU.PC = PCAddr;
-    CPU.SP = 0xFF;
-    CPU.A = CPU.X = CPU.Y = 0;
-    CPU.F_B = 1;
-    CPU.F_N = CPU.F_V = CPU.F_D = CPU.F_I = CPU.F_Z = CPU.F_C = 0;
-}
-
-Byte CPU_Read_Addr(Short addr) {
-    CPU.INS_Cycles += 1;
-    return CPU.Mem[addr];
-}
-
-Byte CPU_Get_Byte() {
-    return CPU_Read_Addr(CPU.PC++);
-}
-
-Short concat_byte(Byte low, Byte high) {
-    return low | (high << 8);
-}
-
-Byte CPU_Write_Addr(Short addr, Byte value) {
-    CPU.INS_Cycles += 1;
-    return CPU.Mem[addr] = value;
-}
-
-void CPU_Stack_Push_Byte(Byte value) {
-    CPU_Write_Addr(CPU.SP,value);
-    CPU.SP--;
-}
-
-Byte CPU_Stack_Pull_Byte() {
-    CPU.SP++;
-    return CPU_Read_Addr(CPU.SP);
-}
-
-void CPU_Stack_Push_Short(Short value) {
-    CPU_Stack_Push_Byte(value&0xff);
-    CPU_Stack_Push_Byte((value>>8)&0xff);
-}
-
-Short CPU_Stack_Pull_Short() {
-    Byte high = CPU_Stack_Pull_Byte();
-    Byte low = CPU_Stack_Pull_Byte();
-    return concat_byte(low,high);
-}
-
-void Pull_Flag() {
-    Byte flag = CPU_Stack_Pull_Byte();
-    CPU.F_N = flag>>7;
-    CPU.F_V = (flag>>6)&1;
-    CPU.F_D = (flag>>3)&1;
-    CPU.F_I = (flag>>2)&1;
-    CPU.F_Z = (flag>>1)&1;
-    CPU.F_C = flag&1;
-    CPU.INS_Cycles += 1;
-}
-
-void Push_Flag() {
-    Byte flag = (CPU.F_N<<7)
-                | (CPU.F_V<<6)
-                | (CPU.F_D<<3)
-                | (CPU.F_I<<2)
-                | (CPU.F_Z<<1)
-                | CPU.F_C;
-    CPU_Stack_Push_Byte(flag);
-}
-
-//-------------寻址方式开始-----------------
-// AM: Addressing Mode
-
-/**
- * 直接寻址
- * @param reg
- * @return
- */
-Byte AM_IMM() {
-
-    return CPU_Get_Byte();
-}
-
-/**
- * 绝对寻址
- * Absolute: a
- * @param low
- * @param high
- * @return
- */
-Short AM_Abs() {
-    Byte low = CPU_Get_Byte();
-    Byte high = CPU_Get_Byte();
-    return concat_byte(low, high);
-}
-
-/**
- * 绝对索引寻址
- * Absolute Indexed with REG: a,REG
- * REG = CPU.X/CPU.Y
- * @param low
- * @param high
- * @param reg
- * @return
- */
-Short AM_Abs_XY(Byte reg) {
-    Short abs = AM_Abs();
-    Short absRegAddr = abs + reg;
-    //page boundary is crossed
-    CPU.INS_Cycles += ((abs ^ absRegAddr) >> 8) > 0;
-    return absRegAddr;
-}
-
-/**
- * 零页寻址
- * @return
- */
-Short AM_ZP() {
-
-    return CPU_Get_Byte();
-}
-
-/**
- * 零页索引寻址
- * @param reg
- * @return
- */
-Short AM_ZP_XY(Byte reg) {
-    CPU.INS_Cycles++;
-    return AM_ZP() + reg;
-}
-
-/**
- * 零页索引间接寻址 X
- * @return
- */
-Short AM_ZP_IND_X() {
-    Short low = AM_ZP_XY(CPU.X);
-    return concat_byte(CPU_Read_Addr(low), CPU_Read_Addr(low + 1));
-}
-
-/**
- * 零页间接索引寻址 Y
- * @return
- */
-Short AM_ZP_IND_Y() {
-    Short low = AM_ZP();
-    Short address_1 = concat_byte(CPU_Read_Addr(low), CPU_Read_Addr(low + 1));
-    Short address_2 = address_1 + CPU.Y;
-    //page boundary is crossed
-    CPU.INS_Cycles += ((address_1 ^ address_2) >> 8) > 0;
-    return address_2;
-}
-
-/**
- * 间接寻址
- * @return
- */
-Short AM_ZP_INDIRECT() {
-    Short addr = AM_Abs();
-    return concat_byte(CPU_Read_Addr(addr), CPU_Read_Addr(addr + 1));
-}
-
-//-------------寻址方式结束-----------------
-
-//-------------FLAG设置开始-----------------
-
-void CPU_F_NZ(Byte data) {
-    CPU.F_N = data >> 7;
-    CPU.F_Z = data == 0;
-}
-
-/**
- *  A - M
- *  注意: 实际使用的是 REG_x - input(M) 是减法
- *          	        N	Z	C
- *  Register < Memory	1	0	0
- *  Register = Memory	0	1	1
- *  Register > Memory	0	0	1
- * @param input
- */
-void CPU_F_Compare(Byte reg, Byte input) {
-    CPU.INS_Cycles += 1;
-    Byte res = reg - input;
-    CPU_F_NZ(res);
-    //unsigned
-    CPU.F_C = reg >= input;
-}
-
-//-------------FLAG设置结束-----------------
-
-//-------------指令开始-----------------
-
-/**
- * AXY寄存器设置值
- * @param value 值
- * @param reg AXY寄存器
- */
-void INS_Set_REG(Byte value, Byte *reg) {
-    *reg = value;
-    CPU_F_NZ(*reg);
-    CPU.INS_Cycles += 1;
-}
-
-/**
- * 保存寄存器的值到内存地址
- * @param value 值
- * @param reg AXY寄存器
- */
-void INS_REG_To_MEM(Short address, Byte REG_Value) {
-    CPU.INS_Cycles += 1;
-    CPU_Write_Addr(address, REG_Value);
-}
-
-/**
- * 相加保存寄存器A
- * A + M + C -> A
- * Flags: N, V, Z, C
- * @param value M值
- */
-void INS_ADC(Byte value) {
-    CPU.INS_Cycles += 1;
-    //结果为0x80代表是相同符号 返回0代表不同符号 同符号相加减才会溢出/进位
-    Byte same_sign = (CPU.A ^ value) >> 7;
-    Short sum_value = CPU.A + value + CPU.F_C;
-    CPU.A = sum_value & 0xFF;
-    CPU_F_NZ(CPU.A);
-    //无符号数越界->进位 0-256
-    CPU.F_C = sum_value > 0xFF;
-    //有符号数越界->溢出 -128-127
-    CPU.F_V = same_sign && ((CPU.A ^ value)>>7);
-}
-
-/**
- * 相减保存寄存器A
- * A - M - ~C -> A
- * Flags: N, V, Z, C
- * @param value M值
- */
-void INS_SBC(Byte value) {
-    INS_ADC(~value);
-}
-
-/**
- * 内存值加减
- * M + 1 -> M
- * Flags: N, Z
- * @param value M值
- * @param value2 1/-1
- */
-void INS_INC_DEC(Short address,byte value) {
-    CPU.INS_Cycles += 2;
-    Byte data = CPU_Read_Addr(address);
-    data = data + value;
-    CPU_Write_Addr(address, data);
-    CPU_F_NZ(data);
-}
-
-/**
- * 内存值加减
- * M + 1 -> M
- * Flags: N, Z
- * @param value M值
- * @param value2 1/-1
- */
-void INS_INC_DEC_XY(Byte *REG,byte value) {
-    *REG = *REG + value;
-    CPU_F_NZ(*REG);
-}
-
-/**
- * 算术左移一位
- * Flags: N, Z, C
- * @param value 值
- */
-Byte INS_ASL(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.F_C = value>>7;
-    value<<=1;
-    CPU_F_NZ(value);
-    return value;
-}
-
-/**
- * 逻辑右移一位
- * Flags: N, Z, C
- * @param value 值
- */
-Byte INS_LSR(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.F_C = value & 1;
-    value>>=1;
-    CPU_F_NZ(value);
-    return value;
-}
-
-
-/**
- * 循环左移一位
- * Flags: N, Z, C
- * @param value 值
- */
-Byte INS_ROL(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.F_C = (value>>7) & 0x1;
-    value<<=1;
-    value = CPU.F_C ? value|0x1 : value&0xFE;
-    CPU_F_NZ(value);
-    return value;
-}
-
-/**
- * 循环右移一位
- * Flags: N, Z, C
- * @param value 值
- */
-Byte INS_ROR(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.F_C = value & 0x1;
-    value>>=1;
-    value = CPU.F_C ? value|0x80 : value&~0x80;
-    CPU_F_NZ(value);
-    return value;
-}
-
-/**
- * 与
- * A & M -> A
- * Flags: N, Z
- * @param value 值
- */
-void INS_AND(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.A&=value;
-    CPU_F_NZ(CPU.A);
-}
-
-/**
- * 或
- * A | M -> A
- * Flags: N, Z
- * @param value 值
- */
-void INS_ORA(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.A|=value;
-    CPU_F_NZ(CPU.A);
-}
-
-/**
- * 异或
- * A ^ M -> A
- * Flags: N, Z
- * @param value 值
- */
-void INS_EOR(Byte value) {
-    CPU.INS_Cycles += 1;
-    CPU.A^=value;
-    CPU_F_NZ(CPU.A);
-}
-
-/**
- *  N = M7, V = M6, Z = A & M
- * @param input
- */
-void INS_BIT(Byte input) {
-    CPU.INS_Cycles += 1;
-    CPU.F_Z = (CPU.A & input) == 0;
-    CPU.F_V = (input>>6)&1;
-    CPU.F_N = input >> 7;
-}
-
-/**
- *  Branch on Carry Clear
- *  Branch if C = 0
- * @param input
- */
-void INS_Branch(byte input,Byte condition) {
-    if(condition) {
-        CPU.INS_Cycles += (((CPU.PC+input) ^ CPU.PC) >> 8) > 0?2:1;
-        CPU.PC += input;
+#include "include/lib6502.h"
+#include "include/fuzz.h"
+#include "include/cfg.h"
+#include "include/test.h"
+
+static void usage() {
+    fprintf(stderr, "usage: cpu_6502 run [--rom] [--mapper MAPPER] [--gdb ADDRESS] [--watch SPEC]... [--break SPEC]...\n"
+                    "                    [--checkpoint FILE [--every CYCLES]] [--restore FILE] [--record|--replay FILE]\n"
+                    "                    [--clock HZ [--speed N|max]] [--metrics FILE] [--metrics-listen ADDRESS]\n"
+                    "                    [--serial ADDR[,IRQ]] [--disk|--disk-ro FILE@REGS,WINDOW]\n"
+                    "                    <image> <load> [cycles] [pc]\n"
+                    "       cpu_6502 asm [-o OUT] [--sym] [-l] [--cycles] [--optimize[=speed|size]] [--cache DIR] [-I DIR]... [-D NAME[=VALUE]]... [-v] <file>...\n"
+                    "       cpu_6502 test [-j N] [--max-cycles N] [--timeout SEC] [--tap FILE] [--junit FILE] [--cache DIR]\n"
+                    "                     [-I DIR]... [-D NAME[=VALUE]]... <file>...\n"
+                    "       cpu_6502 fuzz ...\n"
+                    "       cpu_6502 cfg ...\n"
+                    "SPEC: [r][w][x]:start[-end][:cond], cond e.g. \"== 0x42\", \"& 0x80 != 0\", changed\n"
+                    "ADDRESS: port, host:port or unix:path\n"
+                    "HZ: clock rate with optional k/m suffix, e.g. 1m, 1.79m, 2000000\n"
+                    "--serial: 6551 ACIA at ADDR on stdin/stdout; not with --checkpoint, --restore or --replay\n"
+                    "--disk: 512-byte sectors of FILE mapped at WINDOW; not with --checkpoint, --restore, --record or --replay\n"
+                    "--record: log device reads and interrupts; --replay: rerun a log offline without devices\n"
+                    "MAPPER: nrom, mmc1, uxrom, axrom, #<iNES number> and/or windows BASE/SIZE[=BANK][@CTRL[-END]][:ram],\n"
+                    "        comma separated, plus ram=SIZE, e.g. \"8000/16k@8000-bfff,c000/16k=-1\"\n");
+}
+
+//--serial 的中断源
+#define RUN_SERIAL_IRQ 0
+
+//--gdb/--metrics-listen 时每批执行的周期数
+#define RUN_BATCH 100000
+//--checkpoint 默认的间隔周期数
+#define RUN_CHECKPOINT_EVERY 100000000ULL
+
+//run 的观察点: --watch 只打印, --break 停下
+struct Run_Watch {
+    Lib6502 *Emu;
+    int Stop;
+    int Hit;
+};
+
+static int run_hit(void *ctx, uint16_t addr, uint8_t value, int kind) {
+    struct Run_Watch *watch = ctx;
+    Lib6502_Regs regs;
+    Lib6502_Get_Regs(watch->Emu, &regs);
+    printf("%c $%04X = %02X (cycles=%llu)\n",
+           kind == LIB6502_WATCH_READ ? 'R' : kind == LIB6502_WATCH_WRITE ? 'W' : 'X',
+           addr, value, (unsigned long long) regs.Cycles);
+    watch->Hit |= watch->Stop;
+    return watch->Stop;
+}
+
+/**
+ * 解析 [r][w][x]:start[-end][:cond] 并设置观察点
+ * @return 0 成功
+ */
+static int run_watch(struct Run_Watch *watch, const char *spec) {
+    int kinds = 0;
+    for (; *spec && *spec != ':'; ++spec) {
+        kinds |= *spec == 'r' ? LIB6502_WATCH_READ : *spec == 'w' ? LIB6502_WATCH_WRITE
+               : *spec == 'x' ? LIB6502_WATCH_EXEC : 0x100;
     }
-}
-
-/**
- * 寄存器间值转移
- * @param source 源寄存器
- * @param target 目标寄存器
- * @param set_flag 是否要设置状态寄存器
- */
-void INS_Transfer(Byte source,Byte *target,Byte set_flag) {
-    CPU.INS_Cycles += 2;
-    *target = source;
-    if(set_flag) {
-        CPU_F_NZ(*target);
+    if (*spec != ':' || !kinds || kinds & 0x100) {
+        return -1;
     }
+    char *end;
+    unsigned long start = strtoul(spec + 1, &end, 0);
+    unsigned long last = start;
+    if (*end == '-') {
+        last = strtoul(end + 1, &end, 0);
+    }
+    if (*end != '\0' && *end != ':') {
+        return -1;
+    }
+    return Lib6502_Watch(watch->Emu, start, last, kinds, *end ? end + 1 : NULL, run_hit, watch) < 0 ? -1 : 0;
 }
 
 /**
- * 寄存器间值转移
- * @param source 源寄存器
- * @param target 目标寄存器
- * @param set_flag 是否要设置状态寄存器
- */
-void INS_SET_CLEAR(Byte *FLAG,Byte value) {
-    CPU.INS_Cycles += 2;
-    *FLAG = value;
-}
-
-/**
- * 将寄存器A推送到栈中
- * A -> S
- * Flags: none
- */
-void INS_PHA() {
-    CPU.INS_Cycles +=2;
-    CPU_Stack_Push_Byte(CPU.A);
-}
-
-/**
- * 从栈中拉取一个字节到寄存器A
- * A -> S
- * Flags: N, Z
- */
-void INS_PLA() {
-    CPU.INS_Cycles +=3;
-    CPU.A = CPU_Stack_Pull_Byte();
-    CPU_F_NZ(CPU.A);
-}
-
-/**
- * 将状态寄存器放入栈
- * P -> S
- * Flags: none
- */
-void INS_PHP() {
-    CPU.INS_Cycles +=2;
-    Push_Flag();
-}
-
-/**
- * 将栈数据放入状态寄存器
- * S -> P
- * Flags: ALL
- */
-void INS_PLP() {
-    CPU.INS_Cycles +=2;
-    Pull_Flag();
-}
-
-/**
- * 跳转到地址
- * Flags: none
- */
-void INS_JMP(Short address) {
-    CPU.INS_Cycles ++;
-    CPU.PC = address;
-}
-
-/**
- * 跳转到地址
- * Jump to New Location Saving Return Address
- * Flags: none
- */
-void INS_JSR(Short address) {
-    CPU.INS_Cycles +=2;
-    CPU_Stack_Push_Short(CPU.PC-1);
-    CPU.PC = address;
-}
-
-/**
- * 返回到保存的地址
- * Return from Subroutine
- * Flags: none
- */
-void INS_RTS() {
-    CPU.INS_Cycles ++;
-    INS_JMP(CPU_Stack_Pull_Short() + 1);
-}
-/**
- * 从异常返回
- * ReTurn from Interrupt
- * Flags: none
- */
-void INS_RTI() {
-    CPU.INS_Cycles +=2;
-    Pull_Flag();
-    CPU.PC = CPU_Stack_Pull_Short();
-}
-
-/**
- * break 异常
+ * 解析 FILE@REGS,WINDOW 并挂上块设备
+ * @return 0 成功
  */
-void INS_BRK() {
-    CPU.INS_Cycles++;
-    CPU_Stack_Push_Short(CPU.PC + 1);
-    CPU.F_B = 1;
-    Push_Flag();
-    CPU.PC = CPU_Read_Addr(concat_byte(CPU_Read_Addr(0xFFFE),CPU_Read_Addr(0xFFFF)));
-    CPU.F_I = 1;
-}
-
-//-------------指令结束-----------------
-
-void CPU_Exec() {
-    Byte opcode = CPU_Get_Byte();
-    CPU.INS_Cycles = 0;
-    Short addr;
-    switch (opcode) {
-        // ------------Load(加载到寄存器)------------
-            //LDA #
-        case 0xA9:
-            INS_Set_REG(AM_IMM(), &CPU.A);
-            break;
-            //LDA a
-        case 0xAD:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.A);
-            break;
-            //LDA a,x
-        case 0xBD:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.X)), &CPU.A);
-            break;
-            //LDA a,y
-        case 0xB9:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.Y)), &CPU.A);
-            break;
-            //LDA zp
-        case 0xA5:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.A);
-            break;
-            //LDA zp,x
-        case 0xB5:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.X)), &CPU.A);
-            break;
-            //LDA (Indirect,X)
-        case 0xA1:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP_IND_X()), &CPU.A);
-            break;
-            //LDA (Indirect),Y
-        case 0xB1:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP_IND_Y()), &CPU.A);
-            break;
-
-            //LDX #
-        case 0xA2:
-            INS_Set_REG(AM_IMM(), &CPU.X);
-            break;
-            //LDX a
-        case 0xAE:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.X);
-            break;
-            //LDX a,y
-        case 0xBE:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.Y)), &CPU.X);
-            break;
-            //LDX zp
-        case 0xA6:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.X);
-            break;
-            //LDX zp,y
-        case 0xB6:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.Y)), &CPU.X);
-            break;
-
-            //LDY #
-        case 0xA0:
-            INS_Set_REG(AM_IMM(), &CPU.Y);
-            break;
-            //LDY a
-        case 0xAC:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs()), &CPU.Y);
-            break;
-            //LDY a,x
-        case 0xBC:
-            INS_Set_REG(CPU_Read_Addr(AM_Abs_XY(CPU.X)), &CPU.Y);
-            break;
-            //LDY zp
-        case 0xA4:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP()), &CPU.Y);
-            break;
-            //LDY zp,x
-        case 0xB4:
-            INS_Set_REG(CPU_Read_Addr(AM_ZP_XY(CPU.X)), &CPU.Y);
-            break;
-        // ------------Store(寄存器存储到内存)------------
-            //STA a
-        case 0x8D:
-            INS_REG_To_MEM(AM_Abs(), CPU.A);
-            break;
-            //STA a,x
-        case 0x9D:
-            INS_REG_To_MEM(AM_Abs_XY(CPU.X), CPU.A);
-            break;
-            //STA a,y
-        case 0x99:
-            INS_REG_To_MEM(AM_Abs_XY(CPU.Y), CPU.A);
-            break;
-            //STA zp
-        case 0x85:
-            INS_REG_To_MEM(AM_ZP(), CPU.A);
-            break;
-            //STA zp,x
-        case 0x95:
-            INS_REG_To_MEM(AM_ZP_XY(CPU.X), CPU.A);
-            break;
-            //STA (zp,x)
-        case 0x81:
-            INS_REG_To_MEM(AM_ZP_IND_X(), CPU.A);
-            break;
-            //STA (zp),y
-        case 0x91:
-            INS_REG_To_MEM(AM_ZP_IND_Y(), CPU.A);
-            break;
-
-            //STX a
-        case 0x8E:
-            INS_REG_To_MEM(AM_Abs(), CPU.X);
-            break;
-            //STX zp
-        case 0x86:
-            INS_REG_To_MEM(AM_ZP(), CPU.X);
-            break;
-            //STX zp,y
-        case 0x96:
-            INS_REG_To_MEM(AM_ZP_XY(CPU.Y), CPU.X);
-            break;
-
-            //STY a
-        case 0x8C:
-            INS_REG_To_MEM(AM_Abs(), CPU.Y);
-            break;
-            //STY zp
-        case 0x84:
-            INS_REG_To_MEM(AM_ZP(), CPU.Y);
-            break;
-            //STY zp,x
-        case 0x94:
-            INS_REG_To_MEM(AM_ZP_XY(CPU.X), CPU.Y);
-            break;
-        // ------------Arithmetic(算数)------------
-            //ADC #   (Add Memory to Accumulator with Carry)
-        case 0x69:
-            INS_ADC(AM_IMM());
-            break;
-            //ADC a
-        case 0x6D:
-            INS_ADC(CPU_Read_Addr(AM_Abs()));
-            break;
-            //ADC a,x
-        case 0x7D:
-            INS_ADC(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //ADC a,y
-        case 0x79:
-            INS_ADC(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //ADC zp
-        case 0x65:
-            INS_ADC(CPU_Read_Addr(AM_ZP()));
-            break;
-            //ADC zp,x
-        case 0x75:
-            INS_ADC(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //ADC (Indirect,X)
-        case 0x61:
-            INS_ADC(CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //ADC (Indirect),Y
-        case 0x71:
-            INS_ADC(CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-            //SBC #   (Subtract Memory from Accumulator with Borrow)
-        case 0xE9:
-            INS_SBC(AM_IMM());
-            break;
-            //SBC a
-        case 0xED:
-            INS_SBC(CPU_Read_Addr(AM_Abs()));
-            break;
-            //SBC a,x
-        case 0xFD:
-            INS_SBC(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //SBC a,y
-        case 0xF9:
-            INS_SBC(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //SBC zp
-        case 0xE5:
-            INS_SBC(CPU_Read_Addr(AM_ZP()));
-            break;
-            //SBC zp,x
-        case 0xF5:
-            INS_SBC(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //SBC (Indirect,X)
-        case 0xE1:
-            INS_SBC(CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //SBC (Indirect),Y
-        case 0xF1:
-            INS_SBC(CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-        // ------------Increment and Decrement(加减)------------
-            //INC a
-        case 0xEE:
-            INS_INC_DEC(AM_Abs(),1);
-            break;
-            //INC a,x
-        case 0xFE:
-            INS_INC_DEC(AM_Abs_XY(CPU.X),1);
-            break;
-            //INC zp
-        case 0xE6:
-            INS_INC_DEC(AM_ZP(),1);
-            break;
-            //INC zp,x
-        case 0xF6:
-            INS_INC_DEC(AM_ZP_XY(CPU.X),1);
-            break;
-            //INX #
-        case 0xE8:
-            INS_INC_DEC_XY(&CPU.X,1);
-            break;
-            //INY #
-        case 0xC8:
-            INS_INC_DEC_XY(&CPU.Y,1);
-            break;
-
-            //DEC a
-        case 0xCE:
-            INS_INC_DEC(AM_Abs(),-1);
-            break;
-            //DEC a,x
-        case 0xDE:
-            INS_INC_DEC(AM_Abs_XY(CPU.X),-1);
-            break;
-            //DEC zp
-        case 0xC6:
-            INS_INC_DEC(AM_ZP(),-1);
-            break;
-            //DEC zp,x
-        case 0xD6:
-            INS_INC_DEC(AM_ZP_XY(CPU.X),-1);
-            break;
-            //DEX #
-        case 0xCA:
-            INS_INC_DEC_XY(&CPU.X,-1);
-            break;
-            //DEY #
-        case 0x88:
-            INS_INC_DEC_XY(&CPU.Y,-1);
-            break;
-
-        // ------------Shift and Rotate(位运算与位翻转)------------
-            //ASL a
-        case 0x0E:
-            addr = AM_Abs();
-            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Addr(addr)));
-            break;
-            //ASL a,x
-        case 0x1E:
-            addr = AM_Abs_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Addr(addr)));
-            break;
-            //ASL A
-        case 0x0A:
-            CPU.A = INS_ASL(CPU.A);
-            break;
-            //ASL zp
-        case 0x06:
-            addr = AM_ZP();
-            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Addr(addr)));
-            break;
-            //ASL zp,x
-        case 0x16:
-            addr = AM_ZP_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ASL(CPU_Read_Addr(addr)));
-            break;
-
-            //LSR a
-        case 0x4E:
-            addr = AM_Abs();
-            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Addr(addr)));
-            break;
-            //LSR a,x
-        case 0x5E:
-            addr = AM_Abs_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Addr(addr)));
-            break;
-            //LSR A 寄存器
-        case 0x4A:
-            CPU.A = INS_LSR(CPU.A);
-            break;
-            //LSR zp
-        case 0x46:
-            addr = AM_ZP();
-            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Addr(addr)));
-            break;
-            //LSR zp,x
-        case 0x56:
-            addr = AM_ZP_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_LSR(CPU_Read_Addr(addr)));
-            break;
-
-            //ROL a
-        case 0x2E:
-            addr = AM_Abs();
-            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Addr(addr)));
-            break;
-            //ROL a,x
-        case 0x3E:
-            addr = AM_Abs_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Addr(addr)));
-            break;
-            //ROL A 寄存器
-        case 0x2A:
-            CPU.A = INS_ROL(CPU.A);
-            break;
-            //ROL zp
-        case 0x26:
-            addr = AM_ZP();
-            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Addr(addr)));
-            break;
-            //ROL zp,x
-        case 0x36:
-            addr = AM_ZP_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ROL(CPU_Read_Addr(addr)));
-            break;
-
-            //ROR a
-        case 0x6E:
-            addr = AM_Abs();
-            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Addr(addr)));
-            break;
-            //ROR a,x
-        case 0x7E:
-            addr = AM_Abs_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Addr(addr)));
-            break;
-            //ROR A 寄存器
-        case 0x6A:
-            CPU.A = INS_ROR(CPU.A);
-            break;
-            //ROR zp
-        case 0x66:
-            addr = AM_ZP();
-            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Addr(addr)));
-            break;
-            //ROR zp,x
-        case 0x76:
-            addr = AM_ZP_XY(CPU.X);
-            CPU_Write_Addr(addr,INS_ROR(CPU_Read_Addr(addr)));
-            break;
-
-        // ------------Logic(逻辑运算)------------
-            //AND a  AND Memory with Accumulator
-        case 0x2D:
-            INS_AND(CPU_Read_Addr(AM_Abs()));
-            break;
-            //AND a,x
-        case 0x3D:
-            INS_AND(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //AND a,y
-        case 0x39:
-            INS_AND(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //AND #
-        case 0x29:
-            INS_AND(AM_IMM());
-            break;
-            //AND zp
-        case 0x25:
-            INS_AND(CPU_Read_Addr(AM_ZP()));
-            break;
-            //AND (zp,x)
-        case 0x21:
-            INS_AND(CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //AND zp,x
-        case 0x35:
-            INS_AND(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //AND (zp),y
-        case 0x31:
-            INS_AND(CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-            //ORA a  OR Memory with Accumulator
-        case 0x0D:
-            INS_ORA(CPU_Read_Addr(AM_Abs()));
-            break;
-            //ORA a,x
-        case 0x1D:
-            INS_ORA(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //ORA a,y
-        case 0x19:
-            INS_ORA(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //ORA #
-        case 0x09:
-            INS_ORA(AM_IMM());
-            break;
-            //ORA zp
-        case 0x05:
-            INS_ORA(CPU_Read_Addr(AM_ZP()));
-            break;
-            //ORA (zp,x)
-        case 0x01:
-            INS_ORA(CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //ORA zp,x
-        case 0x15:
-            INS_ORA(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //ORA (zp),y
-        case 0x11:
-            INS_ORA(CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-            //EOR a   Exclusive-OR Memory with Accumulator
-        case 0x4D:
-            INS_EOR(CPU_Read_Addr(AM_Abs()));
-            break;
-            //EOR a,x
-        case 0x5D:
-            INS_EOR(CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //EOR a,y
-        case 0x59:
-            INS_EOR(CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //EOR #
-        case 0x49:
-            INS_EOR(AM_IMM());
-            break;
-            //EOR zp
-        case 0x45:
-            INS_EOR(CPU_Read_Addr(AM_ZP()));
-            break;
-            //EOR (zp,x)
-        case 0x41:
-            INS_EOR(CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //EOR zp,x
-        case 0x55:
-            INS_EOR(CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //EOR (zp),y
-        case 0x51:
-            INS_EOR(CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-        // ------------Compare and Test Bit(比较和检测位)------------
-            //CMP a   Compare Memory and Accumulator
-        case 0xCD:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs()));
-            break;
-            //CMP a,x
-        case 0xDD:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs_XY(CPU.X)));
-            break;
-            //CMP a,y
-        case 0xD9:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_Abs_XY(CPU.Y)));
-            break;
-            //CMP #
-        case 0xC9:
-            CPU_F_Compare(CPU.A, AM_IMM());
-            break;
-            //CMP zp
-        case 0xC5:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP()));
-            break;
-            //CMP (zp,x)
-        case 0xC1:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_IND_X()));
-            break;
-            //CMP zp,x
-        case 0xD5:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_XY(CPU.X)));
-            break;
-            //CMP (zp),y
-        case 0xD1:
-            CPU_F_Compare(CPU.A, CPU_Read_Addr(AM_ZP_IND_Y()));
-            break;
-
-            //CPX a   Compare Memory and Index X
-        case 0xEC:
-            CPU_F_Compare(CPU.X, CPU_Read_Addr(AM_Abs()));
-            break;
-            //CPX #
-        case 0xE0:
-            CPU_F_Compare(CPU.X, AM_IMM());
-            break;
-            //CPX zp
-        case 0xE4:
-            CPU_F_Compare(CPU.X, CPU_Read_Addr(AM_ZP()));
-            break;
-
-            //CPY a   Compare Memory and Index X
-        case 0xCC:
-            CPU_F_Compare(CPU.Y, CPU_Read_Addr(AM_Abs()));
-            break;
-            //CPY #
-        case 0xC0:
-            CPU_F_Compare(CPU.Y, AM_IMM());
-            break;
-            //CPY zp
-        case 0xC4:
-            CPU_F_Compare(CPU.Y, CPU_Read_Addr(AM_ZP()));
-            break;
-
-            //BIT a   Test Bits in Memory with Accumulator
-        case 0x2C:
-            INS_BIT(CPU_Read_Addr(AM_Abs()));
-            break;
-            //BIT #
-        case 0x89:
-            INS_BIT(AM_IMM());
-            break;
-            //BIT zp
-        case 0x24:
-            INS_BIT(CPU_Read_Addr(AM_ZP()));
-            break;
-        default:
-            break;
-
-        // ------------Branch(分支跳转)------------
-            //BCC r
-        case 0x90:
-            INS_Branch(AM_IMM(),CPU.F_C == 0);
-            break;
-            //BCS r
-        case 0xB0:
-            INS_Branch(AM_IMM(),CPU.F_C == 1);
-            break;
-            //BNE r
-        case 0xD0:
-            INS_Branch(AM_IMM(),CPU.F_Z == 0);
-            break;
-            //BEQ r
-        case 0xF0:
-            INS_Branch(AM_IMM(),CPU.F_Z == 1);
-            break;
-            //BPL r
-        case 0x10:
-            INS_Branch(AM_IMM(),CPU.F_N == 0);
-            break;
-            //BMI r
-        case 0x30:
-            INS_Branch(AM_IMM(),CPU.F_N == 1);
-            break;
-            //BVC r
-        case 0x50:
-            INS_Branch(AM_IMM(),CPU.F_V == 0);
-            break;
-            //BVS r
-        case 0x70:
-            INS_Branch(AM_IMM(),CPU.F_V == 1);
-            break;
-
-        // ------------Transfer(转移)------------
-            //TAX
-        case 0xAA:
-            INS_Transfer(CPU.A,&CPU.X,1);
-            break;
-            //TXA
-        case 0x8A:
-            INS_Transfer(CPU.X,&CPU.A,1);
-            break;
-            //TAY
-        case 0xA8:
-            INS_Transfer(CPU.A,&CPU.Y,1);
-            break;
-            //TYA
-        case 0x98:
-            INS_Transfer(CPU.Y,&CPU.A,1);
-            break;
-            //TSX
-        case 0xBA:
-            INS_Transfer(CPU.SP,&CPU.X,1);
-            break;
-            //TXS
-        case 0x9A:
-            INS_Transfer(CPU.X,&CPU.SP,0);
-            break;
-
-        // ------------Set and Clear------------
-            //CLC
-        case 0x18:
-            INS_SET_CLEAR(&CPU.F_C,0);
-            break;
-            //SEC
-        case 0x38:
-            INS_SET_CLEAR(&CPU.F_C,1);
-            break;
-            //CLD
-        case 0xD8:
-            INS_SET_CLEAR(&CPU.F_D,0);
-            break;
-            //SED
-        case 0xF8:
-            INS_SET_CLEAR(&CPU.F_D,1);
-            break;
-            //CLI
-        case 0x58:
-            INS_SET_CLEAR(&CPU.F_I,0);
-            break;
-            //SEI
-        case 0x78:
-            INS_SET_CLEAR(&CPU.F_I,1);
-            break;
-            //CLV
-        case 0xB8:
-            INS_SET_CLEAR(&CPU.F_V,0);
-            break;
-
-        // ------------Stack(栈)------------
-            //PHA
-        case 0x48:
-            INS_PHA();
-            break;
-            //PLA
-        case 0x68:
-            INS_PLA();
-            break;
-            //PHP
-        case 0x08:
-            INS_PHP();
-            break;
-            //PHP
-        case 0x28:
-            INS_PLP();
-            break;
-
-        // ------------Subroutines and Jump(跳转)------------
-            //JMP a
-        case 0x4C:
-            INS_JMP(AM_Abs());
-            break;
-            //JMP (a)
-        case 0x6C:
-            INS_JMP(AM_ZP_INDIRECT());
-            break;
-            //JSR a
-        case 0x20:
-            INS_JSR(AM_Abs());
-            break;
-            //RTS
-        case 0x60:
-            INS_RTS();
-            break;
-            //RTI
-        case 0x40:
-            INS_RTI();
-            break;
-
-        // ------------Miscellaneous------------
-            //BRK
-        case 0x00:
-            INS_BRK();
-            break;
-            //NOP
-        case 0xEA:
-            CPU.INS_Cycles += 2;
-            break;
-
+static int run_disk(Lib6502 *emu, const char *spec, int read_only) {
+    const char *at = strrchr(spec, '@');
+    if (!at || at == spec) {
+        return -1;
+    }
+    char *end;
+    unsigned long regs = strtoul(at + 1, &end, 0);
+    if (*end != ',') {
+        return -1;
+    }
+    unsigned long window = strtoul(end + 1, &end, 0);
+    if (*end || regs > 0xFFFF || window > 0xFFFF) {
+        return -1;
+    }
+    char *path = strndup(spec, at - spec);
+    int err = !path || Lib6502_Attach_Disk(emu, regs, window, path, read_only);
+    free(path);
+    return err ? -1 : 0;
+}
+
+/**
+ * 加载镜像并执行, 结束时打印寄存器
+ * --rom 时只读映射镜像, 否则拷贝到内存; load 只用于裸二进制
+ * --mapper 时用整个镜像(iNES 为 PRG ROM)作为 bank 数据, iNES 映射器号不为 0 时自动使用
+ * 没有给出 pc 时从镜像记录的入口开始, 没有入口时从复位向量开始
+ * --gdb 时按批次执行, 每批结束时检查调试器的请求
+ * --checkpoint 时每 --every 个周期在后台写一个检查点, 结束时再写一个;
+ * --clock 时按时钟频率和实际时间同步执行(--speed 倍速, max 不限速), 结束时打印节奏统计
+ * --metrics 结束时把计数写入文件(.json 为 JSON, 其它为 Prometheus 文本),
+ * --metrics-listen 执行期间在 ADDRESS 上回答 HTTP GET, 按批次执行, 每批结束时更新指令和周期数
+ * --serial 在 ADDR 所在页挂 6551 串口, 接收标准输入, 发送到标准输出, 结束时先写完发送的数据
+ * --disk/--disk-ro 把 FILE 当作块设备, 寄存器在 REGS 所在页, 扇区窗口在 WINDOW 开始的两页
+ * --restore 从检查点继续, 其它参数必须和写检查点的那次运行相同, cycles 仍然从复位开始计算
+ * --record 把设备读到的值和中断写进 FILE; --replay 用 FILE 代替设备重新执行(镜像、--restore 和录制时相同),
+ * 结束时报告不一致的次数; 块设备的窗口不在日志里, 所以都不能和 --disk 一起用, --replay 也不挂串口
+ * 窗口直接写到文件里, 扇区寄存器也不在检查点里, 所以 --checkpoint/--restore 也不能和 --disk 一起用;
+ * 串口的寄存器、收发状态和定时器同样不在检查点里, 也不能和 --serial 一起用
+ */
+static int run(int argc, char **argv) {
+    char *args[4];
+    int count = 0;
+    int rom = 0;
+    const char *gdb = NULL;
+    const char *mapper = NULL;
+    const char *checkpoint = NULL;
+    const char *restore = NULL;
+    const char *record = NULL;
+    const char *replay = NULL;
+    const char *metrics = NULL;
+    const char *listen = NULL;
+    const char *serial = NULL;
+    const char *disk = NULL;
+    int disk_ro = 0;
+    unsigned long long every = RUN_CHECKPOINT_EVERY;
+    double clock = 0;
+    double speed = 1;
+    static struct Run_Watch watches[2];
+    const char *specs[2][32];
+    int spec_count[2] = {0, 0};
+    for (int i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--rom") == 0) {
+            rom = 1;
+        } else if (strcmp(argv[i], "--mapper") == 0 && i + 1 < argc) {
+            mapper = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint = argv[++i];
+        } else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+            every = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+            restore = argv[++i];
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            char *end;
+            clock = strtod(argv[++i], &end);
+            clock *= *end == 'm' || *end == 'M' ? 1e6 : *end == 'k' || *end == 'K' ? 1e3 : 1;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            i++;
+            speed = strcmp(argv[i], "max") == 0 ? 0 : strtod(argv[i], NULL);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metrics = argv[++i];
+        } else if (strcmp(argv[i], "--metrics-listen") == 0 && i + 1 < argc) {
+            listen = argv[++i];
+        } else if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+            serial = argv[++i];
+        } else if ((strcmp(argv[i], "--disk") == 0 || strcmp(argv[i], "--disk-ro") == 0) && i + 1 < argc) {
+            disk_ro = argv[i][6] == '-';
+            disk = argv[++i];
+        } else if (strcmp(argv[i], "--gdb") == 0 && i + 1 < argc) {
+            gdb = argv[++i];
+        } else if ((strcmp(argv[i], "--watch") == 0 || strcmp(argv[i], "--break") == 0) && i + 1 < argc) {
+            int stop = argv[i][2] == 'b';
+            if (spec_count[stop] < 32) {
+                specs[stop][spec_count[stop]++] = argv[i + 1];
+            }
+            i++;
+        } else if (count < 4) {
+            args[count++] = argv[i];
+        }
+    }
+    if (count < 2 || every == 0 || clock < 0 || speed < 0
+        || (record && replay) || ((record || replay || checkpoint || restore) && disk) || ((replay || checkpoint || restore) && serial)) {
+        usage();
+        return 1;
+    }
+    Lib6502_Image *image = Lib6502_Image_Open(args[0], strtoul(args[1], NULL, 0));
+    if (!image) {
+        fprintf(stderr, "can't load %s\n", args[0]);
+        return 1;
     }
+    Lib6502 *emu = Lib6502_Create();
+    if (!emu) {
+        fprintf(stderr, "out of memory\n");
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    Lib6502_Map_Image(emu, image, rom);
+    if ((mapper || Lib6502_Image_Mapper(image) > 0) && Lib6502_Map_Image_Banks(emu, image, mapper)) {
+        if (mapper) {
+            fprintf(stderr, "bad mapper %s\n", mapper);
+        } else {
+            fprintf(stderr, "unsupported iNES mapper %d\n", Lib6502_Image_Mapper(image));
+        }
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    for (int stop = 0; stop < 2; ++stop) {
+        watches[stop].Emu = emu;
+        watches[stop].Stop = stop;
+        for (int i = 0; i < spec_count[stop]; ++i) {
+            if (run_watch(&watches[stop], specs[stop][i])) {
+                fprintf(stderr, "bad watchpoint %s\n", specs[stop][i]);
+                Lib6502_Destroy(emu);
+                Lib6502_Image_Close(image);
+                return 1;
+            }
+        }
+    }
+    if (serial) {
+        char *end;
+        unsigned long addr = strtoul(serial, &end, 0);
+        long irq = *end == ',' ? strtol(end + 1, &end, 0) : RUN_SERIAL_IRQ;
+        if (*end || addr > 0xFFFF || irq > 7
+            || Lib6502_Attach_Serial(emu, addr, STDIN_FILENO, STDOUT_FILENO, (int) irq, clock)) {
+            fprintf(stderr, "bad serial port %s\n", serial);
+            Lib6502_Destroy(emu);
+            Lib6502_Image_Close(image);
+            return 1;
+        }
+        //串口直接写标准输出的文件描述符, 之前缓冲的输出先写出去
+        fflush(stdout);
+    }
+    if (disk && run_disk(emu, disk, disk_ro)) {
+        fprintf(stderr, "can't attach disk %s\n", disk);
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    if (gdb && Lib6502_Debug_Listen(emu, gdb)) {
+        fprintf(stderr, "can't listen on %s\n", gdb);
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    if (listen && Lib6502_Metrics_Listen(listen)) {
+        fprintf(stderr, "can't listen on %s\n", listen);
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    //基准是加载好的镜像, 在执行之前创建
+    Lib6502_Checkpoint *ckpt = NULL;
+    if ((checkpoint || restore) && !(ckpt = Lib6502_Checkpoint_Create(emu, checkpoint ? checkpoint : restore))) {
+        fprintf(stderr, "out of memory\n");
+        Lib6502_Metrics_Close();
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    unsigned long long cycles = count > 2 ? strtoull(args[2], NULL, 0) : 1000000;
+    Lib6502_Reset(emu);
+    Lib6502_Regs regs;
+    int entry = count > 3 ? (int) strtoul(args[3], NULL, 0) : Lib6502_Image_Entry(image);
+    if (entry >= 0) {
+        Lib6502_Get_Regs(emu, &regs);
+        regs.PC = entry;
+        Lib6502_Set_Regs(emu, &regs);
+    }
+    Lib6502_Get_Regs(emu, &regs);
+    unsigned long long start = regs.Cycles;
+    if (restore) {
+        int err = Lib6502_Checkpoint_Restore(ckpt, restore);
+        if (err) {
+            fprintf(stderr, err == LIB6502_CHECKPOINT_BAD_BASE ? "%s was taken from a different image\n"
+                                                               : "bad checkpoint %s\n", restore);
+            Lib6502_Checkpoint_Destroy(ckpt);
+            Lib6502_Metrics_Close();
+            Lib6502_Destroy(emu);
+            Lib6502_Image_Close(image);
+            return 1;
+        }
+        Lib6502_Get_Regs(emu, &regs);
+    }
+    //从这里开始的状态和录制开始时相同
+    Lib6502_Replay *log = NULL;
+    if ((record || replay) && !(log = record ? Lib6502_Record_Start(emu, record) : Lib6502_Replay_Start(emu, replay))) {
+        fprintf(stderr, "can't open %s\n", record ? record : replay);
+        Lib6502_Checkpoint_Destroy(ckpt);
+        Lib6502_Metrics_Close();
+        Lib6502_Destroy(emu);
+        Lib6502_Image_Close(image);
+        return 1;
+    }
+    if (replay) {
+        Lib6502_Get_Regs(emu, &regs);
+    }
+    Lib6502_Set_Clock(emu, clock, speed);
+    unsigned long long next = ((regs.Cycles - start) / every + 1) * every;
+    for (unsigned long long done = regs.Cycles - start; done < cycles && regs.Halted != LIB6502_STOP;) {
+        unsigned long long batch = (gdb || listen) && cycles - done > RUN_BATCH ? RUN_BATCH : cycles - done;
+        if (checkpoint && next - done < batch) {
+            batch = next - done;
+        }
+        unsigned long long ran = clock ? Lib6502_Run_Realtime(emu, batch) : Lib6502_Run_Cycles(emu, batch);
+        done += ran;
+        if (checkpoint && done >= next) {
+            Lib6502_Checkpoint_Save(ckpt);
+            next = (done / every + 1) * every;
+        }
+        Lib6502_Get_Regs(emu, &regs);
+        //调试器断点停下时继续, 由调试器决定什么时候结束
+        if (regs.Halted == LIB6502_STOP || watches[1].Hit || (!gdb && ran < batch)) {
+            break;
+        }
+    }
+    //写完串口的输出再打印寄存器
+    Lib6502_Detach_Serial(emu);
+    Lib6502_Get_Regs(emu, &regs);
+    printf("PC=%04X A=%02X X=%02X Y=%02X SP=%02X P=%02X cycles=%llu%s\n",
+           regs.PC, regs.A, regs.X, regs.Y, regs.SP, regs.P, (unsigned long long) regs.Cycles,
+           regs.Halted == LIB6502_STOP ? " (stopped)" : watches[1].Hit ? " (break)" : "");
+    if (clock) {
+        Lib6502_Pace_Stats pace;
+        Lib6502_Get_Pace_Stats(emu, &pace);
+        printf("pace: batches=%llu overruns=%llu resyncs=%llu jitter avg=%.1fus max=%.1fus busy=%.1f%% drift=%.1fus\n",
+               (unsigned long long) pace.Batches, (unsigned long long) pace.Overruns,
+               (unsigned long long) pace.Resyncs, pace.Jitter_Avg / 1e3, pace.Jitter_Max / 1e3,
+               pace.Busy + pace.Sleep ? 100.0 * pace.Busy / (pace.Busy + pace.Sleep) : 0.0, pace.Drift / 1e3);
+    }
+    int status = 0;
+    unsigned long long mismatch = Lib6502_Replay_Close(log);
+    if (replay) {
+        printf("replay: %llu mismatches\n", mismatch);
+        status = mismatch != 0;
+    }
+    if (metrics && Lib6502_Metrics_Save(metrics)) {
+        fprintf(stderr, "can't write metrics %s\n", metrics);
+        status = 1;
+    }
+    if (checkpoint) {
+        //上一个还在编码时等它写完再保存最终状态
+        while (Lib6502_Checkpoint_Save(ckpt) == 1) {
+            Lib6502_Checkpoint_Wait(ckpt);
+        }
+        if (Lib6502_Checkpoint_Wait(ckpt)) {
+            fprintf(stderr, "can't write checkpoint %s\n", checkpoint);
+            status = 1;
+        }
+    }
+    Lib6502_Checkpoint_Destroy(ckpt);
+    Lib6502_Metrics_Close();
+    Lib6502_Destroy(emu);
+    Lib6502_Image_Close(image);
+    return status;
 }
 
-int main() {
-    CPU_Reset(0x1000);
-    FILE *fp = fopen("D:\\workspace\\MOS_6502_C\\test.asm","r");
-    compile(fp);
-    fclose(fp);
-    return 0;
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "fuzz") == 0) {
+        return Fuzz_Main(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "cfg") == 0) {
+        return CFG_Main(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "run") == 0) {
+        return run(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "asm") == 0) {
+        return ASM_Main(argc - 2, argv + 2);
+    }
+    if (strcmp(argv[1], "test") == 0) {
+        return Test_Main(argc - 2, argv + 2);
+    }
+    usage();
+    return 1;
 }
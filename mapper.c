@@ -0,0 +1,338 @@
+#include <stdlib.h>
+#include <string.h>
+#include "include/mapper.h"
+
+//ram= 的上限
+#define MAPPER_RAM_MAX 0x1000000
+
+//-------------内置映射器-----------------
+
+/**
+ * NROM (iNES 0): $8000 和 $C000 两个固定的 16K 窗口, 只有 16K 时镜像
+ */
+static int Mapper_NROM_Init(struct Mapper *mapper) {
+    if (Mapper_Add_Window(mapper, 0x8000, 0x4000, MAPPER_NO_CONTROL, 0, 0, 0) < 0) {
+        return -1;
+    }
+    return Mapper_Add_Window(mapper, 0xC000, 0x4000, MAPPER_NO_CONTROL, 0, 0, -1) < 0 ? -1 : 0;
+}
+
+/**
+ * UxROM (iNES 2): 写 $8000-$FFFF 切换 $8000 的 16K, $C000 固定为最后一个 bank
+ */
+static int Mapper_UxROM_Init(struct Mapper *mapper) {
+    if (Mapper_Add_Window(mapper, 0x8000, 0x4000, 0x8000, 0xFFFF, 0, 0) < 0) {
+        return -1;
+    }
+    return Mapper_Add_Window(mapper, 0xC000, 0x4000, MAPPER_NO_CONTROL, 0, 0, -1) < 0 ? -1 : 0;
+}
+
+/**
+ * AxROM (iNES 7): 写 $8000-$FFFF 切换整个 32K
+ */
+static int Mapper_AxROM_Init(struct Mapper *mapper) {
+    return Mapper_Add_Window(mapper, 0x8000, 0x8000, 0x8000, 0xFFFF, 0, 0) < 0 ? -1 : 0;
+}
+
+//MMC1 的寄存器
+#define MMC1_SHIFT   0
+#define MMC1_COUNT   1
+#define MMC1_CONTROL 2
+#define MMC1_PRG     3
+
+static void Mapper_MMC1_Update(struct Mapper *mapper) {
+    unsigned int bank = mapper->Regs[MMC1_PRG] & 0x0F;
+    switch (mapper->Regs[MMC1_CONTROL] >> 2 & 3) {
+        case 0:
+        case 1:
+            //32K 模式, 忽略最低位
+            Mapper_Select(mapper, 0, bank & ~1u);
+            Mapper_Select(mapper, 1, bank | 1);
+            break;
+        case 2:
+            Mapper_Select(mapper, 0, 0);
+            Mapper_Select(mapper, 1, bank);
+            break;
+        default:
+            Mapper_Select(mapper, 0, bank);
+            Mapper_Select(mapper, 1, mapper->Windows[1].Count - 1);
+            break;
+    }
+}
+
+/**
+ * MMC1 (iNES 1): 每次写 $8000-$FFFF 移入 1 位, 第 5 次按地址写入控制或 PRG 寄存器
+ * 只模拟 PRG 部分, $6000-$7FFF 为 8K RAM
+ */
+static int Mapper_MMC1_Init(struct Mapper *mapper) {
+    mapper->Regs[MMC1_CONTROL] = 0x0C;
+    if (Mapper_Add_Window(mapper, 0x8000, 0x4000, 0x8000, 0xFFFF, 0, 0) < 0
+        || Mapper_Add_Window(mapper, 0xC000, 0x4000, 0x8000, 0xFFFF, 0, -1) < 0) {
+        return -1;
+    }
+    if (mapper->RAM_Size && Mapper_Add_Window(mapper, 0x6000, 0x2000, MAPPER_NO_CONTROL, 0, 1, 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int Mapper_MMC1_Write(struct Mapper *mapper, Short addr, Byte value) {
+    unsigned int *regs = mapper->Regs;
+    if (value & 0x80) {
+        regs[MMC1_SHIFT] = 0;
+        regs[MMC1_COUNT] = 0;
+        regs[MMC1_CONTROL] |= 0x0C;
+        Mapper_MMC1_Update(mapper);
+        return 1;
+    }
+    regs[MMC1_SHIFT] |= (value & 1) << regs[MMC1_COUNT];
+    if (++regs[MMC1_COUNT] == 5) {
+        switch (addr >> 13 & 3) {
+            case 0:
+                regs[MMC1_CONTROL] = regs[MMC1_SHIFT];
+                break;
+            case 3:
+                regs[MMC1_PRG] = regs[MMC1_SHIFT];
+                break;
+            default:
+                //CHR bank, 没有 PPU
+                break;
+        }
+        regs[MMC1_SHIFT] = 0;
+        regs[MMC1_COUNT] = 0;
+        Mapper_MMC1_Update(mapper);
+    }
+    return 1;
+}
+
+//只由配置里的窗口组成
+static const struct Mapper_Type Mapper_Generic = {"window", -1, 0, NULL, NULL};
+static const struct Mapper_Type Mapper_NROM = {"nrom", 0, 0, Mapper_NROM_Init, NULL};
+static const struct Mapper_Type Mapper_MMC1 = {"mmc1", 1, 0x2000, Mapper_MMC1_Init, Mapper_MMC1_Write};
+static const struct Mapper_Type Mapper_UxROM = {"uxrom", 2, 0, Mapper_UxROM_Init, NULL};
+static const struct Mapper_Type Mapper_AxROM = {"axrom", 7, 0, Mapper_AxROM_Init, NULL};
+
+static const struct Mapper_Type *Mapper_Types[MAPPER_TYPES] = {
+    &Mapper_Generic, &Mapper_NROM, &Mapper_MMC1, &Mapper_UxROM, &Mapper_AxROM,
+};
+static int Mapper_Type_Count = 5;
+
+//-------------注册-----------------
+
+int Mapper_Register(const struct Mapper_Type *type) {
+    if (Mapper_Type_Count == MAPPER_TYPES || Mapper_Find(type->Name)) {
+        return -1;
+    }
+    Mapper_Types[Mapper_Type_Count++] = type;
+    return 0;
+}
+
+const struct Mapper_Type *Mapper_Find(const char *name) {
+    char *end;
+    long number = name[0] == '#' ? strtol(name + 1, &end, 10) : -1;
+    if (name[0] == '#' && (end == name + 1 || *end)) {
+        return NULL;
+    }
+    for (int i = 0; i < Mapper_Type_Count; ++i) {
+        const struct Mapper_Type *type = Mapper_Types[i];
+        if (number >= 0 ? type->Number == number : strcmp(type->Name, name) == 0) {
+            return type;
+        }
+    }
+    return NULL;
+}
+
+//-------------窗口-----------------
+
+int Mapper_Add_Window(struct Mapper *mapper, Short base, unsigned int size, int control_start, int control_end,
+                      int ram, int bank) {
+    unsigned int source = ram ? mapper->RAM_Size : mapper->ROM_Size;
+    if (mapper->Window_Count == MAPPER_WINDOWS || (base & 0xFF) || size < 0x100 || (size & 0xFF)
+        || size > 0x10000u - base || source < size) {
+        return -1;
+    }
+    if (control_start != MAPPER_NO_CONTROL && (control_start < 0 || control_end < control_start
+                                               || control_end > 0xFFFF)) {
+        return -1;
+    }
+    struct Mapper_Window *window = &mapper->Windows[mapper->Window_Count];
+    window->Base = base;
+    window->Size = size;
+    window->Control_Start = control_start;
+    window->Control_End = control_end;
+    window->RAM = ram != 0;
+    window->Count = source / size;
+    //保证第一次 Mapper_Select 会映射
+    window->Bank = window->Count;
+    if (control_start != MAPPER_NO_CONTROL) {
+        Bus_Map_Control(mapper->Bus, control_start, control_end, 1);
+    }
+    Mapper_Select(mapper, mapper->Window_Count, bank < 0 ? window->Count + bank % (int) window->Count : (unsigned int) bank);
+    return mapper->Window_Count++;
+}
+
+void Mapper_Select(struct Mapper *mapper, int window, unsigned int bank) {
+    struct Mapper_Window *w = &mapper->Windows[window];
+    bank %= w->Count;
+    if (bank == w->Bank) {
+        return;
+    }
+    w->Bank = bank;
+    mapper->Switches++;
+    if (w->RAM) {
+        Bus_Map_Bank(mapper->Bus, w->Base, mapper->RAM + (size_t) bank * w->Size, w->Size, 1);
+    } else {
+        Bus_Map_Bank(mapper->Bus, w->Base, mapper->ROM + (size_t) bank * w->Size, w->Size, 0);
+    }
+}
+
+/**
+ * 通用映射器: 写入的值就是控制寄存器对应窗口的 bank
+ */
+static int Mapper_Window_Write(struct Mapper *mapper, Short addr, Byte value) {
+    int handled = 0;
+    for (int i = 0; i < mapper->Window_Count; ++i) {
+        const struct Mapper_Window *window = &mapper->Windows[i];
+        if (window->Control_Start != MAPPER_NO_CONTROL && addr >= window->Control_Start
+            && addr <= window->Control_End) {
+            Mapper_Select(mapper, i, value);
+            handled = 1;
+        }
+    }
+    return handled;
+}
+
+int Mapper_Write(struct Mapper *mapper, Short addr, Byte value) {
+    if (mapper->Type->Write) {
+        return mapper->Type->Write(mapper, addr, value);
+    }
+    return Mapper_Window_Write(mapper, addr, value);
+}
+
+//-------------配置-----------------
+
+/**
+ * 大小: 十进制或 0x 十六进制, 可以带 k
+ */
+static int Mapper_Parse_Size(const char *text, const char **end, unsigned long *size) {
+    char *p;
+    *size = strtoul(text, &p, 0);
+    if (p == text) {
+        return -1;
+    }
+    if (*p == 'k' || *p == 'K') {
+        *size *= 1024;
+        p++;
+    }
+    *end = p;
+    return 0;
+}
+
+/**
+ * 窗口 BASE/SIZE[=BANK][@CTRL[-END]][:ram]
+ */
+static int Mapper_Parse_Window(struct Mapper *mapper, const char *text) {
+    char *p;
+    const char *q;
+    unsigned long base = strtoul(text, &p, 16);
+    unsigned long size;
+    long bank = 0;
+    long control_start = MAPPER_NO_CONTROL;
+    long control_end = 0;
+    int ram = 0;
+    if (p == text || *p != '/' || base > 0xFFFF || Mapper_Parse_Size(p + 1, &q, &size) || size > 0x10000) {
+        return -1;
+    }
+    p = (char *) q;
+    if (*p == '=') {
+        bank = strtol(p + 1, &p, 0);
+    }
+    if (*p == '@') {
+        control_start = control_end = strtol(p + 1, &p, 16);
+        if (*p == '-') {
+            control_end = strtol(p + 1, &p, 16);
+        }
+        if (control_start < 0 || control_end > 0xFFFF) {
+            return -1;
+        }
+    }
+    if (strcmp(p, ":ram") == 0) {
+        ram = 1;
+    } else if (*p) {
+        return -1;
+    }
+    return Mapper_Add_Window(mapper, base, size, control_start, control_end, ram, bank) < 0 ? -1 : 0;
+}
+
+int Mapper_Init(struct Mapper *mapper, struct Bus *bus, const char *spec, const Byte *rom, unsigned int rom_size) {
+    char items[1024];
+    char *save;
+    int windows = 0;
+    long ram_size = -1;
+    memset(mapper, 0, sizeof(*mapper));
+    mapper->Bus = bus;
+    mapper->ROM = rom;
+    mapper->ROM_Size = rom_size;
+    if (strlen(spec) >= sizeof(items)) {
+        return -1;
+    }
+    //先找类型和 RAM 大小, 窗口在类型初始化之后加
+    strcpy(items, spec);
+    for (char *item = strtok_r(items, ",", &save); item; item = strtok_r(NULL, ",", &save)) {
+        if (strncmp(item, "ram=", 4) == 0) {
+            unsigned long size;
+            const char *end;
+            if (Mapper_Parse_Size(item + 4, &end, &size) || *end || size > MAPPER_RAM_MAX) {
+                return -1;
+            }
+            ram_size = size;
+        } else if (strchr(item, '/')) {
+            windows++;
+        } else if (mapper->Type || !(mapper->Type = Mapper_Find(item))) {
+            return -1;
+        }
+    }
+    if (!mapper->Type) {
+        mapper->Type = &Mapper_Generic;
+    }
+    if (mapper->Type == &Mapper_Generic && windows == 0) {
+        return -1;
+    }
+    mapper->RAM_Size = ram_size >= 0 ? (unsigned int) ram_size : mapper->Type->RAM_Size;
+    if (mapper->RAM_Size && !(mapper->RAM = calloc(1, mapper->RAM_Size))) {
+        return -1;
+    }
+    bus->Mapper = mapper;
+    int result = mapper->Type->Init ? mapper->Type->Init(mapper) : 0;
+    strcpy(items, spec);
+    for (char *item = strtok_r(items, ",", &save); item && result == 0; item = strtok_r(NULL, ",", &save)) {
+        if (strchr(item, '/')) {
+            result = Mapper_Parse_Window(mapper, item);
+        }
+    }
+    if (result) {
+        Mapper_Free(mapper);
+    }
+    return result;
+}
+
+void Mapper_Free(struct Mapper *mapper) {
+    struct Bus *bus = mapper->Bus;
+    if (!bus) {
+        return;
+    }
+    for (int i = 0; i < mapper->Window_Count; ++i) {
+        const struct Mapper_Window *window = &mapper->Windows[i];
+        Bus_Map_Bank(bus, window->Base, NULL, window->Size, 1);
+        if (window->Control_Start != MAPPER_NO_CONTROL) {
+            Bus_Map_Control(bus, window->Control_Start, window->Control_End, 0);
+        }
+    }
+    if (bus->Mapper == mapper) {
+        bus->Mapper = NULL;
+    }
+    free(mapper->RAM);
+    mapper->RAM = NULL;
+    mapper->Window_Count = 0;
+    mapper->Bus = NULL;
+}
@@ -0,0 +1,381 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "include/metrics.h"
+
+static const struct {
+    const char *Name;
+    const char *Help;
+} Metrics_Names[METRIC_COUNT] = {
+        {"instructions", "Instructions executed"},
+        {"cycles",       "CPU cycles executed"},
+        {"interrupts",   "IRQs and NMIs taken"},
+        {"fused",        "Instruction groups executed by one fused dispatch"},
+        {"idle_cycles",  "Cycles fast-forwarded in idle loops"},
+        {"page_faults",  "First writes to pages without their own memory"},
+        {"watch_hits",   "Watchpoint hits"},
+        {"runs",         "CPU_Run and CPU_Step calls"},
+};
+
+//实例表, 只在登记、注销和导出时加锁
+static pthread_mutex_t Metrics_Lock = PTHREAD_MUTEX_INITIALIZER;
+static struct Metrics *Metrics_List;
+static int Metrics_Count;
+//已经注销的实例的计数
+static unsigned long long Metrics_Retired[METRIC_COUNT];
+static _Atomic unsigned long long Metrics_Next_Id = 1;
+
+//线程的标识(地址)和最近用过的分片
+static _Thread_local char Metrics_Thread;
+static _Thread_local unsigned long long Metrics_Cache_Id;
+static _Thread_local struct Metrics_Shard *Metrics_Cache;
+
+void Metrics_Init(struct Metrics *metrics, const char *name) {
+    memset(metrics, 0, sizeof(*metrics));
+    metrics->Id = atomic_fetch_add(&Metrics_Next_Id, 1);
+    atomic_init(&metrics->Shards, NULL);
+    Metrics_Set_Name(metrics, name);
+    pthread_mutex_lock(&Metrics_Lock);
+    metrics->Next = Metrics_List;
+    if (Metrics_List) {
+        Metrics_List->Prev = metrics;
+    }
+    Metrics_List = metrics;
+    Metrics_Count++;
+    pthread_mutex_unlock(&Metrics_Lock);
+}
+
+void Metrics_Free(struct Metrics *metrics) {
+    unsigned long long values[METRIC_COUNT];
+    Metrics_Read(metrics, values);
+    pthread_mutex_lock(&Metrics_Lock);
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        Metrics_Retired[i] += values[i];
+    }
+    if (metrics->Prev) {
+        metrics->Prev->Next = metrics->Next;
+    } else {
+        Metrics_List = metrics->Next;
+    }
+    if (metrics->Next) {
+        metrics->Next->Prev = metrics->Prev;
+    }
+    Metrics_Count--;
+    pthread_mutex_unlock(&Metrics_Lock);
+    struct Metrics_Shard *shard = atomic_load(&metrics->Shards);
+    while (shard) {
+        struct Metrics_Shard *next = shard->Next;
+        free(shard);
+        shard = next;
+    }
+    atomic_store(&metrics->Shards, NULL);
+}
+
+/**
+ * 名字放进 Prometheus 标签和 JSON 字符串里, 引号、反斜杠和控制字符换成 _
+ */
+void Metrics_Set_Name(struct Metrics *metrics, const char *name) {
+    if (!name) {
+        snprintf(metrics->Name, sizeof(metrics->Name), "cpu%llu", metrics->Id);
+        return;
+    }
+    snprintf(metrics->Name, sizeof(metrics->Name), "%s", name);
+    for (char *c = metrics->Name; *c; ++c) {
+        if (*c == '"' || *c == '\\' || (unsigned char) *c < 0x20) {
+            *c = '_';
+        }
+    }
+}
+
+void Metrics_Attach(struct CPU_Context *cpu, struct Metrics *metrics) {
+    cpu->Metrics = metrics;
+    cpu->Shard = NULL;
+}
+
+struct Metrics_Shard *Metrics_Shard(struct Metrics *metrics) {
+    if (Metrics_Cache_Id == metrics->Id) {
+        return Metrics_Cache;
+    }
+    struct Metrics_Shard *shard = atomic_load_explicit(&metrics->Shards, memory_order_acquire);
+    while (shard && shard->Thread != &Metrics_Thread) {
+        shard = shard->Next;
+    }
+    if (!shard) {
+        shard = aligned_alloc(BUS_CACHE_LINE, sizeof(*shard));
+        if (!shard) {
+            return NULL;
+        }
+        memset(shard, 0, sizeof(*shard));
+        shard->Thread = &Metrics_Thread;
+        shard->Next = atomic_load_explicit(&metrics->Shards, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&metrics->Shards, &shard->Next, shard,
+                                                      memory_order_release, memory_order_relaxed)) {
+        }
+    }
+    Metrics_Cache_Id = metrics->Id;
+    Metrics_Cache = shard;
+    return shard;
+}
+
+void Metrics_Read(const struct Metrics *metrics, unsigned long long values[METRIC_COUNT]) {
+    memset(values, 0, sizeof(values[0]) * METRIC_COUNT);
+    for (struct Metrics_Shard *shard = atomic_load_explicit(&metrics->Shards, memory_order_acquire);
+         shard; shard = shard->Next) {
+        for (int i = 0; i < METRIC_COUNT; ++i) {
+            values[i] += atomic_load_explicit(&shard->Values[i], memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * 需要持有 Metrics_Lock
+ */
+static void Metrics_Fleet_Locked(unsigned long long values[METRIC_COUNT]) {
+    memcpy(values, Metrics_Retired, sizeof(Metrics_Retired));
+    for (struct Metrics *metrics = Metrics_List; metrics; metrics = metrics->Next) {
+        unsigned long long instance[METRIC_COUNT];
+        Metrics_Read(metrics, instance);
+        for (int i = 0; i < METRIC_COUNT; ++i) {
+            values[i] += instance[i];
+        }
+    }
+}
+
+int Metrics_Read_Fleet(unsigned long long values[METRIC_COUNT]) {
+    pthread_mutex_lock(&Metrics_Lock);
+    Metrics_Fleet_Locked(values);
+    int count = Metrics_Count;
+    pthread_mutex_unlock(&Metrics_Lock);
+    return count;
+}
+
+//-------------导出-----------------
+
+void Metrics_Write_Prometheus(FILE *fp) {
+    pthread_mutex_lock(&Metrics_Lock);
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        fprintf(fp, "# HELP lib6502_%s_total %s.\n# TYPE lib6502_%s_total counter\n",
+                Metrics_Names[i].Name, Metrics_Names[i].Help, Metrics_Names[i].Name);
+        for (struct Metrics *metrics = Metrics_List; metrics; metrics = metrics->Next) {
+            unsigned long long values[METRIC_COUNT];
+            Metrics_Read(metrics, values);
+            fprintf(fp, "lib6502_%s_total{instance=\"%s\"} %llu\n", Metrics_Names[i].Name, metrics->Name, values[i]);
+        }
+    }
+    unsigned long long fleet[METRIC_COUNT];
+    Metrics_Fleet_Locked(fleet);
+    fprintf(fp, "# HELP lib6502_instances Emulator instances in this process.\n# TYPE lib6502_instances gauge\n"
+                "lib6502_instances %d\n", Metrics_Count);
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        fprintf(fp, "# HELP lib6502_fleet_%s_total %s by all instances, including destroyed ones.\n"
+                    "# TYPE lib6502_fleet_%s_total counter\nlib6502_fleet_%s_total %llu\n",
+                Metrics_Names[i].Name, Metrics_Names[i].Help, Metrics_Names[i].Name, Metrics_Names[i].Name, fleet[i]);
+    }
+    pthread_mutex_unlock(&Metrics_Lock);
+}
+
+void Metrics_Write_JSON(FILE *fp) {
+    pthread_mutex_lock(&Metrics_Lock);
+    fprintf(fp, "{\"instances\":[");
+    for (struct Metrics *metrics = Metrics_List; metrics; metrics = metrics->Next) {
+        unsigned long long values[METRIC_COUNT];
+        Metrics_Read(metrics, values);
+        fprintf(fp, "%s{\"instance\":\"%s\"", metrics == Metrics_List ? "" : ",", metrics->Name);
+        for (int i = 0; i < METRIC_COUNT; ++i) {
+            fprintf(fp, ",\"%s\":%llu", Metrics_Names[i].Name, values[i]);
+        }
+        fprintf(fp, "}");
+    }
+    unsigned long long fleet[METRIC_COUNT];
+    Metrics_Fleet_Locked(fleet);
+    fprintf(fp, "],\"fleet\":{\"instances\":%d", Metrics_Count);
+    for (int i = 0; i < METRIC_COUNT; ++i) {
+        fprintf(fp, ",\"%s\":%llu", Metrics_Names[i].Name, fleet[i]);
+    }
+    fprintf(fp, "}}\n");
+    pthread_mutex_unlock(&Metrics_Lock);
+}
+
+static int Metrics_Is_JSON(const char *path) {
+    size_t len = strlen(path);
+    return len >= 5 && strcmp(path + len - 5, ".json") == 0;
+}
+
+int Metrics_Save(const char *path) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int) sizeof(tmp)) {
+        return -1;
+    }
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) {
+        return -1;
+    }
+    if (Metrics_Is_JSON(path)) {
+        Metrics_Write_JSON(fp);
+    } else {
+        Metrics_Write_Prometheus(fp);
+    }
+    if (ferror(fp) | fclose(fp) || rename(tmp, path)) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+//-------------导出服务-----------------
+
+/**
+ * 回答一个请求: 只看请求行里的路径, 回复后关闭连接
+ */
+static void Metrics_Answer(int fd) {
+    char request[2048];
+    size_t len = 0;
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    while (len < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (n <= 0) {
+            break;
+        }
+        len += n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n")) {
+            break;
+        }
+    }
+    request[len] = '\0';
+    char *body = NULL;
+    size_t size = 0;
+    FILE *fp = open_memstream(&body, &size);
+    if (!fp) {
+        return;
+    }
+    const char *status = "200 OK";
+    const char *type = "text/plain; version=0.0.4";
+    char path[256] = "";
+    if (sscanf(request, "GET %255s", path) != 1) {
+        status = "400 Bad Request";
+        fprintf(fp, "bad request\n");
+    } else {
+        char *query = strchr(path, '?');
+        if (query) {
+            *query = '\0';
+        }
+        if (Metrics_Is_JSON(path)) {
+            type = "application/json";
+            Metrics_Write_JSON(fp);
+        } else {
+            Metrics_Write_Prometheus(fp);
+        }
+    }
+    if (fclose(fp) == 0) {
+        char header[256];
+        int head = snprintf(header, sizeof(header),
+                            "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+                            status, type, size);
+        if (send(fd, header, head, MSG_NOSIGNAL) == head) {
+            for (size_t sent = 0; sent < size;) {
+                ssize_t n = send(fd, body + sent, size - sent, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    break;
+                }
+                sent += n;
+            }
+        }
+    }
+    free(body);
+}
+
+static void *Metrics_Serve(void *arg) {
+    struct Metrics_Server *server = arg;
+    for (;;) {
+        struct pollfd fds[2] = {{server->Listen_Fd, POLLIN, 0}, {server->Wake_Fd[0], POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        int fd = accept(server->Listen_Fd, NULL, NULL);
+        if (fd >= 0) {
+            Metrics_Answer(fd);
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+int Metrics_Listen(struct Metrics_Server *server, const char *address) {
+    memset(server, 0, sizeof(*server));
+    server->Listen_Fd = server->Wake_Fd[0] = server->Wake_Fd[1] = -1;
+    int fd;
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr = {0};
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) {
+            return -1;
+        }
+        strcpy(addr.sun_path, address + 5);
+        unlink(addr.sun_path);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            goto fail;
+        }
+    } else {
+        struct sockaddr_in addr = {0};
+        const char *colon = strrchr(address, ':');
+        char host[64] = "127.0.0.1";
+        if (colon && (size_t) (colon - address) < sizeof(host)) {
+            memcpy(host, address, colon - address);
+            host[colon - address] = '\0';
+        }
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(colon ? colon + 1 : address));
+        if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+            return -1;
+        }
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int one = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0
+            || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            goto fail;
+        }
+    }
+    if (listen(fd, 8) < 0 || pipe(server->Wake_Fd) < 0) {
+        goto fail;
+    }
+    server->Listen_Fd = fd;
+    if (pthread_create(&server->Thread, NULL, Metrics_Serve, server)) {
+        server->Listen_Fd = -1;
+        close(server->Wake_Fd[0]);
+        close(server->Wake_Fd[1]);
+        goto fail;
+    }
+    return 0;
+fail:
+    if (fd >= 0) {
+        close(fd);
+    }
+    return -1;
+}
+
+void Metrics_Close(struct Metrics_Server *server) {
+    if (server->Listen_Fd < 0) {
+        return;
+    }
+    char c = 0;
+    if (write(server->Wake_Fd[1], &c, 1) == 1) {
+        pthread_join(server->Thread, NULL);
+    }
+    close(server->Listen_Fd);
+    close(server->Wake_Fd[0]);
+    close(server->Wake_Fd[1]);
+    server->Listen_Fd = -1;
+}
@@ -0,0 +1,760 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/opcodes.h"
+
+/**
+ * 操作码表: 助记符, 寻址方式, 基本周期, 跨页加的周期, 控制流类型
+ * 周期取自 CPU_Exec (分支按不跳转计, 跳转另加 1, 跨页再加 1), JAM/STP 为锁死之前用掉的周期
+ * 和 CPU_Exec 一样按 CPU_VARIANT 编译; 改了任何一边之后用 OP_Check (cfg --check) 对照
+ */
+const struct Opcode_Info OP_Table[256] = {
+#if CPU_IS_CMOS
+    {"BRK", MODE_IMP, 7, 0, OP_FLOW_BRK}, //0x00
+    {"ORA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x01
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x02
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x03
+    {"TSB", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x04
+    {"ORA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x05
+    {"ASL", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x06
+    {"RMB0", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x07
+    {"PHP", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0x08
+    {"ORA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x09
+    {"ASL", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x0A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x0B
+    {"TSB", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x0C
+    {"ORA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x0D
+    {"ASL", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x0E
+    {"BBR0", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x0F
+    {"BPL", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x10
+    {"ORA", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x11
+    {"ORA", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0x12
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x13
+    {"TRB", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x14
+    {"ORA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x15
+    {"ASL", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x16
+    {"RMB1", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x17
+    {"CLC", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x18
+    {"ORA", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x19
+    {"INC", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x1A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x1B
+    {"TRB", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x1C
+    {"ORA", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x1D
+    {"ASL", MODE_ABX, 6, 1, OP_FLOW_NONE}, //0x1E
+    {"BBR1", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x1F
+    {"JSR", MODE_ABS, 6, 0, OP_FLOW_CALL}, //0x20
+    {"AND", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x21
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x22
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x23
+    {"BIT", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x24
+    {"AND", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x25
+    {"ROL", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x26
+    {"RMB2", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x27
+    {"PLP", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0x28
+    {"AND", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x29
+    {"ROL", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x2A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x2B
+    {"BIT", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x2C
+    {"AND", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x2D
+    {"ROL", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x2E
+    {"BBR2", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x2F
+    {"BMI", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x30
+    {"AND", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x31
+    {"AND", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0x32
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x33
+    {"BIT", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x34
+    {"AND", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x35
+    {"ROL", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x36
+    {"RMB3", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x37
+    {"SEC", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x38
+    {"AND", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x39
+    {"DEC", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x3A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x3B
+    {"BIT", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x3C
+    {"AND", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x3D
+    {"ROL", MODE_ABX, 6, 1, OP_FLOW_NONE}, //0x3E
+    {"BBR3", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x3F
+    {"RTI", MODE_IMP, 6, 0, OP_FLOW_RETURN}, //0x40
+    {"EOR", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x41
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x42
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x43
+    {"NOP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x44
+    {"EOR", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x45
+    {"LSR", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x46
+    {"RMB4", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x47
+    {"PHA", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0x48
+    {"EOR", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x49
+    {"LSR", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x4A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x4B
+    {"JMP", MODE_ABS, 3, 0, OP_FLOW_JUMP}, //0x4C
+    {"EOR", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x4D
+    {"LSR", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x4E
+    {"BBR4", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x4F
+    {"BVC", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x50
+    {"EOR", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x51
+    {"EOR", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0x52
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x53
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x54
+    {"EOR", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x55
+    {"LSR", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x56
+    {"RMB5", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x57
+    {"CLI", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x58
+    {"EOR", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x59
+    {"PHY", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0x5A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x5B
+    {"NOP", MODE_ABS, 8, 0, OP_FLOW_NONE}, //0x5C
+    {"EOR", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x5D
+    {"LSR", MODE_ABX, 6, 1, OP_FLOW_NONE}, //0x5E
+    {"BBR5", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x5F
+    {"RTS", MODE_IMP, 6, 0, OP_FLOW_RETURN}, //0x60
+    {"ADC", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x61
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x62
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x63
+    {"STZ", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x64
+    {"ADC", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x65
+    {"ROR", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x66
+    {"RMB6", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x67
+    {"PLA", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0x68
+    {"ADC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x69
+    {"ROR", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x6A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x6B
+    {"JMP", MODE_IND, 6, 0, OP_FLOW_JUMP_IND}, //0x6C
+    {"ADC", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x6D
+    {"ROR", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x6E
+    {"BBR6", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x6F
+    {"BVS", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x70
+    {"ADC", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x71
+    {"ADC", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0x72
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x73
+    {"STZ", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x74
+    {"ADC", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x75
+    {"ROR", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x76
+    {"RMB7", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x77
+    {"SEI", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x78
+    {"ADC", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x79
+    {"PLY", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0x7A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x7B
+    {"JMP", MODE_AIX, 6, 0, OP_FLOW_JUMP_IND}, //0x7C
+    {"ADC", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x7D
+    {"ROR", MODE_ABX, 6, 1, OP_FLOW_NONE}, //0x7E
+    {"BBR7", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x7F
+    {"BRA", MODE_REL, 3, 0, OP_FLOW_JUMP}, //0x80
+    {"STA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x81
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x82
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x83
+    {"STY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x84
+    {"STA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x85
+    {"STX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x86
+    {"SMB0", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x87
+    {"DEY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x88
+    {"BIT", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x89
+    {"TXA", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x8A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x8B
+    {"STY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8C
+    {"STA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8D
+    {"STX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8E
+    {"BBS0", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x8F
+    {"BCC", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x90
+    {"STA", MODE_IZY, 6, 0, OP_FLOW_NONE}, //0x91
+    {"STA", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0x92
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x93
+    {"STY", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x94
+    {"STA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x95
+    {"STX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0x96
+    {"SMB1", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x97
+    {"TYA", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x98
+    {"STA", MODE_ABY, 5, 0, OP_FLOW_NONE}, //0x99
+    {"TXS", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x9A
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0x9B
+    {"STZ", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x9C
+    {"STA", MODE_ABX, 5, 0, OP_FLOW_NONE}, //0x9D
+    {"STZ", MODE_ABX, 5, 0, OP_FLOW_NONE}, //0x9E
+    {"BBS1", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0x9F
+    {"LDY", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA0
+    {"LDA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xA1
+    {"LDX", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xA3
+    {"LDY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA4
+    {"LDA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA5
+    {"LDX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA6
+    {"SMB2", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xA7
+    {"TAY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xA8
+    {"LDA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA9
+    {"TAX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xAA
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xAB
+    {"LDY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAC
+    {"LDA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAD
+    {"LDX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAE
+    {"BBS2", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xAF
+    {"BCS", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xB0
+    {"LDA", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xB1
+    {"LDA", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0xB2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xB3
+    {"LDY", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xB4
+    {"LDA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xB5
+    {"LDX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0xB6
+    {"SMB3", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xB7
+    {"CLV", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xB8
+    {"LDA", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xB9
+    {"TSX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xBA
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xBB
+    {"LDY", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xBC
+    {"LDA", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xBD
+    {"LDX", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xBE
+    {"BBS3", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xBF
+    {"CPY", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC0
+    {"CMP", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xC1
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xC3
+    {"CPY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xC4
+    {"CMP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xC5
+    {"DEC", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xC6
+    {"SMB4", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xC7
+    {"INY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xC8
+    {"CMP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC9
+    {"DEX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xCA
+    {"WAI", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0xCB
+    {"CPY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xCC
+    {"CMP", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xCD
+    {"DEC", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xCE
+    {"BBS4", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xCF
+    {"BNE", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xD0
+    {"CMP", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xD1
+    {"CMP", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0xD2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xD3
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xD4
+    {"CMP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xD5
+    {"DEC", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xD6
+    {"SMB5", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xD7
+    {"CLD", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xD8
+    {"CMP", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xD9
+    {"PHX", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0xDA
+    {"STP", MODE_IMP, 3, 0, OP_FLOW_HALT}, //0xDB
+    {"NOP", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xDC
+    {"CMP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xDD
+    {"DEC", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xDE
+    {"BBS5", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xDF
+    {"CPX", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE0
+    {"SBC", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xE1
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xE3
+    {"CPX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xE4
+    {"SBC", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xE5
+    {"INC", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xE6
+    {"SMB6", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xE7
+    {"INX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xE8
+    {"SBC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE9
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xEA
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xEB
+    {"CPX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xEC
+    {"SBC", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xED
+    {"INC", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xEE
+    {"BBS6", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xEF
+    {"BEQ", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xF0
+    {"SBC", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xF1
+    {"SBC", MODE_IZP, 5, 0, OP_FLOW_NONE}, //0xF2
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xF3
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xF4
+    {"SBC", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xF5
+    {"INC", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xF6
+    {"SMB7", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xF7
+    {"SED", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xF8
+    {"SBC", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xF9
+    {"PLX", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0xFA
+    {"NOP", MODE_IMP, 1, 0, OP_FLOW_NONE}, //0xFB
+    {"NOP", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xFC
+    {"SBC", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xFD
+    {"INC", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xFE
+    {"BBS7", MODE_ZPR, 5, 0, OP_FLOW_BRANCH}, //0xFF
+#else
+    {"BRK", MODE_IMP, 7, 0, OP_FLOW_BRK}, //0x00
+    {"ORA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x01
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x02
+    {"SLO", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0x03
+    {"NOP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x04
+    {"ORA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x05
+    {"ASL", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x06
+    {"SLO", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x07
+    {"PHP", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0x08
+    {"ORA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x09
+    {"ASL", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x0A
+    {"ANC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x0B
+    {"NOP", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x0C
+    {"ORA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x0D
+    {"ASL", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x0E
+    {"SLO", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x0F
+    {"BPL", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x10
+    {"ORA", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x11
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x12
+    {"SLO", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0x13
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x14
+    {"ORA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x15
+    {"ASL", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x16
+    {"SLO", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x17
+    {"CLC", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x18
+    {"ORA", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x19
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x1A
+    {"SLO", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0x1B
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x1C
+    {"ORA", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x1D
+    {"ASL", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x1E
+    {"SLO", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x1F
+    {"JSR", MODE_ABS, 6, 0, OP_FLOW_CALL}, //0x20
+    {"AND", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x21
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x22
+    {"RLA", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0x23
+    {"BIT", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x24
+    {"AND", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x25
+    {"ROL", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x26
+    {"RLA", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x27
+    {"PLP", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0x28
+    {"AND", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x29
+    {"ROL", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x2A
+    {"ANC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x2B
+    {"BIT", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x2C
+    {"AND", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x2D
+    {"ROL", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x2E
+    {"RLA", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x2F
+    {"BMI", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x30
+    {"AND", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x31
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x32
+    {"RLA", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0x33
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x34
+    {"AND", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x35
+    {"ROL", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x36
+    {"RLA", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x37
+    {"SEC", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x38
+    {"AND", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x39
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x3A
+    {"RLA", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0x3B
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x3C
+    {"AND", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x3D
+    {"ROL", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x3E
+    {"RLA", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x3F
+    {"RTI", MODE_IMP, 6, 0, OP_FLOW_RETURN}, //0x40
+    {"EOR", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x41
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x42
+    {"SRE", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0x43
+    {"NOP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x44
+    {"EOR", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x45
+    {"LSR", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x46
+    {"SRE", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x47
+    {"PHA", MODE_IMP, 3, 0, OP_FLOW_NONE}, //0x48
+    {"EOR", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x49
+    {"LSR", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x4A
+    {"ALR", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x4B
+    {"JMP", MODE_ABS, 3, 0, OP_FLOW_JUMP}, //0x4C
+    {"EOR", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x4D
+    {"LSR", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x4E
+    {"SRE", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x4F
+    {"BVC", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x50
+    {"EOR", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x51
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x52
+    {"SRE", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0x53
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x54
+    {"EOR", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x55
+    {"LSR", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x56
+    {"SRE", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x57
+    {"CLI", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x58
+    {"EOR", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x59
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x5A
+    {"SRE", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0x5B
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x5C
+    {"EOR", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x5D
+    {"LSR", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x5E
+    {"SRE", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x5F
+    {"RTS", MODE_IMP, 6, 0, OP_FLOW_RETURN}, //0x60
+    {"ADC", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x61
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x62
+    {"RRA", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0x63
+    {"NOP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x64
+    {"ADC", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x65
+    {"ROR", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x66
+    {"RRA", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0x67
+    {"PLA", MODE_IMP, 4, 0, OP_FLOW_NONE}, //0x68
+    {"ADC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x69
+    {"ROR", MODE_ACC, 2, 0, OP_FLOW_NONE}, //0x6A
+    {"ARR", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x6B
+    {"JMP", MODE_IND, 5, 0, OP_FLOW_JUMP_IND}, //0x6C
+    {"ADC", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x6D
+    {"ROR", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x6E
+    {"RRA", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0x6F
+    {"BVS", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x70
+    {"ADC", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0x71
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x72
+    {"RRA", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0x73
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x74
+    {"ADC", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x75
+    {"ROR", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x76
+    {"RRA", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0x77
+    {"SEI", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x78
+    {"ADC", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0x79
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x7A
+    {"RRA", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0x7B
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x7C
+    {"ADC", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0x7D
+    {"ROR", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x7E
+    {"RRA", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0x7F
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x80
+    {"STA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x81
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x82
+    {"SAX", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0x83
+    {"STY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x84
+    {"STA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x85
+    {"STX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x86
+    {"SAX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0x87
+    {"DEY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x88
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x89
+    {"TXA", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x8A
+    {"XAA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0x8B
+    {"STY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8C
+    {"STA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8D
+    {"STX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8E
+    {"SAX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0x8F
+    {"BCC", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0x90
+    {"STA", MODE_IZY, 6, 0, OP_FLOW_NONE}, //0x91
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0x92
+    {"SHA", MODE_IZY, 6, 0, OP_FLOW_NONE}, //0x93
+    {"STY", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x94
+    {"STA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0x95
+    {"STX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0x96
+    {"SAX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0x97
+    {"TYA", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x98
+    {"STA", MODE_ABY, 5, 0, OP_FLOW_NONE}, //0x99
+    {"TXS", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0x9A
+    {"TAS", MODE_ABY, 5, 0, OP_FLOW_NONE}, //0x9B
+    {"SHY", MODE_ABX, 5, 0, OP_FLOW_NONE}, //0x9C
+    {"STA", MODE_ABX, 5, 0, OP_FLOW_NONE}, //0x9D
+    {"SHX", MODE_ABY, 5, 0, OP_FLOW_NONE}, //0x9E
+    {"SHA", MODE_ABY, 5, 0, OP_FLOW_NONE}, //0x9F
+    {"LDY", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA0
+    {"LDA", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xA1
+    {"LDX", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA2
+    {"LAX", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xA3
+    {"LDY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA4
+    {"LDA", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA5
+    {"LDX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA6
+    {"LAX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xA7
+    {"TAY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xA8
+    {"LDA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xA9
+    {"TAX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xAA
+    {"LXA", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xAB
+    {"LDY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAC
+    {"LDA", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAD
+    {"LDX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAE
+    {"LAX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xAF
+    {"BCS", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xB0
+    {"LDA", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xB1
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0xB2
+    {"LAX", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xB3
+    {"LDY", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xB4
+    {"LDA", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xB5
+    {"LDX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0xB6
+    {"LAX", MODE_ZPY, 4, 0, OP_FLOW_NONE}, //0xB7
+    {"CLV", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xB8
+    {"LDA", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xB9
+    {"TSX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xBA
+    {"LAS", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xBB
+    {"LDY", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xBC
+    {"LDA", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xBD
+    {"LDX", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xBE
+    {"LAX", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xBF
+    {"CPY", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC0
+    {"CMP", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xC1
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC2
+    {"DCP", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0xC3
+    {"CPY", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xC4
+    {"CMP", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xC5
+    {"DEC", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xC6
+    {"DCP", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xC7
+    {"INY", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xC8
+    {"CMP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xC9
+    {"DEX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xCA
+    {"SBX", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xCB
+    {"CPY", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xCC
+    {"CMP", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xCD
+    {"DEC", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xCE
+    {"DCP", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xCF
+    {"BNE", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xD0
+    {"CMP", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xD1
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0xD2
+    {"DCP", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0xD3
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xD4
+    {"CMP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xD5
+    {"DEC", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xD6
+    {"DCP", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xD7
+    {"CLD", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xD8
+    {"CMP", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xD9
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xDA
+    {"DCP", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0xDB
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xDC
+    {"CMP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xDD
+    {"DEC", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xDE
+    {"DCP", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xDF
+    {"CPX", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE0
+    {"SBC", MODE_IZX, 6, 0, OP_FLOW_NONE}, //0xE1
+    {"NOP", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE2
+    {"ISC", MODE_IZX, 8, 0, OP_FLOW_NONE}, //0xE3
+    {"CPX", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xE4
+    {"SBC", MODE_ZP, 3, 0, OP_FLOW_NONE}, //0xE5
+    {"INC", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xE6
+    {"ISC", MODE_ZP, 5, 0, OP_FLOW_NONE}, //0xE7
+    {"INX", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xE8
+    {"SBC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xE9
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xEA
+    {"SBC", MODE_IMM, 2, 0, OP_FLOW_NONE}, //0xEB
+    {"CPX", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xEC
+    {"SBC", MODE_ABS, 4, 0, OP_FLOW_NONE}, //0xED
+    {"INC", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xEE
+    {"ISC", MODE_ABS, 6, 0, OP_FLOW_NONE}, //0xEF
+    {"BEQ", MODE_REL, 2, 0, OP_FLOW_BRANCH}, //0xF0
+    {"SBC", MODE_IZY, 5, 1, OP_FLOW_NONE}, //0xF1
+    {"JAM", MODE_IMP, 1, 0, OP_FLOW_HALT}, //0xF2
+    {"ISC", MODE_IZY, 8, 0, OP_FLOW_NONE}, //0xF3
+    {"NOP", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xF4
+    {"SBC", MODE_ZPX, 4, 0, OP_FLOW_NONE}, //0xF5
+    {"INC", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xF6
+    {"ISC", MODE_ZPX, 6, 0, OP_FLOW_NONE}, //0xF7
+    {"SED", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xF8
+    {"SBC", MODE_ABY, 4, 1, OP_FLOW_NONE}, //0xF9
+    {"NOP", MODE_IMP, 2, 0, OP_FLOW_NONE}, //0xFA
+    {"ISC", MODE_ABY, 7, 0, OP_FLOW_NONE}, //0xFB
+    {"NOP", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xFC
+    {"SBC", MODE_ABX, 4, 1, OP_FLOW_NONE}, //0xFD
+    {"INC", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xFE
+    {"ISC", MODE_ABX, 7, 0, OP_FLOW_NONE}, //0xFF
+#endif
+};
+
+//每种寻址方式的指令长度
+static const Byte OP_Mode_Length[16] = {1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3};
+
+/**
+ * 指令长度(含操作码)
+ * @param opcode
+ * @return
+ */
+Byte OP_Length(Byte opcode) {
+    return OP_Mode_Length[OP_Table[opcode].Mode];
+}
+
+/**
+ * 相对跳转目标
+ * @param addr 指令地址
+ * @param offset 偏移字节
+ * @param length 指令长度
+ * @return
+ */
+Short OP_Branch_Target(Short addr, Byte offset, Byte length) {
+    return addr + length + (byte) offset;
+}
+
+/**
+ * 一条指令的周期范围, 和执行时的规则一致:
+ * 索引读跨页多 1 个周期(a,x/a,y 的基址低字节为 0 时不会跨页),
+ * 分支跳转多 1 个、跳到另一页再多 1 个(BRA 的基本周期已经包含跳转),
+ * 65C02 十进制模式的 ADC/SBC 多 1 个
+ * @param mem 64K 内存
+ * @param addr
+ * @param min 不跳转、不跨页
+ * @param max
+ */
+void OP_Cycle_Range(const Byte *mem, Short addr, Byte *min, Byte *max) {
+    Byte opcode = mem[addr];
+    const struct Opcode_Info *info = &OP_Table[opcode];
+    Byte length = OP_Length(opcode);
+    *min = info->Cycles;
+    *max = info->Cycles;
+    if (info->Page && !((info->Mode == MODE_ABX || info->Mode == MODE_ABY) && mem[(Short) (addr + 1)] == 0)) {
+        *max += info->Page;
+    }
+    if (info->Mode == MODE_REL || info->Mode == MODE_ZPR) {
+        Short next = addr + length;
+        Short target = OP_Branch_Target(addr, mem[(Short) (addr + length - 1)], length);
+        Byte cross = (target ^ next) >> 8 ? 1 : 0;
+        if (info->Flow == OP_FLOW_BRANCH) {
+            *max += 1 + cross;
+        } else {
+            *min += cross;
+            *max += cross;
+        }
+    }
+#if CPU_IS_CMOS
+    if (strcmp(info->Name, "ADC") == 0 || strcmp(info->Name, "SBC") == 0) {
+        *max += 1;
+    }
+#endif
+}
+
+/**
+ * 反汇编一条指令
+ * @param mem 64K 内存
+ * @param addr
+ * @param buf
+ * @param size
+ * @return 指令长度
+ */
+Byte OP_Disasm(const Byte *mem, Short addr, char *buf, int size) {
+    Byte opcode = mem[addr];
+    const struct Opcode_Info *info = &OP_Table[opcode];
+    Byte low = mem[(Short) (addr + 1)];
+    Byte high = mem[(Short) (addr + 2)];
+    Short word = low | (high << 8);
+    Byte length = OP_Length(opcode);
+    switch (info->Mode) {
+        case MODE_IMP:
+            snprintf(buf, size, "%s", info->Name);
+            break;
+        case MODE_ACC:
+            snprintf(buf, size, "%s A", info->Name);
+            break;
+        case MODE_IMM:
+            snprintf(buf, size, "%s #$%02X", info->Name, low);
+            break;
+        case MODE_ZP:
+            snprintf(buf, size, "%s $%02X", info->Name, low);
+            break;
+        case MODE_ZPX:
+            snprintf(buf, size, "%s $%02X,X", info->Name, low);
+            break;
+        case MODE_ZPY:
+            snprintf(buf, size, "%s $%02X,Y", info->Name, low);
+            break;
+        case MODE_IZX:
+            snprintf(buf, size, "%s ($%02X,X)", info->Name, low);
+            break;
+        case MODE_IZY:
+            snprintf(buf, size, "%s ($%02X),Y", info->Name, low);
+            break;
+        case MODE_IZP:
+            snprintf(buf, size, "%s ($%02X)", info->Name, low);
+            break;
+        case MODE_REL:
+            snprintf(buf, size, "%s $%04X", info->Name, OP_Branch_Target(addr, low, length));
+            break;
+        case MODE_ABS:
+            snprintf(buf, size, "%s $%04X", info->Name, word);
+            break;
+        case MODE_ABX:
+            snprintf(buf, size, "%s $%04X,X", info->Name, word);
+            break;
+        case MODE_ABY:
+            snprintf(buf, size, "%s $%04X,Y", info->Name, word);
+            break;
+        case MODE_IND:
+            snprintf(buf, size, "%s ($%04X)", info->Name, word);
+            break;
+        case MODE_AIX:
+            snprintf(buf, size, "%s ($%04X,X)", info->Name, word);
+            break;
+        case MODE_ZPR:
+            snprintf(buf, size, "%s $%02X,$%04X", info->Name, low, OP_Branch_Target(addr, high, length));
+            break;
+    }
+    return length;
+}
+
+//-------------和 CPU_Exec 对照-----------------
+//OP_Check 里指令放的位置, 分支目标都在同一页
+#define OP_CHECK_ADDR 0x0200
+//向回跳过 $0000 的分支: 放在 $0002, 偏移 -16 跳到 $FFF4
+#define OP_WRAP_ADDR  0x0002
+#define OP_WRAP_DELTA 0xF0
+
+/**
+ * 在干净的总线上单步执行一条指令
+ * 操作数为 operand $30: 通常 operand 为 $10, 绝对地址 $3010, 零页 $10, 分支偏移不跨页;
+ * 零页填 fill, 间接地址为 $fillfill
+ * @param addr 指令的地址
+ * @param index X 和 Y 的值, 0xFF 时 a,x / a,y / (zp),y 跨页
+ * @param flags 所有标志(D 除外)的值, 条件分支按它跳或不跳
+ * @param pc 执行后的 PC
+ * @param halted 执行后的 Halted
+ * @return 周期数
+ */
+static unsigned int OP_Probe(struct Bus *bus, Short addr, Byte opcode, Byte operand, Byte index, Byte flags, Byte fill,
+                             Short *pc, Byte *halted) {
+    struct CPU_Context cpu;
+    struct CPU_Context *current = CPU_Current;
+    Byte code[3] = {opcode, operand, 0x30};
+    Bus_Init(bus);
+    for (int zp = 0; zp < 0x100; ++zp) {
+        Bus_Poke(bus, zp, fill);
+    }
+    Bus_Load(bus, addr, code, sizeof(code));
+    CPU_Init(&cpu, bus);
+    CPU_Select(&cpu);
+    CPU_Reset(addr);
+    CPU.X = CPU.Y = index;
+    CPU.F_N = CPU.F_V = CPU.F_Z = CPU.F_C = CPU.F_I = flags;
+    CPU_Step();
+    *pc = CPU.PC;
+    *halted = CPU.Halted;
+    CPU_Select(current);
+    return cpu.Cycles;
+}
+
+/**
+ * 逐条执行 256 个操作码, 对照表里的基本周期、跨页周期、长度和分支跳转的周期;
+ * 相对分支另外在 OP_WRAP_ADDR 向回跳过 $0000, 跳转时要多算跨页的一个周期
+ * 表是照着 CPU_Exec 写的, 两边改了一边时用它检查
+ * @param fp 不一致的操作码写到这里
+ * @return 不一致的操作码数, -1 内存不足
+ */
+int OP_Check(FILE *fp) {
+    struct Bus *bus = aligned_alloc(BUS_CACHE_LINE, sizeof(*bus));
+    if (!bus) {
+        return -1;
+    }
+    int bad = 0;
+    for (int opcode = 0; opcode < 256; ++opcode) {
+        const struct Opcode_Info *info = &OP_Table[opcode];
+        Short next = OP_CHECK_ADDR + OP_Length(opcode);
+        Byte fill = info->Mode == MODE_ZPR ? 0x00 : 0x30;
+        Short pc, cross_pc, alt_pc;
+        Byte halted, cross_halted, alt_halted;
+        unsigned int cycles = OP_Probe(bus, OP_CHECK_ADDR, opcode, 0x10, 0, 0, fill, &pc, &halted);
+        unsigned int cross = OP_Probe(bus, OP_CHECK_ADDR, opcode, 0x10, 0xFF, 0, fill, &cross_pc, &cross_halted);
+        unsigned int alt = OP_Probe(bus, OP_CHECK_ADDR, opcode, 0x10, 0, 1, info->Mode == MODE_ZPR ? 0xFF : fill,
+                                    &alt_pc, &alt_halted);
+        char why[64] = "";
+        if (cross - cycles != info->Page) {
+            snprintf(why, sizeof(why), "page cross +%u, table +%u", cross - cycles, info->Page);
+        } else if (info->Flow == OP_FLOW_BRANCH) {
+            //两种标志下一次跳一次不跳
+            if ((pc == next) == (alt_pc == next)) {
+                snprintf(why, sizeof(why), "branch taken both or neither way");
+            } else {
+                unsigned int stay = pc == next ? cycles : alt;
+                unsigned int jump = pc == next ? alt : cycles;
+                if (stay != info->Cycles || jump != info->Cycles + 1u) {
+                    snprintf(why, sizeof(why), "cycles %u/%u taken, table %u/%u",
+                             stay, jump, info->Cycles, info->Cycles + 1u);
+                }
+            }
+        } else if (cycles != info->Cycles) {
+            snprintf(why, sizeof(why), "cycles %u, table %u", cycles, info->Cycles);
+            //WAI 停在自己上面, 唤醒后从下一条继续
+        } else if (info->Flow == OP_FLOW_NONE && pc != next && !(halted == CPU_WAIT && pc == OP_CHECK_ADDR)) {
+            snprintf(why, sizeof(why), "length %d, table %u", (int) (pc - OP_CHECK_ADDR), OP_Length(opcode));
+        } else if (info->Flow == OP_FLOW_HALT && (pc != OP_CHECK_ADDR || halted != CPU_STOP)) {
+            snprintf(why, sizeof(why), "does not halt");
+        }
+        if (!why[0] && info->Mode == MODE_REL) {
+            //条件分支用跳转的那组标志, 基本周期加跳转和跨页; BRA 总是跳转, 只加跨页
+            Byte taken = pc == next;
+            unsigned int expect = info->Cycles + (info->Flow == OP_FLOW_BRANCH ? 2u : 1u);
+            unsigned int wrap = OP_Probe(bus, OP_WRAP_ADDR, opcode, OP_WRAP_DELTA, 0, taken, fill, &pc, &halted);
+            Short target = (Short) (OP_WRAP_ADDR + 2 + (signed char) OP_WRAP_DELTA);
+            if (pc != target || wrap != expect) {
+                snprintf(why, sizeof(why), "wrap to $%04X: %u cycles, table %u", pc, wrap, expect);
+            }
+        }
+        if (why[0]) {
+            fprintf(fp, "$%02X %-4s: %s\n", opcode, info->Name, why);
+            bad++;
+        }
+    }
+    free(bus);
+    return bad;
+}
@@ -0,0 +1,123 @@
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include "include/pace.h"
+
+static unsigned long long Pace_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void Pace_Update(struct Pace *pace) {
+    pace->Cycle_Ns = pace->Hz > 0 && pace->Speed > 0 ? 1e9 / (pace->Hz * pace->Speed) : 0;
+    pace->Origin_Ns = 0;
+}
+
+void Pace_Init(struct Pace *pace, double hz) {
+    memset(pace, 0, sizeof(*pace));
+    pace->Hz = hz;
+    pace->Speed = 1;
+    pace->Slice = PACE_SLICE_NS;
+    pace->Margin = PACE_SPIN_MAX_NS / 4;
+    Pace_Update(pace);
+}
+
+void Pace_Set_Speed(struct Pace *pace, double speed) {
+    pace->Speed = speed;
+    Pace_Update(pace);
+}
+
+/**
+ * 睡到 deadline - Margin, 再自旋到 deadline
+ * Margin 随睡眠误差变大时立即跟上, 变小时慢慢收回
+ * @return 醒来的时间
+ */
+static unsigned long long Pace_Sleep(struct Pace *pace, unsigned long long deadline) {
+    unsigned long long now = Pace_Now();
+    unsigned long long start = now;
+    if (deadline > now + pace->Margin) {
+        unsigned long long target = deadline - pace->Margin;
+        struct timespec ts = {(time_t) (target / 1000000000ULL), (long) (target % 1000000000ULL)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        now = Pace_Now();
+        unsigned long long late = now > target ? now - target : 0;
+        pace->Margin = late > pace->Margin ? late : pace->Margin - pace->Margin / 16;
+        if (pace->Margin > PACE_SPIN_MAX_NS) {
+            pace->Margin = PACE_SPIN_MAX_NS;
+        }
+    }
+    while (now < deadline) {
+        now = Pace_Now();
+    }
+    unsigned long long jitter = now - deadline;
+    pace->Jitter_Sum += jitter;
+    pace->Wakes++;
+    if (jitter > pace->Stats.Jitter_Max) {
+        pace->Stats.Jitter_Max = jitter;
+    }
+    pace->Stats.Sleep += now - start;
+    return now;
+}
+
+unsigned long long Pace_Run(struct Pace *pace, struct CPU_Context *cpu, unsigned long long cycles) {
+    CPU_Select(cpu);
+    if (pace->Cycle_Ns <= 0) {
+        unsigned long long ran = CPU_Run(cycles);
+        pace->Stats.Batches++;
+        pace->Stats.Cycles += ran;
+        return ran;
+    }
+    unsigned long long now = Pace_Now();
+    if (pace->Origin_Ns) {
+        //两次调用之间停了太久(调试器、宿主暂停)
+        double expected = pace->Origin_Ns + (cpu->Cycles - pace->Origin_Cycles) * pace->Cycle_Ns;
+        if (now > expected + PACE_MAX_LAG_NS) {
+            pace->Stats.Resyncs++;
+            pace->Origin_Ns = 0;
+        }
+    }
+    if (!pace->Origin_Ns) {
+        pace->Origin_Ns = now;
+        pace->Origin_Cycles = cpu->Cycles;
+    }
+    unsigned long long batch = pace->Slice / pace->Cycle_Ns;
+    if (batch == 0) {
+        batch = 1;
+    }
+    unsigned long long done = 0;
+    while (done < cycles) {
+        unsigned long long want = cycles - done < batch ? cycles - done : batch;
+        unsigned long long ran = CPU_Run(want);
+        done += ran;
+        pace->Stats.Batches++;
+        pace->Stats.Cycles += ran;
+        unsigned long long end = Pace_Now();
+        pace->Stats.Busy += end - now;
+        unsigned long long deadline = pace->Origin_Ns
+                                      + (unsigned long long) ((cpu->Cycles - pace->Origin_Cycles) * pace->Cycle_Ns);
+        pace->Stats.Drift = (long long) (end - deadline);
+        if (end > deadline) {
+            pace->Stats.Overruns++;
+            if (end - deadline > PACE_MAX_LAG_NS) {
+                //追不上: 从现在重新计时, 不用一连串满速的批次去补
+                pace->Stats.Resyncs++;
+                pace->Origin_Ns = end;
+                pace->Origin_Cycles = cpu->Cycles;
+            }
+            now = end;
+        } else {
+            now = Pace_Sleep(pace, deadline);
+        }
+        if (ran < want) {
+            break;
+        }
+    }
+    return done;
+}
+
+void Pace_Get_Stats(const struct Pace *pace, struct Pace_Stats *stats) {
+    *stats = pace->Stats;
+    stats->Jitter_Avg = pace->Wakes ? pace->Jitter_Sum / pace->Wakes : 0;
+}
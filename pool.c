@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "include/pool.h"
+
+//FNV-1a 64
+static unsigned long long Pool_Hash(const Byte *data) {
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < 256; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+void Pool_Init(struct Pool *pool) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->Lock, NULL);
+}
+
+void Pool_Free(struct Pool *pool) {
+    while (pool->Slabs) {
+        struct Pool_Slab *next = pool->Slabs->Next;
+        free(pool->Slabs);
+        pool->Slabs = next;
+    }
+    free(pool->Buckets);
+    pthread_mutex_destroy(&pool->Lock);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void Pool_Get_Stats(struct Pool *pool, struct Pool_Stats *stats) {
+    pthread_mutex_lock(&pool->Lock);
+    *stats = pool->Stats;
+    pthread_mutex_unlock(&pool->Lock);
+    stats->Saved_Bytes = (stats->Refs - stats->Pages) * 256;
+}
+
+/**
+ * 哈希表扩容到页数的两倍
+ */
+static int Pool_Grow(struct Pool *pool) {
+    unsigned int count = pool->Bucket_Count ? pool->Bucket_Count * 2 : 1024;
+    struct Pool_Page **buckets = calloc(count, sizeof(*buckets));
+    if (!buckets) {
+        return -1;
+    }
+    for (unsigned int i = 0; i < pool->Bucket_Count; ++i) {
+        for (struct Pool_Page *page = pool->Buckets[i], *next; page; page = next) {
+            next = page->Next;
+            page->Next = buckets[page->Hash & (count - 1)];
+            buckets[page->Hash & (count - 1)] = page;
+        }
+    }
+    free(pool->Buckets);
+    pool->Buckets = buckets;
+    pool->Bucket_Count = count;
+    return 0;
+}
+
+static struct Pool_Page *Pool_Alloc(struct Pool *pool) {
+    if (!pool->Free) {
+        struct Pool_Slab *slab = aligned_alloc(BUS_CACHE_LINE, sizeof(*slab));
+        if (!slab) {
+            return NULL;
+        }
+        slab->Next = pool->Slabs;
+        pool->Slabs = slab;
+        for (int i = 0; i < POOL_SLAB; ++i) {
+            slab->Pages[i].Next = pool->Free;
+            pool->Free = &slab->Pages[i];
+        }
+        pool->Stats.Pool_Bytes += sizeof(*slab);
+    }
+    struct Pool_Page *page = pool->Free;
+    pool->Free = page->Next;
+    return page;
+}
+
+const Byte *Pool_Intern(struct Pool *pool, const Byte *data) {
+    unsigned long long hash = Pool_Hash(data);
+    const Byte *shared = NULL;
+    pthread_mutex_lock(&pool->Lock);
+    if (pool->Stats.Pages >= pool->Bucket_Count && Pool_Grow(pool)) {
+        pthread_mutex_unlock(&pool->Lock);
+        return NULL;
+    }
+    struct Pool_Page **bucket = &pool->Buckets[hash & (pool->Bucket_Count - 1)];
+    for (struct Pool_Page *page = *bucket; page; page = page->Next) {
+        if (page->Hash == hash && memcmp(page->Data, data, 256) == 0) {
+            page->Refs++;
+            shared = page->Data;
+            break;
+        }
+    }
+    if (!shared) {
+        struct Pool_Page *page = Pool_Alloc(pool);
+        if (page) {
+            memcpy(page->Data, data, 256);
+            page->Hash = hash;
+            page->Refs = 1;
+            page->Next = *bucket;
+            *bucket = page;
+            pool->Stats.Pages++;
+            shared = page->Data;
+        }
+    }
+    if (shared) {
+        pool->Stats.Refs++;
+    }
+    pthread_mutex_unlock(&pool->Lock);
+    return shared;
+}
+
+void Pool_Release(struct Pool *pool, const Byte *data) {
+    struct Pool_Page *page = (struct Pool_Page *) (data - offsetof(struct Pool_Page, Data));
+    pthread_mutex_lock(&pool->Lock);
+    pool->Stats.Refs--;
+    if (--page->Refs == 0) {
+        struct Pool_Page **link = &pool->Buckets[page->Hash & (pool->Bucket_Count - 1)];
+        while (*link != page) {
+            link = &(*link)->Next;
+        }
+        *link = page->Next;
+        page->Next = pool->Free;
+        pool->Free = page;
+        pool->Stats.Pages--;
+    }
+    pthread_mutex_unlock(&pool->Lock);
+}
@@ -0,0 +1,214 @@
+#include <stdlib.h>
+#include <string.h>
+#include "include/replay.h"
+
+static const char Replay_Magic[4] = {'6', 'R', 'P', 'L'};
+#define REPLAY_VERSION 1
+
+static void Replay_Flush(struct Replay *replay) {
+    fwrite(replay->Buf, 1, replay->Len, replay->File);
+    replay->Len = 0;
+}
+
+static void Replay_Put(struct Replay *replay, Byte value) {
+    if (replay->Len == REPLAY_BUF_SIZE) {
+        Replay_Flush(replay);
+    }
+    replay->Buf[replay->Len++] = value;
+}
+
+static void Replay_Put_Varint(struct Replay *replay, unsigned long long value) {
+    while (value >= 0x80) {
+        Replay_Put(replay, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    Replay_Put(replay, value);
+}
+
+/**
+ * 回放时读一个字节, 文件结束返回 REPLAY_END
+ */
+static Byte Replay_Get(struct Replay *replay) {
+    if (replay->Pos == replay->Len) {
+        replay->Len = fread(replay->Buf, 1, REPLAY_BUF_SIZE, replay->File);
+        replay->Pos = 0;
+        if (replay->Len == 0) {
+            return REPLAY_END;
+        }
+    }
+    return replay->Buf[replay->Pos++];
+}
+
+static unsigned long long Replay_Get_Varint(struct Replay *replay) {
+    unsigned long long value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        Byte b = Replay_Get(replay);
+        value |= (unsigned long long) (b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    return value;
+}
+
+/**
+ * 预读下一条记录, 中断记录按周期启动定时器
+ */
+static void Replay_Advance(struct Replay *replay) {
+    replay->Next = Replay_Get(replay);
+    if (replay->Next == REPLAY_IRQ || replay->Next == REPLAY_NMI || replay->Next == REPLAY_WAKE) {
+        replay->Next_Stamp = replay->Stamp + Replay_Get_Varint(replay);
+        CPU_Timer_Start(replay->Cpu, &replay->Timer, replay->Next_Stamp);
+    } else if (replay->Next != REPLAY_READ) {
+        replay->Next = REPLAY_END;
+    }
+}
+
+/**
+ * 回放时的 I/O 读: 按顺序返回录制的值
+ */
+static Byte Replay_Device_Read(void *ctx, Short addr) {
+    struct Replay *replay = ctx;
+    (void) addr;
+    if (replay->Next != REPLAY_READ) {
+        replay->Mismatch++;
+        return 0xFF;
+    }
+    Byte value = Replay_Get(replay);
+    Replay_Advance(replay);
+    return value;
+}
+
+/**
+ * 回放时到达中断记录的周期
+ */
+static void Replay_Fire(struct CPU_Timer *timer, struct CPU_Context *cpu) {
+    struct Replay *replay = timer->Ctx;
+    if (cpu->Cycles != replay->Next_Stamp) {
+        replay->Mismatch++;
+    }
+    replay->Stamp = replay->Next_Stamp;
+    switch (replay->Next) {
+        case REPLAY_WAKE:
+            cpu->Halted = CPU_RUN;
+            cpu->PC++;
+            break;
+        case REPLAY_IRQ:
+            CPU_Interrupt(0);
+            break;
+        case REPLAY_NMI:
+            CPU_Interrupt(1);
+            break;
+    }
+    Replay_Advance(replay);
+}
+
+/**
+ * 开始录制 cpu 的外部输入
+ * 从这里开始 I/O 读取和中断都写进 path, 直到 Replay_Close
+ * @param cpu
+ * @param path
+ * @return 打开失败返回 NULL
+ */
+struct Replay *Replay_Record(struct CPU_Context *cpu, const char *path) {
+    struct Replay *replay = calloc(1, sizeof(struct Replay));
+    replay->File = fopen(path, "wb");
+    if (!replay->File) {
+        free(replay);
+        return NULL;
+    }
+    replay->Mode = REPLAY_RECORD;
+    replay->Cpu = cpu;
+    replay->Stamp = cpu->Cycles;
+    Byte io_pages[32] = {0};
+    for (int page = 0; page < 256; ++page) {
+        if (cpu->Bus->IO[page]) {
+            io_pages[page >> 3] |= 1 << (page & 7);
+        }
+    }
+    fwrite(Replay_Magic, 1, sizeof(Replay_Magic), replay->File);
+    fputc(REPLAY_VERSION, replay->File);
+    fwrite(io_pages, 1, sizeof(io_pages), replay->File);
+    for (int i = 0; i < 8; ++i) {
+        fputc((replay->Stamp >> (i * 8)) & 0xFF, replay->File);
+    }
+    cpu->Recorder = replay;
+    return replay;
+}
+
+/**
+ * 回放日志: 日志中的 I/O 页换成回放设备, 中断按录制时的周期注入
+ * cpu 需要处于和录制开始时相同的状态(内存、寄存器), 不需要挂任何设备
+ * @param cpu
+ * @param path
+ * @return 打开失败或格式不对返回 NULL
+ */
+struct Replay *Replay_Play(struct CPU_Context *cpu, const char *path) {
+    struct Replay *replay = calloc(1, sizeof(struct Replay));
+    char magic[4];
+    Byte io_pages[32];
+    Byte stamp[8];
+    replay->File = fopen(path, "rb");
+    if (!replay->File) {
+        free(replay);
+        return NULL;
+    }
+    if (fread(magic, 1, 4, replay->File) != 4 || memcmp(magic, Replay_Magic, 4) != 0
+        || fgetc(replay->File) != REPLAY_VERSION
+        || fread(io_pages, 1, 32, replay->File) != 32
+        || fread(stamp, 1, 8, replay->File) != 8) {
+        fclose(replay->File);
+        free(replay);
+        return NULL;
+    }
+    replay->Mode = REPLAY_PLAY;
+    replay->Cpu = cpu;
+    for (int i = 0; i < 8; ++i) {
+        replay->Stamp |= (unsigned long long) stamp[i] << (i * 8);
+    }
+    replay->Device.Read = Replay_Device_Read;
+    replay->Device.Ctx = replay;
+    for (int page = 0; page < 256; ++page) {
+        if (io_pages[page >> 3] & (1 << (page & 7))) {
+            Bus_Map_IO(cpu->Bus, page << 8, page << 8, &replay->Device);
+        }
+    }
+    CPU_Set_Cycles(cpu, replay->Stamp);
+    replay->Timer.Fire = Replay_Fire;
+    replay->Timer.Ctx = replay;
+    Replay_Advance(replay);
+    return replay;
+}
+
+/**
+ * 结束录制/回放, 录制时写入结束标记, 回放时取消回放设备的映射
+ * @param replay
+ */
+void Replay_Close(struct Replay *replay) {
+    if (replay->Mode == REPLAY_RECORD) {
+        Replay_Put(replay, REPLAY_END);
+        Replay_Flush(replay);
+        replay->Cpu->Recorder = NULL;
+    } else {
+        CPU_Timer_Stop(replay->Cpu, &replay->Timer);
+        //回放设备马上释放, I/O 页恢复成内存
+        for (int page = 0; page < 256; ++page) {
+            if (replay->Cpu->Bus->IO[page] == &replay->Device) {
+                Bus_Map_IO(replay->Cpu->Bus, page << 8, page << 8, NULL);
+            }
+        }
+    }
+    fclose(replay->File);
+    free(replay);
+}
+
+void Replay_Log_Read(struct Replay *replay, Byte value) {
+    Replay_Put(replay, REPLAY_READ);
+    Replay_Put(replay, value);
+}
+
+void Replay_Log_Interrupt(struct Replay *replay, Byte type, unsigned long long cycle) {
+    Replay_Put(replay, type);
+    Replay_Put_Varint(replay, cycle - replay->Stamp);
+    replay->Stamp = cycle;
+}
@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include "include/ring.h"
+
+int Ring_Init(struct Ring *ring, size_t size) {
+    size_t capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    ring->Data = malloc(capacity);
+    if (!ring->Data) {
+        return -1;
+    }
+    ring->Mask = capacity - 1;
+    atomic_init(&ring->Head, 0);
+    atomic_init(&ring->Tail, 0);
+    atomic_init(&ring->Closed, 0);
+    ring->Tail_Cache = 0;
+    ring->Head_Cache = 0;
+    return 0;
+}
+
+void Ring_Free(struct Ring *ring) {
+    free(ring->Data);
+    ring->Data = NULL;
+}
+
+size_t Ring_Write_Span(struct Ring *ring, Byte **data) {
+    size_t head = atomic_load_explicit(&ring->Head, memory_order_relaxed);
+    size_t size = ring->Mask + 1;
+    if (head - ring->Tail_Cache == size) {
+        ring->Tail_Cache = atomic_load_explicit(&ring->Tail, memory_order_acquire);
+    }
+    size_t space = size - (head - ring->Tail_Cache);
+    size_t offset = head & ring->Mask;
+    *data = ring->Data + offset;
+    return space < size - offset ? space : size - offset;
+}
+
+void Ring_Produce(struct Ring *ring, size_t count) {
+    size_t head = atomic_load_explicit(&ring->Head, memory_order_relaxed);
+    atomic_store_explicit(&ring->Head, head + count, memory_order_release);
+}
+
+size_t Ring_Read_Span(struct Ring *ring, const Byte **data) {
+    size_t tail = atomic_load_explicit(&ring->Tail, memory_order_relaxed);
+    if (ring->Head_Cache == tail) {
+        ring->Head_Cache = atomic_load_explicit(&ring->Head, memory_order_acquire);
+    }
+    size_t count = ring->Head_Cache - tail;
+    size_t offset = tail & ring->Mask;
+    *data = ring->Data + offset;
+    return count < ring->Mask + 1 - offset ? count : ring->Mask + 1 - offset;
+}
+
+void Ring_Consume(struct Ring *ring, size_t count) {
+    size_t tail = atomic_load_explicit(&ring->Tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->Tail, tail + count, memory_order_release);
+}
+
+int Ring_Put(struct Ring *ring, Byte value) {
+    Byte *data;
+    if (!Ring_Write_Span(ring, &data)) {
+        return -1;
+    }
+    *data = value;
+    Ring_Produce(ring, 1);
+    return 0;
+}
+
+int Ring_Get(struct Ring *ring) {
+    const Byte *data;
+    if (!Ring_Read_Span(ring, &data)) {
+        return -1;
+    }
+    Byte value = *data;
+    Ring_Consume(ring, 1);
+    return value;
+}
+
+void Ring_Close(struct Ring *ring) {
+    atomic_store_explicit(&ring->Closed, 1, memory_order_release);
+}
+
+int Ring_Ended(struct Ring *ring) {
+    //先看关闭标志: 关闭之前写入的数据一定已经可见
+    if (!atomic_load_explicit(&ring->Closed, memory_order_acquire)) {
+        return 0;
+    }
+    return atomic_load_explicit(&ring->Head, memory_order_acquire)
+           == atomic_load_explicit(&ring->Tail, memory_order_relaxed);
+}
+
+//-------------搬运线程-----------------
+
+static void Ring_Idle() {
+    struct timespec ts = {0, RING_IDLE_NS};
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * 文件 -> 缓冲区: 等文件可读, 直接读进缓冲区的空闲空间
+ */
+static void Ring_Pump_In(struct Ring_Pump *pump) {
+    struct pollfd fd = {pump->Fd, POLLIN, 0};
+    while (!atomic_load_explicit(&pump->Stop, memory_order_acquire)) {
+        Byte *data;
+        size_t span = Ring_Write_Span(pump->Ring, &data);
+        if (!span) {
+            Ring_Idle();
+            continue;
+        }
+        int ready = poll(&fd, 1, RING_POLL_MS);
+        if (ready <= 0) {
+            if (ready < 0 && errno != EINTR) {
+                pump->Error = errno;
+                break;
+            }
+            continue;
+        }
+        ssize_t n = read(pump->Fd, data, span);
+        if (n > 0) {
+            Ring_Produce(pump->Ring, n);
+            atomic_fetch_add_explicit(&pump->Bytes, n, memory_order_relaxed);
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR && errno != EAGAIN) {
+            pump->Error = errno;
+            break;
+        }
+    }
+    Ring_Close(pump->Ring);
+}
+
+/**
+ * 缓冲区 -> 文件: 直接从缓冲区写出; 写入出错后丢弃数据, 不让生产者因为缓冲区满而停住
+ */
+static void Ring_Pump_Out(struct Ring_Pump *pump) {
+    for (;;) {
+        //先看结束条件再取数据, 结束之前写入的数据不会漏掉
+        int last = atomic_load_explicit(&pump->Stop, memory_order_acquire)
+                   || atomic_load_explicit(&pump->Ring->Closed, memory_order_acquire);
+        const Byte *data;
+        size_t span = Ring_Read_Span(pump->Ring, &data);
+        if (!span) {
+            if (last) {
+                break;
+            }
+            Ring_Idle();
+            continue;
+        }
+        if (pump->Error) {
+            Ring_Consume(pump->Ring, span);
+            continue;
+        }
+        ssize_t n = write(pump->Fd, data, span);
+        if (n > 0) {
+            Ring_Consume(pump->Ring, n);
+            atomic_fetch_add_explicit(&pump->Bytes, n, memory_order_relaxed);
+        } else if (n < 0 && errno != EINTR && errno != EAGAIN) {
+            pump->Error = errno;
+        }
+    }
+}
+
+static void *Ring_Pump_Thread(void *arg) {
+    struct Ring_Pump *pump = arg;
+    if (pump->Input) {
+        Ring_Pump_In(pump);
+    } else {
+        Ring_Pump_Out(pump);
+    }
+    atomic_store_explicit(&pump->Done, 1, memory_order_release);
+    return NULL;
+}
+
+int Ring_Pump_Start(struct Ring_Pump *pump, struct Ring *ring, int fd, int input) {
+    pump->Ring = ring;
+    pump->Fd = fd;
+    pump->Input = input;
+    pump->Error = 0;
+    atomic_init(&pump->Stop, 0);
+    atomic_init(&pump->Done, 0);
+    atomic_init(&pump->Bytes, 0);
+    return pthread_create(&pump->Thread, NULL, Ring_Pump_Thread, pump) ? -1 : 0;
+}
+
+void Ring_Pump_Stop(struct Ring_Pump *pump) {
+    atomic_store_explicit(&pump->Stop, 1, memory_order_release);
+    pthread_join(pump->Thread, NULL);
+}
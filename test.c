@@ -0,0 +1,600 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "include/test.h"
+
+static const char *Test_Results[] = {"pass", "fail", "timeout", "halt", "error"};
+
+static double Test_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *Test_Copy(const char *text) {
+    char *copy = malloc(strlen(text) + 1);
+    if (!copy) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    return strcpy(copy, text);
+}
+
+void Test_Init(struct Test_Runner *runner) {
+    memset(runner, 0, sizeof(*runner));
+    runner->Max_Cycles = TEST_MAX_CYCLES;
+    runner->Timeout = TEST_MAX_SECONDS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    runner->Jobs = cpus > 0 ? (int) cpus : 1;
+}
+
+void Test_Free(struct Test_Runner *runner) {
+    for (int i = 0; i < runner->Case_Count; ++i) {
+        struct Test_Case *test = &runner->Cases[i];
+        free(test->Name);
+        free(test->File);
+        free(test->Checks);
+        free(test->Message);
+    }
+    for (int i = 0; i < runner->Unit_Count; ++i) {
+        free(runner->Units[i]->Path);
+        free(runner->Units[i]->Image);
+        free(runner->Units[i]);
+    }
+    free(runner->Cases);
+    free(runner->Units);
+    memset(runner, 0, sizeof(*runner));
+}
+
+static struct Test_Case *Test_New_Case(struct Test_Runner *runner) {
+    if (runner->Case_Count == runner->Case_Cap) {
+        runner->Case_Cap = runner->Case_Cap ? runner->Case_Cap * 2 : 256;
+        runner->Cases = realloc(runner->Cases, sizeof(*runner->Cases) * runner->Case_Cap);
+        if (!runner->Cases) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    struct Test_Case *test = &runner->Cases[runner->Case_Count++];
+    memset(test, 0, sizeof(*test));
+    return test;
+}
+
+/**
+ * 返回地址: 从 $FFF9(中断向量下面)往下找镜像没写过、用例不碰的字节, 跳过栈页
+ * @return -1 没有
+ */
+static long Test_Find_Exit(const struct Assembler *as) {
+    Byte *taken = calloc(0x10000, 1);
+    if (!taken) {
+        return -1;
+    }
+    for (int i = 0; i < as->Check_Count; ++i) {
+        if (as->Checks[i].Target == ASM_CHECK_MEM) {
+            taken[as->Checks[i].Addr] = 1;
+        }
+    }
+    long found = -1;
+    for (long addr = 0xFFF9; addr >= 0x200 && found < 0; --addr) {
+        if (!as->Used[addr] && !taken[addr]) {
+            found = addr;
+        }
+    }
+    free(taken);
+    return found;
+}
+
+int Test_Add(struct Test_Runner *runner, const struct Assembler *as, const char *path, int failed) {
+    struct Test_Unit *unit = calloc(1, sizeof(*unit));
+    if (!unit) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    if (runner->Unit_Count == runner->Unit_Cap) {
+        runner->Unit_Cap = runner->Unit_Cap ? runner->Unit_Cap * 2 : 64;
+        runner->Units = realloc(runner->Units, sizeof(*runner->Units) * runner->Unit_Cap);
+        if (!runner->Units) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    runner->Units[runner->Unit_Count++] = unit;
+    unit->Path = Test_Copy(path);
+    long ret = failed ? -1 : Test_Find_Exit(as);
+    if (ret < 0) {
+        //汇编失败或者没有地方放返回地址: 记一个出错的用例
+        struct Test_Case *test = Test_New_Case(runner);
+        test->Unit = unit;
+        test->Name = Test_Copy("(assemble)");
+        test->File = Test_Copy(path);
+        test->Result = TEST_ERROR;
+        test->Message = Test_Copy(failed ? "assembly failed" : "no free byte for the return address");
+        unit->Failed = 1;
+        return failed ? 0 : -1;
+    }
+    unit->Exit = ret;
+    int low = 0;
+    int high = 0xFFFF;
+    while (low <= 0xFFFF && !as->Used[low]) {
+        low++;
+    }
+    while (high >= low && !as->Used[high]) {
+        high--;
+    }
+    if (low <= high) {
+        unit->Low = low;
+        unit->Size = high - low + 1;
+        unit->Image = malloc(unit->Size);
+        if (!unit->Image) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        memcpy(unit->Image, as->Image + low, unit->Size);
+    }
+    for (int i = 0; i < as->Test_Count; ++i) {
+        const struct ASM_Test *source = &as->Tests[i];
+        struct Test_Case *test = Test_New_Case(runner);
+        test->Unit = unit;
+        test->Name = Test_Copy(source->Name);
+        test->File = Test_Copy(source->File);
+        test->Line = source->Line;
+        test->Entry = source->Entry;
+        test->Max_Cycles = source->Max_Cycles ? source->Max_Cycles : runner->Max_Cycles;
+        test->Count = source->Count;
+        test->Checks = malloc(sizeof(*test->Checks) * (source->Count ? source->Count : 1));
+        if (!test->Checks) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        memcpy(test->Checks, as->Checks + source->First, sizeof(*test->Checks) * source->Count);
+    }
+    return 0;
+}
+
+//-------------执行-----------------
+
+static Byte Test_Get_P(const struct CPU_Context *cpu) {
+    return (cpu->F_N << 7) | (cpu->F_V << 6) | 0x20 | (cpu->F_D << 3) | (cpu->F_I << 2) | (cpu->F_Z << 1) | cpu->F_C;
+}
+
+/**
+ * .setup 的寄存器和标志
+ */
+static void Test_Set(struct CPU_Context *cpu, int target, Byte value) {
+    switch (target) {
+        case ASM_CHECK_A: cpu->A = value; break;
+        case ASM_CHECK_X: cpu->X = value; break;
+        case ASM_CHECK_Y: cpu->Y = value; break;
+        case ASM_CHECK_SP: cpu->SP = value; break;
+        case ASM_CHECK_P:
+            cpu->F_N = value >> 7;
+            cpu->F_V = (value >> 6) & 1;
+            cpu->F_D = (value >> 3) & 1;
+            cpu->F_I = (value >> 2) & 1;
+            cpu->F_Z = (value >> 1) & 1;
+            cpu->F_C = value & 1;
+            break;
+        case ASM_CHECK_N: cpu->F_N = value; break;
+        case ASM_CHECK_V: cpu->F_V = value; break;
+        case ASM_CHECK_D: cpu->F_D = value; break;
+        case ASM_CHECK_I: cpu->F_I = value; break;
+        case ASM_CHECK_Z: cpu->F_Z = value; break;
+        case ASM_CHECK_C: cpu->F_C = value; break;
+        default: break;
+    }
+}
+
+/**
+ * .expect 比较的实际值
+ */
+static unsigned long long Test_Get(const struct CPU_Context *cpu, const struct ASM_Check *check,
+                                   unsigned long long cycles) {
+    switch (check->Target) {
+        case ASM_CHECK_MEM: return Bus_Peek(cpu->Bus, check->Addr);
+        case ASM_CHECK_A: return cpu->A;
+        case ASM_CHECK_X: return cpu->X;
+        case ASM_CHECK_Y: return cpu->Y;
+        case ASM_CHECK_SP: return cpu->SP;
+        case ASM_CHECK_P: return Test_Get_P(cpu);
+        case ASM_CHECK_N: return cpu->F_N;
+        case ASM_CHECK_V: return cpu->F_V;
+        case ASM_CHECK_D: return cpu->F_D;
+        case ASM_CHECK_I: return cpu->F_I;
+        case ASM_CHECK_Z: return cpu->F_Z;
+        case ASM_CHECK_C: return cpu->F_C;
+        default: return cycles;
+    }
+}
+
+/**
+ * 执行一个用例: 装入镜像, .setup, 像 JSR 一样压入 Exit - 1 后从入口开始, 直到停机或超时
+ */
+static void Test_Exec(const struct Test_Runner *runner, struct Test_Case *test, struct Bus *bus,
+                      struct CPU_Context *cpu) {
+    const struct Test_Unit *unit = test->Unit;
+    double start_time = Test_Now();
+    Bus_Init(bus);
+    if (unit->Size) {
+        Bus_Load(bus, unit->Low, unit->Image, unit->Size);
+    }
+    CPU_Init(cpu, bus);
+    CPU_Select(cpu);
+    CPU_Reset(test->Entry);
+    //按源代码的顺序, 先写 P 再改单个标志也可以
+    for (int i = 0; i < test->Count; ++i) {
+        const struct ASM_Check *check = &test->Checks[i];
+        if (check->Expect) {
+            continue;
+        }
+        if (check->Target == ASM_CHECK_MEM) {
+            Bus_Poke(bus, check->Addr, check->Value);
+        } else {
+            Test_Set(cpu, check->Target, check->Value);
+        }
+    }
+    Short ret = unit->Exit - 1;
+    Bus_Poke(bus, unit->Exit, CPU_HALT_OPCODE);
+    Bus_Poke(bus, 0x100 | cpu->SP--, ret >> 8);
+    Bus_Poke(bus, 0x100 | cpu->SP--, ret & 0xFF);
+    int late = 0;
+    while (cpu->Halted != CPU_STOP && cpu->Cycles < test->Max_Cycles && !late) {
+        unsigned long long left = test->Max_Cycles - cpu->Cycles;
+        CPU_Run(left > TEST_BATCH ? TEST_BATCH : left);
+        late = runner->Timeout > 0 && Test_Now() - start_time > runner->Timeout;
+    }
+    test->Seconds = Test_Now() - start_time;
+    char *message = NULL;
+    size_t length = 0;
+    FILE *fp = open_memstream(&message, &length);
+    if (!fp) {
+        test->Result = TEST_ERROR;
+        return;
+    }
+    if (cpu->Halted != CPU_STOP) {
+        test->Result = TEST_TIMEOUT;
+        test->Cycles = cpu->Cycles;
+        if (late) {
+            fprintf(fp, "%s:%d: still running after %.1fs (%llu cycles), PC=$%04X\n", test->File, test->Line,
+                    test->Seconds, cpu->Cycles, cpu->PC);
+        } else {
+            fprintf(fp, "%s:%d: still running after %llu cycles, PC=$%04X\n", test->File, test->Line,
+                    cpu->Cycles, cpu->PC);
+        }
+    } else if (cpu->PC != unit->Exit) {
+        test->Result = TEST_HALT;
+        test->Cycles = cpu->Cycles;
+        fprintf(fp, "%s:%d: halted at $%04X after %llu cycles\n", test->File, test->Line, cpu->PC, cpu->Cycles);
+    } else {
+        test->Result = TEST_PASS;
+        test->Cycles = cpu->Cycles - runner->Halt_Cycles;
+        for (int i = 0; i < test->Count; ++i) {
+            const struct ASM_Check *check = &test->Checks[i];
+            if (!check->Expect) {
+                continue;
+            }
+            unsigned long long value = Test_Get(cpu, check, test->Cycles);
+            if (value == check->Value) {
+                continue;
+            }
+            test->Result = TEST_FAIL;
+            if (check->Target == ASM_CHECK_MEM) {
+                fprintf(fp, "%s:%d: $%04X = $%02llX, expected $%02lX\n", test->File, check->Line, check->Addr,
+                        value, check->Value);
+            } else if (check->Target == ASM_CHECK_CYCLES || check->Target >= ASM_CHECK_N) {
+                fprintf(fp, "%s:%d: %s = %llu, expected %lu\n", test->File, check->Line,
+                        ASM_Check_Name(check->Target), value, check->Value);
+            } else {
+                fprintf(fp, "%s:%d: %s = $%02llX, expected $%02lX\n", test->File, check->Line,
+                        ASM_Check_Name(check->Target), value, check->Value);
+            }
+        }
+    }
+    fclose(fp);
+    if (length) {
+        //去掉最后的换行
+        message[length - 1] = '\0';
+        test->Message = message;
+    } else {
+        free(message);
+    }
+}
+
+struct Test_Worker {
+    struct Test_Runner *Runner;
+    struct Bus *Bus;
+};
+
+static void *Test_Worker_Main(void *arg) {
+    struct Test_Worker *worker = arg;
+    struct Test_Runner *runner = worker->Runner;
+    struct CPU_Context *cpu = aligned_alloc(BUS_CACHE_LINE, sizeof(*cpu));
+    if (!cpu) {
+        return NULL;
+    }
+    for (int i; (i = atomic_fetch_add(&runner->Next, 1)) < runner->Case_Count;) {
+        if (runner->Cases[i].Result != TEST_ERROR) {
+            Test_Exec(runner, &runner->Cases[i], worker->Bus, cpu);
+        }
+    }
+    free(cpu);
+    return NULL;
+}
+
+/**
+ * 停机指令本身用的周期
+ */
+static unsigned int Test_Halt_Cycles(struct Bus *bus) {
+    struct CPU_Context *cpu = aligned_alloc(BUS_CACHE_LINE, sizeof(*cpu));
+    if (!cpu) {
+        return 0;
+    }
+    Bus_Init(bus);
+    Bus_Poke(bus, 0x200, CPU_HALT_OPCODE);
+    CPU_Init(cpu, bus);
+    CPU_Select(cpu);
+    CPU_Reset(0x200);
+    CPU_Run(100);
+    unsigned int cycles = cpu->Cycles;
+    free(cpu);
+    return cycles;
+}
+
+int Test_Run(struct Test_Runner *runner) {
+    int jobs = runner->Jobs < 1 ? 1 : runner->Jobs > runner->Case_Count ? runner->Case_Count : runner->Jobs;
+    double start = Test_Now();
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    pthread_t *tids = malloc(sizeof(*tids) * jobs);
+    struct Test_Worker *workers = calloc(jobs, sizeof(*workers));
+    if (!tids || !workers) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    //总线放 64K 内存, 每个线程一条, 用例之间重新初始化
+    for (int i = 0; i < jobs; ++i) {
+        workers[i].Runner = runner;
+        workers[i].Bus = aligned_alloc(BUS_CACHE_LINE, sizeof(struct Bus));
+        if (!workers[i].Bus) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    runner->Halt_Cycles = Test_Halt_Cycles(workers[0].Bus);
+    atomic_store(&runner->Next, 0);
+    //创建失败的线程不影响结果, 当前线程也执行
+    int started = 0;
+    for (int i = 1; i < jobs; ++i) {
+        if (pthread_create(&tids[started], NULL, Test_Worker_Main, &workers[i]) == 0) {
+            started++;
+        }
+    }
+    Test_Worker_Main(&workers[0]);
+    for (int i = 0; i < started; ++i) {
+        pthread_join(tids[i], NULL);
+    }
+    for (int i = 0; i < jobs; ++i) {
+        free(workers[i].Bus);
+    }
+    free(workers);
+    free(tids);
+    runner->Seconds = Test_Now() - start;
+    int failed = 0;
+    for (int i = 0; i < runner->Case_Count; ++i) {
+        failed += runner->Cases[i].Result != TEST_PASS;
+    }
+    return failed;
+}
+
+//-------------输出-----------------
+
+/**
+ * TAP 的描述里 # 开始指令, 要转义
+ */
+static void Test_TAP_Text(FILE *fp, const char *text) {
+    for (; *text; ++text) {
+        if (*text == '#' || *text == '\\') {
+            fputc('\\', fp);
+        }
+        fputc(*text == '\n' ? ' ' : *text, fp);
+    }
+}
+
+void Test_Write_TAP(const struct Test_Runner *runner, FILE *fp) {
+    fprintf(fp, "TAP version 13\n1..%d\n", runner->Case_Count);
+    for (int i = 0; i < runner->Case_Count; ++i) {
+        const struct Test_Case *test = &runner->Cases[i];
+        fprintf(fp, "%s %d - ", test->Result == TEST_PASS ? "ok" : "not ok", i + 1);
+        Test_TAP_Text(fp, test->Unit->Path);
+        fputs(": ", fp);
+        Test_TAP_Text(fp, test->Name);
+        fputc('\n', fp);
+        if (test->Message) {
+            fputs("# ", fp);
+            for (const char *p = test->Message; *p; ++p) {
+                fputc(*p, fp);
+                if (*p == '\n') {
+                    fputs("# ", fp);
+                }
+            }
+            fputc('\n', fp);
+        }
+    }
+}
+
+static void Test_XML_Text(FILE *fp, const char *text) {
+    for (; *text; ++text) {
+        switch (*text) {
+            case '&': fputs("&amp;", fp); break;
+            case '<': fputs("&lt;", fp); break;
+            case '>': fputs("&gt;", fp); break;
+            case '"': fputs("&quot;", fp); break;
+            case '\n': fputs("&#10;", fp); break;
+            default:
+                //XML 不允许的控制字符
+                if ((unsigned char) *text >= 0x20 || *text == '\t') {
+                    fputc(*text, fp);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * 每个源文件一个 testsuite; 超时和停机算 failure, 汇编失败算 error
+ */
+void Test_Write_JUnit(const struct Test_Runner *runner, FILE *fp) {
+    int failures = 0;
+    int errors = 0;
+    for (int i = 0; i < runner->Case_Count; ++i) {
+        failures += runner->Cases[i].Result != TEST_PASS && runner->Cases[i].Result != TEST_ERROR;
+        errors += runner->Cases[i].Result == TEST_ERROR;
+    }
+    fprintf(fp, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(fp, "<testsuites tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.6f\">\n", runner->Case_Count,
+            failures, errors, runner->Seconds);
+    //同一单元的用例是连续的
+    for (int first = 0, last; first < runner->Case_Count; first = last) {
+        const struct Test_Unit *unit = runner->Cases[first].Unit;
+        double seconds = 0;
+        failures = errors = 0;
+        for (last = first; last < runner->Case_Count && runner->Cases[last].Unit == unit; ++last) {
+            seconds += runner->Cases[last].Seconds;
+            failures += runner->Cases[last].Result != TEST_PASS && runner->Cases[last].Result != TEST_ERROR;
+            errors += runner->Cases[last].Result == TEST_ERROR;
+        }
+        fputs("  <testsuite name=\"", fp);
+        Test_XML_Text(fp, unit->Path);
+        fprintf(fp, "\" tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.6f\">\n", last - first, failures,
+                errors, seconds);
+        for (int i = first; i < last; ++i) {
+            const struct Test_Case *test = &runner->Cases[i];
+            fputs("    <testcase classname=\"", fp);
+            Test_XML_Text(fp, unit->Path);
+            fputs("\" name=\"", fp);
+            Test_XML_Text(fp, test->Name);
+            fprintf(fp, "\" time=\"%.6f\"", test->Seconds);
+            if (test->Result == TEST_PASS) {
+                fputs("/>\n", fp);
+                continue;
+            }
+            const char *tag = test->Result == TEST_ERROR ? "error" : "failure";
+            fprintf(fp, ">\n      <%s type=\"%s\" message=\"", tag, Test_Results[test->Result]);
+            Test_XML_Text(fp, test->Message ? test->Message : "");
+            fputs("\"/>\n    </testcase>\n", fp);
+        }
+        fputs("  </testsuite>\n", fp);
+    }
+    fputs("</testsuites>\n", fp);
+}
+
+static int Test_Write(const struct Test_Runner *runner, const char *path,
+                      void (*write)(const struct Test_Runner *runner, FILE *fp)) {
+    if (strcmp(path, "-") == 0) {
+        write(runner, stdout);
+        return fflush(stdout);
+    }
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return -1;
+    }
+    write(runner, fp);
+    return fclose(fp);
+}
+
+//-------------命令行-----------------
+
+/**
+ * 命令行: test [-j N] [--max-cycles N] [--timeout SEC] [--tap FILE] [--junit FILE] [--cache DIR]
+ *              [-I DIR]... [-D NAME[=VALUE]]... <file>...
+ * 源文件依次汇编(共享词法缓存和单元缓存), 然后并行执行所有用例
+ * 没有给出 --tap/--junit 时 TAP 输出到标准输出; 所有用例通过时返回 0
+ */
+int Test_Main(int argc, char **argv) {
+    const char *tap = NULL;
+    const char *junit = NULL;
+    int failed = 0;
+    struct Test_Runner runner;
+    Test_Init(&runner);
+    struct Assembler *as = malloc(sizeof(*as));
+    if (!as) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    ASM_Init(as);
+    int i = 0;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1]; ++i) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            runner.Jobs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-cycles") == 0 && i + 1 < argc) {
+            runner.Max_Cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+            runner.Timeout = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--tap") == 0 && i + 1 < argc) {
+            tap = argv[++i];
+        } else if (strcmp(argv[i], "--junit") == 0 && i + 1 < argc) {
+            junit = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            as->Cache_Dir = argv[++i];
+        } else if (strcmp(argv[i], "-I") == 0 && i + 1 < argc && as->Dir_Count < ASM_DIRS) {
+            as->Dirs[as->Dir_Count++] = argv[++i];
+        } else if (strcmp(argv[i], "-D") == 0 && i + 1 < argc) {
+            char *define = argv[++i];
+            char *eq = strchr(define, '=');
+            long value = eq ? strtol(eq + 1, NULL, 0) : 1;
+            if (eq) {
+                *eq = '\0';
+            }
+            if (ASM_Define(as, define, value)) {
+                fprintf(stderr, "too many -D\n");
+                failed = 1;
+            }
+        } else {
+            failed = 1;
+            break;
+        }
+    }
+    if (failed || i == argc || runner.Max_Cycles == 0 || runner.Timeout < 0) {
+        fprintf(stderr, "usage: test [-j N] [--max-cycles N] [--timeout SEC] [--tap FILE] [--junit FILE] [--cache DIR]\n"
+                        "            [-I DIR]... [-D NAME[=VALUE]]... <file>...\n"
+                        "in the source:\n"
+                        "  .test \"name\", entry[, max cycles]   call entry as a subroutine, pass when it returns\n"
+                        "  .setup TARGET, value[, value...]    set before the call\n"
+                        "  .expect TARGET, value[, value...]   compare after the return\n"
+                        "TARGET: A, X, Y, SP, P, a flag (N V D I Z C, 0/1), cycles (.expect only, including the RTS)\n"
+                        "        or a memory address, one byte per value\n"
+                        "FILE: - for standard output; TAP goes to standard output when neither is given\n");
+        ASM_Free(as);
+        free(as);
+        Test_Free(&runner);
+        return 1;
+    }
+    if (as->Cache_Dir) {
+        mkdir(as->Cache_Dir, 0777);
+    }
+    for (; i < argc; ++i) {
+        if (Test_Add(&runner, as, argv[i], ASM_Assemble(as, argv[i]) != 0)) {
+            fprintf(stderr, "%s: no free byte for the return address\n", argv[i]);
+        }
+    }
+    ASM_Free(as);
+    free(as);
+    int failures = Test_Run(&runner);
+    if (junit && Test_Write(&runner, junit, Test_Write_JUnit)) {
+        fprintf(stderr, "can't write %s\n", junit);
+        failed = 1;
+    }
+    if (!junit && !tap) {
+        tap = "-";
+    }
+    if (tap && Test_Write(&runner, tap, Test_Write_TAP)) {
+        fprintf(stderr, "can't write %s\n", tap);
+        failed = 1;
+    }
+    fprintf(stderr, "%d tests, %d not ok, %.3fs\n", runner.Case_Count, failures, runner.Seconds);
+    Test_Free(&runner);
+    return failures || failed ? 1 : 0;
+}
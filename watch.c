@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "include/watch.h"
+#include "include/metrics.h"
+
+/**
+ * 重新计算 [start, end] 所在页的观察点类型
+ */
+static void Watch_Arm(struct Watch *watch, Short start, Short end) {
+    for (int page = start >> 8; page <= end >> 8; ++page) {
+        Byte armed = 0;
+        for (int i = 0; i < WATCH_MAX; ++i) {
+            const struct Watch_Point *point = &watch->Points[i];
+            if (point->Used && point->Start >> 8 <= page && point->End >> 8 >= page) {
+                armed |= point->Kind;
+            }
+        }
+        Bus_Arm(watch->Bus, page, armed);
+    }
+}
+
+void Watch_Init(struct Watch *watch, struct Bus *bus) {
+    memset(watch, 0, sizeof(*watch));
+    watch->Bus = bus;
+    bus->Watch = watch;
+}
+
+void Watch_Free(struct Watch *watch) {
+    for (int i = 0; i < WATCH_MAX; ++i) {
+        watch->Points[i].Used = 0;
+    }
+    Watch_Arm(watch, 0x0000, 0xFFFF);
+    watch->Bus->Watch = NULL;
+}
+
+int Watch_Add(struct Watch *watch, const struct Watch_Point *point) {
+    for (int i = 0; i < WATCH_MAX; ++i) {
+        if (!watch->Points[i].Used) {
+            watch->Points[i] = *point;
+            watch->Points[i].Used = 1;
+            watch->Points[i].Count = 0;
+            if (watch->Points[i].End < watch->Points[i].Start) {
+                watch->Points[i].End = watch->Points[i].Start;
+            }
+            Watch_Arm(watch, watch->Points[i].Start, watch->Points[i].End);
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Watch_Remove(struct Watch *watch, int id) {
+    if (id < 0 || id >= WATCH_MAX || !watch->Points[id].Used) {
+        return;
+    }
+    watch->Points[id].Used = 0;
+    Watch_Arm(watch, watch->Points[id].Start, watch->Points[id].End);
+}
+
+int Watch_Parse_Cond(struct Watch_Point *point, const char *text) {
+    char *end;
+    point->Mask = 0xFF;
+    while (isspace((unsigned char) *text)) {
+        text++;
+    }
+    if (*text == '\0') {
+        point->Cond = WATCH_ALWAYS;
+        return 0;
+    }
+    if (strncmp(text, "changed", 7) == 0) {
+        point->Cond = WATCH_CHANGED;
+        return 0;
+    }
+    if (*text == '&') {
+        unsigned long mask = strtoul(text + 1, &end, 0);
+        if (end == text + 1 || mask > 0xFF) {
+            return -1;
+        }
+        point->Mask = mask;
+        text = end;
+        while (isspace((unsigned char) *text)) {
+            text++;
+        }
+    }
+    if (strncmp(text, "==", 2) == 0) {
+        point->Cond = WATCH_EQ;
+        text += 2;
+    } else if (strncmp(text, "!=", 2) == 0) {
+        point->Cond = WATCH_NE;
+        text += 2;
+    } else if (*text == '<') {
+        point->Cond = WATCH_LT;
+        text++;
+    } else if (*text == '>') {
+        point->Cond = WATCH_GT;
+        text++;
+    } else {
+        return -1;
+    }
+    unsigned long operand = strtoul(text, &end, 0);
+    if (end == text || operand > 0xFF) {
+        return -1;
+    }
+    point->Operand = operand;
+    return 0;
+}
+
+static int Watch_Match(const struct Watch_Point *point, Byte value, Byte old) {
+    Byte masked = value & point->Mask;
+    switch (point->Cond) {
+        case WATCH_EQ:
+            return masked == point->Operand;
+        case WATCH_NE:
+            return masked != point->Operand;
+        case WATCH_LT:
+            return masked < point->Operand;
+        case WATCH_GT:
+            return masked > point->Operand;
+        case WATCH_CHANGED:
+            return value != old;
+        default:
+            return 1;
+    }
+}
+
+/**
+ * 检查所有观察点, 依次调用命中的回调
+ * @return 是否要让 CPU 停下
+ */
+static int Watch_Check(struct Watch *watch, Short addr, Byte value, Byte old, Byte kind) {
+    int stop = 0;
+    for (int i = 0; i < WATCH_MAX; ++i) {
+        struct Watch_Point *point = &watch->Points[i];
+        if (!point->Used || !(point->Kind & kind) || addr < point->Start || addr > point->End
+            || !Watch_Match(point, value, old)) {
+            continue;
+        }
+        struct Watch_Hit hit = {i, addr, kind, value, old, CPU.Cycles + CPU.INS_Cycles};
+        point->Count++;
+        METRICS_COUNT(CPU_Current, METRIC_WATCH_HITS, 1);
+        if (!point->Hit || point->Hit(point->Ctx, &hit)) {
+            watch->Last = hit;
+            stop = 1;
+        }
+    }
+    return stop;
+}
+
+void Watch_Access(struct Watch *watch, Short addr, Byte value, Byte kind) {
+    Byte old = kind == WATCH_WRITE ? Bus_Peek(watch->Bus, addr) : value;
+    if (Watch_Check(watch, addr, value, old, kind)) {
+        CPU_Break(CPU_BREAK_WATCH);
+    }
+}
+
+int Watch_Exec(struct Watch *watch, Short pc) {
+    //刚在这里停下, 恢复执行时先执行这条指令
+    if (watch->Stop_Cpu == CPU_Current && watch->Stop_PC == pc && watch->Stop_Cycles == CPU.Cycles) {
+        watch->Stop_Cpu = NULL;
+        return 0;
+    }
+    Byte opcode = Bus_Peek(watch->Bus, pc);
+    if (!Watch_Check(watch, pc, opcode, opcode, WATCH_EXEC)) {
+        return 0;
+    }
+    watch->Stop_Cpu = CPU_Current;
+    watch->Stop_PC = pc;
+    watch->Stop_Cycles = CPU.Cycles;
+    CPU_Break(CPU_BREAK_WATCH);
+    return 1;
+}
+
+int Watch_Trace(void *ctx, const struct Watch_Hit *hit) {
+    static const char kinds[] = {'?', 'R', 'W', '?', 'X'};
+    fprintf(ctx, "%llu %c $%04X %02X\n", hit->Cycles, kinds[hit->Kind], hit->Addr, hit->Value);
+    return 0;
+}